@@ -381,6 +381,40 @@ dtl_ast_to_ir_expression_name(struct dtl_ast_node *expression_node) {
     return NULL;
 }
 
+static struct dtl_ir_ref
+dtl_ast_to_ir_compile_literal_expression(
+    struct dtl_ast_to_ir_context *context,
+    struct dtl_ast_to_ir_scope *scope,
+    struct dtl_ast_node *expression_node,
+    struct dtl_error **error
+) {
+    struct dtl_ast_node *value_node;
+    struct dtl_ir_ref shape;
+
+    assert(context != NULL);
+    assert(dtl_ast_node_is_literal_expression(expression_node));
+
+    // Literals are broadcast to the shape of the columns that they are evaluated alongside.
+    if (scope->num_columns == 0) {
+        dtl_set_error(error, dtl_error_create("literal has no obvious shape"));
+        dtl_ast_to_ir_shrink_error(error, expression_node);
+        return DTL_IR_NULL_REF;
+    }
+    shape = dtl_ir_array_expression_get_shape(context->graph, scope->columns[0].expression);
+
+    value_node = dtl_ast_literal_expression_node_get_value(expression_node);
+
+    if (dtl_ast_node_is_int_literal(value_node)) {
+        return dtl_ir_int64_constant_expression_create(
+            context->graph, shape, dtl_ast_int_literal_node_get_value(value_node)
+        );
+    }
+
+    dtl_set_error(error, dtl_error_create("unsupported literal type"));
+    dtl_ast_to_ir_shrink_error(error, expression_node);
+    return DTL_IR_NULL_REF;
+}
+
 static struct dtl_ir_ref
 dtl_ast_to_ir_compile_column_reference_expression(
     struct dtl_ast_to_ir_context *context,
@@ -758,7 +792,7 @@ dtl_ast_to_ir_compile_expression(
     }
 
     if (dtl_ast_node_is_literal_expression(expression_node)) {
-        assert(false);
+        return dtl_ast_to_ir_compile_literal_expression(context, scope, expression_node, error);
     }
 
     if (dtl_ast_node_is_function_call_expression(expression_node)) {
@@ -1,22 +1,31 @@
 #include "dtl-eval.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xxhash.h>
 
 #include "dtl-ast-to-ir.h"
 #include "dtl-ast.h"
 #include "dtl-bool-array.h"
+#include "dtl-double-array.h"
 #include "dtl-dtype.h"
 #include "dtl-error.h"
 #include "dtl-index-array.h"
 #include "dtl-int64-array.h"
 #include "dtl-io.h"
-#include "dtl-ir-viz.h"
 #include "dtl-ir.h"
 #include "dtl-location.h"
 #include "dtl-parser.h"
@@ -44,6 +53,22 @@ struct dtl_eval_context_trace {
     struct dtl_ir_ref *expressions;
 };
 
+// A comparison against a constant that can be handed to an imported table so that it can skip
+// reading rows that will be filtered out.  Found once at compile time, and applied to the tables
+// opened for each execution.
+struct dtl_eval_context_predicate {
+    size_t import;
+    size_t column;
+    enum dtl_io_predicate_op op;
+    int64_t value;
+};
+
+// Passed to the tracer along with each traced value, so that it can release its reference.
+struct dtl_eval_context_release {
+    struct dtl_eval_context *context;
+    size_t index;
+};
+
 struct dtl_eval_context {
     struct dtl_io_importer *importer;
     struct dtl_io_exporter *exporter;
@@ -60,7 +85,15 @@ struct dtl_eval_context {
     size_t num_traces;
     struct dtl_eval_context_trace *traces;
 
+    size_t num_predicates;
+    struct dtl_eval_context_predicate *predicates;
+
     struct dtl_value *values;
+
+    // Number of expressions, exports and tracers still to use each value.  Arrays are freed as
+    // soon as this drops to zero.
+    atomic_size_t *refcounts;
+    struct dtl_eval_context_release *releases;
 };
 
 /* --- Load ------------------------------------------------------------------------------------- */
@@ -97,7 +130,6 @@ dtl_eval_context_load_index_array(struct dtl_eval_context *context, struct dtl_i
     return dtl_value_get_index_array(&context->values[index]);
 }
 
-/*
 static double *
 dtl_eval_context_load_double_array(struct dtl_eval_context *context, struct dtl_ir_ref expression) {
     size_t index;
@@ -106,6 +138,7 @@ dtl_eval_context_load_double_array(struct dtl_eval_context *context, struct dtl_
     return dtl_value_get_double_array(&context->values[index]);
 }
 
+/*
 static char **
 dtl_eval_context_load_string_array(struct dtl_eval_context *context, struct dtl_ir_ref expression) {
     size_t index;
@@ -153,6 +186,18 @@ dtl_eval_context_store_int64_array(
     dtl_value_take_int64_array(&context->values[index], array);
 }
 
+static void
+dtl_eval_context_store_double_array(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    double *array
+) {
+    size_t index;
+    assert(dtl_ir_expression_get_dtype(context->graph, expression) == DTL_DTYPE_DOUBLE_ARRAY);
+    index = dtl_ir_ref_to_index(context->graph, expression);
+    dtl_value_take_double_array(&context->values[index], array);
+}
+
 static void
 dtl_eval_context_store_index_array(
     struct dtl_eval_context *context,
@@ -176,6 +221,12 @@ dtl_eval_context_clear(
     size_t index;
     struct dtl_value *value;
 
+    // Column data is owned by the table it was read from, and is released when the table is
+    // destroyed.
+    if (dtl_ir_is_read_column_expression(context->graph, expression)) {
+        return;
+    }
+
     index = dtl_ir_ref_to_index(context->graph, expression);
     value = &context->values[index];
 
@@ -217,6 +268,150 @@ dtl_eval_context_clear(
     }
 }
 
+/* --- Release ---------------------------------------------------------------------------------- */
+
+static void
+dtl_eval_context_release(struct dtl_eval_context *context, struct dtl_ir_ref expression) {
+    size_t index;
+
+    index = dtl_ir_ref_to_index(context->graph, expression);
+    assert(context->refcounts[index] > 0);
+    if (atomic_fetch_sub(&context->refcounts[index], 1) != 1) {
+        return;
+    }
+
+    // Scalars are cheap, and shapes are still read after the arrays that depend on them have been
+    // evaluated, so only arrays are cleared early.
+    if (dtl_dtype_is_array_type(dtl_ir_expression_get_dtype(context->graph, expression))) {
+        dtl_eval_context_clear(context, expression);
+    }
+}
+
+// Called by the tracer, possibly from another thread, once it has finished with a traced value.
+static void
+dtl_eval_context_release_traced(void *user_data) {
+    struct dtl_eval_context_release *release = (struct dtl_eval_context_release *)user_data;
+    struct dtl_eval_context *context = release->context;
+
+    dtl_eval_context_release(context, dtl_ir_index_to_ref(context->graph, release->index));
+}
+
+/* === Prefetching ============================================================================== */
+
+// Opening a table can mean reading and decoding a sizeable amount of metadata, so rather than
+// wait for the compiler to ask for each table in turn we open every table that the script
+// imports up front, concurrently.  The import callback then picks up the already open tables.
+// Compiled programs open their tables the same way at the start of each execution.
+
+struct dtl_eval_prefetch_job {
+    struct dtl_io_importer *importer;
+    struct dtl_eval_context_import *import;
+    pthread_t thread;
+    bool started;
+};
+
+static void
+dtl_eval_prefetch_collect_imports(struct dtl_eval_context *context, struct dtl_ast_node *node) {
+    struct dtl_ast_node *path_expression;
+    char const *path;
+    size_t i;
+
+    // Optional clauses are represented by NULL children.
+    if (node == NULL) {
+        return;
+    }
+
+    if (dtl_ast_node_is_import_expression(node)) {
+        path_expression = dtl_ast_import_expression_node_get_path(node);
+        if (!dtl_ast_node_is_string_literal(path_expression)) {
+            return;
+        }
+
+        path = dtl_ast_string_literal_node_get_value(path_expression);
+        path = dtl_ir_graph_intern(context->graph, path);
+
+        // Tables can already have been opened under names that were not interned by this graph,
+        // so names are compared by value and then replaced with the interned copy.
+        for (i = 0; i < context->num_imports; i++) {
+            if (strcmp(context->imports[i].name, path) == 0) {
+                context->imports[i].name = path;
+                return;
+            }
+        }
+
+        context->num_imports += 1;
+        context->imports = realloc(
+            context->imports, sizeof(struct dtl_eval_context_import) * context->num_imports
+        );
+        context->imports[context->num_imports - 1] = (struct dtl_eval_context_import){
+            .name = path,
+            .table = NULL,
+        };
+        return;
+    }
+
+    if (!dtl_ast_node_has_children(node)) {
+        return;
+    }
+
+    for (i = 0; i < dtl_ast_node_get_num_children(node); i++) {
+        dtl_eval_prefetch_collect_imports(context, dtl_ast_node_get_child(node, i));
+    }
+}
+
+static void *
+dtl_eval_prefetch_thread(void *user_data) {
+    struct dtl_eval_prefetch_job *job = (struct dtl_eval_prefetch_job *)user_data;
+    struct dtl_error *error = NULL;
+
+    // Errors are discarded here.  A table that fails to open is left as NULL and opened again by
+    // the import callback, which reports the error with the location of the import, or by
+    // `dtl_program_execute`.
+    job->import->table = dtl_io_importer_import_table(job->importer, job->import->name, &error);
+    dtl_error_destroy(error);
+
+    return NULL;
+}
+
+static void
+dtl_eval_prefetch_tables(struct dtl_eval_context *context) {
+    struct dtl_eval_prefetch_job *jobs;
+    size_t num_jobs = 0;
+    size_t i;
+
+    jobs = calloc(context->num_imports > 0 ? context->num_imports : 1, sizeof(struct dtl_eval_prefetch_job));
+    for (i = 0; i < context->num_imports; i++) {
+        if (context->imports[i].table != NULL) {
+            continue;
+        }
+        jobs[num_jobs].importer = context->importer;
+        jobs[num_jobs].import = &context->imports[i];
+        num_jobs += 1;
+    }
+
+    if (num_jobs < 2) {
+        free(jobs);
+        return; // Nothing to be gained from a thread.
+    }
+
+    for (i = 0; i < num_jobs; i++) {
+        jobs[i].started = pthread_create(&jobs[i].thread, NULL, dtl_eval_prefetch_thread, &jobs[i]) == 0;
+    }
+
+    for (i = 0; i < num_jobs; i++) {
+        if (jobs[i].started) {
+            pthread_join(jobs[i].thread, NULL);
+        }
+    }
+    free(jobs);
+}
+
+static void
+dtl_eval_prefetch_imports(struct dtl_eval_context *context, struct dtl_ast_node *root) {
+    dtl_eval_prefetch_collect_imports(context, root);
+    dtl_eval_prefetch_tables(context);
+}
+
 /* === Compilation ============================================================================== */
 
 static struct dtl_schema *
@@ -250,6 +445,10 @@ dtl_eval_ast_to_ir_import_callback(
         import = &context->imports[context->num_imports - 1];
 
         import->name = table_name;
+        import->table = NULL;
+    }
+
+    if (import->table == NULL) {
         import->table = dtl_io_importer_import_table(context->importer, table_name, error);
         if (import->table == NULL) {
             return NULL;
@@ -306,6 +505,68 @@ dtl_eval_ast_to_ir_trace_callback(
 
 /* === Operations =============================================================================== */
 
+/* --- Constant Operations ---------------------------------------------------------------------- */
+
+static enum dtl_status
+dtl_eval_int64_constant_expression(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    struct dtl_error **error
+) {
+    struct dtl_ir_ref shape_expression;
+    size_t shape;
+    int64_t value;
+    int64_t *data;
+
+    (void)error;
+
+    assert(context != NULL);
+    assert(dtl_ir_is_int64_constant_expression(context->graph, expression));
+
+    shape_expression = dtl_ir_array_expression_get_shape(context->graph, expression);
+    shape = dtl_eval_context_load_index(context, shape_expression);
+
+    value = dtl_ir_int64_constant_expression_get_value(context->graph, expression);
+
+    data = dtl_int64_array_create(shape);
+    for (size_t i = 0; i < shape; i++) {
+        dtl_int64_array_set(data, i, value);
+    }
+
+    dtl_eval_context_store_int64_array(context, expression, data);
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_eval_double_constant_expression(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    struct dtl_error **error
+) {
+    struct dtl_ir_ref shape_expression;
+    size_t shape;
+    double value;
+    double *data;
+
+    (void)error;
+
+    assert(context != NULL);
+    assert(dtl_ir_is_double_constant_expression(context->graph, expression));
+
+    shape_expression = dtl_ir_array_expression_get_shape(context->graph, expression);
+    shape = dtl_eval_context_load_index(context, shape_expression);
+
+    value = dtl_ir_double_constant_expression_get_value(context->graph, expression);
+
+    data = dtl_double_array_create(shape);
+    for (size_t i = 0; i < shape; i++) {
+        dtl_double_array_set(data, i, value);
+    }
+
+    dtl_eval_context_store_double_array(context, expression, data);
+    return DTL_STATUS_OK;
+}
+
 /* --- Import Operations ------------------------------------------------------------------------ */
 
 static enum dtl_status
@@ -389,8 +650,6 @@ dtl_eval_read_column_expression(
 
     column_name = dtl_ir_read_column_expression_get_column_name(context->graph, expression);
 
-    assert(dtl_ir_expression_get_dtype(context->graph, expression) == DTL_DTYPE_INT64_ARRAY); // TODO
-
     for (i = 0; i < dtl_schema_get_num_columns(schema); i++) {
         if (strcmp(dtl_schema_get_column_name(schema, i), column_name) == 0) {
             status = dtl_io_table_read_column_data(table, i, &value, error);
@@ -402,7 +661,20 @@ dtl_eval_read_column_expression(
         }
     }
 
-    dtl_eval_context_store_int64_array(context, expression, value.as_int64_array);
+    switch (dtl_ir_expression_get_dtype(context->graph, expression)) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        dtl_eval_context_store_bool_array(context, expression, value.as_bool_array);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        dtl_eval_context_store_int64_array(context, expression, value.as_int64_array);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        dtl_eval_context_store_double_array(context, expression, value.as_double_array);
+        break;
+    default:
+        assert(false); // TODO
+    }
+
     return DTL_STATUS_OK;
 }
 
@@ -889,408 +1161,2646 @@ dtl_eval_add_expression(
     return DTL_STATUS_OK;
 }
 
-/* === Tracing ================================================================================== */
-
-static enum dtl_status
-dtl_eval_tracing_record_import_metadata(struct dtl_eval_context *context, struct dtl_error **error) {
-    (void)context;
-    (void)error;
-
-    return DTL_STATUS_OK;
-}
-
-static enum dtl_status
-dtl_eval_tracing_record_export_metadata(struct dtl_eval_context *context, struct dtl_error **error) {
+/* === Predicate Push Down ====================================================================== */
+
+// Comparisons between a column read straight from a table and a constant can be handed to the
+// table, which may then be able to skip reading rows that the comparison would reject.  This is
+// only safe if nothing can observe the rows that get dropped:  every use of the table's columns
+// must be either the comparison itself or a `WHERE` filtered by it, and none of them can be
+// exported or traced.  Predicates are also not applied when a tracer is attached, as mappings
+// record rows by their position in the table that was read.
+//
+// DTL has no `AND`, so a range is filtered with two chained `WHERE`s.  Only the inner one compares a
+// column read straight from the table, so only it is pushed down.  The outer bound is evaluated as
+// normal, and can't be used to skip anything.
+
+static bool
+dtl_eval_push_down_is_root(struct dtl_eval_context *context, struct dtl_ir_ref expression) {
     size_t i;
     size_t j;
-    struct dtl_eval_context_export *export;
-    uint64_t *array_ids;
-    enum dtl_status status;
-
-    if (context->tracer == NULL) {
-        return DTL_STATUS_OK;
-    }
 
     for (i = 0; i < context->num_exports; i++) {
-        export = &context->exports[context->num_exports - 1];
-
-        array_ids = calloc(dtl_schema_get_num_columns(export->schema), sizeof(uint64_t));
-        for (j = 0; j < dtl_schema_get_num_columns(export->schema); j++) {
-            array_ids[j] = dtl_ir_ref_to_index(context->graph, export->expressions[j]);
+        for (j = 0; j < dtl_schema_get_num_columns(context->exports[i].schema); j++) {
+            if (dtl_ir_ref_equal(context->graph, context->exports[i].expressions[j], expression)) {
+                return true;
+            }
         }
+    }
 
-        status = dtl_io_tracer_record_output(context->tracer, export->name, export->schema, array_ids, error);
-        if (status != DTL_STATUS_OK) {
-            return status;
+    // Push down happens at compile time, before we know whether the program will be executed with
+    // a tracer, so traced expressions are always treated as roots.
+    for (i = 0; i < context->num_traces; i++) {
+        for (j = 0; j < dtl_schema_get_num_columns(context->traces[i].schema); j++) {
+            if (dtl_ir_ref_equal(context->graph, context->traces[i].expressions[j], expression)) {
+                return true;
+            }
         }
-        free(array_ids);
     }
 
-    return DTL_STATUS_OK;
+    return false;
 }
 
-static enum dtl_status
-dtl_eval_tracing_record_trace_metadata(struct dtl_eval_context *context, struct dtl_error **error) {
-    size_t i;
-    size_t j;
-    struct dtl_eval_context_trace *trace;
-    uint64_t *array_ids;
-    enum dtl_status status;
-
-    if (context->tracer == NULL) {
-        return DTL_STATUS_OK;
+// A file can be imported more than once, so tables are identified by path rather than by their
+// open table expression.
+static bool
+dtl_eval_push_down_is_table(struct dtl_eval_context *context, struct dtl_ir_ref expression, char const *path) {
+    if (!dtl_ir_is_open_table_expression(context->graph, expression)) {
+        return false;
     }
+    return dtl_ir_open_table_expression_get_path(context->graph, expression) == path; // Interned.
+}
 
-    for (i = 0; i < context->num_traces; i++) {
-        trace = &context->traces[context->num_traces - 1];
-
-        array_ids = calloc(dtl_schema_get_num_columns(trace->schema), sizeof(uint64_t));
-        for (j = 0; j < dtl_schema_get_num_columns(trace->schema); j++) {
-            array_ids[j] = dtl_ir_ref_to_index(context->graph, trace->expressions[j]);
-        }
+static bool
+dtl_eval_push_down_is_table_shape(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    char const *path
+) {
+    if (!dtl_ir_is_table_shape_expression(context->graph, expression)) {
+        return false;
+    }
+    return dtl_eval_push_down_is_table(
+        context, dtl_ir_table_shape_expression_get_table(context->graph, expression), path
+    );
+}
 
-        status = dtl_io_tracer_record_trace(context->tracer, trace->start, trace->end, trace->schema, array_ids, error);
-        if (status != DTL_STATUS_OK) {
-            return status;
-        }
-        free(array_ids);
+static bool
+dtl_eval_push_down_is_table_column(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    char const *path
+) {
+    if (!dtl_ir_is_read_column_expression(context->graph, expression)) {
+        return false;
     }
+    return dtl_eval_push_down_is_table(
+        context, dtl_ir_read_column_expression_get_table(context->graph, expression), path
+    );
+}
 
-    return DTL_STATUS_OK;
+static bool
+dtl_eval_push_down_is_filtered_by(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    struct dtl_ir_ref mask
+) {
+    if (!dtl_ir_is_where_expression(context->graph, expression)) {
+        return false;
+    }
+    return dtl_ir_ref_equal(context->graph, dtl_ir_where_expression_get_mask(context->graph, expression), mask);
 }
 
-static void *
-dtl_eval_tracing_mark_dependencies(struct dtl_eval_context *context) {
+static bool
+dtl_eval_push_down_is_safe(
+    struct dtl_eval_context *context,
+    char const *path,
+    struct dtl_ir_ref mask,
+    struct dtl_ir_ref constant
+) {
+    struct dtl_ir_graph *graph = context->graph;
+    struct dtl_ir_ref expression;
+    struct dtl_ir_ref dependency;
     size_t i;
     size_t j;
-    struct dtl_eval_context_trace *trace;
-    void *mask;
-
-    if (context->tracer == NULL) {
-        return NULL;
-    }
-
-    mask = dtl_bool_array_create(dtl_ir_graph_get_size(context->graph));
+    bool ok;
+
+    for (i = 0; i < dtl_ir_graph_get_size(graph); i++) {
+        expression = dtl_ir_index_to_ref(graph, i);
+
+        if (
+            dtl_eval_push_down_is_table_column(context, expression, path) ||
+            dtl_ir_ref_equal(graph, expression, mask) ||
+            dtl_ir_ref_equal(graph, expression, constant)
+        ) {
+            if (dtl_eval_push_down_is_root(context, expression)) {
+                return false;
+            }
+        }
 
-    for (i = 0; i < context->num_traces; i++) {
-        trace = &context->traces[context->num_traces - 1];
+        for (j = 0; j < dtl_ir_expression_get_num_dependencies(graph, expression); j++) {
+            dependency = dtl_ir_expression_get_dependency(graph, expression, j);
+
+            if (dtl_eval_push_down_is_table(context, dependency, path)) {
+                ok = dtl_eval_push_down_is_table_shape(context, expression, path) ||
+                     dtl_eval_push_down_is_table_column(context, expression, path);
+            } else if (dtl_eval_push_down_is_table_shape(context, dependency, path)) {
+                ok = dtl_eval_push_down_is_table_column(context, expression, path) ||
+                     dtl_ir_ref_equal(graph, expression, mask) ||
+                     dtl_ir_ref_equal(graph, expression, constant);
+            } else if (dtl_eval_push_down_is_table_column(context, dependency, path)) {
+                ok = dtl_ir_ref_equal(graph, expression, mask) ||
+                     dtl_eval_push_down_is_filtered_by(context, expression, mask);
+            } else if (dtl_ir_ref_equal(graph, dependency, mask)) {
+                ok = dtl_ir_is_where_shape_expression(graph, expression) ||
+                     dtl_eval_push_down_is_filtered_by(context, expression, mask);
+            } else {
+                continue;
+            }
 
-        for (j = 0; j < dtl_schema_get_num_columns(trace->schema); j++) {
-            dtl_bool_array_set(mask, dtl_ir_ref_to_index(context->graph, trace->expressions[j]), true);
+            if (!ok) {
+                return false;
+            }
         }
     }
 
-    return mask;
+    return true;
 }
 
-/* === Eval ===================================================================================== */
-
-static enum dtl_status
-dtl_eval_expression(
+static bool
+dtl_eval_push_down_match(
     struct dtl_eval_context *context,
     struct dtl_ir_ref expression,
-    struct dtl_error **error
+    struct dtl_ir_ref *column,
+    struct dtl_ir_ref *constant,
+    enum dtl_io_predicate_op *op
 ) {
-    struct dtl_ir_graph *graph;
-    enum dtl_status (*eval)(struct dtl_eval_context *, struct dtl_ir_ref, struct dtl_error **) = NULL;
+    struct dtl_ir_graph *graph = context->graph;
+    struct dtl_ir_ref left;
+    struct dtl_ir_ref right;
+    enum dtl_io_predicate_op flipped_op;
 
-    assert(context != NULL);
-    graph = context->graph;
-
-    if (dtl_ir_is_table_shape_expression(graph, expression)) {
-        eval = dtl_eval_table_shape_expression;
+    if (dtl_ir_is_equal_to_expression(graph, expression)) {
+        left = dtl_ir_equal_to_expression_left(graph, expression);
+        right = dtl_ir_equal_to_expression_right(graph, expression);
+        *op = DTL_IO_PREDICATE_EQUAL_TO;
+        flipped_op = DTL_IO_PREDICATE_EQUAL_TO;
+    } else if (dtl_ir_is_less_than_expression(graph, expression)) {
+        left = dtl_ir_less_than_expression_left(graph, expression);
+        right = dtl_ir_less_than_expression_right(graph, expression);
+        *op = DTL_IO_PREDICATE_LESS_THAN;
+        flipped_op = DTL_IO_PREDICATE_GREATER_THAN;
+    } else if (dtl_ir_is_less_than_or_equal_to_expression(graph, expression)) {
+        left = dtl_ir_less_than_or_equal_to_expression_left(graph, expression);
+        right = dtl_ir_less_than_or_equal_to_expression_right(graph, expression);
+        *op = DTL_IO_PREDICATE_LESS_THAN_OR_EQUAL_TO;
+        flipped_op = DTL_IO_PREDICATE_GREATER_THAN_OR_EQUAL_TO;
+    } else if (dtl_ir_is_greater_than_expression(graph, expression)) {
+        left = dtl_ir_greater_than_expression_left(graph, expression);
+        right = dtl_ir_greater_than_expression_right(graph, expression);
+        *op = DTL_IO_PREDICATE_GREATER_THAN;
+        flipped_op = DTL_IO_PREDICATE_LESS_THAN;
+    } else if (dtl_ir_is_greater_than_or_equal_to_expression(graph, expression)) {
+        left = dtl_ir_greater_than_or_equal_to_expression_left(graph, expression);
+        right = dtl_ir_greater_than_or_equal_to_expression_right(graph, expression);
+        *op = DTL_IO_PREDICATE_GREATER_THAN_OR_EQUAL_TO;
+        flipped_op = DTL_IO_PREDICATE_LESS_THAN_OR_EQUAL_TO;
+    } else {
+        return false;
     }
 
-    if (dtl_ir_is_where_shape_expression(graph, expression)) {
-        eval = dtl_eval_where_shape_expression;
+    if (dtl_ir_is_read_column_expression(graph, left) && dtl_ir_is_int64_constant_expression(graph, right)) {
+        *column = left;
+        *constant = right;
+        return true;
     }
 
-    if (dtl_ir_is_join_shape_expression(graph, expression)) {
-        eval = dtl_eval_join_shape_expression;
+    if (dtl_ir_is_int64_constant_expression(graph, left) && dtl_ir_is_read_column_expression(graph, right)) {
+        *column = right;
+        *constant = left;
+        *op = flipped_op;
+        return true;
     }
 
-    if (dtl_ir_is_int64_constant_expression(graph, expression)) {
-        assert(false); // Not implemented.
+    return false;
+}
+
+static void
+dtl_eval_push_down_predicates(struct dtl_eval_context *context) {
+    struct dtl_ir_graph *graph = context->graph;
+    struct dtl_ir_ref expression;
+    struct dtl_ir_ref column;
+    struct dtl_ir_ref constant;
+    struct dtl_ir_ref table_expression;
+    enum dtl_io_predicate_op op;
+    char const *path;
+    char const *column_name;
+    size_t import;
+    struct dtl_schema *schema;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < dtl_ir_graph_get_size(graph); i++) {
+        expression = dtl_ir_index_to_ref(graph, i);
+
+        if (!dtl_eval_push_down_match(context, expression, &column, &constant, &op)) {
+            continue;
+        }
+
+        table_expression = dtl_ir_read_column_expression_get_table(graph, column);
+        path = dtl_ir_open_table_expression_get_path(graph, table_expression);
+        if (!dtl_eval_push_down_is_safe(context, path, expression, constant)) {
+            continue;
+        }
+
+        for (import = 0; import < context->num_imports; import++) {
+            if (path == context->imports[import].name) { // Interned.
+                break;
+            }
+        }
+        assert(import < context->num_imports);
+
+        schema = dtl_io_table_get_schema(context->imports[import].table);
+        column_name = dtl_ir_read_column_expression_get_column_name(graph, column);
+        for (j = 0; j < dtl_schema_get_num_columns(schema); j++) {
+            if (strcmp(dtl_schema_get_column_name(schema, j), column_name) == 0) {
+                break;
+            }
+        }
+        assert(j < dtl_schema_get_num_columns(schema));
+
+        context->num_predicates += 1;
+        context->predicates = realloc(
+            context->predicates, sizeof(struct dtl_eval_context_predicate) * context->num_predicates
+        );
+        context->predicates[context->num_predicates - 1] = (struct dtl_eval_context_predicate){
+            .import = import,
+            .column = j,
+            .op = op,
+            .value = dtl_ir_int64_constant_expression_get_value(graph, constant),
+        };
+    }
+}
+
+static enum dtl_status
+dtl_eval_apply_predicates(struct dtl_eval_context *context, struct dtl_error **error) {
+    struct dtl_eval_context_predicate *predicate;
+    size_t i;
+    enum dtl_status status;
+
+    for (i = 0; i < context->num_predicates; i++) {
+        predicate = &context->predicates[i];
+
+        assert(predicate->import < context->num_imports);
+        status = dtl_io_table_add_predicate(
+            context->imports[predicate->import].table, predicate->column, predicate->op, predicate->value, error
+        );
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+    }
+
+    return DTL_STATUS_OK;
+}
+
+/* === Exports ================================================================================== */
+
+// Each table is exported on its own thread as soon as the last of its columns has been evaluated,
+// so that writing overlaps with evaluation of the rest of the graph and with other exports.  Later
+// exports to the same name must still win, so they wait for earlier ones to finish first.
+
+struct dtl_eval_export_job {
+    struct dtl_io_exporter *exporter;
+    struct dtl_eval_context_export *export;
+
+    // Number of expressions, in evaluation order, that need to be evaluated before the export can
+    // start.
+    size_t num_dependencies;
+
+    size_t num_rows;
+    struct dtl_value **values;
+
+    pthread_t thread;
+    bool started;
+    bool threaded;
+    bool joined;
+
+    enum dtl_status status;
+    struct dtl_error *error;
+};
+
+static struct dtl_eval_export_job *
+dtl_eval_export_jobs_create(struct dtl_eval_context *context) {
+    struct dtl_eval_export_job *jobs;
+    struct dtl_eval_export_job *job;
+    size_t i;
+    size_t j;
+    size_t index;
+
+    jobs = calloc(context->num_exports > 0 ? context->num_exports : 1, sizeof(struct dtl_eval_export_job));
+
+    for (i = 0; i < context->num_exports; i++) {
+        job = &jobs[i];
+        job->exporter = context->exporter;
+        job->export = &context->exports[i];
+
+        for (j = 0; j < dtl_schema_get_num_columns(job->export->schema); j++) {
+            index = dtl_ir_ref_to_index(context->graph, job->export->expressions[j]);
+            if (index + 1 > job->num_dependencies) {
+                job->num_dependencies = index + 1;
+            }
+        }
+
+        for (j = 0; j < i; j++) {
+            if (strcmp(jobs[j].export->name, job->export->name) != 0) {
+                continue;
+            }
+            if (jobs[j].num_dependencies > job->num_dependencies) {
+                job->num_dependencies = jobs[j].num_dependencies;
+            }
+        }
+    }
+
+    return jobs;
+}
+
+static void *
+dtl_eval_export_thread(void *user_data) {
+    struct dtl_eval_export_job *job = (struct dtl_eval_export_job *)user_data;
+
+    job->status = dtl_io_exporter_export_table(
+        job->exporter,
+        job->export->name,
+        job->export->schema,
+        job->num_rows,
+        job->values,
+        &job->error
+    );
+
+    return NULL;
+}
+
+static void
+dtl_eval_export_join(struct dtl_eval_export_job *job) {
+    if (job->threaded && !job->joined) {
+        pthread_join(job->thread, NULL);
+    }
+    job->joined = true;
+}
+
+static void
+dtl_eval_export_start(struct dtl_eval_context *context, struct dtl_eval_export_job *jobs, size_t job_index) {
+    struct dtl_eval_export_job *job = &jobs[job_index];
+    size_t num_cols;
+    struct dtl_ir_ref shape_expression;
+    size_t index;
+
+    assert(!job->started);
+
+    for (size_t j = 0; j < job_index; j++) {
+        if (strcmp(jobs[j].export->name, job->export->name) == 0) {
+            assert(jobs[j].started);
+            dtl_eval_export_join(&jobs[j]);
+        }
+    }
+
+    num_cols = dtl_schema_get_num_columns(job->export->schema);
+    job->num_rows = 0;
+    if (num_cols > 0) {
+        shape_expression = dtl_ir_array_expression_get_shape(context->graph, job->export->expressions[0]);
+        job->num_rows = dtl_eval_context_load_index(context, shape_expression);
+    }
+
+    job->values = calloc(num_cols > 0 ? num_cols : 1, sizeof(struct dtl_value *));
+    for (size_t j = 0; j < num_cols; j++) {
+        index = dtl_ir_ref_to_index(context->graph, job->export->expressions[j]);
+        job->values[j] = &context->values[index];
+    }
+
+    job->started = true;
+    job->threaded = pthread_create(&job->thread, NULL, dtl_eval_export_thread, job) == 0;
+    if (!job->threaded) {
+        dtl_eval_export_thread(job);
+    }
+}
+
+static enum dtl_status
+dtl_eval_export_jobs_finish(
+    struct dtl_eval_export_job *jobs,
+    size_t num_jobs,
+    struct dtl_error **error
+) {
+    enum dtl_status status = DTL_STATUS_OK;
+    size_t i;
+
+    for (i = 0; i < num_jobs; i++) {
+        if (!jobs[i].started) {
+            continue;
+        }
+
+        dtl_eval_export_join(&jobs[i]);
+        free(jobs[i].values);
+
+        // Only the first error is reported.  Callers that are already handling an error of their
+        // own pass NULL to discard them all.
+        if (jobs[i].status != DTL_STATUS_OK && status == DTL_STATUS_OK) {
+            status = jobs[i].status;
+            if (error != NULL) {
+                dtl_set_error(error, jobs[i].error);
+                continue;
+            }
+        }
+        dtl_error_destroy(jobs[i].error);
+    }
+
+    free(jobs);
+    return status;
+}
+
+/* === Tracing ================================================================================== */
+
+// Only columns that the script reads are recorded, as other columns have no array to refer to.
+static enum dtl_status
+dtl_eval_tracing_record_import_metadata(struct dtl_eval_context *context, struct dtl_error **error) {
+    struct dtl_ir_graph *graph;
+    struct dtl_ir_ref expression;
+    struct dtl_ir_ref table_expression;
+    struct dtl_schema *schema;
+    uint64_t *array_ids;
+    size_t num_columns;
+    size_t i;
+    size_t j;
+    enum dtl_status status;
+
+    if (context->tracer == NULL) {
+        return DTL_STATUS_OK;
+    }
+
+    graph = context->graph;
+
+    for (i = 0; i < context->num_imports; i++) {
+        schema = dtl_schema_create();
+        array_ids = calloc(dtl_ir_graph_get_size(graph) + 1, sizeof(uint64_t));
+        num_columns = 0;
+
+        for (j = 0; j < dtl_ir_graph_get_size(graph); j++) {
+            expression = dtl_ir_index_to_ref(graph, j);
+            if (!dtl_ir_is_read_column_expression(graph, expression)) {
+                continue;
+            }
+
+            table_expression = dtl_ir_read_column_expression_get_table(graph, expression);
+            if (dtl_ir_open_table_expression_get_path(graph, table_expression) != context->imports[i].name) { // Interned.
+                continue;
+            }
+
+            schema = dtl_schema_add_column(
+                schema,
+                dtl_ir_read_column_expression_get_column_name(graph, expression),
+                dtl_ir_expression_get_dtype(graph, expression)
+            );
+            array_ids[num_columns++] = j;
+        }
+
+        status = dtl_io_tracer_record_input(context->tracer, context->imports[i].name, schema, array_ids, error);
+        dtl_schema_destroy(schema);
+        free(array_ids);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_eval_tracing_record_export_metadata(struct dtl_eval_context *context, struct dtl_error **error) {
+    size_t i;
+    size_t j;
+    struct dtl_eval_context_export *export;
+    uint64_t *array_ids;
+    enum dtl_status status;
+
+    if (context->tracer == NULL) {
+        return DTL_STATUS_OK;
+    }
+
+    for (i = 0; i < context->num_exports; i++) {
+        export = &context->exports[i];
+
+        array_ids = calloc(dtl_schema_get_num_columns(export->schema), sizeof(uint64_t));
+        for (j = 0; j < dtl_schema_get_num_columns(export->schema); j++) {
+            array_ids[j] = dtl_ir_ref_to_index(context->graph, export->expressions[j]);
+        }
+
+        status = dtl_io_tracer_record_output(context->tracer, export->name, export->schema, array_ids, error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+        free(array_ids);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_eval_tracing_record_trace_metadata(struct dtl_eval_context *context, struct dtl_error **error) {
+    size_t i;
+    size_t j;
+    struct dtl_eval_context_trace *trace;
+    uint64_t *array_ids;
+    enum dtl_status status;
+
+    if (context->tracer == NULL) {
+        return DTL_STATUS_OK;
+    }
+
+    for (i = 0; i < context->num_traces; i++) {
+        trace = &context->traces[i];
+
+        array_ids = calloc(dtl_schema_get_num_columns(trace->schema), sizeof(uint64_t));
+        for (j = 0; j < dtl_schema_get_num_columns(trace->schema); j++) {
+            array_ids[j] = dtl_ir_ref_to_index(context->graph, trace->expressions[j]);
+        }
+
+        status = dtl_io_tracer_record_trace(context->tracer, trace->start, trace->end, trace->schema, array_ids, error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+        free(array_ids);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static void *
+dtl_eval_tracing_mark_dependencies(struct dtl_eval_context *context) {
+    size_t i;
+    size_t j;
+    struct dtl_eval_context_trace *trace;
+    void *mask;
+
+    if (context->tracer == NULL) {
+        return NULL;
+    }
+
+    mask = dtl_bool_array_create(dtl_ir_graph_get_size(context->graph));
+
+    for (i = 0; i < context->num_traces; i++) {
+        trace = &context->traces[i];
+
+        for (j = 0; j < dtl_schema_get_num_columns(trace->schema); j++) {
+            dtl_bool_array_set(mask, dtl_ir_ref_to_index(context->graph, trace->expressions[j]), true);
+        }
+    }
+
+    return mask;
+}
+
+// Mappings link each exported and traced column back to the imported columns that its values were
+// read from.  They are found by walking down from the column through the graph, following the
+// sources of picks and wheres, and the operands of element-wise operations, which map rows to
+// themselves.  Each pick or where that is passed through adds a step to the chain of index arrays
+// that maps rows of the column to rows of the import.  Rather than recording every step, the chain
+// is composed into a single index array, so that a lookup costs one indirection however deep the
+// script.
+//
+// Compositions are shared between chains with a common prefix, which is the usual case for columns
+// of the same table.
+//
+// When the tracer asks for a sample, only exported columns are walked, and chains start from the
+// sampled rows of the column rather than from every row, so the cost of composing them scales with
+// the size of the sample.  Traced columns passed through on the way down are linked to the export
+// as well.  Traced values are then held until the end of the run, and only the rows that a mapping
+// passes through are recorded.
+
+// A composition of a `step` onto the end of the chain ending in `parent`.  Steps are either picks,
+// which gather from their index array, or wheres, which gather the positions of true values in
+// their mask.
+struct dtl_eval_tracing_composition {
+    size_t parent; // `SIZE_MAX` for the identity mapping.
+    struct dtl_ir_ref step;
+
+    uint64_t id;
+    size_t size;
+    size_t *indexes;
+    bool owned; // False if `indexes` is borrowed from the context.
+
+    // Compositions that are only a prefix of other chains are computed but not recorded.
+    bool used;
+};
+
+struct dtl_eval_tracing_mapping {
+    struct dtl_ir_ref source;
+    struct dtl_ir_ref target;
+    size_t composition; // `SIZE_MAX` for the identity mapping.
+};
+
+// The rows picked for tracing from an exported column with `size` rows.  Rows are picked by a hash
+// of their position alone, so that exports with the same number of rows, which may share
+// compositions, also share a sample.
+struct dtl_eval_tracing_sample {
+    size_t size;
+    uint64_t id;
+    size_t num_rows;
+    size_t *rows;
+};
+
+// An expression reached, through a given composition, while walking back from a target.
+struct dtl_eval_tracing_visit {
+    struct dtl_ir_ref expression;
+    size_t composition;
+};
+
+struct dtl_eval_tracing_mappings {
+    size_t num_compositions;
+    struct dtl_eval_tracing_composition *compositions;
+
+    size_t num_mappings;
+    struct dtl_eval_tracing_mapping *mappings;
+
+    // Pairs already walked from the current target.  Expressions can be reached along more than
+    // one path, and each path would otherwise be walked again in full.
+    size_t num_visits;
+    struct dtl_eval_tracing_visit *visits;
+
+    // Only set when sampling.
+    void *traced_expressions;
+    uint64_t sample_threshold;
+    size_t num_samples;
+    struct dtl_eval_tracing_sample *samples;
+};
+
+// Mixes the bits of a row number.  Rows with a hash below the threshold are sampled.
+static uint64_t
+dtl_eval_tracing_hash_row(size_t row) {
+    uint64_t hash = (uint64_t)row + 0x9e3779b97f4a7c15;
+
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    return hash ^ (hash >> 31);
+}
+
+static struct dtl_eval_tracing_sample *
+dtl_eval_tracing_get_sample(struct dtl_eval_tracing_mappings *mappings, size_t size) {
+    struct dtl_eval_tracing_sample *sample;
+    size_t row;
+    size_t i;
+
+    assert(mappings->traced_expressions != NULL);
+
+    for (i = 0; i < mappings->num_samples; i++) {
+        if (mappings->samples[i].size == size) {
+            return &mappings->samples[i];
+        }
+    }
+
+    mappings->num_samples += 1;
+    mappings->samples = realloc(mappings->samples, sizeof(struct dtl_eval_tracing_sample) * mappings->num_samples);
+
+    sample = &mappings->samples[mappings->num_samples - 1];
+    *sample = (struct dtl_eval_tracing_sample){.size = size};
+
+    for (row = 0; row < size; row++) {
+        if (dtl_eval_tracing_hash_row(row) < mappings->sample_threshold) {
+            sample->num_rows++;
+        }
+    }
+
+    // Padded so that empty samples still get an allocation.
+    sample->rows = dtl_index_array_create(sample->num_rows + 1);
+    i = 0;
+    for (row = 0; row < size; row++) {
+        if (dtl_eval_tracing_hash_row(row) < mappings->sample_threshold) {
+            sample->rows[i++] = row;
+        }
+    }
+
+    return sample;
+}
+
+// Returns the index array of a pick, or the mask of a where.
+static struct dtl_ir_ref
+dtl_eval_tracing_composition_input(struct dtl_ir_graph *graph, struct dtl_ir_ref step) {
+    if (dtl_ir_is_pick_expression(graph, step)) {
+        return dtl_ir_pick_expression_get_indexes(graph, step);
+    }
+    assert(dtl_ir_is_where_expression(graph, step));
+    return dtl_ir_where_expression_get_mask(graph, step);
+}
+
+static size_t
+dtl_eval_tracing_compose(
+    struct dtl_eval_context *context,
+    struct dtl_eval_tracing_mappings *mappings,
+    size_t parent,
+    struct dtl_ir_ref step
+) {
+    struct dtl_eval_tracing_composition *composition;
+    struct dtl_ir_ref input;
+    size_t i;
+
+    // Steps that read the same index array or mask compose to the same mapping.
+    input = dtl_eval_tracing_composition_input(context->graph, step);
+    for (i = 0; i < mappings->num_compositions; i++) {
+        composition = &mappings->compositions[i];
+        if (
+            composition->parent == parent &&
+            dtl_ir_ref_equal(context->graph, dtl_eval_tracing_composition_input(context->graph, composition->step), input)
+        ) {
+            return i;
+        }
+    }
+
+    mappings->num_compositions += 1;
+    mappings->compositions = realloc(
+        mappings->compositions, sizeof(struct dtl_eval_tracing_composition) * mappings->num_compositions
+    );
+
+    composition = &mappings->compositions[mappings->num_compositions - 1];
+    *composition = (struct dtl_eval_tracing_composition){.parent = parent, .step = step};
+
+    return mappings->num_compositions - 1;
+}
+
+static void
+dtl_eval_tracing_add_mapping(
+    struct dtl_eval_context *context,
+    struct dtl_eval_tracing_mappings *mappings,
+    struct dtl_ir_ref source,
+    struct dtl_ir_ref target,
+    size_t composition
+) {
+    struct dtl_eval_tracing_mapping *mapping;
+    size_t i;
+
+    if (dtl_ir_ref_equal(context->graph, source, target)) {
+        return;
+    }
+
+    for (i = 0; i < mappings->num_mappings; i++) {
+        mapping = &mappings->mappings[i];
+        if (
+            dtl_ir_ref_equal(context->graph, mapping->source, source) &&
+            dtl_ir_ref_equal(context->graph, mapping->target, target) &&
+            mapping->composition == composition
+        ) {
+            return;
+        }
+    }
+
+    if (composition != SIZE_MAX) {
+        mappings->compositions[composition].used = true;
+    }
+
+    mappings->num_mappings += 1;
+    mappings->mappings = realloc(mappings->mappings, sizeof(struct dtl_eval_tracing_mapping) * mappings->num_mappings);
+
+    mappings->mappings[mappings->num_mappings - 1] = (struct dtl_eval_tracing_mapping){
+        .source = source,
+        .target = target,
+        .composition = composition,
+    };
+}
+
+static void
+dtl_eval_tracing_walk_mappings(
+    struct dtl_eval_context *context,
+    struct dtl_eval_tracing_mappings *mappings,
+    struct dtl_ir_ref target,
+    struct dtl_ir_ref expression,
+    size_t composition
+) {
+    struct dtl_ir_graph *graph = context->graph;
+    enum dtl_dtype dtype;
+    struct dtl_ir_ref shape;
+    struct dtl_ir_ref dependency;
+    size_t i;
+
+    dtype = dtl_ir_expression_get_dtype(graph, expression);
+
+    // Index arrays and masks only decide which rows are moved, and are not followed.
+    if (!dtl_dtype_is_array_type(dtype) || dtype == DTL_DTYPE_INDEX_ARRAY) {
+        return;
+    }
+
+    for (i = 0; i < mappings->num_visits; i++) {
+        if (
+            mappings->visits[i].composition == composition &&
+            dtl_ir_ref_equal(graph, mappings->visits[i].expression, expression)
+        ) {
+            return;
+        }
+    }
+    mappings->num_visits += 1;
+    mappings->visits = realloc(mappings->visits, sizeof(struct dtl_eval_tracing_visit) * mappings->num_visits);
+    mappings->visits[mappings->num_visits - 1] = (struct dtl_eval_tracing_visit){
+        .expression = expression,
+        .composition = composition,
+    };
+
+    if (
+        mappings->traced_expressions != NULL &&
+        dtl_bool_array_get(mappings->traced_expressions, dtl_ir_ref_to_index(graph, expression))
+    ) {
+        dtl_eval_tracing_add_mapping(context, mappings, expression, target, composition);
+    }
+
+    if (dtl_ir_is_read_column_expression(graph, expression)) {
+        dtl_eval_tracing_add_mapping(context, mappings, expression, target, composition);
+        return;
+    }
+
+    if (dtl_ir_is_pick_expression(graph, expression)) {
+        dtl_eval_tracing_walk_mappings(
+            context,
+            mappings,
+            target,
+            dtl_ir_pick_expression_get_source(graph, expression),
+            dtl_eval_tracing_compose(context, mappings, composition, expression)
+        );
+        return;
+    }
+
+    if (dtl_ir_is_where_expression(graph, expression)) {
+        dtl_eval_tracing_walk_mappings(
+            context,
+            mappings,
+            target,
+            dtl_ir_where_expression_get_source(graph, expression),
+            dtl_eval_tracing_compose(context, mappings, composition, expression)
+        );
+        return;
+    }
+
+    shape = dtl_ir_array_expression_get_shape(graph, expression);
+    for (i = 0; i < dtl_ir_expression_get_num_dependencies(graph, expression); i++) {
+        dependency = dtl_ir_expression_get_dependency(graph, expression, i);
+        if (!dtl_dtype_is_array_type(dtl_ir_expression_get_dtype(graph, dependency))) {
+            continue;
+        }
+        if (!dtl_ir_ref_equal(graph, dtl_ir_array_expression_get_shape(graph, dependency), shape)) {
+            continue;
+        }
+        dtl_eval_tracing_walk_mappings(context, mappings, target, dependency, composition);
+    }
+}
+
+// Returns NULL if tracing is disabled.  The index array or mask of each step is pinned until the
+// mappings have been recorded.  When sampling, traced values must already be pinned.
+static struct dtl_eval_tracing_mappings *
+dtl_eval_tracing_plan_mappings(struct dtl_eval_context *context, void *traced_expressions) {
+    struct dtl_eval_tracing_mappings *mappings;
+    struct dtl_ir_ref expression;
+    struct dtl_ir_ref input;
+    double sample_rate;
+    size_t i;
+    size_t j;
+
+    if (context->tracer == NULL) {
+        return NULL;
+    }
+
+    mappings = calloc(1, sizeof(struct dtl_eval_tracing_mappings));
+
+    sample_rate = dtl_io_tracer_get_sample_rate(context->tracer);
+    assert(sample_rate > 0.0 && sample_rate <= 1.0);
+    if (sample_rate < 1.0) {
+        mappings->traced_expressions = traced_expressions;
+        // Rates just below one can round up to 2^64, which does not fit in the threshold.
+        mappings->sample_threshold = sample_rate * 18446744073709551616.0 >= 18446744073709551616.0
+                                         ? UINT64_MAX
+                                         : (uint64_t)(sample_rate * 18446744073709551616.0);
+    }
+
+    for (i = 0; i < context->num_exports; i++) {
+        for (j = 0; j < dtl_schema_get_num_columns(context->exports[i].schema); j++) {
+            expression = context->exports[i].expressions[j];
+            mappings->num_visits = 0;
+            dtl_eval_tracing_walk_mappings(context, mappings, expression, expression, SIZE_MAX);
+        }
+    }
+    for (i = 0; i < context->num_traces && mappings->traced_expressions == NULL; i++) {
+        for (j = 0; j < dtl_schema_get_num_columns(context->traces[i].schema); j++) {
+            expression = context->traces[i].expressions[j];
+            mappings->num_visits = 0;
+            dtl_eval_tracing_walk_mappings(context, mappings, expression, expression, SIZE_MAX);
+        }
+    }
+
+    for (i = 0; i < mappings->num_compositions; i++) {
+        input = dtl_eval_tracing_composition_input(context->graph, mappings->compositions[i].step);
+        context->refcounts[dtl_ir_ref_to_index(context->graph, input)] += 1;
+    }
+
+    free(mappings->visits);
+    mappings->visits = NULL;
+    mappings->num_visits = 0;
+
+    return mappings;
+}
+
+static int
+dtl_eval_tracing_compare_rows(void const *a, void const *b) {
+    size_t row_a = *(size_t const *)a;
+    size_t row_b = *(size_t const *)b;
+
+    return (row_a > row_b) - (row_a < row_b);
+}
+
+// Gathers the given rows of a traced value into `out`.  Returns false if values of the expression's
+// type can't be recorded by tracers.
+static bool
+dtl_eval_tracing_gather(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    size_t *rows,
+    size_t num_rows,
+    struct dtl_value *out
+) {
+    void *bool_array;
+    int64_t *int64_source;
+    int64_t *int64_array;
+    double *double_source;
+    double *double_array;
+    size_t i;
+
+    switch (dtl_ir_expression_get_dtype(context->graph, expression)) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        bool_array = dtl_bool_array_create(num_rows + 1);
+        dtl_bool_array_pick(dtl_eval_context_load_bool_array(context, expression), rows, num_rows, bool_array);
+        dtl_value_take_bool_array(out, bool_array);
+        return true;
+
+    case DTL_DTYPE_INT64_ARRAY:
+        int64_source = dtl_eval_context_load_int64_array(context, expression);
+        int64_array = dtl_int64_array_create(num_rows + 1);
+        for (i = 0; i < num_rows; i++) {
+            dtl_int64_array_set(int64_array, i, dtl_int64_array_get(int64_source, rows[i]));
+        }
+        dtl_value_take_int64_array(out, int64_array);
+        return true;
+
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        double_source = dtl_eval_context_load_double_array(context, expression);
+        double_array = dtl_double_array_create(num_rows + 1);
+        for (i = 0; i < num_rows; i++) {
+            dtl_double_array_set(double_array, i, dtl_double_array_get(double_source, rows[i]));
+        }
+        dtl_value_take_double_array(out, double_array);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static void
+dtl_eval_tracing_clear_gathered(struct dtl_value *value, enum dtl_dtype dtype, size_t num_rows) {
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        dtl_value_clear_bool_array(value, num_rows);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        dtl_value_clear_int64_array(value, num_rows);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        dtl_value_clear_double_array(value, num_rows);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+// Returns the rows of `expression` that the sample passes through, sorted and without duplicates,
+// or NULL if no mapping passes through it.
+static size_t *
+dtl_eval_tracing_sampled_rows(
+    struct dtl_eval_context *context,
+    struct dtl_eval_tracing_mappings *mappings,
+    struct dtl_ir_ref expression,
+    size_t *num_rows
+) {
+    struct dtl_eval_tracing_mapping *mapping;
+    struct dtl_eval_tracing_sample *sample;
+    size_t *rows = NULL;
+    size_t *source;
+    size_t count;
+    size_t i;
+    size_t j;
+
+    *num_rows = 0;
+
+    for (i = 0; i < mappings->num_mappings; i++) {
+        mapping = &mappings->mappings[i];
+
+        if (
+            !dtl_ir_ref_equal(context->graph, mapping->target, expression) &&
+            !dtl_ir_ref_equal(context->graph, mapping->source, expression)
+        ) {
+            continue;
+        }
+
+        if (dtl_ir_ref_equal(context->graph, mapping->target, expression) || mapping->composition == SIZE_MAX) {
+            sample = dtl_eval_tracing_get_sample(
+                mappings,
+                dtl_eval_context_load_index(context, dtl_ir_array_expression_get_shape(context->graph, mapping->target))
+            );
+            source = sample->rows;
+            count = sample->num_rows;
+        } else {
+            source = mappings->compositions[mapping->composition].indexes;
+            count = mappings->compositions[mapping->composition].size;
+        }
+
+        rows = realloc(rows, sizeof(size_t) * (*num_rows + count + 1));
+        memcpy(&rows[*num_rows], source, sizeof(size_t) * count);
+        *num_rows += count;
+    }
+
+    if (rows == NULL) {
+        return NULL;
+    }
+
+    qsort(rows, *num_rows, sizeof(size_t), dtl_eval_tracing_compare_rows);
+    for (i = 0, j = 0; i < *num_rows; i++) {
+        if (j == 0 || rows[i] != rows[j - 1]) {
+            rows[j++] = rows[i];
+        }
+    }
+    *num_rows = j;
+
+    return rows;
+}
+
+// Records the entries of mapping index array `id` grouped by the rows that they point to, so that
+// lineage queries can follow the mapping from either end without sorting it.  The offsets and
+// entries are given the ids `*next_id` and `*next_id + 1`, and `*next_id` is advanced past them.
+static enum dtl_status
+dtl_eval_tracing_record_grouping(
+    struct dtl_eval_context *context,
+    uint64_t id,
+    size_t const *indexes,
+    size_t size,
+    uint64_t *next_id,
+    struct dtl_error **error
+) {
+    uint64_t offsets_id = (*next_id)++;
+    uint64_t entries_id = (*next_id)++;
+    size_t num_keys;
+    size_t *offsets;
+    size_t *entries;
+    struct dtl_value offsets_value = {0};
+    struct dtl_value entries_value = {0};
+    enum dtl_status status;
+
+    dtl_index_array_group(indexes, size, &num_keys, &offsets, &entries);
+    dtl_value_take_index_array(&offsets_value, offsets);
+    dtl_value_take_index_array(&entries_value, entries);
+
+    status = dtl_io_tracer_record_value(
+        context->tracer, offsets_id, DTL_DTYPE_INDEX_ARRAY, num_keys + 1, &offsets_value, error
+    );
+    if (status == DTL_STATUS_OK) {
+        status = dtl_io_tracer_record_value(context->tracer, entries_id, DTL_DTYPE_INDEX_ARRAY, size, &entries_value, error);
+    }
+    if (status == DTL_STATUS_OK) {
+        status = dtl_io_tracer_record_grouping(context->tracer, id, offsets_id, entries_id, error);
+    }
+
+    dtl_value_clear_index_array(&offsets_value, num_keys + 1);
+    dtl_value_clear_index_array(&entries_value, size);
+    return status;
+}
+
+// Records the sampled rows of every traced value, along with the positions of the rows in the full
+// array.  Row index arrays are given ids starting from `next_id`.
+static enum dtl_status
+dtl_eval_tracing_record_sampled_values(
+    struct dtl_eval_context *context,
+    struct dtl_eval_tracing_mappings *mappings,
+    uint64_t next_id,
+    struct dtl_error **error
+) {
+    struct dtl_ir_graph *graph = context->graph;
+    struct dtl_ir_ref expression;
+    enum dtl_dtype dtype;
+    size_t *rows;
+    size_t num_rows;
+    struct dtl_value rows_value;
+    struct dtl_value value;
+    size_t i;
+    enum dtl_status status;
+
+    for (i = 0; i < dtl_ir_graph_get_size(graph); i++) {
+        if (!dtl_bool_array_get(mappings->traced_expressions, i)) {
+            continue;
+        }
+
+        expression = dtl_ir_index_to_ref(graph, i);
+        dtype = dtl_ir_expression_get_dtype(graph, expression);
+
+        rows = dtl_eval_tracing_sampled_rows(context, mappings, expression, &num_rows);
+        if (rows == NULL) {
+            continue;
+        }
+
+        value = (struct dtl_value){0};
+        if (!dtl_eval_tracing_gather(context, expression, rows, num_rows, &value)) {
+            free(rows);
+            continue;
+        }
+
+        rows_value = (struct dtl_value){0};
+        dtl_value_take_index_array(&rows_value, rows);
+
+        status = dtl_io_tracer_record_value(context->tracer, next_id, DTL_DTYPE_INDEX_ARRAY, num_rows, &rows_value, error);
+        if (status == DTL_STATUS_OK) {
+            status = dtl_io_tracer_record_value(context->tracer, i, dtype, num_rows, &value, error);
+        }
+        if (status == DTL_STATUS_OK) {
+            status = dtl_io_tracer_record_sample(context->tracer, i, next_id, error);
+        }
+
+        dtl_eval_tracing_clear_gathered(&value, dtype, num_rows);
+        dtl_value_clear_index_array(&rows_value, num_rows);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+
+        next_id++;
+    }
+
+    return DTL_STATUS_OK;
+}
+
+// Composes the chains of index arrays, and hands them, their groupings and the mappings that use
+// them to the tracer.  Composed index arrays are given ids following those of the expressions in
+// the graph.
+// Must be called after every expression has been evaluated.
+static enum dtl_status
+dtl_eval_tracing_record_mappings(
+    struct dtl_eval_context *context,
+    struct dtl_eval_tracing_mappings *mappings,
+    void *traced_expressions,
+    struct dtl_error **error
+) {
+    struct dtl_ir_graph *graph = context->graph;
+    struct dtl_eval_tracing_composition *composition;
+    struct dtl_eval_tracing_mapping *mapping;
+    struct dtl_eval_tracing_sample *sample;
+    struct dtl_ir_ref step;
+    struct dtl_ir_ref input;
+    size_t *root_rows;
+    size_t num_root_rows;
+    size_t *positions;
+    size_t num_positions;
+    struct dtl_value value;
+    uint64_t src_id;
+    uint64_t tgt_id;
+    uint64_t next_id;
+    size_t i;
+    enum dtl_status status;
+
+    next_id = dtl_ir_graph_get_size(graph) + mappings->num_compositions;
+
+    for (i = 0; i < mappings->num_compositions; i++) {
+        composition = &mappings->compositions[i];
+
+        step = composition->step;
+
+        input = dtl_eval_tracing_composition_input(graph, step);
+
+        // The rows of the column that the chain starts from.  NULL if it starts from every row.
+        root_rows = NULL;
+        num_root_rows = 0;
+        if (composition->parent != SIZE_MAX) {
+            root_rows = mappings->compositions[composition->parent].indexes;
+            num_root_rows = mappings->compositions[composition->parent].size;
+        } else if (mappings->traced_expressions != NULL) {
+            sample = dtl_eval_tracing_get_sample(
+                mappings, dtl_eval_context_load_index(context, dtl_ir_array_expression_get_shape(graph, step))
+            );
+            root_rows = sample->rows;
+            num_root_rows = sample->num_rows;
+        }
+
+        if (dtl_ir_is_pick_expression(graph, step)) {
+            if (root_rows == NULL) {
+                // The pick's own index array already is the mapping.
+                composition->id = dtl_ir_ref_to_index(graph, input);
+                composition->size = dtl_eval_context_load_index(context, dtl_ir_array_expression_get_shape(graph, step));
+                composition->indexes = dtl_eval_context_load_index_array(context, input);
+                composition->owned = false;
+            } else {
+                composition->id = dtl_ir_graph_get_size(graph) + i;
+                composition->size = num_root_rows;
+                composition->indexes = dtl_index_array_create(composition->size + 1);
+                composition->owned = true;
+                dtl_index_array_pick(
+                    dtl_eval_context_load_index_array(context, input), root_rows, num_root_rows, composition->indexes
+                );
+            }
+        } else {
+            num_positions = dtl_eval_context_load_index(context, dtl_ir_array_expression_get_shape(graph, step));
+            positions = dtl_index_array_create(num_positions);
+            dtl_index_array_where(
+                dtl_eval_context_load_bool_array(context, input),
+                dtl_eval_context_load_index(context, dtl_ir_array_expression_get_shape(graph, input)),
+                positions
+            );
+
+            composition->id = dtl_ir_graph_get_size(graph) + i;
+            composition->owned = true;
+            if (root_rows == NULL) {
+                composition->size = num_positions;
+                composition->indexes = positions;
+            } else {
+                composition->size = num_root_rows;
+                composition->indexes = dtl_index_array_create(composition->size + 1);
+                dtl_index_array_pick(positions, root_rows, num_root_rows, composition->indexes);
+                dtl_index_array_destroy(positions, num_positions);
+            }
+        }
+
+        // Borrowed index arrays that are also traced will already have been recorded.
+        if (!composition->used) {
+            continue;
+        }
+        if (composition->owned || traced_expressions == NULL || !dtl_bool_array_get(traced_expressions, composition->id)) {
+            value = (struct dtl_value){0};
+            dtl_value_take_index_array(&value, composition->indexes);
+            status = dtl_io_tracer_record_value(
+                context->tracer, composition->id, DTL_DTYPE_INDEX_ARRAY, composition->size, &value, error
+            );
+            if (status != DTL_STATUS_OK) {
+                return status;
+            }
+        }
+
+        status = dtl_eval_tracing_record_grouping(
+            context, composition->id, composition->indexes, composition->size, &next_id, error
+        );
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+    }
+
+    if (mappings->traced_expressions != NULL) {
+        // Identity mappings don't start any chains, so may still need samples of their own.
+        for (i = 0; i < mappings->num_mappings; i++) {
+            dtl_eval_tracing_get_sample(
+                mappings,
+                dtl_eval_context_load_index(
+                    context, dtl_ir_array_expression_get_shape(graph, mappings->mappings[i].target)
+                )
+            );
+        }
+
+        for (i = 0; i < mappings->num_samples; i++) {
+            sample = &mappings->samples[i];
+            sample->id = next_id++;
+
+            value = (struct dtl_value){0};
+            dtl_value_take_index_array(&value, sample->rows);
+            status = dtl_io_tracer_record_value(
+                context->tracer, sample->id, DTL_DTYPE_INDEX_ARRAY, sample->num_rows, &value, error
+            );
+            if (status != DTL_STATUS_OK) {
+                return status;
+            }
+
+            // Samples are the index arrays of sampled mappings.
+            status = dtl_eval_tracing_record_grouping(context, sample->id, sample->rows, sample->num_rows, &next_id, error);
+            if (status != DTL_STATUS_OK) {
+                return status;
+            }
+        }
+    }
+
+    for (i = 0; i < mappings->num_mappings; i++) {
+        mapping = &mappings->mappings[i];
+        src_id = mapping->composition != SIZE_MAX ? mappings->compositions[mapping->composition].id
+                                                  : DTL_IO_TRACER_IDENTITY_MAPPING;
+        tgt_id = DTL_IO_TRACER_IDENTITY_MAPPING;
+
+        // Sampled mappings only cover the sampled rows of the target.
+        if (mappings->traced_expressions != NULL) {
+            sample = dtl_eval_tracing_get_sample(
+                mappings, dtl_eval_context_load_index(context, dtl_ir_array_expression_get_shape(graph, mapping->target))
+            );
+            tgt_id = sample->id;
+            if (mapping->composition == SIZE_MAX) {
+                src_id = sample->id;
+            }
+        }
+
+        status = dtl_io_tracer_record_mapping(
+            context->tracer,
+            dtl_ir_ref_to_index(graph, mapping->source),
+            dtl_ir_ref_to_index(graph, mapping->target),
+            src_id,
+            tgt_id,
+            error
+        );
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+    }
+
+    if (mappings->traced_expressions != NULL) {
+        status = dtl_eval_tracing_record_sampled_values(context, mappings, next_id, error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+
+        for (i = 0; i < dtl_ir_graph_get_size(graph); i++) {
+            if (dtl_bool_array_get(mappings->traced_expressions, i)) {
+                dtl_eval_context_release(context, dtl_ir_index_to_ref(graph, i));
+            }
+        }
+    }
+
+    // Borrowed index arrays must not be used after this point.
+    for (i = 0; i < mappings->num_compositions; i++) {
+        dtl_eval_context_release(context, dtl_eval_tracing_composition_input(graph, mappings->compositions[i].step));
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static void
+dtl_eval_tracing_mappings_destroy(struct dtl_eval_tracing_mappings *mappings) {
+    struct dtl_eval_tracing_composition *composition;
+    size_t i;
+
+    if (mappings == NULL) {
+        return;
+    }
+
+    for (i = 0; i < mappings->num_compositions; i++) {
+        composition = &mappings->compositions[i];
+        if (composition->owned) {
+            dtl_index_array_destroy(composition->indexes, composition->size);
+        }
+    }
+
+    for (i = 0; i < mappings->num_samples; i++) {
+        dtl_index_array_destroy(mappings->samples[i].rows, mappings->samples[i].num_rows);
+    }
+
+    free(mappings->compositions);
+    free(mappings->mappings);
+    free(mappings->samples);
+    free(mappings);
+}
+
+/* === Eval ===================================================================================== */
+
+static enum dtl_status
+dtl_eval_expression(
+    struct dtl_eval_context *context,
+    struct dtl_ir_ref expression,
+    struct dtl_error **error
+) {
+    struct dtl_ir_graph *graph;
+    enum dtl_status (*eval)(struct dtl_eval_context *, struct dtl_ir_ref, struct dtl_error **) = NULL;
+
+    assert(context != NULL);
+    graph = context->graph;
+
+    if (dtl_ir_is_table_shape_expression(graph, expression)) {
+        eval = dtl_eval_table_shape_expression;
+    }
+
+    if (dtl_ir_is_where_shape_expression(graph, expression)) {
+        eval = dtl_eval_where_shape_expression;
+    }
+
+    if (dtl_ir_is_join_shape_expression(graph, expression)) {
+        eval = dtl_eval_join_shape_expression;
+    }
+
+    if (dtl_ir_is_int64_constant_expression(graph, expression)) {
+        eval = dtl_eval_int64_constant_expression;
+    }
+
+    if (dtl_ir_is_double_constant_expression(graph, expression)) {
+        eval = dtl_eval_double_constant_expression;
+    }
+
+    if (dtl_ir_is_open_table_expression(graph, expression)) {
+        eval = dtl_eval_open_table_expression;
+    }
+
+    if (dtl_ir_is_read_column_expression(graph, expression)) {
+        eval = dtl_eval_read_column_expression;
+    }
+
+    if (dtl_ir_is_where_expression(graph, expression)) {
+        eval = dtl_eval_where_expression;
+    }
+
+    if (dtl_ir_is_pick_expression(graph, expression)) {
+        eval = dtl_eval_pick_expression;
+    }
+
+    if (dtl_ir_is_index_expression(graph, expression)) {
+        assert(false); // Not implemented.
+    }
+
+    if (dtl_ir_is_join_left_expression(graph, expression)) {
+        eval = dtl_eval_join_left_expression;
+    }
+
+    if (dtl_ir_is_join_right_expression(graph, expression)) {
+        eval = dtl_eval_join_right_expression;
+    }
+
+    if (dtl_ir_is_equal_to_expression(graph, expression)) {
+        eval = dtl_eval_equal_to_expression;
+    }
+
+    if (dtl_ir_is_less_than_expression(graph, expression)) {
+        eval = dtl_eval_less_than_expression;
+    }
+
+    if (dtl_ir_is_less_than_or_equal_to_expression(graph, expression)) {
+        eval = dtl_eval_less_than_or_equal_to_expression;
+    }
+
+    if (dtl_ir_is_greater_than_expression(graph, expression)) {
+        eval = dtl_eval_greater_than_expression;
+    }
+
+    if (dtl_ir_is_greater_than_or_equal_to_expression(graph, expression)) {
+        eval = dtl_eval_greater_than_or_equal_to_expression;
+    }
+
+    if (dtl_ir_is_add_expression(graph, expression)) {
+        eval = dtl_eval_add_expression;
+    }
+
+    if (dtl_ir_is_subtract_expression(graph, expression)) {
+        assert(false); // Not implemented.
+    }
+
+    if (dtl_ir_is_multiply_expression(graph, expression)) {
+        assert(false); // Not implemented.
+    }
+    if (dtl_ir_is_divide_expression(graph, expression)) {
+        assert(false); // Not implemented.
+    }
+
+    assert(eval != NULL);
+    return eval(context, expression, error);
+}
+
+struct dtl_program_import {
+    char const *name;
+    struct dtl_schema *schema;
+};
+
+struct dtl_program {
+    char *source;
+    char *filename;
+
+    struct dtl_ir_graph *graph;
+
+    size_t num_imports;
+    struct dtl_program_import *imports;
+
+    size_t num_exports;
+    struct dtl_eval_context_export *exports;
+
+    size_t num_traces;
+    struct dtl_eval_context_trace *traces;
+
+    size_t num_predicates;
+    struct dtl_eval_context_predicate *predicates;
+
+    // Set for programs loaded from the plan cache.  The graph and the names of tables live in the
+    // mapped plan.
+    void *image;
+    size_t image_size;
+    uint64_t key;
+};
+
+static void
+dtl_eval_close_tables(struct dtl_eval_context *context) {
+    size_t i;
+
+    for (i = 0; i < context->num_imports; i++) {
+        if (context->imports[i].table != NULL) {
+            dtl_io_table_destroy(context->imports[i].table);
+        }
+    }
+    free(context->imports);
+
+    context->num_imports = 0;
+    context->imports = NULL;
+}
+
+// Compiles `source` to a program, leaving the tables that were opened to read their schemas in
+// `context` so that callers that are about to execute the program can reuse them.
+static struct dtl_program *
+dtl_eval_compile(
+    char const *source,
+    char const *filename,
+    struct dtl_eval_context *context,
+    struct dtl_error **error
+) {
+    struct dtl_program *program;
+    struct dtl_tokenizer *tokenizer;
+    int parse_result;
+    enum dtl_status status;
+    struct dtl_ast_node *root;
+    struct dtl_io_table *table;
+    size_t i;
+
+    // Locations in the IR point into the filename, so the program needs its own copy.
+    program = calloc(1, sizeof(struct dtl_program));
+    program->source = strdup(source);
+    program->filename = filename != NULL ? strdup(filename) : NULL;
+
+    // === Parse Source Code =======================================================================
+
+    tokenizer = dtl_tokenizer_create(program->source, program->filename);
+    parse_result = dtl_parser_parse(tokenizer, &root, error);
+    dtl_tokenizer_destroy(tokenizer);
+    if (parse_result != 0) {
+        dtl_program_destroy(program);
+        return NULL;
+    }
+
+    // === Compile AST to List of Tables Referencing IR Expressions ================================
+
+    program->graph = dtl_ir_graph_create();
+    context->graph = program->graph;
+    dtl_eval_prefetch_imports(context, root);
+
+    status = dtl_ast_to_ir(
+        root,
+        program->graph,
+        dtl_eval_ast_to_ir_import_callback,
+        dtl_eval_ast_to_ir_export_callback,
+        dtl_eval_ast_to_ir_trace_callback,
+        context,
+        error
+    );
+    dtl_ast_node_destroy(root);
+
+    program->num_exports = context->num_exports;
+    program->exports = context->exports;
+    program->num_traces = context->num_traces;
+    program->traces = context->traces;
+
+    if (status != DTL_STATUS_OK) {
+        dtl_program_destroy(program);
+        return NULL;
+    }
+
+    // === Generate Mappings =======================================================================
+
+    // Mappings are only needed when tracing, and are cheap to find, so they are planned from the
+    // graph each time a traced program is executed.  See `dtl_eval_tracing_plan_mappings`.
+
+    // === Optimise IR =============================================================================
+
+    // Optimise regular joins to iteration on one side and lookup on index on other.
+    // TODO.
+
+    // Deduplicate IR expressions.
+    // TODO.
+
+    // Drop unreachable IR expressions.
+    // TODO
+
+    // Find comparisons against constants that can be pushed down into the tables that they filter.
+    dtl_eval_push_down_predicates(context);
+    program->num_predicates = context->num_predicates;
+    program->predicates = context->predicates;
+
+    // After this point the expression graph is frozen.  We no longer need to update roots.
+
+    // === Compile Reachable Expressions to Command List ===========================================
+    // TODO
+
+    // === Inject Commands to Export Tables ========================================================
+    // TODO
+
+    // === Record Import Schemas ===================================================================
+
+    program->num_imports = context->num_imports;
+    program->imports = calloc(
+        context->num_imports > 0 ? context->num_imports : 1, sizeof(struct dtl_program_import)
+    );
+    for (i = 0; i < context->num_imports; i++) {
+        table = context->imports[i].table;
+        assert(table != NULL);
+
+        program->imports[i].name = context->imports[i].name;
+        program->imports[i].schema = dtl_schema_copy(dtl_io_table_get_schema(table));
+    }
+
+    return program;
+}
+
+static enum dtl_status
+dtl_eval_open_tables(struct dtl_program *program, struct dtl_eval_context *context, struct dtl_error **error) {
+    struct dtl_eval_context_import *import;
+    size_t i;
+
+    assert(context->num_imports == 0);
+
+    context->num_imports = program->num_imports;
+    context->imports = calloc(
+        program->num_imports > 0 ? program->num_imports : 1, sizeof(struct dtl_eval_context_import)
+    );
+    for (i = 0; i < program->num_imports; i++) {
+        context->imports[i].name = program->imports[i].name;
+    }
+
+    dtl_eval_prefetch_tables(context);
+
+    for (i = 0; i < program->num_imports; i++) {
+        import = &context->imports[i];
+
+        if (import->table == NULL) {
+            import->table = dtl_io_importer_import_table(context->importer, import->name, error);
+            if (import->table == NULL) {
+                return DTL_STATUS_ERROR;
+            }
+        }
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_eval_check_schemas(struct dtl_program *program, struct dtl_eval_context *context, struct dtl_error **error) {
+    struct dtl_eval_context_import *import;
+    size_t i;
+
+    assert(context->num_imports == program->num_imports);
+
+    for (i = 0; i < program->num_imports; i++) {
+        import = &context->imports[i];
+
+        if (!dtl_schema_equal(dtl_io_table_get_schema(import->table), program->imports[i].schema)) {
+            dtl_set_error(
+                error,
+                dtl_error_create("Schema of table '%s' does not match the schema it was compiled against", import->name)
+            );
+            return DTL_STATUS_ERROR;
+        }
+    }
+
+    return DTL_STATUS_OK;
+}
+
+// Evaluates `program` against the tables already opened in `context`.
+static enum dtl_status
+dtl_eval_execute(struct dtl_program *program, struct dtl_eval_context *context, struct dtl_error **error) {
+    size_t num_expressions;
+    struct dtl_eval_export_job *export_jobs = NULL;
+    void *traced_expressions = NULL;
+    struct dtl_eval_tracing_mappings *mappings = NULL;
+    struct dtl_ir_ref expression;
+    struct dtl_ir_ref dependency;
+    struct dtl_ir_ref shape_expression;
+    size_t num_rows;
+    size_t i;
+    size_t j;
+    enum dtl_status status;
+    enum dtl_status flush_status;
+    struct dtl_error *flush_error = NULL;
+
+    assert(context->num_imports == program->num_imports);
+
+    context->graph = program->graph;
+    context->num_exports = program->num_exports;
+    context->exports = program->exports;
+    context->num_traces = program->num_traces;
+    context->traces = program->traces;
+    context->num_predicates = program->num_predicates;
+    context->predicates = program->predicates;
+
+    num_expressions = dtl_ir_graph_get_size(program->graph);
+    context->values = calloc(num_expressions > 0 ? num_expressions : 1, sizeof(struct dtl_value));
+    context->refcounts = calloc(num_expressions > 0 ? num_expressions : 1, sizeof(atomic_size_t));
+    context->releases = calloc(num_expressions > 0 ? num_expressions : 1, sizeof(struct dtl_eval_context_release));
+
+    if (context->tracer != NULL) {
+        status = dtl_io_tracer_record_source(context->tracer, program->source, program->filename, error);
+        if (status != DTL_STATUS_OK) {
+            goto cleanup;
+        }
+    }
+
+    // Traces record rows by their position in the table that was read, so dropping rows would
+    // leave lineage pointing at the wrong rows of the input.
+    if (context->tracer == NULL) {
+        status = dtl_eval_apply_predicates(context, error);
+        if (status != DTL_STATUS_OK) {
+            goto cleanup;
+        }
+    }
+
+    // === Setup Tracing ===========================================================================
+    status = dtl_eval_tracing_record_import_metadata(context, error);
+    if (status != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+
+    status = dtl_eval_tracing_record_export_metadata(context, error);
+    if (status != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+
+    status = dtl_eval_tracing_record_trace_metadata(context, error);
+    if (status != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+
+    traced_expressions = dtl_eval_tracing_mark_dependencies(context);
+
+    // === Count References to Collect Arrays After Use ============================================
+    // Each value holds a reference to itself until it has been evaluated, and one for each
+    // expression that depends on it.  Traced values hold an extra reference for the tracer, and
+    // exported values hold one until the end of the run.  Index arrays and masks that mappings are
+    // composed from are held until the mappings have been recorded.
+    for (i = 0; i < num_expressions; i++) {
+        expression = dtl_ir_index_to_ref(program->graph, i);
+
+        context->refcounts[i] += 1;
+        for (j = 0; j < dtl_ir_expression_get_num_dependencies(program->graph, expression); j++) {
+            dependency = dtl_ir_expression_get_dependency(program->graph, expression, j);
+            context->refcounts[dtl_ir_ref_to_index(program->graph, dependency)] += 1;
+        }
+
+        if (traced_expressions != NULL && dtl_bool_array_get(traced_expressions, i)) {
+            context->refcounts[i] += 1;
+        }
+
+        context->releases[i].context = context;
+        context->releases[i].index = i;
+    }
+    for (i = 0; i < context->num_exports; i++) {
+        for (j = 0; j < dtl_schema_get_num_columns(context->exports[i].schema); j++) {
+            context->refcounts[dtl_ir_ref_to_index(program->graph, context->exports[i].expressions[j])] += 1;
+        }
+    }
+    mappings = dtl_eval_tracing_plan_mappings(context, traced_expressions);
+
+    // === Evaluate the Command List ===============================================================
+    export_jobs = dtl_eval_export_jobs_create(context);
+
+    for (j = 0; j < context->num_exports; j++) {
+        if (export_jobs[j].num_dependencies == 0) {
+            dtl_eval_export_start(context, export_jobs, j);
+        }
+    }
+    for (i = 0; i < num_expressions; i++) {
+        expression = dtl_ir_index_to_ref(program->graph, i);
+
+        status = dtl_eval_expression(context, expression, error);
+        if (status != DTL_STATUS_OK) {
+            dtl_eval_export_jobs_finish(export_jobs, context->num_exports, NULL);
+            goto cleanup;
+        }
+
+        // Traced values are handed to the tracer as soon as they are available, so that writing
+        // them overlaps with evaluation of the rest of the graph.  Sampled values are held until
+        // the mappings are known.
+        if (
+            traced_expressions != NULL && dtl_bool_array_get(traced_expressions, i) &&
+            mappings->traced_expressions == NULL
+        ) {
+            shape_expression = dtl_ir_array_expression_get_shape(program->graph, expression);
+            num_rows = dtl_eval_context_load_index(context, shape_expression);
+
+            status = dtl_io_tracer_record_value_deferred(
+                context->tracer,
+                i,
+                dtl_ir_expression_get_dtype(program->graph, expression),
+                num_rows,
+                &context->values[i],
+                dtl_eval_context_release_traced,
+                &context->releases[i],
+                error
+            );
+            if (status != DTL_STATUS_OK) {
+                dtl_eval_export_jobs_finish(export_jobs, context->num_exports, NULL);
+                goto cleanup;
+            }
+        }
+
+        for (j = 0; j < context->num_exports; j++) {
+            if (export_jobs[j].num_dependencies == i + 1) {
+                dtl_eval_export_start(context, export_jobs, j);
+            }
+        }
+
+        for (j = 0; j < dtl_ir_expression_get_num_dependencies(program->graph, expression); j++) {
+            dtl_eval_context_release(context, dtl_ir_expression_get_dependency(program->graph, expression, j));
+        }
+        dtl_eval_context_release(context, expression);
+    }
+
+    if (mappings != NULL) {
+        status = dtl_eval_tracing_record_mappings(context, mappings, traced_expressions, error);
+        if (status != DTL_STATUS_OK) {
+            dtl_eval_export_jobs_finish(export_jobs, context->num_exports, NULL);
+            goto cleanup;
+        }
+    }
+
+    status = dtl_eval_export_jobs_finish(export_jobs, context->num_exports, error);
+
+cleanup:
+    // The tracer may still be holding on to values, and must be done with them before they can be
+    // freed.  Write errors are only reported if nothing else has gone wrong first.
+    if (context->tracer != NULL) {
+        flush_status = dtl_io_tracer_flush(context->tracer, &flush_error);
+        if (flush_status != DTL_STATUS_OK && status == DTL_STATUS_OK) {
+            status = flush_status;
+            dtl_set_error(error, flush_error);
+            flush_error = NULL;
+        }
+        dtl_clear_error(&flush_error);
+    }
+
+    dtl_eval_tracing_mappings_destroy(mappings);
+
+    for (i = 0; i < num_expressions; i++) {
+        dtl_eval_context_clear(context, dtl_ir_index_to_ref(program->graph, i));
+    }
+    free(context->values);
+    context->values = NULL;
+    free(context->refcounts);
+    context->refcounts = NULL;
+    free(context->releases);
+    context->releases = NULL;
+
+    free(traced_expressions);
+
+    return status;
+}
+
+struct dtl_program *
+dtl_compile(char const *source, char const *filename, struct dtl_io_importer *importer, struct dtl_error **error) {
+    struct dtl_eval_context context = {.importer = importer};
+    struct dtl_program *program;
+
+    program = dtl_eval_compile(source, filename, &context, error);
+    dtl_eval_close_tables(&context);
+
+    return program;
+}
+
+bool
+dtl_program_matches_inputs(struct dtl_program *program, struct dtl_io_importer *importer) {
+    struct dtl_eval_context context = {.importer = importer};
+    struct dtl_error *error = NULL;
+    bool matches;
+
+    assert(program != NULL);
+
+    matches = dtl_eval_open_tables(program, &context, &error) == DTL_STATUS_OK &&
+              dtl_eval_check_schemas(program, &context, &error) == DTL_STATUS_OK;
+    dtl_error_destroy(error);
+
+    dtl_eval_close_tables(&context);
+    return matches;
+}
+
+enum dtl_status
+dtl_program_execute(
+    struct dtl_program *program,
+    struct dtl_io_importer *importer,
+    struct dtl_io_exporter *exporter,
+    struct dtl_io_tracer *tracer,
+    struct dtl_error **error
+) {
+    struct dtl_eval_context context = {
+        .importer = importer,
+        .exporter = exporter,
+        .tracer = tracer,
+    };
+    enum dtl_status status;
+
+    assert(program != NULL);
+
+    status = dtl_eval_open_tables(program, &context, error);
+    if (status == DTL_STATUS_OK) {
+        status = dtl_eval_check_schemas(program, &context, error);
+    }
+    if (status == DTL_STATUS_OK) {
+        status = dtl_eval_execute(program, &context, error);
+    }
+
+    dtl_eval_close_tables(&context);
+    return status;
+}
+
+void
+dtl_program_destroy(struct dtl_program *program) {
+    size_t i;
+
+    if (program == NULL) {
+        return;
+    }
+
+    for (i = 0; i < program->num_imports; i++) {
+        dtl_schema_destroy(program->imports[i].schema);
+    }
+    free(program->imports);
+
+    for (i = 0; i < program->num_exports; i++) {
+        dtl_schema_destroy(program->exports[i].schema);
+        free(program->exports[i].expressions);
+    }
+    free(program->exports);
+
+    for (i = 0; i < program->num_traces; i++) {
+        dtl_schema_destroy(program->traces[i].schema);
+        free(program->traces[i].expressions);
+    }
+    free(program->traces);
+
+    free(program->predicates);
+
+    if (program->graph != NULL) {
+        dtl_ir_graph_destroy(program->graph);
+    }
+
+    if (program->image != NULL) {
+        munmap(program->image, program->image_size);
+    }
+
+    free(program->source);
+    free(program->filename);
+    free(program);
+}
+
+enum dtl_status
+dtl_eval(
+    char const *source,
+    char const *filename,
+    struct dtl_io_importer *importer,
+    struct dtl_io_exporter *exporter,
+    struct dtl_io_tracer *tracer,
+    struct dtl_error **error
+) {
+    struct dtl_eval_context context = {.importer = importer};
+    struct dtl_program *program;
+    enum dtl_status status;
+
+    // Tables opened to read their schemas while compiling have not been read from yet, so they are
+    // reused for the execution rather than opened a second time.
+    program = dtl_eval_compile(source, filename, &context, error);
+    if (program == NULL) {
+        dtl_eval_close_tables(&context);
+        return DTL_STATUS_ERROR;
+    }
+
+    context.exporter = exporter;
+    context.tracer = tracer;
+    status = dtl_eval_execute(program, &context, error);
+
+    dtl_eval_close_tables(&context);
+    dtl_program_destroy(program);
+
+    return status;
+}
+
+/* === Plan Cache =============================================================================== */
+
+// Compiled programs are cached as files named after a hash of the script source.  Each file holds
+// the program's IR graph as an image that is mapped and used in place, followed by a short list
+// of the program's imports, exports, traces and predicates, and a table of the strings that they
+// refer to.  The tables that a script imports are only known once it has been parsed, so plans
+// are found by source alone and are only reused if their key, a hash of the source and of the
+// schemas of the tables they were compiled against, matches the tables they are about to read.
+
+#define DTL_PLAN_MAGIC "DTLPLAN"
+#define DTL_PLAN_VERSION 1
+
+struct dtl_plan_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t graph_offset;
+    uint64_t graph_size;
+    uint64_t metadata_offset;
+    uint64_t metadata_size;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+static char *
+dtl_plan_path(char const *cache_dir, char const *source) {
+    char *path;
+
+    if (asprintf(&path, "%s/%016" PRIx64 ".plan", cache_dir, (uint64_t)XXH64(source, strlen(source), 0)) < 0) {
+        return NULL;
+    }
+    return path;
+}
+
+static uint64_t
+dtl_plan_key(char const *source, struct dtl_eval_context *context) {
+    XXH64_hash_t hash;
+    struct dtl_schema *schema;
+    char const *name;
+    uint64_t dtype;
+    size_t i;
+    size_t j;
+
+    hash = XXH64(source, strlen(source), 0);
+    for (i = 0; i < context->num_imports; i++) {
+        name = context->imports[i].name;
+        hash = XXH64(name, strlen(name) + 1, hash);
+
+        schema = dtl_io_table_get_schema(context->imports[i].table);
+        for (j = 0; j < dtl_schema_get_num_columns(schema); j++) {
+            name = dtl_schema_get_column_name(schema, j);
+            hash = XXH64(name, strlen(name) + 1, hash);
+
+            dtype = dtl_schema_get_column_dtype(schema, j);
+            hash = XXH64(&dtype, sizeof(dtype), hash);
+        }
     }
 
-    if (dtl_ir_is_double_constant_expression(graph, expression)) {
-        assert(false); // Not implemented.
+    return hash;
+}
+
+/* --- Writing ---------------------------------------------------------------------------------- */
+
+struct dtl_plan_writer {
+    FILE *file;
+    bool ok;
+
+    char const **strings;
+    uint64_t *string_offsets;
+    size_t num_strings;
+    uint64_t strings_size;
+};
+
+static uint64_t
+dtl_plan_string_offset(char const *string, void *user_data) {
+    struct dtl_plan_writer *writer = (struct dtl_plan_writer *)user_data;
+    size_t i;
+
+    // Strings that compare equal must share an offset, so that names that were interned by the
+    // compiler can still be compared by pointer once the plan has been mapped.
+    for (i = 0; i < writer->num_strings; i++) {
+        if (writer->strings[i] == string || strcmp(writer->strings[i], string) == 0) {
+            return writer->string_offsets[i];
+        }
     }
 
-    if (dtl_ir_is_open_table_expression(graph, expression)) {
-        eval = dtl_eval_open_table_expression;
+    writer->num_strings += 1;
+    writer->strings = realloc(writer->strings, sizeof(char const *) * writer->num_strings);
+    writer->string_offsets = realloc(writer->string_offsets, sizeof(uint64_t) * writer->num_strings);
+
+    writer->strings[writer->num_strings - 1] = string;
+    writer->string_offsets[writer->num_strings - 1] = writer->strings_size;
+    writer->strings_size += strlen(string) + 1;
+
+    return writer->string_offsets[writer->num_strings - 1];
+}
+
+static void
+dtl_plan_write_word(struct dtl_plan_writer *writer, uint64_t word) {
+    if (writer->ok && fwrite(&word, sizeof(word), 1, writer->file) != 1) {
+        writer->ok = false;
     }
+}
 
-    if (dtl_ir_is_read_column_expression(graph, expression)) {
-        eval = dtl_eval_read_column_expression;
+static void
+dtl_plan_write_string(struct dtl_plan_writer *writer, char const *string) {
+    dtl_plan_write_word(writer, dtl_plan_string_offset(string, writer));
+}
+
+static void
+dtl_plan_write_schema(struct dtl_plan_writer *writer, struct dtl_schema *schema) {
+    size_t i;
+
+    dtl_plan_write_word(writer, dtl_schema_get_num_columns(schema));
+    for (i = 0; i < dtl_schema_get_num_columns(schema); i++) {
+        dtl_plan_write_string(writer, dtl_schema_get_column_name(schema, i));
+        dtl_plan_write_word(writer, dtl_schema_get_column_dtype(schema, i));
     }
+}
 
-    if (dtl_ir_is_where_expression(graph, expression)) {
-        eval = dtl_eval_where_expression;
+static void
+dtl_plan_write_expressions(
+    struct dtl_plan_writer *writer,
+    struct dtl_ir_graph *graph,
+    struct dtl_schema *schema,
+    struct dtl_ir_ref *expressions
+) {
+    size_t i;
+
+    for (i = 0; i < dtl_schema_get_num_columns(schema); i++) {
+        dtl_plan_write_word(writer, dtl_ir_ref_to_index(graph, expressions[i]));
     }
+}
 
-    if (dtl_ir_is_pick_expression(graph, expression)) {
-        eval = dtl_eval_pick_expression;
+static void
+dtl_plan_write_location(struct dtl_plan_writer *writer, struct dtl_location location) {
+    dtl_plan_write_word(writer, location.offset);
+    dtl_plan_write_word(writer, location.lineno);
+    dtl_plan_write_word(writer, location.column);
+}
+
+static void
+dtl_plan_write_metadata(struct dtl_plan_writer *writer, struct dtl_program *program) {
+    struct dtl_eval_context_predicate *predicate;
+    size_t i;
+
+    dtl_plan_write_string(writer, program->source);
+
+    dtl_plan_write_word(writer, program->num_imports);
+    for (i = 0; i < program->num_imports; i++) {
+        dtl_plan_write_string(writer, program->imports[i].name);
+        dtl_plan_write_schema(writer, program->imports[i].schema);
     }
 
-    if (dtl_ir_is_index_expression(graph, expression)) {
-        assert(false); // Not implemented.
+    dtl_plan_write_word(writer, program->num_exports);
+    for (i = 0; i < program->num_exports; i++) {
+        dtl_plan_write_string(writer, program->exports[i].name);
+        dtl_plan_write_schema(writer, program->exports[i].schema);
+        dtl_plan_write_expressions(writer, program->graph, program->exports[i].schema, program->exports[i].expressions);
     }
 
-    if (dtl_ir_is_join_left_expression(graph, expression)) {
-        eval = dtl_eval_join_left_expression;
+    dtl_plan_write_word(writer, program->num_traces);
+    for (i = 0; i < program->num_traces; i++) {
+        dtl_plan_write_location(writer, program->traces[i].start);
+        dtl_plan_write_location(writer, program->traces[i].end);
+        dtl_plan_write_schema(writer, program->traces[i].schema);
+        dtl_plan_write_expressions(writer, program->graph, program->traces[i].schema, program->traces[i].expressions);
     }
 
-    if (dtl_ir_is_join_right_expression(graph, expression)) {
-        eval = dtl_eval_join_right_expression;
+    dtl_plan_write_word(writer, program->num_predicates);
+    for (i = 0; i < program->num_predicates; i++) {
+        predicate = &program->predicates[i];
+        dtl_plan_write_word(writer, predicate->import);
+        dtl_plan_write_word(writer, predicate->column);
+        dtl_plan_write_word(writer, predicate->op);
+        dtl_plan_write_word(writer, (uint64_t)predicate->value);
     }
+}
 
-    if (dtl_ir_is_equal_to_expression(graph, expression)) {
-        eval = dtl_eval_equal_to_expression;
+static void
+dtl_plan_write_padding(struct dtl_plan_writer *writer) {
+    long position;
+
+    position = ftell(writer->file);
+    if (position < 0) {
+        writer->ok = false;
+        return;
+    }
+    while (writer->ok && position % 8 != 0) {
+        if (fputc(0, writer->file) == EOF) {
+            writer->ok = false;
+        }
+        position += 1;
     }
+}
 
-    if (dtl_ir_is_less_than_expression(graph, expression)) {
-        eval = dtl_eval_less_than_expression;
+static uint64_t
+dtl_plan_write_tell(struct dtl_plan_writer *writer) {
+    long position;
+
+    position = ftell(writer->file);
+    if (position < 0) {
+        writer->ok = false;
+        return 0;
     }
+    return (uint64_t)position;
+}
 
-    if (dtl_ir_is_less_than_or_equal_to_expression(graph, expression)) {
-        eval = dtl_eval_less_than_or_equal_to_expression;
+static enum dtl_status
+dtl_plan_write(struct dtl_program *program, uint64_t key, char const *path, struct dtl_error **error) {
+    struct dtl_plan_header header = {0};
+    struct dtl_plan_writer writer = {.ok = true};
+    char *temp_path;
+    int fd;
+    size_t i;
+    int errsv = 0;
+
+    // Plans are written to a temporary file and then renamed into place, so that concurrent runs
+    // never map a partially written plan.
+    if (asprintf(&temp_path, "%s.XXXXXX", path) < 0) {
+        dtl_set_error(error, dtl_error_create("Could not write plan '%s'", path));
+        return DTL_STATUS_ERROR;
     }
 
-    if (dtl_ir_is_greater_than_expression(graph, expression)) {
-        eval = dtl_eval_greater_than_expression;
+    fd = mkstemp(temp_path);
+    if (fd == -1) {
+        dtl_set_error(error, dtl_error_create("Could not create '%s': %s", temp_path, strerror(errno)));
+        free(temp_path);
+        return DTL_STATUS_ERROR;
     }
 
-    if (dtl_ir_is_greater_than_or_equal_to_expression(graph, expression)) {
-        eval = dtl_eval_greater_than_or_equal_to_expression;
+    writer.file = fdopen(fd, "wb");
+    if (writer.file == NULL) {
+        dtl_set_error(error, dtl_error_create("Could not open '%s': %s", temp_path, strerror(errno)));
+        close(fd);
+        unlink(temp_path);
+        free(temp_path);
+        return DTL_STATUS_ERROR;
     }
 
-    if (dtl_ir_is_add_expression(graph, expression)) {
-        eval = dtl_eval_add_expression;
+    // The header is written again once the sections are in place.
+    writer.ok = fwrite(&header, sizeof(header), 1, writer.file) == 1;
+
+    header.graph_offset = dtl_plan_write_tell(&writer);
+    if (writer.ok) {
+        writer.ok = dtl_ir_graph_write_image(program->graph, writer.file, dtl_plan_string_offset, &writer);
     }
+    header.graph_size = dtl_plan_write_tell(&writer) - header.graph_offset;
+    dtl_plan_write_padding(&writer);
 
-    if (dtl_ir_is_subtract_expression(graph, expression)) {
-        assert(false); // Not implemented.
+    header.metadata_offset = dtl_plan_write_tell(&writer);
+    dtl_plan_write_metadata(&writer, program);
+    header.metadata_size = dtl_plan_write_tell(&writer) - header.metadata_offset;
+
+    header.strings_offset = dtl_plan_write_tell(&writer);
+    for (i = 0; i < writer.num_strings && writer.ok; i++) {
+        if (fwrite(writer.strings[i], strlen(writer.strings[i]) + 1, 1, writer.file) != 1) {
+            writer.ok = false;
+        }
     }
+    header.strings_size = writer.strings_size;
 
-    if (dtl_ir_is_multiply_expression(graph, expression)) {
-        assert(false); // Not implemented.
+    memcpy(header.magic, DTL_PLAN_MAGIC, sizeof(header.magic));
+    header.version = DTL_PLAN_VERSION;
+    header.key = key;
+    if (writer.ok && fseek(writer.file, 0, SEEK_SET) != 0) {
+        writer.ok = false;
     }
-    if (dtl_ir_is_divide_expression(graph, expression)) {
-        assert(false); // Not implemented.
+    if (writer.ok && fwrite(&header, sizeof(header), 1, writer.file) != 1) {
+        writer.ok = false;
+    }
+    if (!writer.ok) {
+        errsv = errno;
+    }
+    if (fclose(writer.file) != 0 && writer.ok) {
+        errsv = errno;
+        writer.ok = false;
+    }
+    if (writer.ok && rename(temp_path, path) != 0) {
+        errsv = errno;
+        writer.ok = false;
     }
 
-    assert(eval != NULL);
-    return eval(context, expression, error);
+    if (!writer.ok) {
+        dtl_set_error(error, dtl_error_create("Could not write plan '%s': %s", path, strerror(errsv)));
+        unlink(temp_path);
+    }
+
+    free(writer.strings);
+    free(writer.string_offsets);
+    free(temp_path);
+
+    return writer.ok ? DTL_STATUS_OK : DTL_STATUS_ERROR;
 }
 
-enum dtl_status
-dtl_eval(
-    char const *source,
-    char const *filename,
-    struct dtl_io_importer *importer,
-    struct dtl_io_exporter *exporter,
-    struct dtl_io_tracer *tracer,
-    struct dtl_error **error
-) {
-    struct dtl_tokenizer *tokenizer;
-    int parse_result;
-    enum dtl_status status;
-    struct dtl_ast_node *root;
-    struct dtl_ir_graph *graph;
-    struct dtl_eval_context context;
+/* --- Mapping ---------------------------------------------------------------------------------- */
 
-    if (tracer != NULL) {
-        status = dtl_io_tracer_record_source(tracer, source, filename, error);
-        if (status != DTL_STATUS_OK) {
-            return status;
-        }
+// Plans are only ever read back by the build that wrote them, but files in the cache directory can
+// still be truncated or otherwise damaged, so everything read from them is checked.  A plan that
+// fails any check is treated as missing.
+
+struct dtl_plan_reader {
+    uint64_t const *words;
+    size_t num_words;
+    size_t position;
+
+    char const *strings;
+    size_t strings_size;
+
+    bool ok;
+};
+
+static uint64_t
+dtl_plan_read_word(struct dtl_plan_reader *reader) {
+    if (reader->position >= reader->num_words) {
+        reader->ok = false;
+        return 0;
+    }
+    return reader->words[reader->position++];
+}
+
+// Reads a count of items that each take at least one word, rejecting counts that could not fit in
+// what remains of the plan.
+static size_t
+dtl_plan_read_count(struct dtl_plan_reader *reader) {
+    uint64_t count;
+
+    count = dtl_plan_read_word(reader);
+    if (count > reader->num_words - reader->position) {
+        reader->ok = false;
+        return 0;
     }
+    return count;
+}
 
-    // === Parse Source Code =======================================================================
+static char const *
+dtl_plan_read_string(struct dtl_plan_reader *reader) {
+    uint64_t offset;
 
-    tokenizer = dtl_tokenizer_create(source, filename);
-    parse_result = dtl_parser_parse(tokenizer, &root, error);
-    if (parse_result != 0) {
-        return DTL_STATUS_ERROR;
+    offset = dtl_plan_read_word(reader);
+    if (offset >= reader->strings_size) {
+        reader->ok = false;
+        return "";
     }
-    dtl_tokenizer_destroy(tokenizer);
+    return reader->strings + offset;
+}
 
-    // === Compile AST to List of Tables Referencing IR Expressions ================================
+static struct dtl_schema *
+dtl_plan_read_schema(struct dtl_plan_reader *reader) {
+    struct dtl_schema *schema;
+    size_t num_columns;
+    char const *name;
+    uint64_t dtype;
+    size_t i;
 
-    graph = dtl_ir_graph_create();
-    context = (struct dtl_eval_context){
-        .importer = importer,
-        .exporter = exporter,
-        .tracer = tracer,
-        .graph = graph,
-    };
-    status = dtl_ast_to_ir(
-        root,
-        graph,
-        dtl_eval_ast_to_ir_import_callback,
-        dtl_eval_ast_to_ir_export_callback,
-        dtl_eval_ast_to_ir_trace_callback,
-        &context,
-        error
-    );
-    if (status != DTL_STATUS_OK) {
-        dtl_ir_graph_destroy(graph);
-        dtl_ast_node_destroy(root);
-        return status;
+    schema = dtl_schema_create();
+
+    num_columns = dtl_plan_read_count(reader);
+    for (i = 0; i < num_columns && reader->ok; i++) {
+        name = dtl_plan_read_string(reader);
+        dtype = dtl_plan_read_word(reader);
+
+        switch (dtype) {
+        case DTL_DTYPE_BOOL_ARRAY:
+        case DTL_DTYPE_INT64_ARRAY:
+        case DTL_DTYPE_DOUBLE_ARRAY:
+        case DTL_DTYPE_STRING_ARRAY:
+        case DTL_DTYPE_INDEX_ARRAY:
+            schema = dtl_schema_add_column(schema, name, (enum dtl_dtype)dtype);
+            break;
+        default:
+            reader->ok = false;
+            break;
+        }
     }
 
-    dtl_ast_node_destroy(root);
-    dtl_ir_viz(stderr, graph);
+    return schema;
+}
 
-    // === Generate Mappings =======================================================================
+static struct dtl_ir_ref *
+dtl_plan_read_expressions(struct dtl_plan_reader *reader, struct dtl_ir_graph *graph, struct dtl_schema *schema) {
+    struct dtl_ir_ref *expressions;
+    size_t num_columns;
+    uint64_t index;
+    size_t i;
 
-    // Generate initial mappings for all reachable expressions pairs.
-    // TODO
+    num_columns = dtl_schema_get_num_columns(schema);
+    expressions = calloc(num_columns > 0 ? num_columns : 1, sizeof(struct dtl_ir_ref));
 
-    // Merge mappings between expressions that aren't in the roots list.
-    // TODO
+    for (i = 0; i < num_columns && reader->ok; i++) {
+        index = dtl_plan_read_word(reader);
+        if (index >= dtl_ir_graph_get_size(graph)) {
+            reader->ok = false;
+            break;
+        }
+        expressions[i] = dtl_ir_index_to_ref(graph, index);
 
-    // === Optimise IR =============================================================================
+        if (dtl_ir_expression_get_dtype(graph, expressions[i]) != dtl_schema_get_column_dtype(schema, i)) {
+            reader->ok = false;
+        }
+    }
 
-    // Optimise regular joins to iteration on one side and lookup on index on other.
-    // TODO.
+    return expressions;
+}
 
-    // Deduplicate IR expressions.
-    // TODO.
+static struct dtl_location
+dtl_plan_read_location(struct dtl_plan_reader *reader, char const *filename) {
+    struct dtl_location location;
 
-    // Drop unreachable IR expressions.
-    // TODO
+    location.filename = filename;
+    location.offset = dtl_plan_read_word(reader);
+    location.lineno = dtl_plan_read_word(reader);
+    location.column = dtl_plan_read_word(reader);
 
-    // After this point the expression graph is frozen.  We no longer need to update roots.
+    return location;
+}
 
-    // === Compile Reachable Expressions to Command List ===========================================
-    // TODO
+static void
+dtl_plan_read_metadata(struct dtl_plan_reader *reader, struct dtl_program *program) {
+    struct dtl_eval_context_export *export;
+    struct dtl_eval_context_trace *trace;
+    struct dtl_eval_context_predicate *predicate;
+    size_t count;
+    size_t i;
 
-    // === Inject Commands to Export Tables ========================================================
-    // TODO
+    count = dtl_plan_read_count(reader);
+    program->imports = calloc(count > 0 ? count : 1, sizeof(struct dtl_program_import));
+    for (i = 0; i < count && reader->ok; i++) {
+        program->num_imports += 1;
+        program->imports[i].name = dtl_plan_read_string(reader);
+        program->imports[i].schema = dtl_plan_read_schema(reader);
+    }
 
-    // === Setup Tracing ===========================================================================
-    status = dtl_eval_tracing_record_import_metadata(&context, error);
-    if (status != DTL_STATUS_OK) {
-        return status;
+    count = dtl_plan_read_count(reader);
+    program->exports = calloc(count > 0 ? count : 1, sizeof(struct dtl_eval_context_export));
+    for (i = 0; i < count && reader->ok; i++) {
+        program->num_exports += 1;
+        export = &program->exports[i];
+        export->name = dtl_plan_read_string(reader);
+        export->schema = dtl_plan_read_schema(reader);
+        export->expressions = dtl_plan_read_expressions(reader, program->graph, export->schema);
     }
 
-    status = dtl_eval_tracing_record_export_metadata(&context, error);
-    if (status != DTL_STATUS_OK) {
-        return status;
+    count = dtl_plan_read_count(reader);
+    program->traces = calloc(count > 0 ? count : 1, sizeof(struct dtl_eval_context_trace));
+    for (i = 0; i < count && reader->ok; i++) {
+        program->num_traces += 1;
+        trace = &program->traces[i];
+        trace->start = dtl_plan_read_location(reader, program->filename);
+        trace->end = dtl_plan_read_location(reader, program->filename);
+        trace->schema = dtl_plan_read_schema(reader);
+        trace->expressions = dtl_plan_read_expressions(reader, program->graph, trace->schema);
     }
 
-    status = dtl_eval_tracing_record_trace_metadata(&context, error);
-    if (status != DTL_STATUS_OK) {
-        return status;
+    count = dtl_plan_read_count(reader);
+    program->predicates = calloc(count > 0 ? count : 1, sizeof(struct dtl_eval_context_predicate));
+    for (i = 0; i < count && reader->ok; i++) {
+        program->num_predicates += 1;
+        predicate = &program->predicates[i];
+        predicate->import = dtl_plan_read_word(reader);
+        predicate->column = dtl_plan_read_word(reader);
+        predicate->op = (enum dtl_io_predicate_op)dtl_plan_read_word(reader);
+        predicate->value = (int64_t)dtl_plan_read_word(reader);
+
+        if (predicate->import >= program->num_imports) {
+            reader->ok = false;
+        } else if (predicate->column >= dtl_schema_get_num_columns(program->imports[predicate->import].schema)) {
+            reader->ok = false;
+        } else if (predicate->op > DTL_IO_PREDICATE_GREATER_THAN_OR_EQUAL_TO) {
+            reader->ok = false;
+        }
     }
+}
 
-    void *traced_expressions = dtl_eval_tracing_mark_dependencies(&context);
+static bool
+dtl_plan_section_is_valid(uint64_t offset, uint64_t size, uint64_t file_size) {
+    return offset % 8 == 0 && offset <= file_size && size <= file_size - offset;
+}
 
-    // === Inject Commands to Collect Arrays After Use =============================================
-    // TODO
+// Maps the plan at `path`, if there is one and it was compiled from `source`.  Returns NULL if not.
+static struct dtl_program *
+dtl_plan_map(char const *path, char const *source, char const *filename) {
+    struct dtl_plan_header header;
+    struct dtl_plan_reader reader = {.ok = true};
+    struct dtl_program *program;
+    struct stat info;
+    void *image;
+    char *strings;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
 
-    // === Evaluate the Command List ===============================================================
-    size_t num_expressions = dtl_ir_graph_get_size(graph);
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(header)) {
+        close(fd);
+        return NULL;
+    }
 
-    context.values = calloc(num_expressions, sizeof(struct dtl_value));
-    for (size_t i = 0; i < num_expressions; i++) {
-        struct dtl_ir_ref expression = dtl_ir_index_to_ref(graph, i);
+    // Mapped privately so that the graph can relocate its identifiers without touching the file.
+    image = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return NULL;
+    }
 
-        status = dtl_eval_expression(&context, expression, error);
+    memcpy(&header, image, sizeof(header));
+    if (
+        memcmp(header.magic, DTL_PLAN_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != DTL_PLAN_VERSION ||
+        !dtl_plan_section_is_valid(header.graph_offset, header.graph_size, info.st_size) ||
+        !dtl_plan_section_is_valid(header.metadata_offset, header.metadata_size, info.st_size) ||
+        header.metadata_size % 8 != 0 ||
+        header.strings_offset > (uint64_t)info.st_size ||
+        header.strings_size > info.st_size - header.strings_offset ||
+        header.strings_size == 0
+    ) {
+        munmap(image, info.st_size);
+        return NULL;
     }
 
-    for (size_t i = 0; i < num_expressions; i++) {
-        if (context.tracer == NULL) {
-            break;
-        }
-        if (traced_expressions == NULL) {
-            continue;
-        }
-        if (!dtl_bool_array_get(traced_expressions, i)) {
-            continue;
-        }
+    strings = (char *)image + header.strings_offset;
+    if (strings[header.strings_size - 1] != '\0') {
+        munmap(image, info.st_size);
+        return NULL;
+    }
+
+    program = calloc(1, sizeof(struct dtl_program));
+    program->image = image;
+    program->image_size = info.st_size;
+    program->key = header.key;
 
-        struct dtl_ir_ref expression = dtl_ir_index_to_ref(graph, i);
+    program->graph = dtl_ir_graph_create_from_image(
+        (char *)image + header.graph_offset, header.graph_size, strings, header.strings_size
+    );
+    if (program->graph == NULL) {
+        dtl_program_destroy(program);
+        return NULL;
+    }
 
-        struct dtl_ir_ref shape_expression = dtl_ir_array_expression_get_shape(context.graph, expression);
-        size_t num_rows = dtl_eval_context_load_index(&context, shape_expression);
+    reader.words = (uint64_t const *)((char *)image + header.metadata_offset);
+    reader.num_words = header.metadata_size / 8;
+    reader.strings = strings;
+    reader.strings_size = header.strings_size;
 
-        status = dtl_io_tracer_record_value(
-            context.tracer,
-            i,
-            dtl_ir_expression_get_dtype(context.graph, expression),
-            num_rows,
-            &context.values[i],
-            error
-        );
-        if (status != DTL_STATUS_OK) {
-            return status;
-        }
+    // Guards against collisions between source hashes.
+    if (strcmp(dtl_plan_read_string(&reader), source) != 0 || !reader.ok) {
+        dtl_program_destroy(program);
+        return NULL;
     }
 
-    for (size_t i = 0; i < context.num_exports; i++) {
-        struct dtl_eval_context_export *export;
-        size_t num_cols;
-        size_t num_rows;
-        struct dtl_ir_ref shape_expression;
-        struct dtl_value **values;
-        size_t index;
+    // Locations should point at the script as it is being run now, which may have moved.
+    program->source = strdup(source);
+    program->filename = filename != NULL ? strdup(filename) : NULL;
 
-        export = &context.exports[i];
+    dtl_plan_read_metadata(&reader, program);
+    if (!reader.ok) {
+        dtl_program_destroy(program);
+        return NULL;
+    }
 
-        num_cols = dtl_schema_get_num_columns(export->schema);
-        num_rows = 0;
-        if (num_cols > 0) {
-            shape_expression = dtl_ir_array_expression_get_shape(context.graph, export->expressions[0]);
-            num_rows = dtl_eval_context_load_index(&context, shape_expression);
-        }
+    return program;
+}
 
-        values = calloc(num_cols, sizeof(struct dtl_value *));
-        for (size_t j = 0; j < num_cols; j++) {
-            index = dtl_ir_ref_to_index(context.graph, export->expressions[j]);
-            values[j] = &context.values[index];
-        }
+enum dtl_status
+dtl_eval_cached(
+    char const *source,
+    char const *filename,
+    char const *cache_dir,
+    struct dtl_io_importer *importer,
+    struct dtl_io_exporter *exporter,
+    struct dtl_io_tracer *tracer,
+    struct dtl_error **error
+) {
+    struct dtl_eval_context context = {.importer = importer};
+    struct dtl_program *program = NULL;
+    struct dtl_error *cache_error = NULL;
+    char **names = NULL;
+    size_t num_names = 0;
+    char *path;
+    size_t i;
+    enum dtl_status status;
 
-        status = dtl_io_exporter_export_table(
-            exporter,
-            export->name,
-            export->schema,
-            num_rows,
-            values,
-            error
-        );
+    path = dtl_plan_path(cache_dir, source);
+    if (path != NULL) {
+        program = dtl_plan_map(path, source, filename);
+    }
+
+    if (program != NULL) {
+        status = dtl_eval_open_tables(program, &context, error);
         if (status != DTL_STATUS_OK) {
+            dtl_eval_close_tables(&context);
+            dtl_program_destroy(program);
+            free(path);
             return status;
         }
 
-        free(values);
-    }
+        // Tables can't always be opened twice, so if the plan turns out to be stale the tables
+        // that are already open are handed on to the compiler.  Their names point into the plan,
+        // and so need copying before it is unmapped.
+        if (dtl_plan_key(program->source, &context) != program->key) {
+            num_names = context.num_imports;
+            names = calloc(num_names > 0 ? num_names : 1, sizeof(char *));
+            for (i = 0; i < num_names; i++) {
+                names[i] = strdup(context.imports[i].name);
+                context.imports[i].name = names[i];
+            }
 
-    // TODO
-    for (size_t i = 0; i < num_expressions; i++) {
-        struct dtl_ir_ref expression = dtl_ir_index_to_ref(graph, i);
-        dtl_eval_context_clear(&context, expression);
+            dtl_program_destroy(program);
+            program = NULL;
+        }
     }
-    free(context.values);
 
-    for (size_t i = 0; i < context.num_imports; i++) {
-        dtl_io_table_destroy(context.imports[i].table);
-    }
-    free(context.imports);
+    if (program == NULL) {
+        program = dtl_eval_compile(source, filename, &context, error);
+        if (program == NULL) {
+            dtl_eval_close_tables(&context);
+            for (i = 0; i < num_names; i++) {
+                free(names[i]);
+            }
+            free(names);
+            free(path);
+            return DTL_STATUS_ERROR;
+        }
 
-    for (size_t i = 0; i < context.num_exports; i++) {
-        dtl_schema_destroy(context.exports[i].schema);
-        free(context.exports[i].expressions);
-    }
+        for (i = 0; i < num_names; i++) {
+            free(names[i]);
+        }
+        free(names);
 
-    for (size_t i = 0; i < context.num_traces; i++) {
-        dtl_schema_destroy(context.traces[i].schema);
-        free(context.traces[i].expressions);
+        // Failing to store the plan only costs the next run a compile, so is not reported.
+        if (path != NULL) {
+            mkdir(cache_dir, 0777);
+            dtl_plan_write(program, dtl_plan_key(program->source, &context), path, &cache_error);
+            dtl_error_destroy(cache_error);
+        }
     }
+    free(path);
 
-    dtl_ir_graph_destroy(graph);
+    context.exporter = exporter;
+    context.tracer = tracer;
+    status = dtl_eval_execute(program, &context, error);
 
-    return DTL_STATUS_OK;
+    dtl_eval_close_tables(&context);
+    dtl_program_destroy(program);
+
+    return status;
 }
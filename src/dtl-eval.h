@@ -1,8 +1,41 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "dtl-error.h"
 #include "dtl-io.h"
 
+// A script compiled against the schemas of the tables it imports.  Programs can be executed any
+// number of times, against any inputs that have the same schemas as the tables they were compiled
+// against, without parsing or optimising the script again.
+struct dtl_program;
+
+// The importer is only used to look up the schemas of the imported tables.  Tables are closed
+// again before returning.  Returns NULL on error.
+struct dtl_program *
+dtl_compile(char const *source, char const *filename, struct dtl_io_importer *importer, struct dtl_error **error);
+
+// Returns true if every table read by the program can be imported from `importer`, and has the
+// schema that the program was compiled against.  Tables are closed again before returning.
+bool
+dtl_program_matches_inputs(struct dtl_program *program, struct dtl_io_importer *importer);
+
+// Imports every table read by the program from `importer`, checking that their schemas match the
+// ones the program was compiled against, and evaluates the program against them.  The tracer is
+// optional.
+enum dtl_status
+dtl_program_execute(
+    struct dtl_program *program,
+    struct dtl_io_importer *importer,
+    struct dtl_io_exporter *exporter,
+    struct dtl_io_tracer *tracer,
+    struct dtl_error **error
+);
+
+void
+dtl_program_destroy(struct dtl_program *program);
+
+// Compiles and executes a script in one go.
 enum dtl_status
 dtl_eval(
     char const *source,
@@ -12,3 +45,17 @@ dtl_eval(
     struct dtl_io_tracer *tracer,
     struct dtl_error **error
 );
+
+// As `dtl_eval`, but first looks in `cache_dir` for a plan compiled from the same script against
+// tables with the same schemas, and maps it rather than compiling the script again.  Newly
+// compiled plans are written back to the cache.
+enum dtl_status
+dtl_eval_cached(
+    char const *source,
+    char const *filename,
+    char const *cache_dir,
+    struct dtl_io_importer *importer,
+    struct dtl_io_exporter *exporter,
+    struct dtl_io_tracer *tracer,
+    struct dtl_error **error
+);
@@ -4,6 +4,8 @@
 #include <stddef.h>
 #include <stdlib.h>
 
+#include "dtl-bool-array.h"
+
 size_t *
 dtl_index_array_create(size_t size) {
     return calloc(size, sizeof(size_t));
@@ -26,3 +28,55 @@ dtl_index_array_get(size_t *array, size_t index) {
     assert(array != NULL);
     return array[index];
 }
+
+void
+dtl_index_array_pick(size_t const *restrict array, size_t const *restrict indexes, size_t size, size_t *restrict out) {
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        out[i] = array[indexes[i]];
+    }
+}
+
+void
+dtl_index_array_where(void const *restrict mask, size_t size, size_t *restrict out) {
+    size_t cursor = 0;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        if (dtl_bool_array_get(mask, i)) {
+            out[cursor++] = i;
+        }
+    }
+}
+
+void
+dtl_index_array_group(size_t const *array, size_t size, size_t *num_keys, size_t **offsets, size_t **entries) {
+    size_t key;
+    size_t i;
+
+    *num_keys = 0;
+    for (i = 0; i < size; i++) {
+        *num_keys = array[i] + 1 > *num_keys ? array[i] + 1 : *num_keys;
+    }
+
+    // Padded so that empty arrays still get an allocation.
+    *offsets = dtl_index_array_create(*num_keys + 1);
+    *entries = dtl_index_array_create(size + 1);
+
+    // Counting sort.  Each offset is advanced past its run as the run is filled, and then shifted
+    // back.
+    for (i = 0; i < size; i++) {
+        (*offsets)[array[i] + 1] += 1;
+    }
+    for (key = 0; key < *num_keys; key++) {
+        (*offsets)[key + 1] += (*offsets)[key];
+    }
+    for (i = 0; i < size; i++) {
+        (*entries)[(*offsets)[array[i]]++] = i;
+    }
+    for (key = *num_keys; key > 0; key--) {
+        (*offsets)[key] = (*offsets)[key - 1];
+    }
+    (*offsets)[0] = 0;
+}
@@ -13,3 +13,18 @@ dtl_index_array_set(size_t *array, size_t index, size_t value);
 
 size_t
 dtl_index_array_get(size_t *array, size_t index);
+
+// Gathers `out[i] = array[indexes[i]]` for the first `size` indexes.
+void
+dtl_index_array_pick(size_t const *restrict array, size_t const *restrict indexes, size_t size, size_t *restrict out);
+
+// Writes the index of every true value in the first `size` values of `mask` to `out`.
+void
+dtl_index_array_where(void const *restrict mask, size_t size, size_t *restrict out);
+
+// Groups the positions of the first `size` values of `array` by value, in compressed sparse row
+// form.  Positions holding value `v` are `entries[offsets[v]..offsets[v + 1]]`, in ascending order.
+// `num_keys` is set to one more than the largest value.  `offsets` and `entries` are allocated with
+// `dtl_index_array_create`, and hold `num_keys + 1` and `size` values.
+void
+dtl_index_array_group(size_t const *array, size_t size, size_t *num_keys, size_t **offsets, size_t **entries);
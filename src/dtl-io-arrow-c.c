@@ -0,0 +1,838 @@
+#include "dtl-io-arrow-c.h"
+
+#include <arrow/c/abi.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtl-bool-array.h"
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-io.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+
+/* === Importer ================================================================================= */
+
+struct dtl_io_arrow_c_table {
+    struct dtl_io_table base;
+
+    // Record batches read from the stream.  Released when the table is destroyed, as columns can
+    // borrow their buffers.
+    struct ArrowArray *batches;
+    size_t num_batches;
+    size_t num_rows;
+
+    // Arrow format character of each column.  Only primitive types are accepted.
+    char *formats;
+
+    // Data handed out by `read_column_data`, indexed by column.  Entries are either borrowed from
+    // `batches` or allocated by us and flagged in `owned_columns`.
+    void **columns;
+    bool *owned_columns;
+};
+
+struct dtl_io_arrow_c_importer_stream {
+    char *name;
+    struct ArrowArrayStream stream;
+};
+
+struct dtl_io_arrow_c_importer {
+    struct dtl_io_importer base;
+
+    // Guards `streams`, as tables can be imported concurrently.
+    pthread_mutex_t lock;
+
+    struct dtl_io_arrow_c_importer_stream *streams;
+    size_t num_streams;
+};
+
+static size_t
+dtl_io_arrow_c_table_get_num_rows(struct dtl_io_table *table) {
+    struct dtl_io_arrow_c_table *arrow_table;
+
+    assert(table != NULL);
+    assert(table->get_num_rows == dtl_io_arrow_c_table_get_num_rows);
+
+    arrow_table = (struct dtl_io_arrow_c_table *)table;
+
+    return arrow_table->num_rows;
+}
+
+static size_t
+dtl_io_arrow_c_count_nulls(struct ArrowArray const *array, int64_t offset, int64_t length) {
+    uint8_t const *validity;
+    size_t count = 0;
+
+    if (array->null_count == 0 || array->n_buffers < 1 || array->buffers[0] == NULL) {
+        return 0;
+    }
+
+    validity = array->buffers[0];
+    for (int64_t i = offset; i < offset + length; i++) {
+        count += !((validity[i / 8] >> (i % 8)) & 1);
+    }
+    return count;
+}
+
+static void
+dtl_io_arrow_c_copy_values(
+    char format,
+    struct ArrowArray const *array,
+    int64_t offset,
+    int64_t length,
+    void *out,
+    size_t out_offset
+) {
+    void const *values = array->buffers[1];
+
+    switch (format) {
+    case 'b':
+        for (int64_t i = 0; i < length; i++) {
+            if ((((uint8_t const *)values)[(offset + i) / 8] >> ((offset + i) % 8)) & 1) {
+                dtl_bool_array_set(out, out_offset + i, true);
+            }
+        }
+        break;
+    case 'c':
+        for (int64_t i = 0; i < length; i++) {
+            ((int64_t *)out)[out_offset + i] = ((int8_t const *)values)[offset + i];
+        }
+        break;
+    case 's':
+        for (int64_t i = 0; i < length; i++) {
+            ((int64_t *)out)[out_offset + i] = ((int16_t const *)values)[offset + i];
+        }
+        break;
+    case 'i':
+        for (int64_t i = 0; i < length; i++) {
+            ((int64_t *)out)[out_offset + i] = ((int32_t const *)values)[offset + i];
+        }
+        break;
+    case 'l':
+        memcpy((int64_t *)out + out_offset, (int64_t const *)values + offset, length * sizeof(int64_t));
+        break;
+    case 'f':
+        for (int64_t i = 0; i < length; i++) {
+            ((double *)out)[out_offset + i] = ((float const *)values)[offset + i];
+        }
+        break;
+    case 'g':
+        memcpy((double *)out + out_offset, (double const *)values + offset, length * sizeof(double));
+        break;
+    default:
+        assert(false); // Rejected when the table was imported.
+    }
+}
+
+static enum dtl_status
+dtl_io_arrow_c_table_read_column_data(
+    struct dtl_io_table *table,
+    size_t col_index,
+    struct dtl_value *out,
+    struct dtl_error **error
+) {
+    struct dtl_io_arrow_c_table *arrow_table;
+    enum dtl_dtype dtype;
+    struct ArrowArray const *batch;
+    struct ArrowArray const *child;
+    char format;
+    void *data;
+    size_t cursor;
+    int64_t offset;
+
+    assert(table != NULL);
+    assert(table->read_column_data == dtl_io_arrow_c_table_read_column_data);
+
+    arrow_table = (struct dtl_io_arrow_c_table *)table;
+    dtype = dtl_schema_get_column_dtype(table->schema, col_index);
+    format = arrow_table->formats[col_index];
+
+    data = arrow_table->columns[col_index];
+    if (data == NULL) {
+        for (size_t i = 0; i < arrow_table->num_batches; i++) {
+            batch = &arrow_table->batches[i];
+            child = batch->children[col_index];
+            if (dtl_io_arrow_c_count_nulls(child, child->offset + batch->offset, batch->length) != 0) {
+                dtl_set_error(
+                    error,
+                    dtl_error_create(
+                        "Column '%s' contains null values", dtl_schema_get_column_name(table->schema, col_index)
+                    )
+                );
+                return DTL_STATUS_ERROR;
+            }
+        }
+
+        // A single batch of 64 bit values can be handed to the evaluator as is.  Bitmaps are
+        // always copied as DTL reads them a word at a time, which could run past the end of the
+        // buffer.
+        if (arrow_table->num_batches == 1 && (format == 'l' || format == 'g')) {
+            batch = &arrow_table->batches[0];
+            child = batch->children[col_index];
+            offset = child->offset + batch->offset;
+            data = (void *)((uint8_t const *)child->buffers[1] + offset * 8);
+            if (child->buffers[1] != NULL && (uintptr_t)data % 8 == 0) {
+                arrow_table->columns[col_index] = data;
+                arrow_table->owned_columns[col_index] = false;
+            }
+        }
+
+        if (arrow_table->columns[col_index] == NULL) {
+            if (format == 'b') {
+                data = dtl_bool_array_create(arrow_table->num_rows);
+            } else {
+                data = calloc(arrow_table->num_rows > 0 ? arrow_table->num_rows : 1, 8);
+            }
+
+            cursor = 0;
+            for (size_t i = 0; i < arrow_table->num_batches; i++) {
+                batch = &arrow_table->batches[i];
+                child = batch->children[col_index];
+                dtl_io_arrow_c_copy_values(
+                    format, child, child->offset + batch->offset, batch->length, data, cursor
+                );
+                cursor += batch->length;
+            }
+
+            arrow_table->columns[col_index] = data;
+            arrow_table->owned_columns[col_index] = true;
+        }
+
+        data = arrow_table->columns[col_index];
+    }
+
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        dtl_value_take_bool_array(out, data);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        dtl_value_take_int64_array(out, (int64_t *)data);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        dtl_value_take_double_array(out, (double *)data);
+        break;
+    default:
+        assert(false);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static void
+dtl_io_arrow_c_table_destroy(struct dtl_io_table *table) {
+    struct dtl_io_arrow_c_table *arrow_table;
+    size_t col;
+
+    assert(table != NULL);
+    assert(table->destroy == dtl_io_arrow_c_table_destroy);
+
+    arrow_table = (struct dtl_io_arrow_c_table *)table;
+
+    for (col = 0; col < dtl_schema_get_num_columns(table->schema); col++) {
+        if (arrow_table->owned_columns[col]) {
+            free(arrow_table->columns[col]);
+        }
+    }
+    free(arrow_table->columns);
+    free(arrow_table->owned_columns);
+    free(arrow_table->formats);
+
+    for (size_t i = 0; i < arrow_table->num_batches; i++) {
+        arrow_table->batches[i].release(&arrow_table->batches[i]);
+    }
+    free(arrow_table->batches);
+
+    dtl_schema_destroy(table->schema);
+
+    free(arrow_table);
+}
+
+static void
+dtl_io_arrow_c_set_stream_error(
+    struct ArrowArrayStream *stream,
+    char const *name,
+    int code,
+    struct dtl_error **error
+) {
+    char const *message = stream->get_last_error(stream);
+
+    if (message == NULL) {
+        dtl_set_error(error, dtl_error_create("Could not read table '%s': error %i", name, code));
+    } else {
+        dtl_set_error(error, dtl_error_create("Could not read table '%s': %s", name, message));
+    }
+}
+
+static struct dtl_schema *
+dtl_io_arrow_c_import_schema(
+    struct ArrowSchema const *arrow_schema,
+    char const *name,
+    char *formats,
+    struct dtl_error **error
+) {
+    struct dtl_schema *schema;
+    struct ArrowSchema const *child;
+    enum dtl_dtype dtype;
+
+    if (strcmp(arrow_schema->format, "+s") != 0) {
+        dtl_set_error(error, dtl_error_create("Stream for table '%s' does not contain record batches", name));
+        return NULL;
+    }
+
+    schema = dtl_schema_create();
+    for (int64_t i = 0; i < arrow_schema->n_children; i++) {
+        child = arrow_schema->children[i];
+
+        dtype = 0;
+        if (strlen(child->format) == 1) {
+            switch (child->format[0]) {
+            case 'b':
+                dtype = DTL_DTYPE_BOOL_ARRAY;
+                break;
+            case 'c':
+            case 's':
+            case 'i':
+            case 'l':
+                dtype = DTL_DTYPE_INT64_ARRAY;
+                break;
+            case 'f':
+            case 'g':
+                dtype = DTL_DTYPE_DOUBLE_ARRAY;
+                break;
+            default:
+                break;
+            }
+        }
+        if (dtype == 0) {
+            dtl_set_error(
+                error,
+                dtl_error_create(
+                    "Column '%s' of table '%s' has unsupported format '%s'",
+                    child->name != NULL ? child->name : "", name, child->format
+                )
+            );
+            dtl_schema_destroy(schema);
+            return NULL;
+        }
+
+        formats[i] = child->format[0];
+        schema = dtl_schema_add_column(schema, child->name != NULL ? child->name : "", dtype);
+    }
+
+    return schema;
+}
+
+static struct dtl_io_table *
+dtl_io_arrow_c_importer_import_table(struct dtl_io_importer *importer, char const *name, struct dtl_error **error) {
+    struct dtl_io_arrow_c_importer *arrow_importer;
+    struct ArrowArrayStream stream = {0};
+    struct ArrowSchema arrow_schema = {0};
+    struct ArrowArray batch;
+    struct dtl_io_arrow_c_table *arrow_table = NULL;
+    struct dtl_schema *schema = NULL;
+    size_t num_columns;
+    char *formats = NULL;
+    int code;
+
+    assert(importer != NULL);
+    assert(importer->import_table == dtl_io_arrow_c_importer_import_table);
+    assert(name != NULL);
+
+    arrow_importer = (struct dtl_io_arrow_c_importer *)importer;
+
+    // Streams can only be read once, so they are moved out of the importer.
+    pthread_mutex_lock(&arrow_importer->lock);
+    for (size_t i = 0; i < arrow_importer->num_streams; i++) {
+        if (arrow_importer->streams[i].stream.release != NULL && strcmp(arrow_importer->streams[i].name, name) == 0) {
+            stream = arrow_importer->streams[i].stream;
+            arrow_importer->streams[i].stream.release = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&arrow_importer->lock);
+
+    if (stream.release == NULL) {
+        dtl_set_error(error, dtl_error_create("No stream available for table '%s'", name));
+        return NULL;
+    }
+
+    code = stream.get_schema(&stream, &arrow_schema);
+    if (code != 0) {
+        dtl_io_arrow_c_set_stream_error(&stream, name, code, error);
+        goto done;
+    }
+
+    num_columns = arrow_schema.n_children;
+    formats = calloc(num_columns > 0 ? num_columns : 1, sizeof(char));
+    schema = dtl_io_arrow_c_import_schema(&arrow_schema, name, formats, error);
+    if (schema == NULL) {
+        goto done;
+    }
+
+    arrow_table = calloc(1, sizeof(struct dtl_io_arrow_c_table));
+    arrow_table->base.schema = schema;
+    arrow_table->base.get_num_rows = dtl_io_arrow_c_table_get_num_rows;
+    arrow_table->base.read_column_data = dtl_io_arrow_c_table_read_column_data;
+    arrow_table->base.destroy = dtl_io_arrow_c_table_destroy;
+    arrow_table->formats = formats;
+    arrow_table->columns = calloc(num_columns > 0 ? num_columns : 1, sizeof(void *));
+    arrow_table->owned_columns = calloc(num_columns > 0 ? num_columns : 1, sizeof(bool));
+    formats = NULL;
+
+    while (true) {
+        code = stream.get_next(&stream, &batch);
+        if (code != 0) {
+            dtl_io_arrow_c_set_stream_error(&stream, name, code, error);
+            dtl_io_arrow_c_table_destroy(&arrow_table->base);
+            arrow_table = NULL;
+            goto done;
+        }
+        if (batch.release == NULL) {
+            break; // End of stream.
+        }
+
+        if (batch.null_count != 0 && dtl_io_arrow_c_count_nulls(&batch, batch.offset, batch.length) != 0) {
+            dtl_set_error(error, dtl_error_create("Table '%s' contains null rows", name));
+            batch.release(&batch);
+            dtl_io_arrow_c_table_destroy(&arrow_table->base);
+            arrow_table = NULL;
+            goto done;
+        }
+
+        arrow_table->num_batches += 1;
+        arrow_table->batches = realloc(
+            arrow_table->batches, arrow_table->num_batches * sizeof(struct ArrowArray)
+        );
+        arrow_table->batches[arrow_table->num_batches - 1] = batch;
+        arrow_table->num_rows += batch.length;
+    }
+
+done:
+    free(formats);
+    if (arrow_schema.release != NULL) {
+        arrow_schema.release(&arrow_schema);
+    }
+    stream.release(&stream);
+    return arrow_table == NULL ? NULL : &arrow_table->base;
+}
+
+struct dtl_io_importer *
+dtl_io_arrow_c_importer_create(void) {
+    struct dtl_io_arrow_c_importer *arrow_importer;
+
+    arrow_importer = calloc(1, sizeof(struct dtl_io_arrow_c_importer));
+    arrow_importer->base.import_table = dtl_io_arrow_c_importer_import_table;
+    pthread_mutex_init(&arrow_importer->lock, NULL);
+
+    return &arrow_importer->base;
+}
+
+void
+dtl_io_arrow_c_importer_add_stream(struct dtl_io_importer *importer, char const *name, struct ArrowArrayStream *stream) {
+    struct dtl_io_arrow_c_importer *arrow_importer;
+    struct dtl_io_arrow_c_importer_stream *entry;
+
+    assert(importer != NULL);
+    assert(importer->import_table == dtl_io_arrow_c_importer_import_table);
+    assert(name != NULL);
+    assert(stream != NULL);
+    assert(stream->release != NULL);
+
+    arrow_importer = (struct dtl_io_arrow_c_importer *)importer;
+
+    pthread_mutex_lock(&arrow_importer->lock);
+    arrow_importer->num_streams += 1;
+    arrow_importer->streams = realloc(
+        arrow_importer->streams, arrow_importer->num_streams * sizeof(struct dtl_io_arrow_c_importer_stream)
+    );
+    entry = &arrow_importer->streams[arrow_importer->num_streams - 1];
+    entry->name = strdup(name);
+    entry->stream = *stream;
+    pthread_mutex_unlock(&arrow_importer->lock);
+
+    stream->release = NULL;
+}
+
+void
+dtl_io_arrow_c_importer_destroy(struct dtl_io_importer *importer) {
+    struct dtl_io_arrow_c_importer *arrow_importer;
+
+    if (importer == NULL) {
+        return;
+    }
+
+    assert(importer->import_table == dtl_io_arrow_c_importer_import_table);
+
+    arrow_importer = (struct dtl_io_arrow_c_importer *)importer;
+
+    for (size_t i = 0; i < arrow_importer->num_streams; i++) {
+        if (arrow_importer->streams[i].stream.release != NULL) {
+            arrow_importer->streams[i].stream.release(&arrow_importer->streams[i].stream);
+        }
+        free(arrow_importer->streams[i].name);
+    }
+    free(arrow_importer->streams);
+
+    pthread_mutex_destroy(&arrow_importer->lock);
+    free(arrow_importer);
+}
+
+/* === Exporter ================================================================================= */
+
+struct dtl_io_arrow_c_exporter_table {
+    char *name;
+    struct dtl_schema *schema;
+    struct ArrowArray array;
+};
+
+struct dtl_io_arrow_c_exporter {
+    struct dtl_io_exporter base;
+
+    // Guards `tables`, as tables can be exported concurrently.
+    pthread_mutex_t lock;
+
+    struct dtl_io_arrow_c_exporter_table *tables;
+    size_t num_tables;
+};
+
+static void
+dtl_io_arrow_c_release_column(struct ArrowArray *array) {
+    free((void *)array->buffers[1]);
+    free(array->buffers);
+    array->release = NULL;
+}
+
+static void
+dtl_io_arrow_c_release_table(struct ArrowArray *array) {
+    for (int64_t i = 0; i < array->n_children; i++) {
+        if (array->children[i]->release != NULL) {
+            array->children[i]->release(array->children[i]);
+        }
+        free(array->children[i]);
+    }
+    free(array->children);
+    free(array->buffers);
+    array->release = NULL;
+}
+
+static void
+dtl_io_arrow_c_release_schema(struct ArrowSchema *schema) {
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        if (schema->children[i]->release != NULL) {
+            schema->children[i]->release(schema->children[i]);
+        }
+        free(schema->children[i]);
+    }
+    free(schema->children);
+    free((void *)schema->name);
+    schema->release = NULL;
+}
+
+static char const *
+dtl_io_arrow_c_dtype_format(enum dtl_dtype dtype) {
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        return "b";
+    case DTL_DTYPE_INT64_ARRAY:
+        return "l";
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        return "g";
+    default:
+        assert(false); // TODO
+    }
+    return NULL;
+}
+
+static void
+dtl_io_arrow_c_export_schema(struct dtl_schema *schema, struct ArrowSchema *out) {
+    size_t num_columns = dtl_schema_get_num_columns(schema);
+
+    *out = (struct ArrowSchema){
+        .format = "+s",
+        .name = strdup(""),
+        .n_children = num_columns,
+        .children = calloc(num_columns > 0 ? num_columns : 1, sizeof(struct ArrowSchema *)),
+        .release = dtl_io_arrow_c_release_schema,
+    };
+
+    for (size_t col = 0; col < num_columns; col++) {
+        out->children[col] = malloc(sizeof(struct ArrowSchema));
+        *out->children[col] = (struct ArrowSchema){
+            .format = dtl_io_arrow_c_dtype_format(dtl_schema_get_column_dtype(schema, col)),
+            .name = strdup(dtl_schema_get_column_name(schema, col)),
+            .flags = ARROW_FLAG_NULLABLE,
+            .release = dtl_io_arrow_c_release_schema,
+        };
+    }
+}
+
+static enum dtl_status
+dtl_io_arrow_c_exporter_export_table(
+    struct dtl_io_exporter *exporter,
+    char const *table_name,
+    struct dtl_schema *schema,
+    size_t num_rows,
+    struct dtl_value **values,
+    struct dtl_error **error
+) {
+    struct dtl_io_arrow_c_exporter *arrow_exporter;
+    struct dtl_io_arrow_c_exporter_table table;
+    size_t num_columns;
+    size_t size;
+    void const *data;
+    void *copy;
+    size_t i;
+
+    (void)error;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_arrow_c_exporter_export_table);
+    assert(table_name != NULL);
+    assert(schema != NULL);
+    assert(values != NULL);
+
+    arrow_exporter = (struct dtl_io_arrow_c_exporter *)exporter;
+    num_columns = dtl_schema_get_num_columns(schema);
+
+    table.name = strdup(table_name);
+    table.schema = dtl_schema_create();
+    table.array = (struct ArrowArray){
+        .length = num_rows,
+        .n_buffers = 1,
+        .n_children = num_columns,
+        .buffers = calloc(1, sizeof(void const *)),
+        .children = calloc(num_columns > 0 ? num_columns : 1, sizeof(struct ArrowArray *)),
+        .release = dtl_io_arrow_c_release_table,
+    };
+
+    // Values are only lent to exporters, and the same array can be exported, traced, and owned by
+    // an imported table all at once, so each column is copied into a buffer owned by the array.
+    // This is a single copy of the raw values, with no conversion.
+    for (size_t col = 0; col < num_columns; col++) {
+        switch (dtl_schema_get_column_dtype(schema, col)) {
+        case DTL_DTYPE_BOOL_ARRAY:
+            data = dtl_value_get_bool_array(values[col]);
+            size = (num_rows + 7) / 8;
+            break;
+        case DTL_DTYPE_INT64_ARRAY:
+            data = dtl_value_get_int64_array(values[col]);
+            size = num_rows * sizeof(int64_t);
+            break;
+        case DTL_DTYPE_DOUBLE_ARRAY:
+            data = dtl_value_get_double_array(values[col]);
+            size = num_rows * sizeof(double);
+            break;
+        default:
+            assert(false); // TODO
+        }
+
+        copy = malloc(size > 0 ? size : 1);
+        memcpy(copy, data, size);
+
+        table.array.children[col] = malloc(sizeof(struct ArrowArray));
+        *table.array.children[col] = (struct ArrowArray){
+            .length = num_rows,
+            .n_buffers = 2,
+            .buffers = calloc(2, sizeof(void const *)),
+            .release = dtl_io_arrow_c_release_column,
+        };
+        table.array.children[col]->buffers[1] = copy;
+
+        table.schema = dtl_schema_add_column(
+            table.schema, dtl_schema_get_column_name(schema, col), dtl_schema_get_column_dtype(schema, col)
+        );
+    }
+
+    // Later exports with the same name replace earlier ones.
+    pthread_mutex_lock(&arrow_exporter->lock);
+    for (i = 0; i < arrow_exporter->num_tables; i++) {
+        if (strcmp(arrow_exporter->tables[i].name, table_name) == 0) {
+            break;
+        }
+    }
+    if (i == arrow_exporter->num_tables) {
+        arrow_exporter->num_tables += 1;
+        arrow_exporter->tables = realloc(
+            arrow_exporter->tables, arrow_exporter->num_tables * sizeof(struct dtl_io_arrow_c_exporter_table)
+        );
+    } else {
+        free(arrow_exporter->tables[i].name);
+        dtl_schema_destroy(arrow_exporter->tables[i].schema);
+        if (arrow_exporter->tables[i].array.release != NULL) {
+            arrow_exporter->tables[i].array.release(&arrow_exporter->tables[i].array);
+        }
+    }
+    arrow_exporter->tables[i] = table;
+    pthread_mutex_unlock(&arrow_exporter->lock);
+
+    return DTL_STATUS_OK;
+}
+
+struct dtl_io_exporter *
+dtl_io_arrow_c_exporter_create(void) {
+    struct dtl_io_arrow_c_exporter *arrow_exporter;
+
+    arrow_exporter = calloc(1, sizeof(struct dtl_io_arrow_c_exporter));
+    arrow_exporter->base.export_table = dtl_io_arrow_c_exporter_export_table;
+    pthread_mutex_init(&arrow_exporter->lock, NULL);
+
+    return &arrow_exporter->base;
+}
+
+// Moves the named table out of the exporter.  The caller takes ownership of the schema.
+static struct dtl_schema *
+dtl_io_arrow_c_exporter_remove_table(struct dtl_io_exporter *exporter, char const *name, struct ArrowArray *array) {
+    struct dtl_io_arrow_c_exporter *arrow_exporter;
+    struct dtl_io_arrow_c_exporter_table *table;
+    struct dtl_schema *schema = NULL;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_arrow_c_exporter_export_table);
+    assert(name != NULL);
+
+    arrow_exporter = (struct dtl_io_arrow_c_exporter *)exporter;
+
+    pthread_mutex_lock(&arrow_exporter->lock);
+    for (size_t i = 0; i < arrow_exporter->num_tables; i++) {
+        table = &arrow_exporter->tables[i];
+        if (strcmp(table->name, name) != 0) {
+            continue;
+        }
+
+        schema = table->schema;
+        *array = table->array;
+        free(table->name);
+
+        arrow_exporter->num_tables -= 1;
+        memmove(table, table + 1, (arrow_exporter->num_tables - i) * sizeof(struct dtl_io_arrow_c_exporter_table));
+        break;
+    }
+    pthread_mutex_unlock(&arrow_exporter->lock);
+
+    return schema;
+}
+
+bool
+dtl_io_arrow_c_exporter_take_table(
+    struct dtl_io_exporter *exporter,
+    char const *name,
+    struct ArrowSchema *schema,
+    struct ArrowArray *array
+) {
+    struct dtl_schema *dtl_schema;
+
+    assert(schema != NULL);
+    assert(array != NULL);
+
+    dtl_schema = dtl_io_arrow_c_exporter_remove_table(exporter, name, array);
+    if (dtl_schema == NULL) {
+        return false;
+    }
+
+    dtl_io_arrow_c_export_schema(dtl_schema, schema);
+    dtl_schema_destroy(dtl_schema);
+    return true;
+}
+
+/* --- Streams ---------------------------------------------------------------------------------- */
+
+struct dtl_io_arrow_c_stream {
+    struct dtl_schema *schema;
+    struct ArrowArray array;
+};
+
+static int
+dtl_io_arrow_c_stream_get_schema(struct ArrowArrayStream *stream, struct ArrowSchema *out) {
+    struct dtl_io_arrow_c_stream *data = stream->private_data;
+
+    dtl_io_arrow_c_export_schema(data->schema, out);
+    return 0;
+}
+
+static int
+dtl_io_arrow_c_stream_get_next(struct ArrowArrayStream *stream, struct ArrowArray *out) {
+    struct dtl_io_arrow_c_stream *data = stream->private_data;
+
+    // The table is moved out by the first call.  After that `array` is marked as released, which
+    // signals the end of the stream.
+    *out = data->array;
+    data->array.release = NULL;
+    return 0;
+}
+
+static char const *
+dtl_io_arrow_c_stream_get_last_error(struct ArrowArrayStream *stream) {
+    (void)stream;
+
+    return NULL;
+}
+
+static void
+dtl_io_arrow_c_stream_release(struct ArrowArrayStream *stream) {
+    struct dtl_io_arrow_c_stream *data = stream->private_data;
+
+    if (data->array.release != NULL) {
+        data->array.release(&data->array);
+    }
+    dtl_schema_destroy(data->schema);
+    free(data);
+
+    stream->release = NULL;
+}
+
+bool
+dtl_io_arrow_c_exporter_take_stream(struct dtl_io_exporter *exporter, char const *name, struct ArrowArrayStream *stream) {
+    struct dtl_io_arrow_c_stream *data;
+    struct ArrowArray array;
+    struct dtl_schema *schema;
+
+    assert(stream != NULL);
+
+    schema = dtl_io_arrow_c_exporter_remove_table(exporter, name, &array);
+    if (schema == NULL) {
+        return false;
+    }
+
+    data = calloc(1, sizeof(struct dtl_io_arrow_c_stream));
+    data->schema = schema;
+    data->array = array;
+
+    *stream = (struct ArrowArrayStream){
+        .get_schema = dtl_io_arrow_c_stream_get_schema,
+        .get_next = dtl_io_arrow_c_stream_get_next,
+        .get_last_error = dtl_io_arrow_c_stream_get_last_error,
+        .release = dtl_io_arrow_c_stream_release,
+        .private_data = data,
+    };
+    return true;
+}
+
+void
+dtl_io_arrow_c_exporter_destroy(struct dtl_io_exporter *exporter) {
+    struct dtl_io_arrow_c_exporter *arrow_exporter;
+
+    if (exporter == NULL) {
+        return;
+    }
+
+    assert(exporter->export_table == dtl_io_arrow_c_exporter_export_table);
+
+    arrow_exporter = (struct dtl_io_arrow_c_exporter *)exporter;
+
+    for (size_t i = 0; i < arrow_exporter->num_tables; i++) {
+        free(arrow_exporter->tables[i].name);
+        dtl_schema_destroy(arrow_exporter->tables[i].schema);
+        if (arrow_exporter->tables[i].array.release != NULL) {
+            arrow_exporter->tables[i].array.release(&arrow_exporter->tables[i].array);
+        }
+    }
+    free(arrow_exporter->tables);
+
+    pthread_mutex_destroy(&arrow_exporter->lock);
+    free(arrow_exporter);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <arrow/c/abi.h>
+#include <stdbool.h>
+
+#include "dtl-io.h"
+
+// Passes tables in and out of DTL in process using the Arrow C data interface, for embedding DTL
+// in programs that already hold their data in Arrow.
+
+// Tables are looked up by name from the streams registered with `add_stream`.
+struct dtl_io_importer *
+dtl_io_arrow_c_importer_create(void);
+
+// Registers a stream of record batches to be imported as `name`.  The importer takes ownership of
+// the stream, leaving `stream` released.  Each stream can only be imported once.  Where possible,
+// column buffers are handed to the evaluator as is, and stay owned by the stream's arrays until
+// the table is destroyed.
+void
+dtl_io_arrow_c_importer_add_stream(struct dtl_io_importer *, char const *name, struct ArrowArrayStream *stream);
+
+void
+dtl_io_arrow_c_importer_destroy(struct dtl_io_importer *);
+
+// Exported tables are held by the exporter until they are taken by the caller.
+struct dtl_io_exporter *
+dtl_io_arrow_c_exporter_create(void);
+
+// Moves the table exported as `name` into `schema` and `array`, as a struct array with one child
+// per column.  The caller becomes responsible for releasing both.  Returns false, leaving the
+// outputs untouched, if no table has been exported with that name.
+bool
+dtl_io_arrow_c_exporter_take_table(
+    struct dtl_io_exporter *, char const *name, struct ArrowSchema *schema, struct ArrowArray *array
+);
+
+// As `take_table`, but wraps the table in a stream with a single record batch.
+bool
+dtl_io_arrow_c_exporter_take_stream(struct dtl_io_exporter *, char const *name, struct ArrowArrayStream *stream);
+
+void
+dtl_io_arrow_c_exporter_destroy(struct dtl_io_exporter *);
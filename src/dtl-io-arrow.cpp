@@ -0,0 +1,232 @@
+#include "dtl-io-arrow.hpp"
+
+#include <arrow/api.h>
+#include <arrow/util/bitmap_ops.h>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+extern "C" {
+#define restrict __restrict__
+
+#include "dtl-bool-array.h"
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+}
+
+void
+dtl_io_arrow_set_error_from_status(struct dtl_error **error, arrow::Status const &status) {
+    dtl_set_error(error, dtl_error_create("%s", status.ToString().c_str()));
+}
+
+/* === Import =================================================================================== */
+
+struct dtl_schema *
+dtl_io_arrow_import_schema(arrow::Schema const &arrow_schema, char const *table_name, struct dtl_error **error) {
+    struct dtl_schema *schema;
+
+    schema = dtl_schema_create();
+    for (int i = 0; i < arrow_schema.num_fields(); i++) {
+        auto arrow_field = arrow_schema.field(i);
+
+        char const *column_name = arrow_field->name().c_str();
+        enum dtl_dtype column_dtype;
+
+        switch (arrow_field->type()->id()) {
+        case arrow::Type::BOOL:
+            column_dtype = DTL_DTYPE_BOOL_ARRAY;
+            break;
+        case arrow::Type::INT8:
+        case arrow::Type::INT16:
+        case arrow::Type::INT32:
+        case arrow::Type::INT64:
+            column_dtype = DTL_DTYPE_INT64_ARRAY;
+            break;
+        case arrow::Type::FLOAT:
+        case arrow::Type::DOUBLE:
+            column_dtype = DTL_DTYPE_DOUBLE_ARRAY;
+            break;
+        default:
+            dtl_set_error(
+                error,
+                dtl_error_create(
+                    "Column '%s' of table '%s' has unsupported type %s",
+                    column_name, table_name, arrow_field->type()->ToString().c_str()
+                )
+            );
+            dtl_schema_destroy(schema);
+            return NULL;
+        }
+
+        schema = dtl_schema_add_column(schema, column_name, column_dtype);
+    }
+
+    return schema;
+}
+
+template <typename ArrowType, typename T>
+static void
+dtl_io_arrow_copy_chunks(arrow::ChunkedArray const &column, T *out) {
+    size_t cursor = 0;
+
+    for (auto const &chunk : column.chunks()) {
+        auto const &typed_chunk = static_cast<arrow::NumericArray<ArrowType> const &>(*chunk);
+        auto const *values = typed_chunk.raw_values();
+        size_t length = typed_chunk.length();
+
+        if constexpr (std::is_same_v<typename ArrowType::c_type, T>) {
+            memcpy(out + cursor, values, length * sizeof(T));
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                out[cursor + i] = values[i];
+            }
+        }
+        cursor += length;
+    }
+}
+
+template <typename ArrowType, typename T>
+static T *
+dtl_io_arrow_import_numeric_column(arrow::ChunkedArray const &column, bool *owned) {
+    T *data;
+
+    // The common case of a single chunk of exactly the right type can be handed straight to the
+    // evaluator.  The caller holds a reference to the chunk for as long as the data is in use.
+    if constexpr (std::is_same_v<typename ArrowType::c_type, T>) {
+        if (column.num_chunks() == 1) {
+            auto const &chunk = static_cast<arrow::NumericArray<ArrowType> const &>(*column.chunk(0));
+            *owned = false;
+            return const_cast<T *>(chunk.raw_values());
+        }
+    }
+
+    data = (T *)calloc(column.length() > 0 ? column.length() : 1, sizeof(T));
+    dtl_io_arrow_copy_chunks<ArrowType, T>(column, data);
+
+    *owned = true;
+    return data;
+}
+
+static void *
+dtl_io_arrow_import_bool_column(arrow::ChunkedArray const &column, bool *owned) {
+    void *data;
+    int64_t cursor = 0;
+
+    data = dtl_bool_array_create(column.length());
+
+    // Arrow bitmaps and DTL boolean arrays are both LSB first, so this is a straight copy of the
+    // bits, shifted to account for any chunk offsets.
+    for (auto const &chunk : column.chunks()) {
+        auto const &bool_chunk = static_cast<arrow::BooleanArray const &>(*chunk);
+
+        arrow::internal::CopyBitmap(
+            bool_chunk.values()->data(), bool_chunk.offset(), bool_chunk.length(), (uint8_t *)data, cursor
+        );
+        cursor += bool_chunk.length();
+    }
+
+    *owned = true;
+    return data;
+}
+
+void *
+dtl_io_arrow_import_column(arrow::ChunkedArray const &column, bool *owned) {
+    assert(column.null_count() == 0);
+
+    switch (column.type()->id()) {
+    case arrow::Type::BOOL:
+        return dtl_io_arrow_import_bool_column(column, owned);
+    case arrow::Type::INT8:
+        return dtl_io_arrow_import_numeric_column<arrow::Int8Type, int64_t>(column, owned);
+    case arrow::Type::INT16:
+        return dtl_io_arrow_import_numeric_column<arrow::Int16Type, int64_t>(column, owned);
+    case arrow::Type::INT32:
+        return dtl_io_arrow_import_numeric_column<arrow::Int32Type, int64_t>(column, owned);
+    case arrow::Type::INT64:
+        return dtl_io_arrow_import_numeric_column<arrow::Int64Type, int64_t>(column, owned);
+    case arrow::Type::FLOAT:
+        return dtl_io_arrow_import_numeric_column<arrow::FloatType, double>(column, owned);
+    case arrow::Type::DOUBLE:
+        return dtl_io_arrow_import_numeric_column<arrow::DoubleType, double>(column, owned);
+    default:
+        assert(false); // Rejected by `dtl_io_arrow_import_schema`.
+    }
+
+    return NULL;
+}
+
+/* === Export =================================================================================== */
+
+static std::shared_ptr<arrow::Array>
+dtl_io_arrow_wrap_array(
+    std::shared_ptr<arrow::DataType> type,
+    void const *data,
+    size_t size,
+    size_t num_rows
+) {
+    // The buffer does not take ownership of `data`.  Arrays built here must not outlive the call
+    // to `export_table` that created them, after which the values go back to the evaluator.
+    auto buffer = std::make_shared<arrow::Buffer>((uint8_t const *)data, size);
+    auto array_data = arrow::ArrayData::Make(type, num_rows, {nullptr, buffer}, 0);
+    return arrow::MakeArray(array_data);
+}
+
+std::shared_ptr<arrow::RecordBatch>
+dtl_io_arrow_export_batch(struct dtl_schema *schema, size_t num_rows, struct dtl_value **values) {
+    size_t col;
+    enum dtl_dtype col_dtype;
+    char const *col_name;
+    std::shared_ptr<arrow::Array> arrow_array;
+    std::vector<std::shared_ptr<arrow::Field>> schema_columns;
+    std::vector<std::shared_ptr<arrow::Array>> table_columns;
+
+    assert(schema != NULL);
+    assert(values != NULL);
+
+    for (col = 0; col < dtl_schema_get_num_columns(schema); col++) {
+        col_dtype = dtl_schema_get_column_dtype(schema, col);
+        col_name = dtl_schema_get_column_name(schema, col);
+
+        switch (col_dtype) {
+        case DTL_DTYPE_BOOL_ARRAY:
+            // DTL boolean arrays are LSB first, the same as Arrow bitmaps.
+            arrow_array = dtl_io_arrow_wrap_array(
+                arrow::boolean(), dtl_value_get_bool_array(values[col]), (num_rows + 7) / 8, num_rows
+            );
+            break;
+        case DTL_DTYPE_INT64_ARRAY:
+            arrow_array = dtl_io_arrow_wrap_array(
+                arrow::int64(), dtl_value_get_int64_array(values[col]), num_rows * sizeof(int64_t), num_rows
+            );
+            break;
+        case DTL_DTYPE_DOUBLE_ARRAY:
+            arrow_array = dtl_io_arrow_wrap_array(
+                arrow::float64(), dtl_value_get_double_array(values[col]), num_rows * sizeof(double), num_rows
+            );
+            break;
+        case DTL_DTYPE_INDEX_ARRAY:
+            // Only ever written by tracers.
+            static_assert(sizeof(size_t) == sizeof(uint64_t));
+            arrow_array = dtl_io_arrow_wrap_array(
+                arrow::uint64(), dtl_value_get_index_array(values[col]), num_rows * sizeof(size_t), num_rows
+            );
+            break;
+        case DTL_DTYPE_STRING_ARRAY:
+            assert(false); // TODO
+
+        default:
+            assert(false);
+        }
+
+        schema_columns.push_back(arrow::field(col_name, arrow_array->type()));
+        table_columns.push_back(arrow_array);
+    }
+
+    return arrow::RecordBatch::Make(std::make_shared<arrow::Schema>(schema_columns), num_rows, table_columns);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Conversions between Arrow and DTL values, shared by the Arrow based importers and exporters.
+// C++ only.
+
+#include <arrow/api.h>
+#include <memory>
+
+extern "C" {
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dtl-error.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+}
+
+void
+dtl_io_arrow_set_error_from_status(struct dtl_error **error, arrow::Status const &status);
+
+// Builds a DTL schema from an Arrow schema, or sets `error` and returns NULL if any of the fields
+// have a type that DTL can't represent.  `table_name` is only used in error messages.
+struct dtl_schema *
+dtl_io_arrow_import_schema(arrow::Schema const &arrow_schema, char const *table_name, struct dtl_error **error);
+
+// Converts a column of a schema accepted by `dtl_io_arrow_import_schema` to DTL's representation.
+// If the column is a single chunk that is already in the right format then its buffer is returned
+// as is, and `owned` is set to false.  The caller must keep the column alive for as long as the
+// data is in use.  Otherwise the data is copied into a new allocation that the caller must free.
+// Columns must not contain nulls.
+void *
+dtl_io_arrow_import_column(arrow::ChunkedArray const &column, bool *owned);
+
+// Wraps exported values in a record batch without copying them.  The batch must not outlive the
+// values.
+std::shared_ptr<arrow::RecordBatch>
+dtl_io_arrow_export_batch(struct dtl_schema *schema, size_t num_rows, struct dtl_value **values);
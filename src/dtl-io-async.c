@@ -0,0 +1,412 @@
+#include "dtl-io-async.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-io.h"
+#include "dtl-location.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+
+struct dtl_io_async_tracer_entry {
+    uint64_t id;
+    enum dtl_dtype dtype;
+    size_t size;
+    struct dtl_value *value;
+    void (*release)(void *);
+    void *user_data;
+
+    size_t num_bytes;
+
+    struct dtl_io_async_tracer_entry *next;
+};
+
+struct dtl_io_async_tracer {
+    struct dtl_io_tracer base;
+    struct dtl_io_tracer *inner;
+
+    pthread_t thread;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;  // Signalled when an entry is added, or on shutdown.
+    pthread_cond_t written; // Signalled when an entry has been written.
+
+    size_t capacity;
+    size_t num_bytes;
+    struct dtl_io_async_tracer_entry *head;
+    struct dtl_io_async_tracer_entry *tail;
+
+    // Set while the writer is working on an entry that has already been popped from the queue.
+    bool writing;
+    bool shutdown;
+
+    // The first error from a write since the last flush.  Once set, values are released without
+    // being written.
+    struct dtl_error *error;
+};
+
+static size_t
+dtl_io_async_tracer_value_size(enum dtl_dtype dtype, size_t size) {
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        return (size + 7) / 8;
+    case DTL_DTYPE_INT64_ARRAY:
+        return size * sizeof(int64_t);
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        return size * sizeof(double);
+    case DTL_DTYPE_STRING_ARRAY:
+        return size * sizeof(char *);
+    case DTL_DTYPE_INDEX_ARRAY:
+        return size * sizeof(size_t);
+    default:
+        return 0;
+    }
+}
+
+static void *
+dtl_io_async_tracer_thread(void *user_data) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)user_data;
+    struct dtl_io_async_tracer_entry *entry;
+    struct dtl_error *error = NULL;
+    bool failed;
+
+    pthread_mutex_lock(&tracer->mutex);
+    while (true) {
+        while (tracer->head == NULL && !tracer->shutdown) {
+            pthread_cond_wait(&tracer->queued, &tracer->mutex);
+        }
+        if (tracer->head == NULL) {
+            break;
+        }
+
+        entry = tracer->head;
+        tracer->head = entry->next;
+        if (tracer->head == NULL) {
+            tracer->tail = NULL;
+        }
+        tracer->writing = true;
+        failed = tracer->error != NULL;
+        pthread_mutex_unlock(&tracer->mutex);
+
+        if (!failed) {
+            dtl_io_tracer_record_value(tracer->inner, entry->id, entry->dtype, entry->size, entry->value, &error);
+        }
+        entry->release(entry->user_data);
+
+        pthread_mutex_lock(&tracer->mutex);
+        if (error != NULL && tracer->error == NULL) {
+            tracer->error = error;
+            error = NULL;
+        }
+        dtl_clear_error(&error);
+
+        tracer->num_bytes -= entry->num_bytes;
+        tracer->writing = false;
+        pthread_cond_broadcast(&tracer->written);
+
+        free(entry);
+    }
+    pthread_mutex_unlock(&tracer->mutex);
+
+    return NULL;
+}
+
+// Must be called with the mutex held.
+static void
+dtl_io_async_tracer_wait(struct dtl_io_async_tracer *tracer) {
+    while (tracer->head != NULL || tracer->writing) {
+        pthread_cond_wait(&tracer->written, &tracer->mutex);
+    }
+}
+
+// Waits for the queue to drain, and then takes the error from any failed write.
+static enum dtl_status
+dtl_io_async_tracer_drain(struct dtl_io_async_tracer *tracer, struct dtl_error **error) {
+    struct dtl_error *write_error;
+
+    pthread_mutex_lock(&tracer->mutex);
+    dtl_io_async_tracer_wait(tracer);
+    write_error = tracer->error;
+    tracer->error = NULL;
+    pthread_mutex_unlock(&tracer->mutex);
+
+    if (write_error != NULL) {
+        dtl_set_error(error, write_error);
+        return DTL_STATUS_ERROR;
+    }
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_source(
+    struct dtl_io_tracer *base_tracer,
+    char const *source,
+    char const *filename,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_source(tracer->inner, source, filename, error);
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_input(
+    struct dtl_io_tracer *base_tracer,
+    char const *name,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_input(tracer->inner, name, schema, array_ids, error);
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_output(
+    struct dtl_io_tracer *base_tracer,
+    char const *name,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_output(tracer->inner, name, schema, array_ids, error);
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_trace(
+    struct dtl_io_tracer *base_tracer,
+    struct dtl_location start,
+    struct dtl_location end,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_trace(tracer->inner, start, end, schema, array_ids, error);
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_mapping(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t src_array_id,
+    uint64_t tgt_array_id,
+    uint64_t src_index_array_id,
+    uint64_t tgt_index_array_id,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_mapping(
+        tracer->inner, src_array_id, tgt_array_id, src_index_array_id, tgt_index_array_id, error
+    );
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_value(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t id,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_value(tracer->inner, id, dtype, size, value, error);
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_value_deferred(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t id,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value,
+    void (*release)(void *),
+    void *user_data,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    struct dtl_io_async_tracer_entry *entry;
+
+    (void)error;
+
+    entry = calloc(1, sizeof(struct dtl_io_async_tracer_entry));
+    entry->id = id;
+    entry->dtype = dtype;
+    entry->size = size;
+    entry->value = value;
+    entry->release = release;
+    entry->user_data = user_data;
+    entry->num_bytes = dtl_io_async_tracer_value_size(dtype, size);
+
+    pthread_mutex_lock(&tracer->mutex);
+
+    // A single value larger than the capacity is let through once the queue is empty.
+    while (tracer->num_bytes > 0 && tracer->num_bytes + entry->num_bytes > tracer->capacity) {
+        pthread_cond_wait(&tracer->written, &tracer->mutex);
+    }
+
+    tracer->num_bytes += entry->num_bytes;
+    if (tracer->tail != NULL) {
+        tracer->tail->next = entry;
+    } else {
+        tracer->head = entry;
+    }
+    tracer->tail = entry;
+    pthread_cond_signal(&tracer->queued);
+
+    pthread_mutex_unlock(&tracer->mutex);
+
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_sample(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t id,
+    uint64_t row_index_array,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_sample(tracer->inner, id, row_index_array, error);
+}
+
+static enum dtl_status
+dtl_io_async_tracer_record_grouping(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t index_array,
+    uint64_t offsets_array,
+    uint64_t entries_array,
+    struct dtl_error **error
+) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_record_grouping(tracer->inner, index_array, offsets_array, entries_array, error);
+}
+
+static enum dtl_status
+dtl_io_async_tracer_flush(struct dtl_io_tracer *base_tracer, struct dtl_error **error) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status;
+
+    status = dtl_io_async_tracer_drain(tracer, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
+    }
+    return dtl_io_tracer_flush(tracer->inner, error);
+}
+
+struct dtl_io_tracer *
+dtl_io_async_tracer_create(struct dtl_io_tracer *inner, size_t capacity) {
+    struct dtl_io_async_tracer *tracer;
+
+    assert(inner != NULL);
+
+    tracer = calloc(1, sizeof(struct dtl_io_async_tracer));
+    tracer->base.record_source = dtl_io_async_tracer_record_source;
+    tracer->base.record_input = dtl_io_async_tracer_record_input;
+    tracer->base.record_output = dtl_io_async_tracer_record_output;
+    tracer->base.record_trace = dtl_io_async_tracer_record_trace;
+    tracer->base.record_mapping = dtl_io_async_tracer_record_mapping;
+    tracer->base.record_value = dtl_io_async_tracer_record_value;
+    tracer->base.record_value_deferred = dtl_io_async_tracer_record_value_deferred;
+    tracer->base.record_sample = dtl_io_async_tracer_record_sample;
+    tracer->base.record_grouping = dtl_io_async_tracer_record_grouping;
+    tracer->base.flush = dtl_io_async_tracer_flush;
+
+    tracer->inner = inner;
+    tracer->capacity = capacity;
+
+    pthread_mutex_init(&tracer->mutex, NULL);
+    pthread_cond_init(&tracer->queued, NULL);
+    pthread_cond_init(&tracer->written, NULL);
+
+    // Without a writer thread, deferred values are recorded synchronously instead.
+    if (pthread_create(&tracer->thread, NULL, dtl_io_async_tracer_thread, tracer) != 0) {
+        tracer->base.record_value_deferred = NULL;
+        tracer->shutdown = true;
+    }
+
+    return &tracer->base;
+}
+
+enum dtl_status
+dtl_io_async_tracer_destroy(struct dtl_io_tracer *base_tracer, struct dtl_error **error) {
+    struct dtl_io_async_tracer *tracer = (struct dtl_io_async_tracer *)base_tracer;
+    enum dtl_status status = DTL_STATUS_OK;
+    bool threaded;
+
+    pthread_mutex_lock(&tracer->mutex);
+    threaded = !tracer->shutdown;
+    tracer->shutdown = true;
+    pthread_cond_signal(&tracer->queued);
+    pthread_mutex_unlock(&tracer->mutex);
+
+    if (threaded) {
+        pthread_join(tracer->thread, NULL);
+    }
+
+    if (tracer->error != NULL) {
+        dtl_set_error(error, tracer->error);
+        status = DTL_STATUS_ERROR;
+    }
+
+    pthread_cond_destroy(&tracer->written);
+    pthread_cond_destroy(&tracer->queued);
+    pthread_mutex_destroy(&tracer->mutex);
+    free(tracer);
+
+    return status;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "dtl-error.h"
+#include "dtl-io.h"
+
+// Wraps `inner` so that values are written on a background thread, overlapping trace writes with
+// evaluation.  Values are queued as they are recorded, and are held until `inner` has written
+// them.  Once more than `capacity` bytes of values are waiting to be written, recording blocks
+// until the writer has caught up.
+//
+// All other calls, and values recorded with the plain `record_value`, wait for the queue to drain
+// and are then passed straight on to `inner`, which is only ever used by one thread at a time.
+struct dtl_io_tracer *
+dtl_io_async_tracer_create(struct dtl_io_tracer *inner, size_t capacity);
+
+// Waits for queued values to be written.  Returns the first error from a write that has not
+// already been reported by a flush.  Does not destroy the inner tracer.
+enum dtl_status
+dtl_io_async_tracer_destroy(struct dtl_io_tracer *, struct dtl_error **error);
@@ -0,0 +1,407 @@
+#include "dtl-io-cache.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-io.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+
+struct dtl_io_table_cache_entry {
+    char *path;
+    struct timespec mtime;
+    off_t size;
+
+    // The table that the columns were read from.  Column data is owned by the table, so it is
+    // kept open for as long as the entry is alive.
+    struct dtl_io_table *table;
+    size_t num_rows;
+    struct dtl_value *columns;
+    size_t num_bytes;
+
+    // Set while the first import of the table is still reading it.  Other imports of the same
+    // file wait for it to finish rather than reading the file a second time.
+    bool loading;
+
+    // One reference is held by the cache while the entry is in the LRU list, and one by each open
+    // table.
+    size_t refcount;
+
+    // LRU list, most recently used first.
+    struct dtl_io_table_cache_entry *prev;
+    struct dtl_io_table_cache_entry *next;
+};
+
+struct dtl_io_table_cache {
+    pthread_mutex_t mutex;
+    pthread_cond_t loaded;
+
+    size_t capacity;
+    size_t size;
+
+    struct dtl_io_table_cache_entry *head;
+    struct dtl_io_table_cache_entry *tail;
+};
+
+struct dtl_io_cache_table {
+    struct dtl_io_table base;
+
+    struct dtl_io_table_cache *cache;
+    struct dtl_io_table_cache_entry *entry;
+};
+
+struct dtl_io_cache_importer {
+    struct dtl_io_importer base;
+
+    struct dtl_io_table_cache *cache;
+    struct dtl_io_importer *inner;
+    char *root;
+    char *(*get_path)(char const *root, char const *name);
+};
+
+/* === Entries ================================================================================== */
+
+// All functions in this section must be called with the cache's mutex held.
+
+static void
+dtl_io_table_cache_entry_release(struct dtl_io_table_cache_entry *entry) {
+    assert(entry->refcount > 0);
+
+    entry->refcount -= 1;
+    if (entry->refcount > 0) {
+        return;
+    }
+
+    dtl_io_table_destroy(entry->table);
+    free(entry->columns);
+    free(entry->path);
+    free(entry);
+}
+
+static void
+dtl_io_table_cache_unlink(struct dtl_io_table_cache *cache, struct dtl_io_table_cache_entry *entry) {
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void
+dtl_io_table_cache_push_front(struct dtl_io_table_cache *cache, struct dtl_io_table_cache_entry *entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head != NULL) {
+        cache->head->prev = entry;
+    } else {
+        cache->tail = entry;
+    }
+    cache->head = entry;
+}
+
+static void
+dtl_io_table_cache_evict(struct dtl_io_table_cache *cache, struct dtl_io_table_cache_entry *entry) {
+    dtl_io_table_cache_unlink(cache, entry);
+    cache->size -= entry->num_bytes;
+    dtl_io_table_cache_entry_release(entry);
+}
+
+static void
+dtl_io_table_cache_trim(struct dtl_io_table_cache *cache) {
+    struct dtl_io_table_cache_entry *entry;
+    struct dtl_io_table_cache_entry *prev;
+
+    for (entry = cache->tail; entry != NULL && cache->size > cache->capacity; entry = prev) {
+        prev = entry->prev;
+        if (!entry->loading) {
+            dtl_io_table_cache_evict(cache, entry);
+        }
+    }
+}
+
+static struct dtl_io_table_cache_entry *
+dtl_io_table_cache_find(struct dtl_io_table_cache *cache, char const *path) {
+    struct dtl_io_table_cache_entry *entry;
+
+    for (entry = cache->head; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* === Loading ================================================================================== */
+
+static size_t
+dtl_io_table_cache_column_size(enum dtl_dtype dtype, struct dtl_value *value, size_t num_rows) {
+    char **strings;
+    size_t num_bytes;
+    size_t i;
+
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        return (num_rows + 7) / 8;
+    case DTL_DTYPE_INT64_ARRAY:
+        return num_rows * sizeof(int64_t);
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        return num_rows * sizeof(double);
+    case DTL_DTYPE_STRING_ARRAY:
+        // Each string is a separate allocation, and usually much larger than the pointer to it.
+        strings = dtl_value_get_string_array(value);
+        num_bytes = num_rows * sizeof(char *);
+        for (i = 0; i < num_rows; i++) {
+            if (strings[i] != NULL) {
+                num_bytes += strlen(strings[i]) + 1;
+            }
+        }
+        return num_bytes;
+    case DTL_DTYPE_INDEX_ARRAY:
+        return num_rows * sizeof(size_t);
+    default:
+        return num_rows * sizeof(void *);
+    }
+}
+
+// Reads every column of a newly imported table.  Called without the mutex held.
+static enum dtl_status
+dtl_io_table_cache_entry_load(struct dtl_io_table_cache_entry *entry, struct dtl_error **error) {
+    struct dtl_schema *schema;
+    size_t num_columns;
+    size_t i;
+    enum dtl_status status;
+
+    schema = dtl_io_table_get_schema(entry->table);
+    num_columns = dtl_schema_get_num_columns(schema);
+
+    entry->num_rows = dtl_io_table_get_num_rows(entry->table);
+    entry->columns = calloc(num_columns > 0 ? num_columns : 1, sizeof(struct dtl_value));
+    entry->num_bytes = 0;
+
+    for (i = 0; i < num_columns; i++) {
+        status = dtl_io_table_read_column_data(entry->table, i, &entry->columns[i], error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+        entry->num_bytes += dtl_io_table_cache_column_size(dtl_schema_get_column_dtype(schema, i), &entry->columns[i], entry->num_rows);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+/* === Tables =================================================================================== */
+
+static size_t
+dtl_io_cache_table_get_num_rows(struct dtl_io_table *table) {
+    struct dtl_io_cache_table *cache_table = (struct dtl_io_cache_table *)table;
+    return cache_table->entry->num_rows;
+}
+
+static enum dtl_status
+dtl_io_cache_table_read_column_data(
+    struct dtl_io_table *table,
+    size_t col_index,
+    struct dtl_value *out,
+    struct dtl_error **error
+) {
+    struct dtl_io_cache_table *cache_table = (struct dtl_io_cache_table *)table;
+
+    (void)error;
+
+    *out = cache_table->entry->columns[col_index];
+    return DTL_STATUS_OK;
+}
+
+static void
+dtl_io_cache_table_destroy(struct dtl_io_table *table) {
+    struct dtl_io_cache_table *cache_table = (struct dtl_io_cache_table *)table;
+    struct dtl_io_table_cache *cache = cache_table->cache;
+
+    pthread_mutex_lock(&cache->mutex);
+    dtl_io_table_cache_entry_release(cache_table->entry);
+    pthread_mutex_unlock(&cache->mutex);
+
+    free(cache_table);
+}
+
+static struct dtl_io_table *
+dtl_io_cache_table_create(struct dtl_io_table_cache *cache, struct dtl_io_table_cache_entry *entry) {
+    struct dtl_io_cache_table *cache_table;
+
+    cache_table = calloc(1, sizeof(struct dtl_io_cache_table));
+    cache_table->base.schema = dtl_io_table_get_schema(entry->table);
+    cache_table->base.get_num_rows = dtl_io_cache_table_get_num_rows;
+    cache_table->base.read_column_data = dtl_io_cache_table_read_column_data;
+    cache_table->base.destroy = dtl_io_cache_table_destroy;
+    cache_table->cache = cache;
+    cache_table->entry = entry;
+
+    return &cache_table->base;
+}
+
+/* === Caches =================================================================================== */
+
+struct dtl_io_table_cache *
+dtl_io_table_cache_create(size_t capacity) {
+    struct dtl_io_table_cache *cache;
+
+    cache = calloc(1, sizeof(struct dtl_io_table_cache));
+    pthread_mutex_init(&cache->mutex, NULL);
+    pthread_cond_init(&cache->loaded, NULL);
+    cache->capacity = capacity;
+
+    return cache;
+}
+
+void
+dtl_io_table_cache_destroy(struct dtl_io_table_cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    // Tables that are still open keep their entries alive until they are destroyed.
+    pthread_mutex_lock(&cache->mutex);
+    while (cache->head != NULL) {
+        assert(!cache->head->loading);
+        dtl_io_table_cache_evict(cache, cache->head);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    pthread_cond_destroy(&cache->loaded);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+/* === Importers ================================================================================ */
+
+static struct dtl_io_table *
+dtl_io_cache_importer_import_table(struct dtl_io_importer *importer, char const *name, struct dtl_error **error) {
+    struct dtl_io_cache_importer *cache_importer = (struct dtl_io_cache_importer *)importer;
+    struct dtl_io_table_cache *cache = cache_importer->cache;
+    struct dtl_io_table_cache_entry *entry;
+    struct dtl_io_table *table;
+    struct stat info;
+    char *path;
+    enum dtl_status status;
+
+    path = cache_importer->get_path(cache_importer->root, name);
+    if (stat(path, &info) != 0) {
+        free(path);
+        return dtl_io_importer_import_table(cache_importer->inner, name, error);
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    while (true) {
+        entry = dtl_io_table_cache_find(cache, path);
+        if (entry == NULL) {
+            break;
+        }
+
+        if (entry->mtime.tv_sec != info.st_mtim.tv_sec || entry->mtime.tv_nsec != info.st_mtim.tv_nsec ||
+            entry->size != info.st_size) {
+            if (entry->loading) {
+                pthread_cond_wait(&cache->loaded, &cache->mutex);
+                continue;
+            }
+            dtl_io_table_cache_evict(cache, entry);
+            break;
+        }
+
+        if (entry->loading) {
+            pthread_cond_wait(&cache->loaded, &cache->mutex);
+            continue;
+        }
+
+        entry->refcount += 1;
+        dtl_io_table_cache_unlink(cache, entry);
+        dtl_io_table_cache_push_front(cache, entry);
+        pthread_mutex_unlock(&cache->mutex);
+
+        free(path);
+        return dtl_io_cache_table_create(cache, entry);
+    }
+
+    entry = calloc(1, sizeof(struct dtl_io_table_cache_entry));
+    entry->path = path;
+    entry->mtime = info.st_mtim;
+    entry->size = info.st_size;
+    entry->loading = true;
+    entry->refcount = 2;
+    dtl_io_table_cache_push_front(cache, entry);
+    pthread_mutex_unlock(&cache->mutex);
+
+    table = dtl_io_importer_import_table(cache_importer->inner, name, error);
+    status = DTL_STATUS_ERROR;
+    if (table != NULL) {
+        entry->table = table;
+        status = dtl_io_table_cache_entry_load(entry, error);
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    entry->loading = false;
+    if (status == DTL_STATUS_OK) {
+        cache->size += entry->num_bytes;
+        dtl_io_table_cache_trim(cache);
+    } else {
+        // Drops both the cache's reference and our own.
+        dtl_io_table_cache_unlink(cache, entry);
+        dtl_io_table_cache_entry_release(entry);
+        dtl_io_table_cache_entry_release(entry);
+    }
+    pthread_cond_broadcast(&cache->loaded);
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (status != DTL_STATUS_OK) {
+        return NULL;
+    }
+    return dtl_io_cache_table_create(cache, entry);
+}
+
+struct dtl_io_importer *
+dtl_io_cache_importer_create(
+    struct dtl_io_table_cache *cache,
+    struct dtl_io_importer *inner,
+    char const *root,
+    char *(*get_path)(char const *root, char const *name)
+) {
+    struct dtl_io_cache_importer *cache_importer;
+
+    assert(cache != NULL);
+    assert(inner != NULL);
+    assert(root != NULL);
+    assert(get_path != NULL);
+
+    cache_importer = calloc(1, sizeof(struct dtl_io_cache_importer));
+    cache_importer->base.import_table = dtl_io_cache_importer_import_table;
+    cache_importer->cache = cache;
+    cache_importer->inner = inner;
+    cache_importer->root = strdup(root);
+    cache_importer->get_path = get_path;
+
+    return &cache_importer->base;
+}
+
+void
+dtl_io_cache_importer_destroy(struct dtl_io_importer *importer) {
+    struct dtl_io_cache_importer *cache_importer = (struct dtl_io_cache_importer *)importer;
+
+    free(cache_importer->root);
+    free(cache_importer);
+}
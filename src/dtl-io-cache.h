@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "dtl-io.h"
+
+// Keeps fully read input tables in memory so that they can be shared between runs in a long lived
+// process.  Tables are keyed by the path of the file they were read from, along with its
+// modification time and size, so that a file that is replaced is read again.  Once the total size
+// of the cached column data goes over the cache's capacity, the least recently used tables are
+// dropped.  Tables that are still in use are freed when the last run using them finishes.
+struct dtl_io_table_cache;
+
+struct dtl_io_table_cache *
+dtl_io_table_cache_create(size_t capacity);
+
+void
+dtl_io_table_cache_destroy(struct dtl_io_table_cache *cache);
+
+// Wraps `inner` so that tables are looked up in `cache` before being imported.  `get_path` maps
+// the name of a table to the file that `inner` would read it from, and should return a string
+// allocated with `malloc`.  Tables that can't be found on disk are imported from `inner` without
+// being cached.
+//
+// Cached tables are shared, so predicates are not passed on to them and all of their rows are
+// always returned.  Importers can be used from several threads at once.
+struct dtl_io_importer *
+dtl_io_cache_importer_create(
+    struct dtl_io_table_cache *cache,
+    struct dtl_io_importer *inner,
+    char const *root,
+    char *(*get_path)(char const *root, char const *name)
+);
+
+void
+dtl_io_cache_importer_destroy(struct dtl_io_importer *importer);
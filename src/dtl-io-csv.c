@@ -0,0 +1,893 @@
+#include "dtl-io-csv.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dtl-bool-array.h"
+#include "dtl-double-array.h"
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-int64-array.h"
+#include "dtl-io.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+
+// Number of rows, after the header, that are used to guess the type of each column.
+#define DTL_IO_CSV_SAMPLE_SIZE 1024
+
+// Files are only split between threads if each thread gets at least this many bytes.
+#define DTL_IO_CSV_MIN_CHUNK_SIZE (1024 * 1024)
+
+#define DTL_IO_CSV_MAX_THREADS 64
+
+struct dtl_io_csv_table {
+    struct dtl_io_table base;
+
+    size_t num_rows;
+
+    // Parsed column data, indexed by column.  Owned by the table and lent to the evaluator.
+    void **columns;
+};
+
+struct dtl_io_csv_importer {
+    struct dtl_io_importer base;
+
+    char *root;
+};
+
+/* === Scanning ================================================================================= */
+
+// Returns a pointer to the first comma or newline in `[cursor, end)`, or `end` if there are none.
+static char const *
+dtl_io_csv_find_field_end(char const *cursor, char const *end) {
+#ifdef __SSE2__
+    __m128i const commas = _mm_set1_epi8(',');
+    __m128i const newlines = _mm_set1_epi8('\n');
+
+    while (end - cursor >= 16) {
+        __m128i block = _mm_loadu_si128((__m128i const *)cursor);
+        int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(block, commas), _mm_cmpeq_epi8(block, newlines))
+        );
+        if (mask != 0) {
+            return cursor + __builtin_ctz(mask);
+        }
+        cursor += 16;
+    }
+#endif
+
+    while (cursor < end && *cursor != ',' && *cursor != '\n') {
+        cursor++;
+    }
+    return cursor;
+}
+
+static size_t
+dtl_io_csv_count_newlines(char const *cursor, char const *end) {
+    size_t count = 0;
+
+#ifdef __SSE2__
+    __m128i const newlines = _mm_set1_epi8('\n');
+
+    while (end - cursor >= 16) {
+        __m128i block = _mm_loadu_si128((__m128i const *)cursor);
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines)));
+        cursor += 16;
+    }
+#endif
+
+    while (cursor < end) {
+        count += *cursor == '\n';
+        cursor++;
+    }
+    return count;
+}
+
+// Returns true if the line that ends at `line_end`, a newline or the end of the chunk, is empty or
+// holds only a carriage return.  Chunks always start at the start of a line.
+static bool
+dtl_io_csv_is_empty_line(char const *start, char const *line_end) {
+    if (line_end > start && line_end[-1] == '\r') {
+        line_end--;
+    }
+    return line_end == start || line_end[-1] == '\n';
+}
+
+static size_t
+dtl_io_csv_count_nonempty_lines(char const *start, char const *cursor, char const *end) {
+    size_t count = 0;
+
+    for (; cursor < end; cursor++) {
+        count += *cursor == '\n' && !dtl_io_csv_is_empty_line(start, cursor);
+    }
+    return count;
+}
+
+// Returns the number of rows in a chunk of complete lines.  The last line of the file may be
+// missing its newline.  Empty lines, such as a blank line at the end of the file, are not rows.
+static size_t
+dtl_io_csv_count_rows(char const *start, char const *end) {
+    char const *cursor = start;
+    size_t count = 0;
+
+#ifdef __SSE2__
+    // A newline ends an empty line if it follows another newline, or a carriage return that
+    // follows a newline.  The first two bytes don't have enough history and are checked below.
+    __m128i const newlines = _mm_set1_epi8('\n');
+    __m128i const returns = _mm_set1_epi8('\r');
+
+    if (end - start >= 2) {
+        count += dtl_io_csv_count_nonempty_lines(start, start, start + 2);
+        cursor = start + 2;
+
+        while (end - cursor >= 16) {
+            __m128i block = _mm_loadu_si128((__m128i const *)cursor);
+            __m128i previous = _mm_loadu_si128((__m128i const *)(cursor - 1));
+            __m128i before_previous = _mm_loadu_si128((__m128i const *)(cursor - 2));
+            __m128i empty = _mm_or_si128(
+                _mm_cmpeq_epi8(previous, newlines),
+                _mm_and_si128(_mm_cmpeq_epi8(previous, returns), _mm_cmpeq_epi8(before_previous, newlines))
+            );
+            count += __builtin_popcount(_mm_movemask_epi8(_mm_andnot_si128(empty, _mm_cmpeq_epi8(block, newlines))));
+            cursor += 16;
+        }
+    }
+#endif
+
+    count += dtl_io_csv_count_nonempty_lines(start, cursor, end);
+    if (end > start && end[-1] != '\n' && !dtl_io_csv_is_empty_line(start, end)) {
+        count += 1;
+    }
+    return count;
+}
+
+// Advances `cursor` past any empty lines, and returns the number of lines skipped.
+static size_t
+dtl_io_csv_skip_empty_lines(char const **cursor, char const *end) {
+    size_t num_lines = 0;
+
+    while (*cursor < end) {
+        if (**cursor == '\n') {
+            *cursor += 1;
+        } else if (**cursor == '\r' && (*cursor + 1 == end || (*cursor)[1] == '\n')) {
+            *cursor += *cursor + 1 == end ? 1 : 2;
+        } else {
+            break;
+        }
+        num_lines++;
+    }
+    return num_lines;
+}
+
+/* === Parsing ================================================================================== */
+
+static bool
+dtl_io_csv_parse_int64(char const *start, char const *end, int64_t *out) {
+    bool negative = false;
+    uint64_t value = 0;
+    unsigned digit;
+
+    if (start < end && (*start == '-' || *start == '+')) {
+        negative = *start == '-';
+        start++;
+    }
+    if (start == end) {
+        return false;
+    }
+
+    for (; start < end; start++) {
+        digit = (unsigned char)*start - '0';
+        if (digit > 9) {
+            return false;
+        }
+        if (value > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+
+    if (negative) {
+        if (value > (uint64_t)INT64_MAX + 1) {
+            return false;
+        }
+        *out = (int64_t)(0 - value);
+    } else {
+        if (value > (uint64_t)INT64_MAX) {
+            return false;
+        }
+        *out = (int64_t)value;
+    }
+    return true;
+}
+
+static double const dtl_io_csv_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Converts text that has already been checked by `dtl_io_csv_parse_double`.
+static bool
+dtl_io_csv_parse_double_slow(char const *start, char const *end, double *out) {
+    char buffer[64];
+    char *copy = buffer;
+    char *copy_end;
+    size_t length = end - start;
+    bool ok;
+
+    if (length >= sizeof(buffer)) {
+        copy = malloc(length + 1);
+    }
+    memcpy(copy, start, length);
+    copy[length] = '\0';
+
+    errno = 0;
+    *out = strtod(copy, &copy_end);
+    ok = copy_end == copy + length && errno != ERANGE;
+
+    if (copy != buffer) {
+        free(copy);
+    }
+    return ok;
+}
+
+// Accepts an optional sign, digits with an optional point, and an optional exponent.  Hex,
+// infinities, NaNs and surrounding whitespace are rejected.
+static bool
+dtl_io_csv_parse_double(char const *start, char const *end, double *out) {
+    char const *cursor = start;
+    bool negative = false;
+    bool exact = true;
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int num_fraction_digits = 0;
+    int num_exponent_digits = 0;
+    double value;
+
+    // Plain decimals with at most 15 significant digits, and at most 22 of those after the
+    // point, can be converted exactly with a single floating point division.  Anything else,
+    // including exponents, is checked here and then left to `strtod`.
+    if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+        negative = *cursor == '-';
+        cursor++;
+    }
+    while (cursor < end && (unsigned)(*cursor - '0') <= 9) {
+        mantissa = mantissa * 10 + (*cursor - '0');
+        num_digits++;
+        cursor++;
+    }
+    if (cursor < end && *cursor == '.') {
+        cursor++;
+        while (cursor < end && (unsigned)(*cursor - '0') <= 9) {
+            mantissa = mantissa * 10 + (*cursor - '0');
+            num_digits++;
+            num_fraction_digits++;
+            cursor++;
+        }
+    }
+    if (num_digits == 0) {
+        return false;
+    }
+    if (num_digits > 15) {
+        exact = false;
+    }
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+        exact = false;
+        cursor++;
+        if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+            cursor++;
+        }
+        while (cursor < end && (unsigned)(*cursor - '0') <= 9) {
+            num_exponent_digits++;
+            cursor++;
+        }
+        if (num_exponent_digits == 0) {
+            return false;
+        }
+    }
+    if (cursor != end) {
+        return false;
+    }
+    if (!exact) {
+        return dtl_io_csv_parse_double_slow(start, end, out);
+    }
+
+    value = (double)mantissa / dtl_io_csv_powers_of_ten[num_fraction_digits];
+    *out = negative ? -value : value;
+    return true;
+}
+
+static bool
+dtl_io_csv_field_equals(char const *start, char const *end, char const *lower, char const *upper) {
+    size_t length = end - start;
+
+    if (length != strlen(lower)) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (start[i] != lower[i] && start[i] != upper[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+dtl_io_csv_parse_bool(char const *start, char const *end, bool *out) {
+    if (dtl_io_csv_field_equals(start, end, "true", "TRUE")) {
+        *out = true;
+        return true;
+    }
+    if (dtl_io_csv_field_equals(start, end, "false", "FALSE")) {
+        *out = false;
+        return true;
+    }
+    return false;
+}
+
+// Splits the next line into fields.  Returns the number of fields found, which may be more than
+// `max_fields`, in which case the extra fields are not recorded.  `field_ends` points at the
+// separator following each field, with any carriage return before the newline excluded.
+static size_t
+dtl_io_csv_split_line(
+    char const **cursor,
+    char const *end,
+    char const **field_starts,
+    char const **field_ends,
+    size_t max_fields
+) {
+    char const *field_start = *cursor;
+    char const *field_end;
+    size_t num_fields = 0;
+
+    while (true) {
+        field_end = dtl_io_csv_find_field_end(field_start, end);
+
+        if (num_fields < max_fields) {
+            field_starts[num_fields] = field_start;
+            field_ends[num_fields] = field_end;
+            if ((field_end == end || *field_end == '\n') && field_end > field_start && field_end[-1] == '\r') {
+                field_ends[num_fields] -= 1;
+            }
+        }
+        num_fields++;
+
+        if (field_end == end || *field_end == '\n') {
+            *cursor = field_end == end ? end : field_end + 1;
+            return num_fields;
+        }
+        field_start = field_end + 1;
+    }
+}
+
+/* === Chunks =================================================================================== */
+
+struct dtl_io_csv_chunk {
+    char const *start;
+    char const *end;
+
+    struct dtl_schema *schema;
+    void **columns;
+
+    // Set by the counting pass, and then used by the parsing pass as the index of the first row.
+    size_t num_rows;
+    size_t first_row;
+
+    // Counted alongside rows so that errors can report line numbers, which include empty lines.
+    size_t num_lines;
+    size_t first_line;
+
+    struct dtl_error *error;
+};
+
+static void *
+dtl_io_csv_count_thread(void *user_data) {
+    struct dtl_io_csv_chunk *chunk = (struct dtl_io_csv_chunk *)user_data;
+
+    chunk->num_rows = dtl_io_csv_count_rows(chunk->start, chunk->end);
+    chunk->num_lines = dtl_io_csv_count_newlines(chunk->start, chunk->end);
+    return NULL;
+}
+
+static void *
+dtl_io_csv_parse_thread(void *user_data) {
+    struct dtl_io_csv_chunk *chunk = (struct dtl_io_csv_chunk *)user_data;
+    size_t num_columns = dtl_schema_get_num_columns(chunk->schema);
+    char const **field_starts;
+    char const **field_ends;
+    char const *cursor = chunk->start;
+    size_t num_fields;
+    size_t line = chunk->first_line;
+    size_t row;
+    size_t col;
+    int64_t int64_value = 0;
+    double double_value = 0.0;
+    bool bool_value = false;
+    bool ok;
+
+    field_starts = calloc(num_columns, sizeof(char const *));
+    field_ends = calloc(num_columns, sizeof(char const *));
+
+    for (row = chunk->first_row; row < chunk->first_row + chunk->num_rows; row++, line++) {
+        line += dtl_io_csv_skip_empty_lines(&cursor, chunk->end);
+
+        num_fields = dtl_io_csv_split_line(&cursor, chunk->end, field_starts, field_ends, num_columns);
+        if (num_fields != num_columns) {
+            chunk->error = dtl_error_create(
+                "Expected %zu fields on line %zu but found %zu", num_columns, line, num_fields
+            );
+            break;
+        }
+
+        for (col = 0; col < num_columns; col++) {
+            switch (dtl_schema_get_column_dtype(chunk->schema, col)) {
+            case DTL_DTYPE_BOOL_ARRAY:
+                ok = dtl_io_csv_parse_bool(field_starts[col], field_ends[col], &bool_value);
+                // Neighbouring chunks can share a word of the bitmap.
+                if (ok && bool_value) {
+                    __atomic_fetch_or(
+                        &((uint64_t *)chunk->columns[col])[row / 64], (uint64_t)1 << (row % 64), __ATOMIC_RELAXED
+                    );
+                }
+                break;
+            case DTL_DTYPE_INT64_ARRAY:
+                ok = dtl_io_csv_parse_int64(field_starts[col], field_ends[col], &int64_value);
+                ((int64_t *)chunk->columns[col])[row] = int64_value;
+                break;
+            case DTL_DTYPE_DOUBLE_ARRAY:
+                ok = dtl_io_csv_parse_double(field_starts[col], field_ends[col], &double_value);
+                ((double *)chunk->columns[col])[row] = double_value;
+                break;
+            default:
+                assert(false);
+            }
+
+            if (!ok) {
+                chunk->error = dtl_error_create(
+                    "Could not parse '%.*s' in column '%s' on line %zu",
+                    (int)(field_ends[col] - field_starts[col]), field_starts[col],
+                    dtl_schema_get_column_name(chunk->schema, col), line
+                );
+                goto done;
+            }
+        }
+    }
+
+done:
+    free(field_starts);
+    free(field_ends);
+    return NULL;
+}
+
+// Runs `thread` over every chunk, using the calling thread for the first.
+static void
+dtl_io_csv_run_chunks(struct dtl_io_csv_chunk *chunks, size_t num_chunks, void *(*thread)(void *)) {
+    pthread_t threads[DTL_IO_CSV_MAX_THREADS];
+    bool started[DTL_IO_CSV_MAX_THREADS] = {false};
+    size_t i;
+
+    assert(num_chunks <= DTL_IO_CSV_MAX_THREADS);
+
+    for (i = 1; i < num_chunks; i++) {
+        started[i] = pthread_create(&threads[i], NULL, thread, &chunks[i]) == 0;
+    }
+
+    for (i = 0; i < num_chunks; i++) {
+        if (i == 0 || !started[i]) {
+            thread(&chunks[i]);
+        }
+    }
+
+    for (i = 1; i < num_chunks; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+/* === Schema Inference ========================================================================= */
+
+static struct dtl_schema *
+dtl_io_csv_infer_schema(
+    char const *header_start,
+    char const *header_end,
+    char const *body_start,
+    char const *end,
+    char const *table_name,
+    struct dtl_error **error
+) {
+    struct dtl_schema *schema = NULL;
+    char const *cursor;
+    char const **field_starts = NULL;
+    char const **field_ends = NULL;
+    size_t num_columns;
+    size_t num_fields;
+    size_t line;
+    bool *can_be_int64 = NULL;
+    bool *can_be_double = NULL;
+    bool *can_be_bool = NULL;
+    char *column_name;
+    enum dtl_dtype dtype;
+    size_t row;
+    size_t col;
+    int64_t int64_value;
+    double double_value;
+    bool bool_value;
+
+    cursor = header_start;
+    num_columns = dtl_io_csv_split_line(&cursor, header_end, NULL, NULL, 0);
+
+    field_starts = calloc(num_columns, sizeof(char const *));
+    field_ends = calloc(num_columns, sizeof(char const *));
+    can_be_int64 = malloc(num_columns * sizeof(bool));
+    can_be_double = malloc(num_columns * sizeof(bool));
+    can_be_bool = malloc(num_columns * sizeof(bool));
+    memset(can_be_int64, true, num_columns * sizeof(bool));
+    memset(can_be_double, true, num_columns * sizeof(bool));
+    memset(can_be_bool, true, num_columns * sizeof(bool));
+
+    cursor = body_start;
+    line = 2;
+    for (row = 0; row < DTL_IO_CSV_SAMPLE_SIZE; row++, line++) {
+        line += dtl_io_csv_skip_empty_lines(&cursor, end);
+        if (cursor == end) {
+            break;
+        }
+
+        num_fields = dtl_io_csv_split_line(&cursor, end, field_starts, field_ends, num_columns);
+        if (num_fields != num_columns) {
+            dtl_set_error(
+                error,
+                dtl_error_create(
+                    "Expected %zu fields on line %zu of table '%s' but found %zu",
+                    num_columns, line, table_name, num_fields
+                )
+            );
+            goto done;
+        }
+
+        for (col = 0; col < num_columns; col++) {
+            can_be_int64[col] = can_be_int64[col] &&
+                dtl_io_csv_parse_int64(field_starts[col], field_ends[col], &int64_value);
+            can_be_double[col] = can_be_double[col] &&
+                dtl_io_csv_parse_double(field_starts[col], field_ends[col], &double_value);
+            can_be_bool[col] = can_be_bool[col] &&
+                dtl_io_csv_parse_bool(field_starts[col], field_ends[col], &bool_value);
+        }
+    }
+
+    schema = dtl_schema_create();
+
+    cursor = header_start;
+    dtl_io_csv_split_line(&cursor, header_end, field_starts, field_ends, num_columns);
+    for (col = 0; col < num_columns; col++) {
+        column_name = strndup(field_starts[col], field_ends[col] - field_starts[col]);
+
+        if (can_be_int64[col]) {
+            dtype = DTL_DTYPE_INT64_ARRAY;
+        } else if (can_be_double[col]) {
+            dtype = DTL_DTYPE_DOUBLE_ARRAY;
+        } else if (can_be_bool[col]) {
+            dtype = DTL_DTYPE_BOOL_ARRAY;
+        } else {
+            dtl_set_error(
+                error,
+                dtl_error_create(
+                    "Column '%s' of table '%s' contains values that are not numbers or booleans",
+                    column_name, table_name
+                )
+            );
+            free(column_name);
+            dtl_schema_destroy(schema);
+            schema = NULL;
+            goto done;
+        }
+
+        schema = dtl_schema_add_column(schema, column_name, dtype);
+        free(column_name);
+    }
+
+done:
+    free(field_starts);
+    free(field_ends);
+    free(can_be_int64);
+    free(can_be_double);
+    free(can_be_bool);
+    return schema;
+}
+
+/* === Tables =================================================================================== */
+
+static size_t
+dtl_io_csv_table_get_num_rows(struct dtl_io_table *table) {
+    struct dtl_io_csv_table *csv_table;
+
+    assert(table != NULL);
+    assert(table->get_num_rows == dtl_io_csv_table_get_num_rows);
+
+    csv_table = (struct dtl_io_csv_table *)table;
+
+    return csv_table->num_rows;
+}
+
+static enum dtl_status
+dtl_io_csv_table_read_column_data(
+    struct dtl_io_table *table,
+    size_t col_index,
+    struct dtl_value *out,
+    struct dtl_error **error
+) {
+    struct dtl_io_csv_table *csv_table;
+
+    (void)error;
+
+    assert(table != NULL);
+    assert(table->read_column_data == dtl_io_csv_table_read_column_data);
+
+    csv_table = (struct dtl_io_csv_table *)table;
+
+    switch (dtl_schema_get_column_dtype(table->schema, col_index)) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        dtl_value_take_bool_array(out, csv_table->columns[col_index]);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        dtl_value_take_int64_array(out, csv_table->columns[col_index]);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        dtl_value_take_double_array(out, csv_table->columns[col_index]);
+        break;
+    default:
+        assert(false);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static void
+dtl_io_csv_table_destroy(struct dtl_io_table *table) {
+    struct dtl_io_csv_table *csv_table;
+    size_t col;
+
+    assert(table != NULL);
+    assert(table->destroy == dtl_io_csv_table_destroy);
+
+    csv_table = (struct dtl_io_csv_table *)table;
+
+    for (col = 0; col < dtl_schema_get_num_columns(table->schema); col++) {
+        free(csv_table->columns[col]);
+    }
+    free(csv_table->columns);
+
+    dtl_schema_destroy(table->schema);
+
+    free(csv_table);
+}
+
+static void **
+dtl_io_csv_parse(
+    struct dtl_schema *schema,
+    char const *start,
+    char const *end,
+    size_t *num_rows,
+    struct dtl_error **error
+) {
+    struct dtl_io_csv_chunk chunks[DTL_IO_CSV_MAX_THREADS];
+    size_t num_chunks;
+    size_t num_columns = dtl_schema_get_num_columns(schema);
+    size_t allocated_rows;
+    void **columns;
+    char const *boundary;
+    long num_cpus;
+    size_t i;
+    size_t col;
+
+    // Chunks are cut at the first newline after an even split of the bytes.  Lines can't span a
+    // newline as quoting is not supported.
+    num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    num_chunks = (size_t)(end - start) / DTL_IO_CSV_MIN_CHUNK_SIZE;
+    if (num_chunks > (size_t)num_cpus) {
+        num_chunks = num_cpus;
+    }
+    if (num_chunks > DTL_IO_CSV_MAX_THREADS) {
+        num_chunks = DTL_IO_CSV_MAX_THREADS;
+    }
+    if (num_chunks < 1) {
+        num_chunks = 1;
+    }
+
+    boundary = start;
+    for (i = 0; i < num_chunks; i++) {
+        chunks[i] = (struct dtl_io_csv_chunk){.start = boundary, .schema = schema};
+
+        if (i == num_chunks - 1) {
+            boundary = end;
+        } else {
+            boundary = start + (end - start) * (i + 1) / num_chunks;
+            if (boundary < chunks[i].start) {
+                boundary = chunks[i].start;
+            }
+            boundary = memchr(boundary, '\n', end - boundary);
+            boundary = boundary == NULL ? end : boundary + 1;
+        }
+        chunks[i].end = boundary;
+    }
+
+    dtl_io_csv_run_chunks(chunks, num_chunks, dtl_io_csv_count_thread);
+
+    // The header is line 1.
+    *num_rows = 0;
+    for (i = 0; i < num_chunks; i++) {
+        chunks[i].first_row = *num_rows;
+        chunks[i].first_line = i == 0 ? 2 : chunks[i - 1].first_line + chunks[i - 1].num_lines;
+        *num_rows += chunks[i].num_rows;
+    }
+
+    allocated_rows = *num_rows > 0 ? *num_rows : 1;
+    columns = calloc(num_columns, sizeof(void *));
+    for (col = 0; col < num_columns; col++) {
+        switch (dtl_schema_get_column_dtype(schema, col)) {
+        case DTL_DTYPE_BOOL_ARRAY:
+            columns[col] = dtl_bool_array_create(allocated_rows);
+            break;
+        case DTL_DTYPE_INT64_ARRAY:
+            columns[col] = dtl_int64_array_create(allocated_rows);
+            break;
+        case DTL_DTYPE_DOUBLE_ARRAY:
+            columns[col] = dtl_double_array_create(allocated_rows);
+            break;
+        default:
+            assert(false);
+        }
+    }
+
+    for (i = 0; i < num_chunks; i++) {
+        chunks[i].columns = columns;
+    }
+
+    dtl_io_csv_run_chunks(chunks, num_chunks, dtl_io_csv_parse_thread);
+
+    for (i = 0; i < num_chunks; i++) {
+        if (chunks[i].error != NULL) {
+            break;
+        }
+    }
+    if (i < num_chunks) {
+        dtl_set_error(error, chunks[i].error);
+        for (i = i + 1; i < num_chunks; i++) {
+            dtl_error_destroy(chunks[i].error);
+        }
+        for (col = 0; col < num_columns; col++) {
+            free(columns[col]);
+        }
+        free(columns);
+        return NULL;
+    }
+
+    return columns;
+}
+
+/* === Importer ================================================================================= */
+
+static struct dtl_io_table *
+dtl_io_csv_importer_import_table(struct dtl_io_importer *importer, char const *name, struct dtl_error **error) {
+    struct dtl_io_csv_importer *csv_importer;
+    struct dtl_io_csv_table *csv_table = NULL;
+    char *path;
+    int fd;
+    struct stat stat_buf;
+    char const *data = MAP_FAILED;
+    char const *end;
+    char const *header_end;
+    char const *body_start;
+    struct dtl_schema *schema = NULL;
+    void **columns;
+    size_t num_rows;
+
+    assert(importer != NULL);
+    assert(importer->import_table == dtl_io_csv_importer_import_table);
+    assert(name != NULL);
+
+    csv_importer = (struct dtl_io_csv_importer *)importer;
+
+    path = malloc(strlen(csv_importer->root) + strlen(name) + 2);
+    strcpy(path, csv_importer->root);
+    strcat(path, "/");
+    strcat(path, name);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        dtl_set_error(error, dtl_error_create("Could not open '%s': %s", path, strerror(errno)));
+        free(path);
+        return NULL;
+    }
+    free(path);
+
+    if (fstat(fd, &stat_buf) != 0 || stat_buf.st_size == 0) {
+        dtl_set_error(error, dtl_error_create("Table '%s' is empty or could not be read", name));
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        dtl_set_error(error, dtl_error_create("Could not map table '%s': %s", name, strerror(errno)));
+        return NULL;
+    }
+    end = data + stat_buf.st_size;
+
+    // Every page is about to be read, from several threads at once.
+    madvise((void *)data, stat_buf.st_size, MADV_WILLNEED);
+
+    header_end = memchr(data, '\n', end - data);
+    if (header_end == NULL) {
+        header_end = end;
+        body_start = end;
+    } else {
+        body_start = header_end + 1;
+    }
+
+    schema = dtl_io_csv_infer_schema(data, header_end, body_start, end, name, error);
+    if (schema == NULL) {
+        goto done;
+    }
+
+    columns = dtl_io_csv_parse(schema, body_start, end, &num_rows, error);
+    if (columns == NULL) {
+        dtl_schema_destroy(schema);
+        goto done;
+    }
+
+    csv_table = calloc(1, sizeof(struct dtl_io_csv_table));
+    csv_table->base.schema = schema;
+    csv_table->base.get_num_rows = dtl_io_csv_table_get_num_rows;
+    csv_table->base.read_column_data = dtl_io_csv_table_read_column_data;
+    csv_table->base.destroy = dtl_io_csv_table_destroy;
+    csv_table->num_rows = num_rows;
+    csv_table->columns = columns;
+
+done:
+    munmap((void *)data, stat_buf.st_size);
+    return csv_table == NULL ? NULL : &csv_table->base;
+}
+
+struct dtl_io_importer *
+dtl_io_csv_importer_create(char const *root) {
+    struct dtl_io_csv_importer *csv_importer;
+
+    assert(root != NULL);
+
+    csv_importer = calloc(1, sizeof(struct dtl_io_csv_importer));
+    csv_importer->base.import_table = dtl_io_csv_importer_import_table;
+    csv_importer->root = strdup(root);
+
+    return &csv_importer->base;
+}
+
+void
+dtl_io_csv_importer_destroy(struct dtl_io_importer *importer) {
+    struct dtl_io_csv_importer *csv_importer;
+
+    if (importer == NULL) {
+        return;
+    }
+
+    assert(importer->import_table == dtl_io_csv_importer_import_table);
+
+    csv_importer = (struct dtl_io_csv_importer *)importer;
+    free(csv_importer->root);
+    free(csv_importer);
+}
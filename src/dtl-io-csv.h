@@ -0,0 +1,15 @@
+#pragma once
+
+#include "dtl-io.h"
+
+// Reads tables from comma separated files with a header row.  Table names are used as file names
+// as is, and so should include the extension.  Column types are inferred from the first rows of
+// the file, and must be integers, floating point numbers, or `true`/`false`.  Quoted fields and
+// missing values are not supported.  Empty lines are skipped.
+//
+// Files are memory mapped and parsed in parallel, one chunk of lines per thread.
+struct dtl_io_importer *
+dtl_io_csv_importer_create(char const *root);
+
+void
+dtl_io_csv_importer_destroy(struct dtl_io_importer *);
@@ -1,19 +1,50 @@
 #include "dtl-io-duckdb.h"
 
+#include <assert.h>
 #include <duckdb.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <xxhash.h>
 
 #include "dtl-bool-array.h"
 #include "dtl-dtype.h"
 #include "dtl-error.h"
+#include "dtl-index-array.h"
+#include "dtl-int64-array.h"
 #include "dtl-io.h"
 #include "dtl-location.h"
+#include "dtl-manifest.h"
 #include "dtl-schema.h"
+#include "dtl-trace-encoding.h"
 #include "dtl-value.h"
 
+// Number of values stored in each row of the value tables.
+#define DTL_IO_DUCKDB_SEGMENT_SIZE 2048
+
+// Number of segments appended at once.
+#define DTL_IO_DUCKDB_SEGMENTS_PER_CHUNK 64
+
+#define DTL_IO_DUCKDB_CONTENTS_INITIAL_CAPACITY 1024
+
+struct dtl_io_duckdb_segment_table {
+    char const *name;
+    duckdb_appender appender;
+    duckdb_data_chunk chunk;
+    size_t num_rows;
+};
+
+struct dtl_io_duckdb_content {
+    XXH128_hash_t hash;
+    enum dtl_dtype dtype;
+    size_t size;
+    uint64_t id;
+};
+
 struct dtl_io_duckdb_tracer {
     struct dtl_io_tracer base;
 
@@ -23,8 +54,30 @@ struct dtl_io_duckdb_tracer {
     duckdb_appender source_appender;
     duckdb_appender trace_appender;
     duckdb_appender mapping_appender;
+    duckdb_appender sample_appender;
+    duckdb_appender grouping_appender;
     duckdb_appender input_appender;
     duckdb_appender output_appender;
+    duckdb_appender content_appender;
+
+    struct dtl_io_duckdb_segment_table int64_values;
+    struct dtl_io_duckdb_segment_table index_sequences;
+    struct dtl_io_duckdb_segment_table index_offsets;
+    struct dtl_io_duckdb_segment_table index_plain;
+    struct dtl_io_duckdb_segment_table mask_runs;
+    struct dtl_io_duckdb_segment_table mask_positions;
+    struct dtl_io_duckdb_segment_table mask_bitmap;
+
+    // Scratch space for encoding index arrays and masks one segment at a time.
+    struct dtl_trace_segment *segment;
+
+    // Open addressed set of the arrays that have already been written.  Content ids are assigned
+    // in order starting from one, so a zero id marks an empty slot.
+    struct dtl_io_duckdb_content *contents;
+    size_t num_contents;
+    size_t contents_capacity;
+
+    XXH3_state_t *hash_state;
 };
 
 static enum dtl_status
@@ -150,133 +203,434 @@ dtl_io_duckdb_tracer_record_mapping(
     uint64_t tgt_index_array_id,
     struct dtl_error **error
 ) {
+    duckdb_state state = DuckDBSuccess;
     struct dtl_io_duckdb_tracer *tracer = (struct dtl_io_duckdb_tracer *)base_tracer;
 
-    (void)tracer;
-    (void)src_array_id;
-    (void)tgt_array_id;
-    (void)src_index_array_id;
-    (void)tgt_index_array_id;
-    (void)error;
+    // Identity mappings are stored as nulls.
+    state |= duckdb_append_int64(tracer->mapping_appender, src_array_id);
+    state |= duckdb_append_int64(tracer->mapping_appender, tgt_array_id);
+    if (src_index_array_id != DTL_IO_TRACER_IDENTITY_MAPPING) {
+        state |= duckdb_append_int64(tracer->mapping_appender, src_index_array_id);
+    } else {
+        state |= duckdb_append_null(tracer->mapping_appender);
+    }
+    if (tgt_index_array_id != DTL_IO_TRACER_IDENTITY_MAPPING) {
+        state |= duckdb_append_int64(tracer->mapping_appender, tgt_index_array_id);
+    } else {
+        state |= duckdb_append_null(tracer->mapping_appender);
+    }
+    state |= duckdb_appender_end_row(tracer->mapping_appender);
+
+    if (state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Could not append mapping details: %s", duckdb_appender_error(tracer->mapping_appender)));
+        return DTL_STATUS_ERROR;
+    }
 
     return DTL_STATUS_OK;
 }
 
+// Values are stored in one table per type rather than one table per expression, split into
+// segments of up to `DTL_IO_DUCKDB_SEGMENT_SIZE` values, each held in a row as a list.  Segments
+// are appended a data chunk at a time, copying values straight into the chunk's buffers.
+//
+// Each distinct array is only written once, under a content id, with the `value_content` table
+// mapping expressions to the content that they evaluated to.  Arrays are matched on their type,
+// their length and a 128 bit hash of their values.  Values are not compared, as the arrays that
+// have been written are no longer held, so two arrays with colliding hashes would share the
+// values of the first.  With 128 bit hashes this is not expected to happen in practice.
+
+static XXH128_hash_t
+dtl_io_duckdb_tracer_hash_array(struct dtl_io_duckdb_tracer *tracer, enum dtl_dtype dtype, void const *array, size_t size) {
+    uint64_t const *chunks;
+    uint64_t tail;
+
+    XXH3_128bits_reset_withSeed(tracer->hash_state, 0);
+
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        // Bits past the end of the array are not guaranteed to be cleared, so the last partial
+        // chunk is masked before being hashed.
+        chunks = array;
+        XXH3_128bits_update(tracer->hash_state, chunks, (size / 64) * sizeof(uint64_t));
+        if (size % 64 != 0) {
+            tail = chunks[size / 64] & ((((uint64_t)1) << (size % 64)) - 1);
+            XXH3_128bits_update(tracer->hash_state, &tail, sizeof(tail));
+        }
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        XXH3_128bits_update(tracer->hash_state, array, size * sizeof(int64_t));
+        break;
+    case DTL_DTYPE_INDEX_ARRAY:
+        XXH3_128bits_update(tracer->hash_state, array, size * sizeof(size_t));
+        break;
+    default:
+        assert(false);
+    }
+
+    return XXH3_128bits_digest(tracer->hash_state);
+}
+
+static void
+dtl_io_duckdb_tracer_insert_content(struct dtl_io_duckdb_tracer *tracer, struct dtl_io_duckdb_content content) {
+    size_t cursor;
+
+    cursor = content.hash.low64 % tracer->contents_capacity;
+    while (tracer->contents[cursor].id != 0) {
+        cursor = (cursor + 1) % tracer->contents_capacity;
+    }
+    tracer->contents[cursor] = content;
+}
+
+// Finds the id of the content of an array, assigning a new one if no matching array has been
+// written.  Sets `is_new` if the array still needs to be written.
+static uint64_t
+dtl_io_duckdb_tracer_get_content(
+    struct dtl_io_duckdb_tracer *tracer, enum dtl_dtype dtype, void const *array, size_t size, bool *is_new
+) {
+    struct dtl_io_duckdb_content *old_contents;
+    struct dtl_io_duckdb_content *candidate;
+    size_t old_capacity;
+    XXH128_hash_t hash;
+    size_t cursor;
+    size_t i;
+
+    if ((tracer->num_contents + 1) * 2 > tracer->contents_capacity) {
+        old_contents = tracer->contents;
+        old_capacity = tracer->contents_capacity;
+
+        tracer->contents_capacity = old_capacity > 0 ? old_capacity * 2 : DTL_IO_DUCKDB_CONTENTS_INITIAL_CAPACITY;
+        tracer->contents = calloc(tracer->contents_capacity, sizeof(struct dtl_io_duckdb_content));
+
+        for (i = 0; i < old_capacity; i++) {
+            if (old_contents[i].id != 0) {
+                dtl_io_duckdb_tracer_insert_content(tracer, old_contents[i]);
+            }
+        }
+        free(old_contents);
+    }
+
+    hash = dtl_io_duckdb_tracer_hash_array(tracer, dtype, array, size);
+
+    cursor = hash.low64 % tracer->contents_capacity;
+    while (tracer->contents[cursor].id != 0) {
+        candidate = &tracer->contents[cursor];
+        if (candidate->dtype == dtype && candidate->size == size && XXH128_isEqual(candidate->hash, hash)) {
+            *is_new = false;
+            return candidate->id;
+        }
+        cursor = (cursor + 1) % tracer->contents_capacity;
+    }
+
+    tracer->num_contents += 1;
+    tracer->contents[cursor] = (struct dtl_io_duckdb_content){
+        .hash = hash,
+        .dtype = dtype,
+        .size = size,
+        .id = tracer->num_contents,
+    };
+
+    *is_new = true;
+    return tracer->num_contents;
+}
+
+// Rows for each of the value tables are built up in a data chunk, which is appended once it holds
+// `DTL_IO_DUCKDB_SEGMENTS_PER_CHUNK` segments.  The first two columns of every value table are the
+// content and the segment, and all others are either scalars or lists.
+
 static enum dtl_status
-dtl_io_duckdb_tracer_record_bool_array(
+dtl_io_duckdb_segment_table_create(
     struct dtl_io_duckdb_tracer *tracer,
-    uint64_t id,
-    size_t size,
-    void *array,
+    struct dtl_io_duckdb_segment_table *table,
+    char const *name,
     struct dtl_error **error
 ) {
-    char *query = NULL;
-    char *table_name;
-    duckdb_result db_result;
-    duckdb_state db_state;
-    duckdb_appender appender;
+    duckdb_logical_type *types;
+    size_t num_columns;
     size_t i;
+    duckdb_state db_state;
 
-    asprintf(
-        &query,
-        "CREATE TABLE expression_%li (\n"
-        "    data bool NOT NULL\n"
-        ");",
-        id
-    );
-    db_state = duckdb_query(tracer->db_conn, query, &db_result);
+    db_state = duckdb_appender_create(tracer->db_conn, NULL, name, &table->appender);
     if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Failed to create input table: %s", duckdb_result_error(&db_result)));
-        duckdb_destroy_result(&db_result);
-        free(query);
+        dtl_set_error(error, dtl_error_create("Failed to create %s appender", name));
         return DTL_STATUS_ERROR;
     }
-    duckdb_destroy_result(&db_result);
-    free(query);
 
-    asprintf(&table_name, "expression_%li", id);
-    db_state = duckdb_appender_create(tracer->db_conn, NULL, table_name, &appender);
-    if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Failed to create appender"));
-        free(table_name);
-        return DTL_STATUS_ERROR;
+    num_columns = duckdb_appender_column_count(table->appender);
+    types = calloc(num_columns, sizeof(duckdb_logical_type));
+    for (i = 0; i < num_columns; i++) {
+        types[i] = duckdb_appender_column_type(table->appender, i);
     }
-    free(table_name);
-
-    for (i = 0; i < size; i++) {
-        db_state |= duckdb_append_bool(appender, dtl_bool_array_get(array, i));
-        db_state |= duckdb_appender_end_row(appender);
+    table->chunk = duckdb_create_data_chunk(types, num_columns);
+    for (i = 0; i < num_columns; i++) {
+        duckdb_destroy_logical_type(&types[i]);
     }
+    free(types);
 
-    if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Could not append trace data: %s", duckdb_appender_error(appender)));
-        return DTL_STATUS_ERROR;
+    table->name = name;
+    table->num_rows = 0;
+
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_duckdb_segment_table_flush(struct dtl_io_duckdb_segment_table *table, struct dtl_error **error) {
+    duckdb_state db_state;
+
+    if (table->num_rows == 0) {
+        return DTL_STATUS_OK;
     }
 
-    db_state = duckdb_appender_close(appender);
+    duckdb_data_chunk_set_size(table->chunk, table->num_rows);
+    db_state = duckdb_append_data_chunk(table->appender, table->chunk);
+    duckdb_data_chunk_reset(table->chunk);
+    table->num_rows = 0;
+
     if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Error flushing trace data: %s", duckdb_appender_error(appender)));
+        dtl_set_error(error, dtl_error_create("Could not append to %s: %s", table->name, duckdb_appender_error(table->appender)));
         return DTL_STATUS_ERROR;
     }
 
     return DTL_STATUS_OK;
 }
 
+// Starts a new row, flushing the chunk first if it is full.  The row is completed by
+// `dtl_io_duckdb_segment_table_end_row` after its remaining columns have been set.
 static enum dtl_status
-dtl_io_duckdb_tracer_record_int64_array(
-    struct dtl_io_duckdb_tracer *tracer,
-    uint64_t id,
-    size_t size,
-    int64_t *array,
+dtl_io_duckdb_segment_table_begin_row(
+    struct dtl_io_duckdb_segment_table *table,
+    uint64_t content,
+    size_t segment,
     struct dtl_error **error
 ) {
-    char *query = NULL;
-    char *table_name;
-    duckdb_result db_result;
+    enum dtl_status status;
+    uint64_t *contents;
+    int64_t *segments;
+
+    if (table->num_rows == DTL_IO_DUCKDB_SEGMENTS_PER_CHUNK) {
+        status = dtl_io_duckdb_segment_table_flush(table, error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+    }
+
+    contents = duckdb_vector_get_data(duckdb_data_chunk_get_vector(table->chunk, 0));
+    segments = duckdb_vector_get_data(duckdb_data_chunk_get_vector(table->chunk, 1));
+    contents[table->num_rows] = content;
+    segments[table->num_rows] = (int64_t)segment;
+
+    return DTL_STATUS_OK;
+}
+
+static void
+dtl_io_duckdb_segment_table_set_int64(struct dtl_io_duckdb_segment_table *table, size_t column, int64_t value) {
+    int64_t *values;
+
+    values = duckdb_vector_get_data(duckdb_data_chunk_get_vector(table->chunk, column));
+    values[table->num_rows] = value;
+}
+
+static void
+dtl_io_duckdb_segment_table_set_list(
+    struct dtl_io_duckdb_segment_table *table,
+    size_t column,
+    void const *values,
+    size_t value_size,
+    size_t count
+) {
+    duckdb_vector vector;
+    duckdb_list_entry *entries;
+    char *child_values;
+    size_t offset;
+
+    vector = duckdb_data_chunk_get_vector(table->chunk, column);
+    entries = duckdb_vector_get_data(vector);
+
+    offset = duckdb_list_vector_get_size(vector);
+    duckdb_list_vector_reserve(vector, offset + count);
+    duckdb_list_vector_set_size(vector, offset + count);
+
+    child_values = duckdb_vector_get_data(duckdb_list_vector_get_child(vector));
+    if (count > 0) {
+        memcpy(child_values + offset * value_size, values, count * value_size);
+    }
+
+    entries[table->num_rows].offset = offset;
+    entries[table->num_rows].length = count;
+}
+
+static void
+dtl_io_duckdb_segment_table_end_row(struct dtl_io_duckdb_segment_table *table) {
+    table->num_rows += 1;
+}
+
+static enum dtl_status
+dtl_io_duckdb_segment_table_close(struct dtl_io_duckdb_segment_table *table, struct dtl_error **error) {
+    enum dtl_status status;
     duckdb_state db_state;
-    duckdb_appender appender;
-    size_t i;
 
-    asprintf(
-        &query,
-        "CREATE TABLE expression_%li (\n"
-        "    data int64 NOT NULL\n"
-        ");",
-        id
-    );
-    db_state = duckdb_query(tracer->db_conn, query, &db_result);
-    if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Failed to create input table: %s", duckdb_result_error(&db_result)));
-        duckdb_destroy_result(&db_result);
-        free(query);
-        return DTL_STATUS_ERROR;
+    status = dtl_io_duckdb_segment_table_flush(table, error);
+    if (status != DTL_STATUS_OK) {
+        return status;
     }
-    duckdb_destroy_result(&db_result);
-    free(query);
 
-    asprintf(&table_name, "expression_%li", id);
-    db_state = duckdb_appender_create(tracer->db_conn, NULL, table_name, &appender);
+    db_state = duckdb_appender_close(table->appender);
     if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Failed to create appender"));
-        free(table_name);
+        dtl_set_error(error, dtl_error_create("Error flushing %s: %s", table->name, duckdb_appender_error(table->appender)));
         return DTL_STATUS_ERROR;
     }
-    free(table_name);
 
-    for (i = 0; i < size; i++) {
-        db_state |= duckdb_append_int64(appender, array[i]);
-        db_state |= duckdb_appender_end_row(appender);
+    return DTL_STATUS_OK;
+}
+
+static void
+dtl_io_duckdb_segment_table_destroy(struct dtl_io_duckdb_segment_table *table) {
+    if (table->chunk != NULL) {
+        duckdb_destroy_data_chunk(&table->chunk);
     }
+    if (table->appender != NULL) {
+        duckdb_appender_destroy(&table->appender);
+    }
+}
 
-    if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Could not append trace data: %s", duckdb_appender_error(appender)));
-        return DTL_STATUS_ERROR;
+static enum dtl_status
+dtl_io_duckdb_tracer_record_int64_array(
+    struct dtl_io_duckdb_tracer *tracer,
+    uint64_t content,
+    int64_t const *array,
+    size_t size,
+    struct dtl_error **error
+) {
+    struct dtl_io_duckdb_segment_table *table = &tracer->int64_values;
+    size_t offset;
+    size_t count;
+    enum dtl_status status;
+
+    for (offset = 0; offset < size; offset += count) {
+        count = size - offset < DTL_IO_DUCKDB_SEGMENT_SIZE ? size - offset : DTL_IO_DUCKDB_SEGMENT_SIZE;
+
+        status = dtl_io_duckdb_segment_table_begin_row(table, content, offset / DTL_IO_DUCKDB_SEGMENT_SIZE, error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+        dtl_io_duckdb_segment_table_set_list(table, 2, array + offset, sizeof(int64_t), count);
+        dtl_io_duckdb_segment_table_end_row(table);
     }
 
-    db_state = duckdb_appender_close(appender);
-    if (db_state == DuckDBError) {
-        dtl_set_error(error, dtl_error_create("Error flushing trace data: %s", duckdb_appender_error(appender)));
-        return DTL_STATUS_ERROR;
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_duckdb_tracer_record_index_array(
+    struct dtl_io_duckdb_tracer *tracer,
+    uint64_t content,
+    size_t const *array,
+    size_t size,
+    struct dtl_error **error
+) {
+    struct dtl_trace_segment *segment = tracer->segment;
+    struct dtl_io_duckdb_segment_table *table;
+    size_t offset;
+    size_t count;
+    enum dtl_status status;
+
+    for (offset = 0; offset < size; offset += count) {
+        count = size - offset < DTL_IO_DUCKDB_SEGMENT_SIZE ? size - offset : DTL_IO_DUCKDB_SEGMENT_SIZE;
+        dtl_trace_encode_index_segment(segment, array + offset, count);
+
+        switch (segment->encoding) {
+        case DTL_TRACE_ENCODING_SEQUENCES:
+            table = &tracer->index_sequences;
+            break;
+        case DTL_TRACE_ENCODING_OFFSETS:
+            table = &tracer->index_offsets;
+            break;
+        case DTL_TRACE_ENCODING_PLAIN:
+            table = &tracer->index_plain;
+            break;
+        default:
+            assert(false);
+            return DTL_STATUS_ERROR;
+        }
+
+        status = dtl_io_duckdb_segment_table_begin_row(table, content, offset / DTL_IO_DUCKDB_SEGMENT_SIZE, error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+
+        switch (segment->encoding) {
+        case DTL_TRACE_ENCODING_SEQUENCES:
+            dtl_io_duckdb_segment_table_set_list(table, 2, segment->starts, sizeof(int64_t), segment->num_entries);
+            dtl_io_duckdb_segment_table_set_list(table, 3, segment->steps, sizeof(int64_t), segment->num_entries);
+            dtl_io_duckdb_segment_table_set_list(table, 4, segment->counts, sizeof(uint32_t), segment->num_entries);
+            break;
+        case DTL_TRACE_ENCODING_OFFSETS:
+            dtl_io_duckdb_segment_table_set_int64(table, 2, segment->base);
+            dtl_io_duckdb_segment_table_set_list(table, 3, segment->counts, sizeof(uint32_t), segment->num_entries);
+            break;
+        default:
+            dtl_io_duckdb_segment_table_set_list(table, 2, segment->values, sizeof(int64_t), segment->num_entries);
+            break;
+        }
+
+        dtl_io_duckdb_segment_table_end_row(table);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_duckdb_tracer_record_bool_array(
+    struct dtl_io_duckdb_tracer *tracer,
+    uint64_t content,
+    void const *array,
+    size_t size,
+    struct dtl_error **error
+) {
+    struct dtl_trace_segment *segment = tracer->segment;
+    struct dtl_io_duckdb_segment_table *table;
+    size_t offset;
+    size_t count;
+    enum dtl_status status;
+
+    for (offset = 0; offset < size; offset += count) {
+        count = size - offset < DTL_IO_DUCKDB_SEGMENT_SIZE ? size - offset : DTL_IO_DUCKDB_SEGMENT_SIZE;
+        dtl_trace_encode_mask_segment(segment, array, offset, count);
+
+        switch (segment->encoding) {
+        case DTL_TRACE_ENCODING_RUNS:
+            table = &tracer->mask_runs;
+            break;
+        case DTL_TRACE_ENCODING_POSITIONS:
+            table = &tracer->mask_positions;
+            break;
+        case DTL_TRACE_ENCODING_BITMAP:
+            table = &tracer->mask_bitmap;
+            break;
+        default:
+            assert(false);
+            return DTL_STATUS_ERROR;
+        }
+
+        status = dtl_io_duckdb_segment_table_begin_row(table, content, offset / DTL_IO_DUCKDB_SEGMENT_SIZE, error);
+        if (status != DTL_STATUS_OK) {
+            return status;
+        }
+
+        switch (segment->encoding) {
+        case DTL_TRACE_ENCODING_RUNS:
+            dtl_io_duckdb_segment_table_set_list(table, 2, segment->counts, sizeof(uint32_t), segment->num_entries);
+            break;
+        case DTL_TRACE_ENCODING_POSITIONS:
+            dtl_io_duckdb_segment_table_set_int64(table, 2, (int64_t)segment->length);
+            dtl_io_duckdb_segment_table_set_list(table, 3, segment->counts, sizeof(uint32_t), segment->num_entries);
+            break;
+        default:
+            dtl_io_duckdb_segment_table_set_int64(table, 2, (int64_t)segment->length);
+            dtl_io_duckdb_segment_table_set_list(table, 3, segment->words, sizeof(uint64_t), segment->num_entries);
+            break;
+        }
+
+        dtl_io_duckdb_segment_table_end_row(table);
     }
 
     return DTL_STATUS_OK;
@@ -292,27 +646,105 @@ dtl_io_duckdb_tracer_record_value(
     struct dtl_error **error
 ) {
     struct dtl_io_duckdb_tracer *tracer = (struct dtl_io_duckdb_tracer *)base_tracer;
+    void *array;
+    uint64_t content;
+    bool is_new;
+    duckdb_state db_state = DuckDBSuccess;
 
     switch (dtype) {
     case DTL_DTYPE_BOOL_ARRAY:
-        return dtl_io_duckdb_tracer_record_bool_array(
-            tracer, id, size, dtl_value_get_bool_array(value), error
-        );
+        array = dtl_value_get_bool_array(value);
+        break;
     case DTL_DTYPE_INT64_ARRAY:
-        return dtl_io_duckdb_tracer_record_int64_array(
-            tracer, id, size, dtl_value_get_int64_array(value), error
-        );
+        array = dtl_value_get_int64_array(value);
+        break;
+    case DTL_DTYPE_INDEX_ARRAY:
+        array = dtl_value_get_index_array(value);
+        break;
+    default:
+        return DTL_STATUS_OK;
+    }
+
+    content = dtl_io_duckdb_tracer_get_content(tracer, dtype, array, size, &is_new);
+
+    db_state |= duckdb_append_int64(tracer->content_appender, id);
+    db_state |= duckdb_append_uint64(tracer->content_appender, content);
+    db_state |= duckdb_appender_end_row(tracer->content_appender);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Could not append value content: %s", duckdb_appender_error(tracer->content_appender)));
+        return DTL_STATUS_ERROR;
+    }
+
+    if (!is_new) {
+        return DTL_STATUS_OK;
+    }
+
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        return dtl_io_duckdb_tracer_record_bool_array(tracer, content, array, size, error);
+    case DTL_DTYPE_INT64_ARRAY:
+        return dtl_io_duckdb_tracer_record_int64_array(tracer, content, array, size, error);
+    case DTL_DTYPE_INDEX_ARRAY:
+        return dtl_io_duckdb_tracer_record_index_array(tracer, content, array, size, error);
     default:
+        assert(false);
         return DTL_STATUS_OK;
     }
 }
 
+static enum dtl_status
+dtl_io_duckdb_tracer_record_sample(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t id,
+    uint64_t row_index_array,
+    struct dtl_error **error
+) {
+    duckdb_state state = DuckDBSuccess;
+    struct dtl_io_duckdb_tracer *tracer = (struct dtl_io_duckdb_tracer *)base_tracer;
+
+    state |= duckdb_append_int64(tracer->sample_appender, id);
+    state |= duckdb_append_int64(tracer->sample_appender, row_index_array);
+    state |= duckdb_appender_end_row(tracer->sample_appender);
+
+    if (state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Could not append sample details: %s", duckdb_appender_error(tracer->sample_appender)));
+        return DTL_STATUS_ERROR;
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_duckdb_tracer_record_grouping(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t index_array,
+    uint64_t offsets_array,
+    uint64_t entries_array,
+    struct dtl_error **error
+) {
+    duckdb_state state = DuckDBSuccess;
+    struct dtl_io_duckdb_tracer *tracer = (struct dtl_io_duckdb_tracer *)base_tracer;
+
+    state |= duckdb_append_int64(tracer->grouping_appender, index_array);
+    state |= duckdb_append_int64(tracer->grouping_appender, offsets_array);
+    state |= duckdb_append_int64(tracer->grouping_appender, entries_array);
+    state |= duckdb_appender_end_row(tracer->grouping_appender);
+
+    if (state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Could not append grouping details: %s", duckdb_appender_error(tracer->grouping_appender)));
+        return DTL_STATUS_ERROR;
+    }
+
+    return DTL_STATUS_OK;
+}
+
 struct dtl_io_tracer *
 dtl_io_duckdb_tracer_create(char const *path, struct dtl_error **error) {
     duckdb_database db;
     duckdb_result db_result;
     duckdb_state db_state;
     char *errstr = NULL;
+    char *query = NULL;
     struct dtl_io_duckdb_tracer *tracer = NULL;
 
     tracer = calloc(1, sizeof(struct dtl_io_duckdb_tracer));
@@ -327,6 +759,8 @@ dtl_io_duckdb_tracer_create(char const *path, struct dtl_error **error) {
     tracer->base.record_trace = dtl_io_duckdb_tracer_record_trace;
     tracer->base.record_mapping = dtl_io_duckdb_tracer_record_mapping;
     tracer->base.record_value = dtl_io_duckdb_tracer_record_value;
+    tracer->base.record_sample = dtl_io_duckdb_tracer_record_sample;
+    tracer->base.record_grouping = dtl_io_duckdb_tracer_record_grouping;
 
     db_state = duckdb_open_ext(path, &tracer->db, NULL, &errstr);
     if (db_state == DuckDBError) {
@@ -457,6 +891,201 @@ dtl_io_duckdb_tracer_create(char const *path, struct dtl_error **error) {
         goto cleanup;
     }
 
+    // --- Samples -------------------------------------------------------------------------------------------
+
+    // Values that were only traced for a sample of their rows.  Row `i` of the value is row
+    // `row_expression[i]` of the full array.
+    db_state = duckdb_query(
+        tracer->db_conn,
+        "CREATE TABLE sample_meta (\n"
+        "    expression INT NOT NULL,\n"    // Reference to expression table by index.
+        "    row_expression INT NOT NULL\n" // Reference to expression table by index.
+        ");",
+        &db_result
+    );
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to create sample table: %s", duckdb_result_error(&db_result)));
+        duckdb_destroy_result(&db_result);
+        goto cleanup;
+    }
+
+    db_state = duckdb_appender_create(tracer->db_conn, NULL, "sample_meta", &tracer->sample_appender);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to create sample appender"));
+        goto cleanup;
+    }
+
+    // --- Groupings -----------------------------------------------------------------------------------------
+
+    // Entries of a mapping index array grouped by the rows that they point to.  The entries that
+    // point to row `r` are `entries_expression[offsets_expression[r]]` up to
+    // `entries_expression[offsets_expression[r + 1]]`.
+    db_state = duckdb_query(
+        tracer->db_conn,
+        "CREATE TABLE grouping_meta (\n"
+        "    expression INT NOT NULL,\n"         // Reference to expression table by index.
+        "    offsets_expression INT NOT NULL,\n" // Reference to expression table by index.
+        "    entries_expression INT NOT NULL\n"  // Reference to expression table by index.
+        ");",
+        &db_result
+    );
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to create grouping table: %s", duckdb_result_error(&db_result)));
+        duckdb_destroy_result(&db_result);
+        goto cleanup;
+    }
+
+    db_state = duckdb_appender_create(tracer->db_conn, NULL, "grouping_meta", &tracer->grouping_appender);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to create grouping appender"));
+        goto cleanup;
+    }
+
+    // --- Values --------------------------------------------------------------------------------------------
+
+    db_state = duckdb_query(
+        tracer->db_conn,
+        "CREATE TABLE value_content (\n"
+        "    expression BIGINT NOT NULL,\n"
+        "    content UBIGINT NOT NULL\n"
+        ");\n"
+        "CREATE TABLE int64_value (\n"
+        "    content UBIGINT NOT NULL,\n"
+        "    segment BIGINT NOT NULL,\n"
+        "    data BIGINT[] NOT NULL\n"
+        ");\n"
+        "CREATE TABLE index_sequences (\n"
+        "    content UBIGINT NOT NULL,\n"
+        "    segment BIGINT NOT NULL,\n"
+        "    starts BIGINT[] NOT NULL,\n"
+        "    steps BIGINT[] NOT NULL,\n"
+        "    counts UINTEGER[] NOT NULL\n"
+        ");\n"
+        "CREATE TABLE index_offsets (\n"
+        "    content UBIGINT NOT NULL,\n"
+        "    segment BIGINT NOT NULL,\n"
+        "    base BIGINT NOT NULL,\n"
+        "    offsets UINTEGER[] NOT NULL\n"
+        ");\n"
+        "CREATE TABLE index_plain (\n"
+        "    content UBIGINT NOT NULL,\n"
+        "    segment BIGINT NOT NULL,\n"
+        "    data BIGINT[] NOT NULL\n"
+        ");\n"
+        "CREATE TABLE mask_runs (\n"
+        "    content UBIGINT NOT NULL,\n"
+        "    segment BIGINT NOT NULL,\n"
+        "    runs UINTEGER[] NOT NULL\n"
+        ");\n"
+        "CREATE TABLE mask_positions (\n"
+        "    content UBIGINT NOT NULL,\n"
+        "    segment BIGINT NOT NULL,\n"
+        "    length BIGINT NOT NULL,\n"
+        "    positions UINTEGER[] NOT NULL\n"
+        ");\n"
+        "CREATE TABLE mask_bitmap (\n"
+        "    content UBIGINT NOT NULL,\n"
+        "    segment BIGINT NOT NULL,\n"
+        "    length BIGINT NOT NULL,\n"
+        "    words UBIGINT[] NOT NULL\n"
+        ");",
+        &db_result
+    );
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to create value tables: %s", duckdb_result_error(&db_result)));
+        duckdb_destroy_result(&db_result);
+        goto cleanup;
+    }
+
+    // Expands segments back out to one row per value, for querying individual expressions.  Index
+    // and mask segments are decoded by the views, so only the segments that a query touches are
+    // ever expanded.
+    asprintf(
+        &query,
+        "CREATE VIEW bool_expression AS\n"
+        "WITH segments AS (\n"
+        "    SELECT content, segment, flatten(list_transform(\n"
+        "        range(len(runs)), k -> list_transform(range(runs[k + 1]), i -> k %% 2 = 1)\n"
+        "    )) AS data FROM mask_runs\n"
+        "    UNION ALL\n"
+        "    SELECT content, segment, list_transform(\n"
+        "        range(length), i -> list_contains(positions, i)\n"
+        "    ) AS data FROM mask_positions\n"
+        "    UNION ALL\n"
+        "    SELECT content, segment, list_transform(\n"
+        "        range(length), i -> (words[i // 64 + 1] >> (i %% 64)::UBIGINT) & 1 = 1\n"
+        "    ) AS data FROM mask_bitmap\n"
+        ")\n"
+        "SELECT\n"
+        "    expression,\n"
+        "    segment * %i + generate_subscripts(data, 1) - 1 AS row,\n"
+        "    unnest(data) AS data\n"
+        "FROM value_content JOIN segments USING (content);\n"
+        "CREATE VIEW int64_expression AS\n"
+        "SELECT\n"
+        "    expression,\n"
+        "    segment * %i + generate_subscripts(data, 1) - 1 AS row,\n"
+        "    unnest(data) AS data\n"
+        "FROM value_content JOIN int64_value USING (content);\n"
+        "CREATE VIEW index_expression AS\n"
+        "WITH segments AS (\n"
+        "    SELECT content, segment, flatten(list_transform(\n"
+        "        range(len(starts)),\n"
+        "        k -> list_transform(range(counts[k + 1]), i -> starts[k + 1] + steps[k + 1] * i)\n"
+        "    )) AS data FROM index_sequences\n"
+        "    UNION ALL\n"
+        "    SELECT content, segment, list_transform(offsets, o -> base + o) AS data FROM index_offsets\n"
+        "    UNION ALL\n"
+        "    SELECT content, segment, data FROM index_plain\n"
+        ")\n"
+        "SELECT\n"
+        "    expression,\n"
+        "    segment * %i + generate_subscripts(data, 1) - 1 AS row,\n"
+        "    unnest(data) AS data\n"
+        "FROM value_content JOIN segments USING (content);",
+        DTL_IO_DUCKDB_SEGMENT_SIZE,
+        DTL_IO_DUCKDB_SEGMENT_SIZE,
+        DTL_IO_DUCKDB_SEGMENT_SIZE
+    );
+    db_state = duckdb_query(tracer->db_conn, query, &db_result);
+    free(query);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to create value views: %s", duckdb_result_error(&db_result)));
+        duckdb_destroy_result(&db_result);
+        goto cleanup;
+    }
+
+    db_state = duckdb_appender_create(tracer->db_conn, NULL, "value_content", &tracer->content_appender);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to create value content appender"));
+        goto cleanup;
+    }
+
+    if (dtl_io_duckdb_segment_table_create(tracer, &tracer->int64_values, "int64_value", error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_create(tracer, &tracer->index_sequences, "index_sequences", error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_create(tracer, &tracer->index_offsets, "index_offsets", error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_create(tracer, &tracer->index_plain, "index_plain", error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_create(tracer, &tracer->mask_runs, "mask_runs", error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_create(tracer, &tracer->mask_positions, "mask_positions", error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_create(tracer, &tracer->mask_bitmap, "mask_bitmap", error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+
+    tracer->segment = dtl_trace_segment_create(DTL_IO_DUCKDB_SEGMENT_SIZE);
+    tracer->hash_state = XXH3_createState();
+
     return &tracer->base;
 
 cleanup:
@@ -470,6 +1099,46 @@ dtl_io_duckdb_tracer_destroy(struct dtl_io_tracer *base_tracer, struct dtl_error
     duckdb_state db_state;
     enum dtl_status result = DTL_STATUS_ERROR;
 
+    if (dtl_io_duckdb_segment_table_close(&tracer->mask_bitmap, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_close(&tracer->mask_positions, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_close(&tracer->mask_runs, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_close(&tracer->index_plain, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_close(&tracer->index_offsets, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_close(&tracer->index_sequences, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    if (dtl_io_duckdb_segment_table_close(&tracer->int64_values, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+
+    db_state = duckdb_appender_close(tracer->content_appender);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Error flushing value contents: %s", duckdb_appender_error(tracer->content_appender)));
+        goto cleanup;
+    }
+
+    db_state = duckdb_appender_close(tracer->grouping_appender);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Error flushing groupings: %s", duckdb_appender_error(tracer->grouping_appender)));
+        goto cleanup;
+    }
+
+    db_state = duckdb_appender_close(tracer->sample_appender);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Error flushing samples: %s", duckdb_appender_error(tracer->sample_appender)));
+        goto cleanup;
+    }
+
     db_state = duckdb_appender_close(tracer->mapping_appender);
     if (db_state == DuckDBError) {
         dtl_set_error(error, dtl_error_create("Error flushing mappings: %s", duckdb_appender_error(tracer->mapping_appender)));
@@ -503,6 +1172,16 @@ dtl_io_duckdb_tracer_destroy(struct dtl_io_tracer *base_tracer, struct dtl_error
     result = DTL_STATUS_OK;
 
 cleanup:
+    dtl_io_duckdb_segment_table_destroy(&tracer->mask_bitmap);
+    dtl_io_duckdb_segment_table_destroy(&tracer->mask_positions);
+    dtl_io_duckdb_segment_table_destroy(&tracer->mask_runs);
+    dtl_io_duckdb_segment_table_destroy(&tracer->index_plain);
+    dtl_io_duckdb_segment_table_destroy(&tracer->index_offsets);
+    dtl_io_duckdb_segment_table_destroy(&tracer->index_sequences);
+    dtl_io_duckdb_segment_table_destroy(&tracer->int64_values);
+    duckdb_appender_destroy(&tracer->content_appender);
+    duckdb_appender_destroy(&tracer->grouping_appender);
+    duckdb_appender_destroy(&tracer->sample_appender);
     duckdb_appender_destroy(&tracer->mapping_appender);
     duckdb_appender_destroy(&tracer->trace_appender);
     duckdb_appender_destroy(&tracer->output_appender);
@@ -512,5 +1191,423 @@ cleanup:
     duckdb_disconnect(&tracer->db_conn);
     duckdb_close(&tracer->db);
 
+    dtl_trace_segment_destroy(tracer->segment);
+    XXH3_freeState(tracer->hash_state);
+    free(tracer->contents);
+
     return result;
 }
+
+// Reads traces back out of a database written by the tracer.  Values are read through the views,
+// which decode index arrays and masks in the database, so that only the segments of the requested
+// array are ever expanded.  Arrays are copied out of the result a chunk of vectors at a time.
+
+struct dtl_io_duckdb_trace_reader {
+    struct dtl_io_trace_reader base;
+
+    duckdb_database db;
+    duckdb_connection db_conn;
+};
+
+static enum dtl_status
+dtl_io_duckdb_trace_reader_query(
+    struct dtl_io_duckdb_trace_reader *reader,
+    char const *query,
+    duckdb_result *result,
+    struct dtl_error **error
+) {
+    if (duckdb_query(reader->db_conn, query, result) == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to read trace: %s", duckdb_result_error(result)));
+        duckdb_destroy_result(result);
+        return DTL_STATUS_ERROR;
+    }
+    return DTL_STATUS_OK;
+}
+
+// Runs a query with the id of an array as its only parameter.
+static enum dtl_status
+dtl_io_duckdb_trace_reader_query_array(
+    struct dtl_io_duckdb_trace_reader *reader,
+    char const *query,
+    uint64_t id,
+    duckdb_result *result,
+    struct dtl_error **error
+) {
+    duckdb_prepared_statement statement;
+    duckdb_state db_state;
+
+    if (duckdb_prepare(reader->db_conn, query, &statement) == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to read trace: %s", duckdb_prepare_error(statement)));
+        duckdb_destroy_prepare(&statement);
+        return DTL_STATUS_ERROR;
+    }
+
+    db_state = duckdb_bind_int64(statement, 1, (int64_t)id);
+    if (db_state == DuckDBSuccess) {
+        db_state = duckdb_execute_prepared(statement, result);
+        if (db_state == DuckDBError) {
+            dtl_set_error(error, dtl_error_create("Failed to read array %llu: %s", (unsigned long long)id, duckdb_result_error(result)));
+            duckdb_destroy_result(result);
+        }
+    } else {
+        dtl_set_error(error, dtl_error_create("Failed to read array %llu", (unsigned long long)id));
+    }
+
+    duckdb_destroy_prepare(&statement);
+    return db_state == DuckDBSuccess ? DTL_STATUS_OK : DTL_STATUS_ERROR;
+}
+
+// Index arrays are stored as nulls if they are the identity.
+static ssize_t
+dtl_io_duckdb_trace_reader_get_index_array(duckdb_result *result, idx_t column, idx_t row) {
+    if (duckdb_value_is_null(result, column, row)) {
+        return -1;
+    }
+    return (ssize_t)duckdb_value_int64(result, column, row);
+}
+
+static enum dtl_status
+dtl_io_duckdb_trace_reader_read_columns(
+    struct dtl_io_duckdb_trace_reader *reader,
+    struct dtl_manifest *manifest,
+    char const *query,
+    void (*add_column)(struct dtl_manifest *, char const *, char const *, size_t),
+    struct dtl_error **error
+) {
+    duckdb_result result;
+    char *table;
+    char *column;
+    idx_t row;
+
+    if (dtl_io_duckdb_trace_reader_query(reader, query, &result, error) != DTL_STATUS_OK) {
+        return DTL_STATUS_ERROR;
+    }
+    for (row = 0; row < duckdb_row_count(&result); row++) {
+        table = duckdb_value_varchar(&result, 0, row);
+        column = duckdb_value_varchar(&result, 1, row);
+        add_column(manifest, table, column, (size_t)duckdb_value_int64(&result, 2, row));
+        duckdb_free(table);
+        duckdb_free(column);
+    }
+    duckdb_destroy_result(&result);
+
+    return DTL_STATUS_OK;
+}
+
+static struct dtl_manifest *
+dtl_io_duckdb_trace_reader_read_manifest(struct dtl_io_trace_reader *base_reader, struct dtl_error **error) {
+    struct dtl_io_duckdb_trace_reader *reader = (struct dtl_io_duckdb_trace_reader *)base_reader;
+    struct dtl_manifest *manifest;
+    duckdb_result result;
+    char *text;
+    char *filename;
+    char *column;
+    idx_t row;
+
+    manifest = dtl_manifest_create();
+
+    if (dtl_io_duckdb_trace_reader_query(reader, "SELECT text, filename FROM source", &result, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    for (row = 0; row < duckdb_row_count(&result); row++) {
+        text = duckdb_value_varchar(&result, 0, row);
+        filename = duckdb_value_varchar(&result, 1, row);
+        dtl_manifest_add_source(manifest, text, filename);
+        duckdb_free(text);
+        duckdb_free(filename);
+    }
+    duckdb_destroy_result(&result);
+
+    if (dtl_io_duckdb_trace_reader_read_columns(
+            reader, manifest, "SELECT input_name, column_name, expression FROM input_meta", dtl_manifest_add_input, error
+        ) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+
+    if (dtl_io_duckdb_trace_reader_read_columns(
+            reader, manifest, "SELECT output_name, column_name, expression FROM output_meta", dtl_manifest_add_output, error
+        ) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+
+    if (dtl_io_duckdb_trace_reader_query(
+            reader, "SELECT filename, start_offset, end_offset, column_name, expression FROM trace_meta", &result, error
+        ) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    for (row = 0; row < duckdb_row_count(&result); row++) {
+        filename = duckdb_value_varchar(&result, 0, row);
+        column = duckdb_value_varchar(&result, 3, row);
+        dtl_manifest_add_trace(
+            manifest,
+            filename,
+            (size_t)duckdb_value_int64(&result, 1, row),
+            (size_t)duckdb_value_int64(&result, 2, row),
+            column,
+            (size_t)duckdb_value_int64(&result, 4, row)
+        );
+        duckdb_free(filename);
+        duckdb_free(column);
+    }
+    duckdb_destroy_result(&result);
+
+    if (dtl_io_duckdb_trace_reader_query(
+            reader,
+            "SELECT src_expression, tgt_expression, src_mapping_expression, tgt_mapping_expression FROM mapping_meta",
+            &result,
+            error
+        ) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    for (row = 0; row < duckdb_row_count(&result); row++) {
+        dtl_manifest_add_mapping(
+            manifest,
+            (size_t)duckdb_value_int64(&result, 0, row),
+            (size_t)duckdb_value_int64(&result, 1, row),
+            dtl_io_duckdb_trace_reader_get_index_array(&result, 2, row),
+            dtl_io_duckdb_trace_reader_get_index_array(&result, 3, row)
+        );
+    }
+    duckdb_destroy_result(&result);
+
+    if (dtl_io_duckdb_trace_reader_query(reader, "SELECT expression, row_expression FROM sample_meta", &result, error) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    for (row = 0; row < duckdb_row_count(&result); row++) {
+        dtl_manifest_add_sample(
+            manifest, (size_t)duckdb_value_int64(&result, 0, row), (size_t)duckdb_value_int64(&result, 1, row)
+        );
+    }
+    duckdb_destroy_result(&result);
+
+    if (dtl_io_duckdb_trace_reader_query(
+            reader, "SELECT expression, offsets_expression, entries_expression FROM grouping_meta", &result, error
+        ) != DTL_STATUS_OK) {
+        goto cleanup;
+    }
+    for (row = 0; row < duckdb_row_count(&result); row++) {
+        dtl_manifest_add_grouping(
+            manifest,
+            (size_t)duckdb_value_int64(&result, 0, row),
+            (size_t)duckdb_value_int64(&result, 1, row),
+            (size_t)duckdb_value_int64(&result, 2, row)
+        );
+    }
+    duckdb_destroy_result(&result);
+
+    return manifest;
+
+cleanup:
+    dtl_manifest_destroy(manifest);
+    return NULL;
+}
+
+static enum dtl_status
+dtl_io_duckdb_trace_reader_read_index_array(
+    struct dtl_io_trace_reader *base_reader,
+    uint64_t id,
+    size_t **out,
+    size_t *size,
+    struct dtl_error **error
+) {
+    struct dtl_io_duckdb_trace_reader *reader = (struct dtl_io_duckdb_trace_reader *)base_reader;
+    duckdb_result result;
+    duckdb_data_chunk chunk;
+    int64_t *data;
+    size_t *array;
+    idx_t chunk_size;
+    idx_t row;
+    idx_t i;
+
+    if (dtl_io_duckdb_trace_reader_query_array(
+            reader, "SELECT data FROM index_expression WHERE expression = $1 ORDER BY row", id, &result, error
+        ) != DTL_STATUS_OK) {
+        return DTL_STATUS_ERROR;
+    }
+
+    // Empty arrays have no segments, and so can't be told apart from missing ones.  Padded so that
+    // they still get an allocation.
+    *size = duckdb_row_count(&result);
+    array = dtl_index_array_create(*size + 1);
+    row = 0;
+    while ((chunk = duckdb_fetch_chunk(result)) != NULL) {
+        data = duckdb_vector_get_data(duckdb_data_chunk_get_vector(chunk, 0));
+        chunk_size = duckdb_data_chunk_get_size(chunk);
+        assert(row + chunk_size <= *size);
+        for (i = 0; i < chunk_size; i++) {
+            array[row + i] = (size_t)data[i];
+        }
+        row += chunk_size;
+        duckdb_destroy_data_chunk(&chunk);
+    }
+    duckdb_destroy_result(&result);
+
+    *out = array;
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_duckdb_trace_reader_read_value(
+    struct dtl_io_trace_reader *base_reader,
+    uint64_t id,
+    bool *found,
+    enum dtl_dtype *dtype,
+    size_t *size,
+    struct dtl_value *out,
+    struct dtl_error **error
+) {
+    struct dtl_io_duckdb_trace_reader *reader = (struct dtl_io_duckdb_trace_reader *)base_reader;
+    duckdb_result result;
+    duckdb_data_chunk chunk;
+    bool *bool_data;
+    int64_t *int64_array;
+    void *bool_array;
+    size_t *index_array;
+    idx_t chunk_size;
+    idx_t row;
+    idx_t i;
+
+    // The type of a value is given by the table that its segments were written to.
+    if (dtl_io_duckdb_trace_reader_query_array(
+            reader,
+            "SELECT\n"
+            "    EXISTS (FROM int64_value WHERE content = value_content.content),\n"
+            "    EXISTS (FROM mask_runs WHERE content = value_content.content)\n"
+            "        OR EXISTS (FROM mask_positions WHERE content = value_content.content)\n"
+            "        OR EXISTS (FROM mask_bitmap WHERE content = value_content.content),\n"
+            "    EXISTS (FROM index_sequences WHERE content = value_content.content)\n"
+            "        OR EXISTS (FROM index_offsets WHERE content = value_content.content)\n"
+            "        OR EXISTS (FROM index_plain WHERE content = value_content.content)\n"
+            "FROM value_content WHERE expression = $1 LIMIT 1",
+            id,
+            &result,
+            error
+        ) != DTL_STATUS_OK) {
+        return DTL_STATUS_ERROR;
+    }
+
+    *found = false;
+    if (duckdb_row_count(&result) > 0) {
+        if (duckdb_value_boolean(&result, 0, 0)) {
+            *found = true;
+            *dtype = DTL_DTYPE_INT64_ARRAY;
+        } else if (duckdb_value_boolean(&result, 1, 0)) {
+            *found = true;
+            *dtype = DTL_DTYPE_BOOL_ARRAY;
+        } else if (duckdb_value_boolean(&result, 2, 0)) {
+            *found = true;
+            *dtype = DTL_DTYPE_INDEX_ARRAY;
+        }
+    }
+    duckdb_destroy_result(&result);
+
+    if (!*found) {
+        return DTL_STATUS_OK;
+    }
+
+    switch (*dtype) {
+    case DTL_DTYPE_INT64_ARRAY:
+        if (dtl_io_duckdb_trace_reader_query_array(
+                reader, "SELECT data FROM int64_expression WHERE expression = $1 ORDER BY row", id, &result, error
+            ) != DTL_STATUS_OK) {
+            return DTL_STATUS_ERROR;
+        }
+        *size = duckdb_row_count(&result);
+        int64_array = dtl_int64_array_create(*size);
+        row = 0;
+        while ((chunk = duckdb_fetch_chunk(result)) != NULL) {
+            chunk_size = duckdb_data_chunk_get_size(chunk);
+            assert(row + chunk_size <= *size);
+            memcpy(
+                int64_array + row, duckdb_vector_get_data(duckdb_data_chunk_get_vector(chunk, 0)), chunk_size * sizeof(int64_t)
+            );
+            row += chunk_size;
+            duckdb_destroy_data_chunk(&chunk);
+        }
+        duckdb_destroy_result(&result);
+        dtl_value_take_int64_array(out, int64_array);
+        return DTL_STATUS_OK;
+
+    case DTL_DTYPE_BOOL_ARRAY:
+        if (dtl_io_duckdb_trace_reader_query_array(
+                reader, "SELECT data FROM bool_expression WHERE expression = $1 ORDER BY row", id, &result, error
+            ) != DTL_STATUS_OK) {
+            return DTL_STATUS_ERROR;
+        }
+        *size = duckdb_row_count(&result);
+        bool_array = dtl_bool_array_create(*size);
+        row = 0;
+        while ((chunk = duckdb_fetch_chunk(result)) != NULL) {
+            bool_data = duckdb_vector_get_data(duckdb_data_chunk_get_vector(chunk, 0));
+            chunk_size = duckdb_data_chunk_get_size(chunk);
+            assert(row + chunk_size <= *size);
+            for (i = 0; i < chunk_size; i++) {
+                dtl_bool_array_set(bool_array, row + i, bool_data[i]);
+            }
+            row += chunk_size;
+            duckdb_destroy_data_chunk(&chunk);
+        }
+        duckdb_destroy_result(&result);
+        dtl_value_take_bool_array(out, bool_array);
+        return DTL_STATUS_OK;
+
+    default:
+        if (dtl_io_duckdb_trace_reader_read_index_array(base_reader, id, &index_array, size, error) != DTL_STATUS_OK) {
+            return DTL_STATUS_ERROR;
+        }
+        dtl_value_take_index_array(out, index_array);
+        return DTL_STATUS_OK;
+    }
+}
+
+struct dtl_io_trace_reader *
+dtl_io_duckdb_trace_reader_create(char const *path, struct dtl_error **error) {
+    struct dtl_io_duckdb_trace_reader *reader;
+    duckdb_config config;
+    duckdb_state db_state;
+    char *errstr = NULL;
+
+    reader = calloc(1, sizeof(struct dtl_io_duckdb_trace_reader));
+    reader->base.read_manifest = dtl_io_duckdb_trace_reader_read_manifest;
+    reader->base.read_index_array = dtl_io_duckdb_trace_reader_read_index_array;
+    reader->base.read_value = dtl_io_duckdb_trace_reader_read_value;
+
+    if (duckdb_create_config(&config) == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Couldn't create duckdb config"));
+        free(reader);
+        return NULL;
+    }
+    duckdb_set_config(config, "access_mode", "READ_ONLY");
+
+    db_state = duckdb_open_ext(path, &reader->db, config, &errstr);
+    duckdb_destroy_config(&config);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Couldn't open %s: %s", path, errstr));
+        duckdb_free(errstr);
+        free(reader);
+        return NULL;
+    }
+
+    db_state = duckdb_connect(reader->db, &reader->db_conn);
+    if (db_state == DuckDBError) {
+        dtl_set_error(error, dtl_error_create("Failed to open connection to duckdb"));
+        duckdb_close(&reader->db);
+        free(reader);
+        return NULL;
+    }
+
+    return &reader->base;
+}
+
+void
+dtl_io_duckdb_trace_reader_destroy(struct dtl_io_trace_reader *base_reader) {
+    struct dtl_io_duckdb_trace_reader *reader = (struct dtl_io_duckdb_trace_reader *)base_reader;
+
+    if (reader == NULL) {
+        return;
+    }
+
+    duckdb_disconnect(&reader->db_conn);
+    duckdb_close(&reader->db);
+    free(reader);
+}
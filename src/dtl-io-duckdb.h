@@ -8,3 +8,10 @@ dtl_io_duckdb_tracer_create(char const *path, struct dtl_error **error);
 
 enum dtl_status
 dtl_io_duckdb_tracer_destroy(struct dtl_io_tracer *, struct dtl_error **error);
+
+// Opens a database written by the DuckDB tracer for reading.
+struct dtl_io_trace_reader *
+dtl_io_duckdb_trace_reader_create(char const *path, struct dtl_error **error);
+
+void
+dtl_io_duckdb_trace_reader_destroy(struct dtl_io_trace_reader *);
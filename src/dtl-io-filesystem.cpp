@@ -2,49 +2,91 @@ extern "C" {
 #include "dtl-io-filesystem.h"
 }
 
+#include "dtl-io-arrow.hpp"
+
 #include <arrow/api.h>
 #include <arrow/io/api.h>
+#include <arrow/io/caching.h>
+#include <arrow/ipc/api.h>
 #include <arrow/type.h>
+#include <algorithm>
+#include <arrow/util/compression.h>
+#include <arrow/util/future.h>
+#include <arrow/util/thread_pool.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <parquet/arrow/reader.h>
 #include <parquet/arrow/writer.h>
+#include <parquet/bloom_filter.h>
+#include <parquet/bloom_filter_reader.h>
 #include <parquet/exception.h>
+#include <parquet/metadata.h>
+#include <parquet/properties.h>
+#include <parquet/statistics.h>
 #include <string>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 extern "C" {
 #define restrict __restrict__
 
 #include "dtl-io.h"
-#include "dtl-bool-array.h"
-#include "dtl-int64-array.h"
 #include "dtl-value.h"
+#include "dtl-bool-array.h"
+#include "dtl-double-array.h"
 #include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-index-array.h"
+#include "dtl-int64-array.h"
+#include "dtl-location.h"
+#include "dtl-manifest.h"
 #include "dtl-schema.h"
 }
 
 
-void
-dtl_io_filesystem_set_error_from_arrow_status(struct dtl_error **error, arrow::Status status) {
-    // TODO
-    (void) error;
-    (void) status;
-}
-
 /* === Importer ================================================================================= */
 
 struct dtl_io_filesystem_table {
     struct dtl_io_table base;
 
-    std::shared_ptr<arrow::Table> arrow_table;
+    // Only the footer is read when the table is imported.  Column chunks are fetched through the
+    // reader the first time the evaluator asks for them.
+    std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
+    std::shared_ptr<arrow::Schema> arrow_schema;
+
+    // The whole file, if it was memory mapped.  Used to tell the kernel which ranges are about to
+    // be read.
+    std::shared_ptr<arrow::Buffer> mapping;
+
+    // Row groups that could not be ruled out by the predicates passed to `add_predicate`, and the
+    // total number of rows that they contain.
+    std::vector<int> row_groups;
+    size_t num_rows;
+
+    // Data handed out by `read_column_data`, indexed by column.  Entries are either borrowed
+    // directly from the buffers of `arrow_columns` or, if the column had to be converted or spans
+    // more than one chunk, allocated by us and flagged in `owned_columns`.
+    std::vector<std::shared_ptr<arrow::ChunkedArray>> arrow_columns;
+    std::vector<void *> columns;
+    std::vector<bool> owned_columns;
 };
 
 struct dtl_io_filesystem_importer {
     struct dtl_io_importer base;
 
     std::filesystem::path root;
+    bool memory_map;
 };
 
 static size_t
@@ -56,25 +98,197 @@ dtl_io_filesystem_table_get_num_rows(struct dtl_io_table* table) {
 
     fs_table = (struct dtl_io_filesystem_table *) table;
 
-    return fs_table->arrow_table->num_rows();
+    return fs_table->num_rows;
 }
 
-struct dtl_io_filesystem_table_get_column_data_visitor : arrow::ScalarVisitor {
-    enum dtl_dtype dtype;
-    struct dtl_value value;
+template <typename ParquetType>
+static bool
+dtl_io_filesystem_statistics_may_match(
+    parquet::Statistics const &statistics,
+    enum dtl_io_predicate_op op,
+    int64_t value
+) {
+    auto const &typed_statistics = static_cast<parquet::TypedStatistics<ParquetType> const &>(statistics);
+    int64_t min = typed_statistics.min();
+    int64_t max = typed_statistics.max();
+
+    switch (op) {
+    case DTL_IO_PREDICATE_EQUAL_TO:
+        return min <= value && value <= max;
+    case DTL_IO_PREDICATE_LESS_THAN:
+        return min < value;
+    case DTL_IO_PREDICATE_LESS_THAN_OR_EQUAL_TO:
+        return min <= value;
+    case DTL_IO_PREDICATE_GREATER_THAN:
+        return max > value;
+    case DTL_IO_PREDICATE_GREATER_THAN_OR_EQUAL_TO:
+        return max >= value;
+    }
+
+    return true;
+}
+
+static bool
+dtl_io_filesystem_bloom_filter_may_match(
+    parquet::ParquetFileReader &reader,
+    int row_group,
+    int column,
+    parquet::Type::type physical_type,
+    int64_t value
+) {
+    std::unique_ptr<parquet::BloomFilter> bloom_filter;
+
+    try {
+        auto row_group_bloom_filters = reader.GetBloomFilterReader().RowGroup(row_group);
+        if (row_group_bloom_filters == nullptr) {
+            return true;
+        }
+        bloom_filter = row_group_bloom_filters->GetColumnBloomFilter(column);
+    } catch (parquet::ParquetException const &) {
+        // A corrupt or unreadable filter just means that we can't rule the row group out.
+        return true;
+    }
+    if (bloom_filter == nullptr) {
+        return true;
+    }
+
+    // Values are hashed in their physical representation.
+    switch (physical_type) {
+    case parquet::Type::INT32:
+        if (value < INT32_MIN || value > INT32_MAX) {
+            return false;
+        }
+        return bloom_filter->FindHash(bloom_filter->Hash((int32_t)value));
+    case parquet::Type::INT64:
+        return bloom_filter->FindHash(bloom_filter->Hash(value));
+    default:
+        return true;
+    }
+}
+
+static enum dtl_status
+dtl_io_filesystem_table_add_predicate(
+    struct dtl_io_table* table,
+    size_t col_index,
+    enum dtl_io_predicate_op op,
+    int64_t value,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_table *fs_table;
+    std::vector<int> row_groups;
+    size_t num_rows = 0;
+
+    (void)error;
+
+    assert(table != NULL);
+    assert(table->add_predicate == dtl_io_filesystem_table_add_predicate);
+
+    fs_table = (struct dtl_io_filesystem_table *)table;
+
+    if (dtl_schema_get_column_dtype(table->schema, col_index) != DTL_DTYPE_INT64_ARRAY) {
+        return DTL_STATUS_OK;
+    }
+
+    // Row groups are dropped using the min/max statistics from the footer and, for equality
+    // predicates, any bloom filters that the file contains.  Nested columns are rejected at
+    // import, so field indexes and leaf column indexes are the same.
+    auto parquet_reader = fs_table->arrow_reader->parquet_reader();
+    auto metadata = parquet_reader->metadata();
+    auto physical_type = metadata->schema()->Column(col_index)->physical_type();
+    for (int row_group : fs_table->row_groups) {
+        auto row_group_metadata = metadata->RowGroup(row_group);
+        auto column_metadata = row_group_metadata->ColumnChunk(col_index);
+        bool may_match = true;
+
+        auto statistics = column_metadata->statistics();
+        if (column_metadata->is_stats_set() && statistics != nullptr && statistics->HasMinMax()) {
+            switch (physical_type) {
+            case parquet::Type::INT32:
+                may_match = dtl_io_filesystem_statistics_may_match<parquet::Int32Type>(*statistics, op, value);
+                break;
+            case parquet::Type::INT64:
+                may_match = dtl_io_filesystem_statistics_may_match<parquet::Int64Type>(*statistics, op, value);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (may_match && op == DTL_IO_PREDICATE_EQUAL_TO) {
+            may_match = dtl_io_filesystem_bloom_filter_may_match(
+                *parquet_reader, row_group, col_index, physical_type, value
+            );
+        }
+
+        if (may_match) {
+            row_groups.push_back(row_group);
+            num_rows += row_group_metadata->num_rows();
+        }
+    }
 
-    arrow::Status Visit(const arrow::Int32Scalar &scalar) {
-        dtype = DTL_DTYPE_INT64;
-        dtl_value_set_int64(&value, scalar.value);
+    fs_table->row_groups = std::move(row_groups);
+    fs_table->num_rows = num_rows;
+
+    return DTL_STATUS_OK;
+}
+
+// Asks the kernel to start reading in the chunks of a column that belong to the surviving row
+// groups.  Pages belonging to row groups that were ruled out are never touched.
+static arrow::Status
+dtl_io_filesystem_table_advise_column(struct dtl_io_filesystem_table *fs_table, size_t col_index) {
+    auto metadata = fs_table->arrow_reader->parquet_reader()->metadata();
+    uintptr_t page_size = sysconf(_SC_PAGESIZE);
+
+    if (fs_table->mapping == nullptr) {
         return arrow::Status::OK();
     }
 
-    arrow::Status Visit(const arrow::Int64Scalar &scalar) {
-        dtype = DTL_DTYPE_INT64;
-        dtl_value_set_int64(&value, scalar.value);
+    for (int row_group : fs_table->row_groups) {
+        auto column_metadata = metadata->RowGroup(row_group)->ColumnChunk(col_index);
+
+        int64_t start = column_metadata->data_page_offset();
+        if (column_metadata->has_dictionary_page() && column_metadata->dictionary_page_offset() > 0) {
+            start = std::min(start, column_metadata->dictionary_page_offset());
+        }
+        int64_t end = std::min(start + column_metadata->total_compressed_size(), fs_table->mapping->size());
+        if (start < 0 || start >= end) {
+            continue;
+        }
+
+        uintptr_t address = (uintptr_t)fs_table->mapping->data() + start;
+        uintptr_t aligned = address & ~(page_size - 1);
+        if (madvise((void *)aligned, address - aligned + (end - start), MADV_WILLNEED) != 0) {
+            return arrow::Status::IOError("madvise failed: ", strerror(errno));
+        }
+    }
+
+    return arrow::Status::OK();
+}
+
+static arrow::Status
+dtl_io_filesystem_table_fetch_column(
+    struct dtl_io_filesystem_table *fs_table,
+    size_t col_index,
+    std::shared_ptr<arrow::ChunkedArray> *out
+) {
+    auto metadata = fs_table->arrow_reader->parquet_reader()->metadata();
+    std::shared_ptr<arrow::Table> arrow_table;
+
+    ARROW_RETURN_NOT_OK(dtl_io_filesystem_table_advise_column(fs_table, col_index));
+
+    if (fs_table->row_groups.size() == (size_t)metadata->num_row_groups()) {
+        return fs_table->arrow_reader->ReadColumn(col_index, out);
+    }
+
+    if (fs_table->row_groups.empty()) {
+        ARROW_ASSIGN_OR_RAISE(*out, arrow::ChunkedArray::MakeEmpty(fs_table->arrow_schema->field(col_index)->type()));
         return arrow::Status::OK();
     }
-};
+
+    ARROW_RETURN_NOT_OK(fs_table->arrow_reader->ReadRowGroups(fs_table->row_groups, {(int)col_index}, &arrow_table));
+    *out = arrow_table->column(0);
+    return arrow::Status::OK();
+}
 
 static enum dtl_status
 dtl_io_filesystem_table_read_column_data(
@@ -85,55 +299,55 @@ dtl_io_filesystem_table_read_column_data(
 ) {
     enum dtl_dtype dtype;
     struct dtl_io_filesystem_table *fs_table;
+    arrow::Status status;
     std::shared_ptr<arrow::ChunkedArray> arrow_column;
-    size_t size;
-    int64_t *array;
-    size_t i;
-    arrow::Result<std::shared_ptr<arrow::Scalar>> arrow_scalar_result;
-    struct dtl_io_filesystem_table_get_column_data_visitor visitor;
-    arrow::Status arrow_status;
+    void *data = NULL;
+    bool owned = false;
 
     assert(table != NULL);
     assert(table->read_column_data == dtl_io_filesystem_table_read_column_data);
 
-    dtype = dtl_schema_get_column_dtype(table->schema, col_index);
-    dtype = dtl_dtype_get_scalar_type(dtype);
-
     fs_table = (struct dtl_io_filesystem_table*)table;
-    arrow_column = fs_table->arrow_table->column(col_index);
-
-    size = fs_table->arrow_table->num_rows();
-    array = dtl_int64_array_create(size);  // TODO
+    dtype = dtl_schema_get_column_dtype(table->schema, col_index);
 
-    for (i = 0; i < size; i++) {
-        // TODO this is fucking insane.  There must be a better way to do this.
-        arrow_scalar_result = arrow_column->GetScalar(i);
-        if (!arrow_scalar_result.ok()) {
-            dtl_io_filesystem_set_error_from_arrow_status(error, arrow_scalar_result.status());
-            return DTL_STATUS_ERROR;
-        }
-        arrow_status = arrow_scalar_result.ValueOrDie()->Accept(&visitor);
-        if (!arrow_status.ok()) {
-            dtl_io_filesystem_set_error_from_arrow_status(error, arrow_status);
+    data = fs_table->columns[col_index];
+    if (data == NULL) {
+        status = dtl_io_filesystem_table_fetch_column(fs_table, col_index, &arrow_column);
+        if (!status.ok()) {
+            dtl_io_arrow_set_error_from_status(error, status);
             return DTL_STATUS_ERROR;
         }
 
-        if (visitor.dtype != dtype) {
-            // TODO set error.
+        if (arrow_column->null_count() != 0) {
+            dtl_set_error(
+                error,
+                dtl_error_create(
+                    "Column '%s' contains null values", dtl_schema_get_column_name(table->schema, col_index)
+                )
+            );
             return DTL_STATUS_ERROR;
         }
 
-        switch (dtype) {
-        case DTL_DTYPE_INT64:
-            dtl_int64_array_set(array, i, dtl_value_get_int64(&visitor.value));
-            dtl_value_clear_int64(&visitor.value);
-            break;
-        default:
-            assert(false);
-        }
+        data = dtl_io_arrow_import_column(*arrow_column, &owned);
+
+        fs_table->arrow_columns[col_index] = arrow_column;
+        fs_table->columns[col_index] = data;
+        fs_table->owned_columns[col_index] = owned;
     }
 
-    dtl_value_take_int64_array(out, array);
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        dtl_value_take_bool_array(out, data);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        dtl_value_take_int64_array(out, (int64_t *)data);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        dtl_value_take_double_array(out, (double *)data);
+        break;
+    default:
+        assert(false);
+    }
 
     return DTL_STATUS_OK;
 }
@@ -145,12 +359,36 @@ dtl_io_filesystem_table_destroy(struct dtl_io_table* table) {
     assert(table != NULL);
     assert(table->destroy == dtl_io_filesystem_table_destroy);
 
+    fs_table = (struct dtl_io_filesystem_table*)table;
+
+    for (size_t i = 0; i < fs_table->columns.size(); i++) {
+        if (fs_table->owned_columns[i]) {
+            free(fs_table->columns[i]);
+        }
+    }
+
     dtl_schema_destroy(table->schema);
 
-    fs_table = (struct dtl_io_filesystem_table*)table;
     delete fs_table;
 }
 
+// Reading at offset zero returns a slice of the mapping itself, which is page aligned.  Nothing
+// is advised here: predicates can rule out row groups anywhere in the file, so the ranges that
+// will be read aren't known until columns are fetched.
+static arrow::Result<std::shared_ptr<arrow::io::RandomAccessFile>>
+dtl_io_filesystem_open_memory_mapped(std::filesystem::path const &path, std::shared_ptr<arrow::Buffer> *mapping) {
+    std::shared_ptr<arrow::io::MemoryMappedFile> file;
+
+    ARROW_ASSIGN_OR_RAISE(file, arrow::io::MemoryMappedFile::Open(path, arrow::io::FileMode::READ));
+    ARROW_ASSIGN_OR_RAISE(int64_t size, file->GetSize());
+    if (size == 0) {
+        return file;
+    }
+
+    ARROW_ASSIGN_OR_RAISE(*mapping, file->ReadAt(0, size));
+    return file;
+}
+
 struct dtl_io_table*
 dtl_io_filesystem_importer_import_table(
     struct dtl_io_importer* importer,
@@ -159,46 +397,84 @@ dtl_io_filesystem_importer_import_table(
 ) {
     struct dtl_io_filesystem_importer* fs_importer;
     arrow::Status status;
-    std::shared_ptr<arrow::io::ReadableFile> input_file;
-    std::shared_ptr<arrow::Table> arrow_table;
+    std::shared_ptr<arrow::io::RandomAccessFile> input_file;
+    std::shared_ptr<arrow::Buffer> mapping;
+    arrow::MemoryPool* pool;
+    std::shared_ptr<arrow::Schema> arrow_schema;
+    parquet::ArrowReaderProperties arrow_properties;
+    parquet::arrow::FileReaderBuilder reader_builder;
+    std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
+    struct dtl_schema *schema;
     struct dtl_io_filesystem_table* fs_table;
 
-    (void) error;
-
     fs_importer = (struct dtl_io_filesystem_importer*)importer;
 
     auto input_path = fs_importer->root / (std::string(name) + ".parquet");
 
-    auto input_file_result = arrow::io::ReadableFile::Open(input_path, arrow::default_memory_pool());
-    assert(input_file_result.ok()); // TODO
-    input_file = input_file_result.ValueUnsafe();
+    pool = arrow::default_memory_pool();
+
+    if (fs_importer->memory_map) {
+        auto input_file_result = dtl_io_filesystem_open_memory_mapped(input_path, &mapping);
+        if (!input_file_result.ok()) {
+            dtl_io_arrow_set_error_from_status(error, input_file_result.status());
+            return NULL;
+        }
+        input_file = input_file_result.ValueUnsafe();
+    } else {
+        auto input_file_result = arrow::io::ReadableFile::Open(input_path, pool);
+        if (!input_file_result.ok()) {
+            dtl_io_arrow_set_error_from_status(error, input_file_result.status());
+            return NULL;
+        }
+        input_file = input_file_result.ValueUnsafe();
+    }
 
-    auto reader_result = parquet::arrow::OpenFile(input_file, arrow::default_memory_pool());
-    assert(reader_result.ok()); // TODO
-    auto arrow_reader = std::move(reader_result).ValueUnsafe();
+    // Column chunks are fetched with coalesced, pre-buffered reads, and row groups are decoded in
+    // parallel on Arrow's CPU thread pool.
+    arrow_properties.set_use_threads(true);
+    arrow_properties.set_pre_buffer(true);
+    arrow_properties.set_cache_options(arrow::io::CacheOptions::Defaults());
 
-    status = arrow_reader->ReadTable(&arrow_table);
-    assert(status.ok()); // TODO
+    status = reader_builder.Open(input_file, parquet::default_reader_properties());
+    if (!status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, status);
+        return NULL;
+    }
 
-    auto schema = dtl_schema_create();
-    auto arrow_schema = arrow_table->schema();
-    for (int i = 0; i < arrow_schema->num_fields(); i++) {
-        auto arrow_field = arrow_schema->field(i);
+    status = reader_builder.memory_pool(pool)->properties(arrow_properties)->Build(&arrow_reader);
+    if (!status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, status);
+        return NULL;
+    }
 
-        char const *column_name = arrow_field->name().c_str();
-        enum dtl_dtype column_dtype = DTL_DTYPE_INT64_ARRAY;  // TODO
+    status = arrow_reader->GetSchema(&arrow_schema);
+    if (!status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, status);
+        return NULL;
+    }
 
-        schema = dtl_schema_add_column(schema, column_name, column_dtype);
+    schema = dtl_io_arrow_import_schema(*arrow_schema, name, error);
+    if (schema == NULL) {
+        return NULL;
     }
 
-    fs_table = new struct dtl_io_filesystem_table;
+    fs_table = new struct dtl_io_filesystem_table();
 
     fs_table->base.get_num_rows = dtl_io_filesystem_table_get_num_rows;
+    fs_table->base.add_predicate = dtl_io_filesystem_table_add_predicate;
     fs_table->base.read_column_data = dtl_io_filesystem_table_read_column_data;
     fs_table->base.destroy = dtl_io_filesystem_table_destroy;
 
     fs_table->base.schema = schema;
-    fs_table->arrow_table = arrow_table;
+    fs_table->num_rows = arrow_reader->parquet_reader()->metadata()->num_rows();
+    fs_table->row_groups.resize(arrow_reader->num_row_groups());
+    std::iota(fs_table->row_groups.begin(), fs_table->row_groups.end(), 0);
+    fs_table->arrow_reader = std::move(arrow_reader);
+    fs_table->arrow_schema = arrow_schema;
+    fs_table->mapping = mapping;
+    fs_table->arrow_columns.resize(arrow_schema->num_fields());
+    fs_table->columns.resize(arrow_schema->num_fields(), NULL);
+    fs_table->owned_columns.resize(arrow_schema->num_fields(), false);
 
     return &fs_table->base;
 }
@@ -214,6 +490,17 @@ dtl_io_filesystem_importer_create(char const* root) {
     return &fs_importer->base;
 }
 
+void
+dtl_io_filesystem_importer_set_memory_map(struct dtl_io_importer* importer, bool memory_map) {
+    struct dtl_io_filesystem_importer* fs_importer;
+
+    assert(importer != NULL);
+    assert(importer->import_table == dtl_io_filesystem_importer_import_table);
+
+    fs_importer = (struct dtl_io_filesystem_importer*)importer;
+    fs_importer->memory_map = memory_map;
+}
+
 void
 dtl_io_filesystem_importer_destroy(struct dtl_io_importer* importer) {
     struct dtl_io_filesystem_importer* fs_importer;
@@ -234,6 +521,16 @@ struct dtl_io_filesystem_exporter {
     struct dtl_io_exporter base;
 
     std::filesystem::path root;
+
+    // Writer settings.  These apply to every table exported.
+    size_t row_group_size;
+    arrow::Compression::type compression;
+    int compression_level;
+    bool dictionary;
+    bool statistics;
+
+    // Names of columns that should have bloom filters written, in any table.
+    std::unordered_set<std::string> bloom_filter_columns;
 };
 
 static enum dtl_status
@@ -247,19 +544,13 @@ dtl_io_filesystem_exporter_export_table(
 ) {
     struct dtl_io_filesystem_exporter* fs_exporter;
     size_t col;
-    size_t row;
     enum dtl_dtype col_dtype;
     char const* col_name;
-    void* col_data = NULL;
-    arrow::MemoryPool* pool;
     arrow::Status arrow_status;
-    std::shared_ptr<arrow::Array> arrow_array;
-    std::shared_ptr<arrow::Schema> arrow_schema;
-    std::shared_ptr<arrow::Table> arrow_table;
     std::filesystem::path output_path;
     std::shared_ptr<arrow::io::FileOutputStream> outfile;
-
-    (void) error;
+    std::unique_ptr<parquet::arrow::FileWriter> writer;
+    std::shared_ptr<arrow::RecordBatch> batch;
 
     assert(exporter != NULL);
     assert(exporter->export_table == dtl_io_filesystem_exporter_export_table);
@@ -269,94 +560,90 @@ dtl_io_filesystem_exporter_export_table(
 
     fs_exporter = (struct dtl_io_filesystem_exporter*)exporter;
 
-    pool = arrow::default_memory_pool();
+    parquet::WriterProperties::Builder properties_builder;
 
-    std::vector<std::shared_ptr<arrow::Field>> schema_columns;
-    std::vector<std::shared_ptr<arrow::Array>> table_columns;
+    properties_builder.max_row_group_length(fs_exporter->row_group_size);
+    properties_builder.compression(fs_exporter->compression);
+    if (fs_exporter->compression_level != arrow::util::kUseDefaultCompressionLevel) {
+        properties_builder.compression_level(fs_exporter->compression_level);
+    }
+    if (fs_exporter->dictionary) {
+        properties_builder.enable_dictionary();
+    } else {
+        properties_builder.disable_dictionary();
+    }
+    if (fs_exporter->statistics) {
+        properties_builder.enable_statistics();
+    } else {
+        properties_builder.disable_statistics();
+    }
 
     for (col = 0; col < dtl_schema_get_num_columns(schema); col++) {
         col_dtype = dtl_schema_get_column_dtype(schema, col);
         col_name = dtl_schema_get_column_name(schema, col);
 
-        switch (col_dtype) {
-        case DTL_DTYPE_BOOL_ARRAY: {
-            arrow::BooleanBuilder builder(pool);
-            arrow_status = builder.Resize(num_rows);
-            if (!arrow_status.ok()) {
-                dtl_io_filesystem_set_error_from_arrow_status(error, arrow_status);
-                return DTL_STATUS_ERROR;
-            }
-
-            void *array = dtl_value_get_bool_array(values[col]);
-
-            for (row = 0; row < num_rows; row++) {
-                arrow_status = builder.Append(dtl_bool_array_get(array, row));
-                if (!arrow_status.ok()) {
-                    dtl_io_filesystem_set_error_from_arrow_status(error, arrow_status);
-                    return DTL_STATUS_ERROR;
-                }
-            }
+        // Parquet only supports bloom filters on non-boolean columns.  Filters are per row group.
+        if (col_dtype != DTL_DTYPE_BOOL_ARRAY && fs_exporter->bloom_filter_columns.contains(col_name)) {
+            parquet::BloomFilterOptions bloom_filter_options;
+            bloom_filter_options.ndv = (int32_t)std::clamp<size_t>(
+                std::min(num_rows, fs_exporter->row_group_size), 1, INT32_MAX
+            );
+            properties_builder.enable_bloom_filter_options(bloom_filter_options, col_name);
+        }
+    }
 
-            arrow_status = builder.Finish(&arrow_array);
-            if (!arrow_status.ok()) {
-               dtl_io_filesystem_set_error_from_arrow_status(error, arrow_status);
-               return DTL_STATUS_ERROR;
-            }
+    batch = dtl_io_arrow_export_batch(schema, num_rows, values);
 
-            break;
-        }
-        case DTL_DTYPE_INT64_ARRAY: {
-            arrow::Int64Builder builder(pool);
+    output_path = fs_exporter->root / (std::string(table_name) + ".parquet");
 
-            arrow_status = builder.Resize(num_rows);
-            if (!arrow_status.ok()) {
-                dtl_io_filesystem_set_error_from_arrow_status(error, arrow_status);
-                return DTL_STATUS_ERROR;
-            }
+    auto outfile_result = arrow::io::FileOutputStream::Open(output_path);
+    if (!outfile_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, outfile_result.status());
+        return DTL_STATUS_ERROR;
+    }
+    outfile = outfile_result.ValueUnsafe();
 
-            int64_t *array = dtl_value_get_int64_array(values[col]);
+    // Columns within each row group are encoded in parallel on Arrow's CPU thread pool.
+    auto arrow_properties = parquet::ArrowWriterProperties::Builder().set_use_threads(true)->build();
 
-            for (row = 0; row < num_rows; row++) {
-                arrow_status = builder.Append(dtl_int64_array_get(array, row));
-                if (!arrow_status.ok()) {
-                    dtl_io_filesystem_set_error_from_arrow_status(error, arrow_status);
-                    return DTL_STATUS_ERROR;
-                }
-            }
+    auto writer_result = parquet::arrow::FileWriter::Open(
+        *batch->schema(), arrow::default_memory_pool(), outfile, properties_builder.build(), arrow_properties
+    );
+    if (!writer_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, writer_result.status());
+        return DTL_STATUS_ERROR;
+    }
+    writer = std::move(writer_result).ValueUnsafe();
 
-            arrow_status = builder.Finish(&arrow_array);
-            if (!arrow_status.ok()) {
-                dtl_io_filesystem_set_error_from_arrow_status(error, arrow_status);
-                return DTL_STATUS_ERROR;
-            }
+    // Row groups are written one at a time from slices of the column arrays, so the writer only
+    // ever buffers a single row group's worth of encoded pages.
+    for (size_t offset = 0; offset < num_rows; offset += fs_exporter->row_group_size) {
+        size_t length = std::min(fs_exporter->row_group_size, num_rows - offset);
 
-            break;
+        arrow_status = writer->NewBufferedRowGroup();
+        if (!arrow_status.ok()) {
+            dtl_io_arrow_set_error_from_status(error, arrow_status);
+            return DTL_STATUS_ERROR;
         }
-        case DTL_DTYPE_DOUBLE_ARRAY:
-        case DTL_DTYPE_STRING_ARRAY:
-        case DTL_DTYPE_INDEX_ARRAY:
-            assert(false); // TODO
 
-        default:
-            assert(false);
+        arrow_status = writer->WriteRecordBatch(*batch->Slice(offset, length));
+        if (!arrow_status.ok()) {
+            dtl_io_arrow_set_error_from_status(error, arrow_status);
+            return DTL_STATUS_ERROR;
         }
-
-        schema_columns.push_back(arrow::field(col_name, arrow_array->type()));
-        table_columns.push_back(arrow_array);
     }
-    free(col_data);
-
-    arrow_schema = std::make_shared<arrow::Schema>(schema_columns);
-    arrow_table = arrow::Table::Make(arrow_schema, table_columns);
-
-    output_path = fs_exporter->root / (std::string(table_name) + ".parquet");
 
-    auto outfile_result = arrow::io::FileOutputStream::Open(output_path);
-    assert(outfile_result.ok());
-    outfile = outfile_result.ValueUnsafe();
+    arrow_status = writer->Close();
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
 
-    arrow_status = parquet::arrow::WriteTable(*arrow_table, arrow::default_memory_pool(), outfile, 65535);
-    assert(arrow_status.ok());
+    arrow_status = outfile->Close();
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
 
     return DTL_STATUS_OK;
 }
@@ -369,10 +656,100 @@ dtl_io_filesystem_exporter_create(char const* root) {
 
     fs_exporter->base.export_table = dtl_io_filesystem_exporter_export_table;
     fs_exporter->root = root;
+    fs_exporter->row_group_size = 65535;
+    fs_exporter->compression = arrow::Compression::UNCOMPRESSED;
+    fs_exporter->compression_level = arrow::util::kUseDefaultCompressionLevel;
+    fs_exporter->dictionary = true;
+    fs_exporter->statistics = true;
 
     return &fs_exporter->base;
 }
 
+void
+dtl_io_filesystem_exporter_set_row_group_size(struct dtl_io_exporter* exporter, size_t row_group_size) {
+    struct dtl_io_filesystem_exporter* fs_exporter;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_filesystem_exporter_export_table);
+    assert(row_group_size > 0);
+
+    fs_exporter = (struct dtl_io_filesystem_exporter*)exporter;
+    fs_exporter->row_group_size = row_group_size;
+}
+
+enum dtl_status
+dtl_io_filesystem_exporter_set_compression(
+    struct dtl_io_exporter* exporter,
+    char const* codec,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_exporter* fs_exporter;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_filesystem_exporter_export_table);
+    assert(codec != NULL);
+
+    fs_exporter = (struct dtl_io_filesystem_exporter*)exporter;
+
+    auto compression_result = arrow::util::Codec::GetCompressionType(codec);
+    if (!compression_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, compression_result.status());
+        return DTL_STATUS_ERROR;
+    }
+    if (!arrow::util::Codec::IsAvailable(*compression_result)) {
+        dtl_set_error(error, dtl_error_create("Compression codec '%s' is not available", codec));
+        return DTL_STATUS_ERROR;
+    }
+
+    fs_exporter->compression = *compression_result;
+    return DTL_STATUS_OK;
+}
+
+void
+dtl_io_filesystem_exporter_set_compression_level(struct dtl_io_exporter* exporter, int level) {
+    struct dtl_io_filesystem_exporter* fs_exporter;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_filesystem_exporter_export_table);
+
+    fs_exporter = (struct dtl_io_filesystem_exporter*)exporter;
+    fs_exporter->compression_level = level;
+}
+
+void
+dtl_io_filesystem_exporter_set_dictionary(struct dtl_io_exporter* exporter, bool dictionary) {
+    struct dtl_io_filesystem_exporter* fs_exporter;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_filesystem_exporter_export_table);
+
+    fs_exporter = (struct dtl_io_filesystem_exporter*)exporter;
+    fs_exporter->dictionary = dictionary;
+}
+
+void
+dtl_io_filesystem_exporter_set_statistics(struct dtl_io_exporter* exporter, bool statistics) {
+    struct dtl_io_filesystem_exporter* fs_exporter;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_filesystem_exporter_export_table);
+
+    fs_exporter = (struct dtl_io_filesystem_exporter*)exporter;
+    fs_exporter->statistics = statistics;
+}
+
+void
+dtl_io_filesystem_exporter_add_bloom_filter(struct dtl_io_exporter* exporter, char const* column_name) {
+    struct dtl_io_filesystem_exporter* fs_exporter;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_filesystem_exporter_export_table);
+    assert(column_name != NULL);
+
+    fs_exporter = (struct dtl_io_filesystem_exporter*)exporter;
+    fs_exporter->bloom_filter_columns.insert(column_name);
+}
+
 void
 dtl_io_filesystem_exporter_destroy(struct dtl_io_exporter* exporter) {
     struct dtl_io_filesystem_exporter* fs_exporter;
@@ -387,34 +764,1014 @@ dtl_io_filesystem_exporter_destroy(struct dtl_io_exporter* exporter) {
     delete fs_exporter;
 }
 
-/* === Tracer =================================================================================== */
+/* === Tracer ================================================================================= */
+
+// Traced arrays are written to `arrays/<id>.arrow` as single column Arrow IPC files.  IPC files
+// hold the array's buffers exactly as DTL lays them out, so values are wrapped and written without
+// being copied or encoded.  Everything else goes into a manifest that is kept in memory until the
+// tracer is destroyed, and is then written as a handful of small Parquet tables under `manifest/`,
+// and again as `manifest.bin`, in the binary layout that `dtl_manifest_map` reads in place.
 
 struct dtl_io_filesystem_tracer {
     struct dtl_io_tracer base;
 
     std::filesystem::path root;
+
+    struct dtl_manifest *manifest;
+
+    // Deferred writes that have been submitted to Arrow's IO thread pool since the last flush.
+    std::mutex writes_mutex;
+    std::vector<arrow::Future<>> writes;
 };
 
+static arrow::Status
+dtl_io_filesystem_tracer_write_array(
+    std::filesystem::path const &path,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value
+) {
+    struct dtl_schema *schema;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+
+    schema = dtl_schema_add_column(dtl_schema_create(), "value", dtype);
+    batch = dtl_io_arrow_export_batch(schema, size, &value);
+    dtl_schema_destroy(schema);
+
+    ARROW_ASSIGN_OR_RAISE(outfile, arrow::io::FileOutputStream::Open(path));
+    ARROW_ASSIGN_OR_RAISE(writer, arrow::ipc::MakeFileWriter(outfile, batch->schema()));
+    ARROW_RETURN_NOT_OK(writer->WriteRecordBatch(*batch));
+    ARROW_RETURN_NOT_OK(writer->Close());
+    return outfile->Close();
+}
+
+static bool
+dtl_io_filesystem_tracer_can_write(enum dtl_dtype dtype) {
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+    case DTL_DTYPE_INT64_ARRAY:
+    case DTL_DTYPE_DOUBLE_ARRAY:
+    case DTL_DTYPE_INDEX_ARRAY:
+        return true;
+    default:
+        // Strings can't yet be exported without copying, and scalars are not traced.
+        return false;
+    }
+}
+
+static std::filesystem::path
+dtl_io_filesystem_tracer_array_path(struct dtl_io_filesystem_tracer *fs_tracer, uint64_t id) {
+    return fs_tracer->root / "arrays" / (std::to_string(id) + ".arrow");
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_source(
+    struct dtl_io_tracer *tracer,
+    char const *source,
+    char const *filename,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    (void)error;
+
+    dtl_manifest_add_source(fs_tracer->manifest, source, filename);
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_input(
+    struct dtl_io_tracer *tracer,
+    char const *input_name,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    size_t i;
+    (void)error;
+
+    for (i = 0; i < dtl_schema_get_num_columns(schema); i++) {
+        dtl_manifest_add_input(fs_tracer->manifest, input_name, dtl_schema_get_column_name(schema, i), array_ids[i]);
+    }
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_output(
+    struct dtl_io_tracer *tracer,
+    char const *output_name,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    size_t i;
+    (void)error;
+
+    for (i = 0; i < dtl_schema_get_num_columns(schema); i++) {
+        dtl_manifest_add_output(fs_tracer->manifest, output_name, dtl_schema_get_column_name(schema, i), array_ids[i]);
+    }
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_trace(
+    struct dtl_io_tracer *tracer,
+    struct dtl_location start,
+    struct dtl_location end,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    size_t i;
+    (void)error;
+
+    for (i = 0; i < dtl_schema_get_num_columns(schema); i++) {
+        dtl_manifest_add_trace(
+            fs_tracer->manifest,
+            start.filename,
+            start.offset,
+            end.offset,
+            dtl_schema_get_column_name(schema, i),
+            array_ids[i]
+        );
+    }
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_mapping(
+    struct dtl_io_tracer *tracer,
+    uint64_t src_array_id,
+    uint64_t tgt_array_id,
+    uint64_t src_index_array_id,
+    uint64_t tgt_index_array_id,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    (void)error;
+
+    dtl_manifest_add_mapping(
+        fs_tracer->manifest,
+        src_array_id,
+        tgt_array_id,
+        src_index_array_id == DTL_IO_TRACER_IDENTITY_MAPPING ? -1 : (ssize_t)src_index_array_id,
+        tgt_index_array_id == DTL_IO_TRACER_IDENTITY_MAPPING ? -1 : (ssize_t)tgt_index_array_id
+    );
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_value(
+    struct dtl_io_tracer *tracer,
+    uint64_t id,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    arrow::Status arrow_status;
+
+    if (!dtl_io_filesystem_tracer_can_write(dtype)) {
+        return DTL_STATUS_OK;
+    }
+
+    arrow_status = dtl_io_filesystem_tracer_write_array(
+        dtl_io_filesystem_tracer_array_path(fs_tracer, id), dtype, size, value
+    );
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_value_deferred(
+    struct dtl_io_tracer *tracer,
+    uint64_t id,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value,
+    void (*release)(void *),
+    void *user_data,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    std::filesystem::path path;
+    enum dtl_status status;
+
+    if (!dtl_io_filesystem_tracer_can_write(dtype)) {
+        release(user_data);
+        return DTL_STATUS_OK;
+    }
+
+    path = dtl_io_filesystem_tracer_array_path(fs_tracer, id);
+
+    // Writes are independent of one another, so any number can be in flight at once.  Each holds
+    // on to its value until the file has been closed.
+    auto write_result = arrow::io::default_io_context().executor()->Submit(
+        [path, dtype, size, value, release, user_data]() {
+            arrow::Status arrow_status = dtl_io_filesystem_tracer_write_array(path, dtype, size, value);
+            release(user_data);
+            return arrow_status;
+        }
+    );
+    if (write_result.ok()) {
+        std::lock_guard<std::mutex> lock(fs_tracer->writes_mutex);
+        fs_tracer->writes.push_back(std::move(write_result).ValueUnsafe());
+        return DTL_STATUS_OK;
+    }
+
+    status = dtl_io_filesystem_tracer_record_value(tracer, id, dtype, size, value, error);
+    release(user_data);
+    return status;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_sample(
+    struct dtl_io_tracer *tracer,
+    uint64_t id,
+    uint64_t row_index_array,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    (void)error;
+
+    dtl_manifest_add_sample(fs_tracer->manifest, id, row_index_array);
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_record_grouping(
+    struct dtl_io_tracer *tracer,
+    uint64_t index_array,
+    uint64_t offsets_array,
+    uint64_t entries_array,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    (void)error;
+
+    dtl_manifest_add_grouping(fs_tracer->manifest, index_array, offsets_array, entries_array);
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_tracer_flush(struct dtl_io_tracer *tracer, struct dtl_error **error) {
+    struct dtl_io_filesystem_tracer *fs_tracer = (struct dtl_io_filesystem_tracer *)tracer;
+    std::vector<arrow::Future<>> writes;
+    arrow::Status arrow_status;
+
+    {
+        std::lock_guard<std::mutex> lock(fs_tracer->writes_mutex);
+        writes.swap(fs_tracer->writes);
+    }
+
+    // Every write is waited for, even after one has failed, as they all hold evaluator values.
+    for (auto &write : writes) {
+        if (!write.status().ok() && arrow_status.ok()) {
+            arrow_status = write.status();
+        }
+    }
+
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
+    return DTL_STATUS_OK;
+}
+
+static arrow::Status
+dtl_io_filesystem_tracer_write_table(
+    std::filesystem::path const &path,
+    std::vector<std::shared_ptr<arrow::Field>> fields,
+    std::vector<std::shared_ptr<arrow::Array>> columns
+) {
+    std::shared_ptr<arrow::Table> table;
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+
+    table = arrow::Table::Make(arrow::schema(std::move(fields)), std::move(columns));
+
+    ARROW_ASSIGN_OR_RAISE(outfile, arrow::io::FileOutputStream::Open(path));
+    ARROW_RETURN_NOT_OK(parquet::arrow::WriteTable(
+        *table, arrow::default_memory_pool(), outfile, parquet::DEFAULT_MAX_ROW_GROUP_LENGTH
+    ));
+    return outfile->Close();
+}
+
+static arrow::Status
+dtl_io_filesystem_tracer_write_columns(
+    std::filesystem::path const &path,
+    struct dtl_manifest_column *manifest_columns,
+    size_t num_manifest_columns
+) {
+    arrow::StringBuilder table_builder;
+    arrow::StringBuilder column_builder;
+    arrow::UInt64Builder array_builder;
+    std::shared_ptr<arrow::Array> table_array;
+    std::shared_ptr<arrow::Array> column_array;
+    std::shared_ptr<arrow::Array> array_array;
+
+    for (size_t i = 0; i < num_manifest_columns; i++) {
+        ARROW_RETURN_NOT_OK(table_builder.Append(manifest_columns[i].table));
+        ARROW_RETURN_NOT_OK(column_builder.Append(manifest_columns[i].column));
+        ARROW_RETURN_NOT_OK(array_builder.Append(manifest_columns[i].array));
+    }
+    ARROW_RETURN_NOT_OK(table_builder.Finish(&table_array));
+    ARROW_RETURN_NOT_OK(column_builder.Finish(&column_array));
+    ARROW_RETURN_NOT_OK(array_builder.Finish(&array_array));
+
+    return dtl_io_filesystem_tracer_write_table(
+        path,
+        {
+            arrow::field("table", arrow::utf8(), false),
+            arrow::field("column", arrow::utf8(), false),
+            arrow::field("array", arrow::uint64(), false),
+        },
+        {table_array, column_array, array_array}
+    );
+}
+
+static arrow::Status
+dtl_io_filesystem_tracer_write_manifest(struct dtl_io_filesystem_tracer *fs_tracer) {
+    struct dtl_manifest *manifest = fs_tracer->manifest;
+    std::filesystem::path manifest_path = fs_tracer->root / "manifest";
+
+    std::filesystem::create_directories(manifest_path);
+
+    {
+        arrow::StringBuilder text_builder;
+        arrow::StringBuilder filename_builder;
+        std::shared_ptr<arrow::Array> text_array;
+        std::shared_ptr<arrow::Array> filename_array;
+
+        for (size_t i = 0; i < manifest->num_sources; i++) {
+            ARROW_RETURN_NOT_OK(text_builder.Append(manifest->sources[i].text));
+            ARROW_RETURN_NOT_OK(filename_builder.Append(manifest->sources[i].filename));
+        }
+        ARROW_RETURN_NOT_OK(text_builder.Finish(&text_array));
+        ARROW_RETURN_NOT_OK(filename_builder.Finish(&filename_array));
+
+        ARROW_RETURN_NOT_OK(dtl_io_filesystem_tracer_write_table(
+            manifest_path / "sources.parquet",
+            {
+                arrow::field("text", arrow::utf8(), false),
+                arrow::field("filename", arrow::utf8(), false),
+            },
+            {text_array, filename_array}
+        ));
+    }
+
+    ARROW_RETURN_NOT_OK(dtl_io_filesystem_tracer_write_columns(
+        manifest_path / "inputs.parquet", manifest->inputs, manifest->num_inputs
+    ));
+    ARROW_RETURN_NOT_OK(dtl_io_filesystem_tracer_write_columns(
+        manifest_path / "outputs.parquet", manifest->outputs, manifest->num_outputs
+    ));
+
+    {
+        arrow::StringBuilder filename_builder;
+        arrow::UInt64Builder start_builder;
+        arrow::UInt64Builder end_builder;
+        arrow::StringBuilder column_builder;
+        arrow::UInt64Builder array_builder;
+        std::shared_ptr<arrow::Array> filename_array;
+        std::shared_ptr<arrow::Array> start_array;
+        std::shared_ptr<arrow::Array> end_array;
+        std::shared_ptr<arrow::Array> column_array;
+        std::shared_ptr<arrow::Array> array_array;
+
+        for (size_t i = 0; i < manifest->num_traces; i++) {
+            ARROW_RETURN_NOT_OK(filename_builder.Append(manifest->traces[i].filename));
+            ARROW_RETURN_NOT_OK(start_builder.Append(manifest->traces[i].start_offset));
+            ARROW_RETURN_NOT_OK(end_builder.Append(manifest->traces[i].end_offset));
+            ARROW_RETURN_NOT_OK(column_builder.Append(manifest->traces[i].column));
+            ARROW_RETURN_NOT_OK(array_builder.Append(manifest->traces[i].array));
+        }
+        ARROW_RETURN_NOT_OK(filename_builder.Finish(&filename_array));
+        ARROW_RETURN_NOT_OK(start_builder.Finish(&start_array));
+        ARROW_RETURN_NOT_OK(end_builder.Finish(&end_array));
+        ARROW_RETURN_NOT_OK(column_builder.Finish(&column_array));
+        ARROW_RETURN_NOT_OK(array_builder.Finish(&array_array));
+
+        ARROW_RETURN_NOT_OK(dtl_io_filesystem_tracer_write_table(
+            manifest_path / "traces.parquet",
+            {
+                arrow::field("filename", arrow::utf8(), false),
+                arrow::field("start_offset", arrow::uint64(), false),
+                arrow::field("end_offset", arrow::uint64(), false),
+                arrow::field("column", arrow::utf8(), false),
+                arrow::field("array", arrow::uint64(), false),
+            },
+            {filename_array, start_array, end_array, column_array, array_array}
+        ));
+    }
+
+    {
+        arrow::UInt64Builder src_builder;
+        arrow::UInt64Builder tgt_builder;
+        arrow::UInt64Builder src_index_builder;
+        arrow::UInt64Builder tgt_index_builder;
+        std::shared_ptr<arrow::Array> src_array;
+        std::shared_ptr<arrow::Array> tgt_array;
+        std::shared_ptr<arrow::Array> src_index_array;
+        std::shared_ptr<arrow::Array> tgt_index_array;
+
+        // Identity mappings are written as nulls.
+        for (size_t i = 0; i < manifest->num_mappings; i++) {
+            struct dtl_manifest_mapping *mapping = &manifest->mappings[i];
+
+            ARROW_RETURN_NOT_OK(src_builder.Append(mapping->src_array));
+            ARROW_RETURN_NOT_OK(tgt_builder.Append(mapping->tgt_array));
+            if (mapping->src_index_array < 0) {
+                ARROW_RETURN_NOT_OK(src_index_builder.AppendNull());
+            } else {
+                ARROW_RETURN_NOT_OK(src_index_builder.Append((uint64_t)mapping->src_index_array));
+            }
+            if (mapping->tgt_index_array < 0) {
+                ARROW_RETURN_NOT_OK(tgt_index_builder.AppendNull());
+            } else {
+                ARROW_RETURN_NOT_OK(tgt_index_builder.Append((uint64_t)mapping->tgt_index_array));
+            }
+        }
+        ARROW_RETURN_NOT_OK(src_builder.Finish(&src_array));
+        ARROW_RETURN_NOT_OK(tgt_builder.Finish(&tgt_array));
+        ARROW_RETURN_NOT_OK(src_index_builder.Finish(&src_index_array));
+        ARROW_RETURN_NOT_OK(tgt_index_builder.Finish(&tgt_index_array));
+
+        ARROW_RETURN_NOT_OK(dtl_io_filesystem_tracer_write_table(
+            manifest_path / "mappings.parquet",
+            {
+                arrow::field("src_array", arrow::uint64(), false),
+                arrow::field("tgt_array", arrow::uint64(), false),
+                arrow::field("src_index_array", arrow::uint64()),
+                arrow::field("tgt_index_array", arrow::uint64()),
+            },
+            {src_array, tgt_array, src_index_array, tgt_index_array}
+        ));
+    }
+
+    {
+        arrow::UInt64Builder array_builder;
+        arrow::UInt64Builder rows_builder;
+        std::shared_ptr<arrow::Array> array_array;
+        std::shared_ptr<arrow::Array> rows_array;
+
+        for (size_t i = 0; i < manifest->num_samples; i++) {
+            ARROW_RETURN_NOT_OK(array_builder.Append(manifest->samples[i].array));
+            ARROW_RETURN_NOT_OK(rows_builder.Append(manifest->samples[i].rows_array));
+        }
+        ARROW_RETURN_NOT_OK(array_builder.Finish(&array_array));
+        ARROW_RETURN_NOT_OK(rows_builder.Finish(&rows_array));
+
+        ARROW_RETURN_NOT_OK(dtl_io_filesystem_tracer_write_table(
+            manifest_path / "samples.parquet",
+            {
+                arrow::field("array", arrow::uint64(), false),
+                arrow::field("rows_array", arrow::uint64(), false),
+            },
+            {array_array, rows_array}
+        ));
+    }
+
+    {
+        arrow::UInt64Builder array_builder;
+        arrow::UInt64Builder offsets_builder;
+        arrow::UInt64Builder entries_builder;
+        std::shared_ptr<arrow::Array> array_array;
+        std::shared_ptr<arrow::Array> offsets_array;
+        std::shared_ptr<arrow::Array> entries_array;
+
+        for (size_t i = 0; i < manifest->num_groupings; i++) {
+            ARROW_RETURN_NOT_OK(array_builder.Append(manifest->groupings[i].array));
+            ARROW_RETURN_NOT_OK(offsets_builder.Append(manifest->groupings[i].offsets_array));
+            ARROW_RETURN_NOT_OK(entries_builder.Append(manifest->groupings[i].entries_array));
+        }
+        ARROW_RETURN_NOT_OK(array_builder.Finish(&array_array));
+        ARROW_RETURN_NOT_OK(offsets_builder.Finish(&offsets_array));
+        ARROW_RETURN_NOT_OK(entries_builder.Finish(&entries_array));
+
+        ARROW_RETURN_NOT_OK(dtl_io_filesystem_tracer_write_table(
+            manifest_path / "groupings.parquet",
+            {
+                arrow::field("array", arrow::uint64(), false),
+                arrow::field("offsets_array", arrow::uint64(), false),
+                arrow::field("entries_array", arrow::uint64(), false),
+            },
+            {array_array, offsets_array, entries_array}
+        ));
+    }
+
+    return arrow::Status::OK();
+}
+
 struct dtl_io_tracer*
 dtl_io_filesystem_tracer_create(char const* root) {
     struct dtl_io_filesystem_tracer* fs_tracer;
-    (void)root; // TODO
+    std::error_code error_code;
 
     fs_tracer = new struct dtl_io_filesystem_tracer();
-    return &fs_tracer->base; // TODO
+    fs_tracer->base.record_source = dtl_io_filesystem_tracer_record_source;
+    fs_tracer->base.record_input = dtl_io_filesystem_tracer_record_input;
+    fs_tracer->base.record_output = dtl_io_filesystem_tracer_record_output;
+    fs_tracer->base.record_trace = dtl_io_filesystem_tracer_record_trace;
+    fs_tracer->base.record_mapping = dtl_io_filesystem_tracer_record_mapping;
+    fs_tracer->base.record_value = dtl_io_filesystem_tracer_record_value;
+    fs_tracer->base.record_value_deferred = dtl_io_filesystem_tracer_record_value_deferred;
+    fs_tracer->base.record_sample = dtl_io_filesystem_tracer_record_sample;
+    fs_tracer->base.record_grouping = dtl_io_filesystem_tracer_record_grouping;
+    fs_tracer->base.flush = dtl_io_filesystem_tracer_flush;
+
+    fs_tracer->root = root;
+    fs_tracer->manifest = dtl_manifest_create();
+
+    // Failures show up as errors from the first write.
+    std::filesystem::create_directories(fs_tracer->root / "arrays", error_code);
+
+    return &fs_tracer->base;
 }
 
-void
-dtl_io_filesystem_tracer_destroy(struct dtl_io_tracer* tracer) {
+enum dtl_status
+dtl_io_filesystem_tracer_destroy(struct dtl_io_tracer* tracer, struct dtl_error **error) {
     struct dtl_io_filesystem_tracer* fs_tracer;
+    enum dtl_status status;
+    arrow::Status arrow_status;
 
     if (tracer == NULL) {
-        return;
+        return DTL_STATUS_OK;
     }
 
-    //    assert(tracer->write_manifest == dtl_io_filesystem_tracer_write_manifest); TODO
-    //    assert(tracer->write_array == dtl_io_filesystem_tracer_write_array); TODO
+    assert(tracer->flush == dtl_io_filesystem_tracer_flush);
 
     fs_tracer = (struct dtl_io_filesystem_tracer*)tracer;
+
+    status = dtl_io_filesystem_tracer_flush(tracer, error);
+    if (status == DTL_STATUS_OK) {
+        try {
+            arrow_status = dtl_io_filesystem_tracer_write_manifest(fs_tracer);
+        } catch (std::filesystem::filesystem_error const &e) {
+            arrow_status = arrow::Status::IOError(e.what());
+        }
+        if (!arrow_status.ok()) {
+            dtl_io_arrow_set_error_from_status(error, arrow_status);
+            status = DTL_STATUS_ERROR;
+        }
+    }
+    if (status == DTL_STATUS_OK) {
+        status = dtl_manifest_write(fs_tracer->manifest, (fs_tracer->root / "manifest.bin").c_str(), error);
+    }
+
+    dtl_manifest_destroy(fs_tracer->manifest);
     delete fs_tracer;
+
+    return status;
+}
+
+/* === Trace reader ============================================================================= */
+
+struct dtl_io_filesystem_trace_reader {
+    struct dtl_io_trace_reader base;
+
+    std::filesystem::path root;
+};
+
+static arrow::Result<std::shared_ptr<arrow::Table>>
+dtl_io_filesystem_trace_reader_read_table(std::filesystem::path const &path) {
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    parquet::arrow::FileReaderBuilder reader_builder;
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    std::shared_ptr<arrow::Table> table;
+
+    ARROW_ASSIGN_OR_RAISE(infile, arrow::io::ReadableFile::Open(path));
+    ARROW_RETURN_NOT_OK(reader_builder.Open(infile, parquet::default_reader_properties()));
+    ARROW_RETURN_NOT_OK(reader_builder.Build(&reader));
+    ARROW_RETURN_NOT_OK(reader->ReadTable(&table));
+    return table;
+}
+
+static arrow::Result<std::shared_ptr<arrow::StringArray>>
+dtl_io_filesystem_trace_reader_get_string_column(arrow::RecordBatch const &batch, char const *name) {
+    std::shared_ptr<arrow::Array> column = batch.GetColumnByName(name);
+
+    if (column == nullptr || column->type_id() != arrow::Type::STRING) {
+        return arrow::Status::Invalid("Manifest column '", name, "' is missing or is not a string");
+    }
+    return std::static_pointer_cast<arrow::StringArray>(column);
+}
+
+static arrow::Result<std::shared_ptr<arrow::UInt64Array>>
+dtl_io_filesystem_trace_reader_get_uint64_column(arrow::RecordBatch const &batch, char const *name) {
+    std::shared_ptr<arrow::Array> column = batch.GetColumnByName(name);
+
+    if (column == nullptr || column->type_id() != arrow::Type::UINT64) {
+        return arrow::Status::Invalid("Manifest column '", name, "' is missing or is not an unsigned integer");
+    }
+    return std::static_pointer_cast<arrow::UInt64Array>(column);
+}
+
+// Index arrays of mappings are stored as nulls if they are the identity.
+static ssize_t
+dtl_io_filesystem_trace_reader_get_index_array(arrow::UInt64Array const &column, int64_t row) {
+    return column.IsNull(row) ? -1 : (ssize_t)column.Value(row);
+}
+
+static arrow::Status
+dtl_io_filesystem_trace_reader_read_columns(
+    std::filesystem::path const &path,
+    struct dtl_manifest *manifest,
+    void (*add_column)(struct dtl_manifest *, char const *, char const *, size_t)
+) {
+    std::shared_ptr<arrow::Table> table;
+    std::shared_ptr<arrow::RecordBatch> batch;
+
+    ARROW_ASSIGN_OR_RAISE(table, dtl_io_filesystem_trace_reader_read_table(path));
+
+    arrow::TableBatchReader batches(*table);
+    while (true) {
+        ARROW_RETURN_NOT_OK(batches.ReadNext(&batch));
+        if (batch == nullptr) {
+            break;
+        }
+
+        ARROW_ASSIGN_OR_RAISE(auto table_column, dtl_io_filesystem_trace_reader_get_string_column(*batch, "table"));
+        ARROW_ASSIGN_OR_RAISE(auto column_column, dtl_io_filesystem_trace_reader_get_string_column(*batch, "column"));
+        ARROW_ASSIGN_OR_RAISE(auto array_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "array"));
+
+        for (int64_t i = 0; i < batch->num_rows(); i++) {
+            add_column(
+                manifest,
+                table_column->GetString(i).c_str(),
+                column_column->GetString(i).c_str(),
+                array_column->Value(i)
+            );
+        }
+    }
+
+    return arrow::Status::OK();
+}
+
+static arrow::Status
+dtl_io_filesystem_trace_reader_load_manifest(
+    struct dtl_io_filesystem_trace_reader *fs_reader,
+    struct dtl_manifest *manifest
+) {
+    std::filesystem::path manifest_path = fs_reader->root / "manifest";
+    std::shared_ptr<arrow::Table> table;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    std::error_code error_code;
+
+    ARROW_ASSIGN_OR_RAISE(table, dtl_io_filesystem_trace_reader_read_table(manifest_path / "sources.parquet"));
+    {
+        arrow::TableBatchReader batches(*table);
+        while (true) {
+            ARROW_RETURN_NOT_OK(batches.ReadNext(&batch));
+            if (batch == nullptr) {
+                break;
+            }
+
+            ARROW_ASSIGN_OR_RAISE(auto text_column, dtl_io_filesystem_trace_reader_get_string_column(*batch, "text"));
+            ARROW_ASSIGN_OR_RAISE(auto filename_column, dtl_io_filesystem_trace_reader_get_string_column(*batch, "filename"));
+
+            for (int64_t i = 0; i < batch->num_rows(); i++) {
+                dtl_manifest_add_source(
+                    manifest, text_column->GetString(i).c_str(), filename_column->GetString(i).c_str()
+                );
+            }
+        }
+    }
+
+    ARROW_RETURN_NOT_OK(dtl_io_filesystem_trace_reader_read_columns(
+        manifest_path / "inputs.parquet", manifest, dtl_manifest_add_input
+    ));
+    ARROW_RETURN_NOT_OK(dtl_io_filesystem_trace_reader_read_columns(
+        manifest_path / "outputs.parquet", manifest, dtl_manifest_add_output
+    ));
+
+    ARROW_ASSIGN_OR_RAISE(table, dtl_io_filesystem_trace_reader_read_table(manifest_path / "traces.parquet"));
+    {
+        arrow::TableBatchReader batches(*table);
+        while (true) {
+            ARROW_RETURN_NOT_OK(batches.ReadNext(&batch));
+            if (batch == nullptr) {
+                break;
+            }
+
+            ARROW_ASSIGN_OR_RAISE(auto filename_column, dtl_io_filesystem_trace_reader_get_string_column(*batch, "filename"));
+            ARROW_ASSIGN_OR_RAISE(auto start_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "start_offset"));
+            ARROW_ASSIGN_OR_RAISE(auto end_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "end_offset"));
+            ARROW_ASSIGN_OR_RAISE(auto column_column, dtl_io_filesystem_trace_reader_get_string_column(*batch, "column"));
+            ARROW_ASSIGN_OR_RAISE(auto array_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "array"));
+
+            for (int64_t i = 0; i < batch->num_rows(); i++) {
+                dtl_manifest_add_trace(
+                    manifest,
+                    filename_column->GetString(i).c_str(),
+                    start_column->Value(i),
+                    end_column->Value(i),
+                    column_column->GetString(i).c_str(),
+                    array_column->Value(i)
+                );
+            }
+        }
+    }
+
+    ARROW_ASSIGN_OR_RAISE(table, dtl_io_filesystem_trace_reader_read_table(manifest_path / "mappings.parquet"));
+    {
+        arrow::TableBatchReader batches(*table);
+        while (true) {
+            ARROW_RETURN_NOT_OK(batches.ReadNext(&batch));
+            if (batch == nullptr) {
+                break;
+            }
+
+            ARROW_ASSIGN_OR_RAISE(auto src_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "src_array"));
+            ARROW_ASSIGN_OR_RAISE(auto tgt_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "tgt_array"));
+            ARROW_ASSIGN_OR_RAISE(auto src_index_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "src_index_array"));
+            ARROW_ASSIGN_OR_RAISE(auto tgt_index_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "tgt_index_array"));
+
+            for (int64_t i = 0; i < batch->num_rows(); i++) {
+                dtl_manifest_add_mapping(
+                    manifest,
+                    src_column->Value(i),
+                    tgt_column->Value(i),
+                    dtl_io_filesystem_trace_reader_get_index_array(*src_index_column, i),
+                    dtl_io_filesystem_trace_reader_get_index_array(*tgt_index_column, i)
+                );
+            }
+        }
+    }
+
+    ARROW_ASSIGN_OR_RAISE(table, dtl_io_filesystem_trace_reader_read_table(manifest_path / "samples.parquet"));
+    {
+        arrow::TableBatchReader batches(*table);
+        while (true) {
+            ARROW_RETURN_NOT_OK(batches.ReadNext(&batch));
+            if (batch == nullptr) {
+                break;
+            }
+
+            ARROW_ASSIGN_OR_RAISE(auto array_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "array"));
+            ARROW_ASSIGN_OR_RAISE(auto rows_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "rows_array"));
+
+            for (int64_t i = 0; i < batch->num_rows(); i++) {
+                dtl_manifest_add_sample(manifest, array_column->Value(i), rows_column->Value(i));
+            }
+        }
+    }
+
+    // Traces written before groupings were recorded can still be read, but not queried for lineage.
+    if (!std::filesystem::exists(manifest_path / "groupings.parquet", error_code)) {
+        return arrow::Status::OK();
+    }
+    ARROW_ASSIGN_OR_RAISE(table, dtl_io_filesystem_trace_reader_read_table(manifest_path / "groupings.parquet"));
+    {
+        arrow::TableBatchReader batches(*table);
+        while (true) {
+            ARROW_RETURN_NOT_OK(batches.ReadNext(&batch));
+            if (batch == nullptr) {
+                break;
+            }
+
+            ARROW_ASSIGN_OR_RAISE(auto array_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "array"));
+            ARROW_ASSIGN_OR_RAISE(auto offsets_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "offsets_array"));
+            ARROW_ASSIGN_OR_RAISE(auto entries_column, dtl_io_filesystem_trace_reader_get_uint64_column(*batch, "entries_array"));
+
+            for (int64_t i = 0; i < batch->num_rows(); i++) {
+                dtl_manifest_add_grouping(
+                    manifest, array_column->Value(i), offsets_column->Value(i), entries_column->Value(i)
+                );
+            }
+        }
+    }
+
+    return arrow::Status::OK();
+}
+
+static struct dtl_manifest *
+dtl_io_filesystem_trace_reader_read_manifest(struct dtl_io_trace_reader *reader, struct dtl_error **error) {
+    struct dtl_io_filesystem_trace_reader *fs_reader = (struct dtl_io_filesystem_trace_reader *)reader;
+    struct dtl_manifest *manifest;
+    std::filesystem::path binary_path = fs_reader->root / "manifest.bin";
+    std::error_code error_code;
+    arrow::Status arrow_status;
+
+    // Traces written before the binary manifest was added only have the Parquet tables.
+    if (std::filesystem::exists(binary_path, error_code)) {
+        return dtl_manifest_map(binary_path.c_str(), error);
+    }
+
+    manifest = dtl_manifest_create();
+
+    arrow_status = dtl_io_filesystem_trace_reader_load_manifest(fs_reader, manifest);
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        dtl_manifest_destroy(manifest);
+        return NULL;
+    }
+
+    return manifest;
+}
+
+// Copies a traced array out of its IPC file.  Arrays are written by `dtl_io_arrow_export_batch`, so
+// the types that can appear are exactly the ones that it produces.
+static arrow::Status
+dtl_io_filesystem_trace_reader_load_array(
+    std::filesystem::path const &path,
+    enum dtl_dtype *dtype,
+    size_t *size,
+    struct dtl_value *out
+) {
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    std::shared_ptr<arrow::ipc::RecordBatchFileReader> reader;
+    std::vector<std::shared_ptr<arrow::Array>> chunks;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    void *bool_array;
+    int64_t *int64_array;
+    double *double_array;
+    size_t *index_array;
+    size_t offset;
+
+    static_assert(sizeof(size_t) == sizeof(uint64_t));
+
+    ARROW_ASSIGN_OR_RAISE(infile, arrow::io::ReadableFile::Open(path));
+    ARROW_ASSIGN_OR_RAISE(reader, arrow::ipc::RecordBatchFileReader::Open(infile));
+
+    if (reader->schema()->num_fields() != 1) {
+        return arrow::Status::Invalid("Traced array ", path.string(), " does not have exactly one column");
+    }
+    switch (reader->schema()->field(0)->type()->id()) {
+    case arrow::Type::BOOL:
+        *dtype = DTL_DTYPE_BOOL_ARRAY;
+        break;
+    case arrow::Type::INT64:
+        *dtype = DTL_DTYPE_INT64_ARRAY;
+        break;
+    case arrow::Type::DOUBLE:
+        *dtype = DTL_DTYPE_DOUBLE_ARRAY;
+        break;
+    case arrow::Type::UINT64:
+        *dtype = DTL_DTYPE_INDEX_ARRAY;
+        break;
+    default:
+        return arrow::Status::Invalid("Traced array ", path.string(), " has unsupported type");
+    }
+
+    *size = 0;
+    for (int i = 0; i < reader->num_record_batches(); i++) {
+        ARROW_ASSIGN_OR_RAISE(batch, reader->ReadRecordBatch(i));
+        if (batch->column(0)->null_count() != 0) {
+            return arrow::Status::Invalid("Traced array ", path.string(), " contains null values");
+        }
+        chunks.push_back(batch->column(0));
+        *size += batch->num_rows();
+    }
+
+    // Padded so that empty arrays still get an allocation.
+    offset = 0;
+    switch (*dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        bool_array = dtl_bool_array_create(*size + 1);
+        for (auto const &chunk : chunks) {
+            auto const &values = static_cast<arrow::BooleanArray const &>(*chunk);
+            for (int64_t i = 0; i < values.length(); i++) {
+                dtl_bool_array_set(bool_array, offset++, values.Value(i));
+            }
+        }
+        dtl_value_take_bool_array(out, bool_array);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        int64_array = dtl_int64_array_create(*size + 1);
+        for (auto const &chunk : chunks) {
+            auto const &values = static_cast<arrow::Int64Array const &>(*chunk);
+            std::memcpy(int64_array + offset, values.raw_values(), values.length() * sizeof(int64_t));
+            offset += values.length();
+        }
+        dtl_value_take_int64_array(out, int64_array);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        double_array = dtl_double_array_create(*size + 1);
+        for (auto const &chunk : chunks) {
+            auto const &values = static_cast<arrow::DoubleArray const &>(*chunk);
+            std::memcpy(double_array + offset, values.raw_values(), values.length() * sizeof(double));
+            offset += values.length();
+        }
+        dtl_value_take_double_array(out, double_array);
+        break;
+    default:
+        index_array = dtl_index_array_create(*size + 1);
+        for (auto const &chunk : chunks) {
+            auto const &values = static_cast<arrow::UInt64Array const &>(*chunk);
+            std::memcpy(index_array + offset, values.raw_values(), values.length() * sizeof(size_t));
+            offset += values.length();
+        }
+        dtl_value_take_index_array(out, index_array);
+        break;
+    }
+
+    return infile->Close();
+}
+
+static std::filesystem::path
+dtl_io_filesystem_trace_reader_array_path(struct dtl_io_filesystem_trace_reader *fs_reader, uint64_t id) {
+    return fs_reader->root / "arrays" / (std::to_string(id) + ".arrow");
+}
+
+static enum dtl_status
+dtl_io_filesystem_trace_reader_read_index_array(
+    struct dtl_io_trace_reader *reader,
+    uint64_t id,
+    size_t **out,
+    size_t *size,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_trace_reader *fs_reader = (struct dtl_io_filesystem_trace_reader *)reader;
+    struct dtl_value value;
+    enum dtl_dtype dtype;
+    arrow::Status arrow_status;
+
+    arrow_status = dtl_io_filesystem_trace_reader_load_array(
+        dtl_io_filesystem_trace_reader_array_path(fs_reader, id), &dtype, size, &value
+    );
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
+
+    if (dtype != DTL_DTYPE_INDEX_ARRAY) {
+        dtl_set_error(error, dtl_error_create("Traced array %llu is not an index array", (unsigned long long)id));
+        switch (dtype) {
+        case DTL_DTYPE_BOOL_ARRAY:
+            dtl_value_clear_bool_array(&value, *size);
+            break;
+        case DTL_DTYPE_INT64_ARRAY:
+            dtl_value_clear_int64_array(&value, *size);
+            break;
+        default:
+            dtl_value_clear_double_array(&value, *size);
+            break;
+        }
+        return DTL_STATUS_ERROR;
+    }
+
+    *out = dtl_value_get_index_array(&value);
+    return DTL_STATUS_OK;
+}
+
+static enum dtl_status
+dtl_io_filesystem_trace_reader_read_value(
+    struct dtl_io_trace_reader *reader,
+    uint64_t id,
+    bool *found,
+    enum dtl_dtype *dtype,
+    size_t *size,
+    struct dtl_value *out,
+    struct dtl_error **error
+) {
+    struct dtl_io_filesystem_trace_reader *fs_reader = (struct dtl_io_filesystem_trace_reader *)reader;
+    std::filesystem::path path;
+    std::error_code error_code;
+    arrow::Status arrow_status;
+
+    // Values of types that the tracer can't write are skipped, and so have no file.
+    path = dtl_io_filesystem_trace_reader_array_path(fs_reader, id);
+    *found = std::filesystem::exists(path, error_code);
+    if (!*found) {
+        return DTL_STATUS_OK;
+    }
+
+    arrow_status = dtl_io_filesystem_trace_reader_load_array(path, dtype, size, out);
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
+    return DTL_STATUS_OK;
+}
+
+struct dtl_io_trace_reader*
+dtl_io_filesystem_trace_reader_create(char const* root) {
+    struct dtl_io_filesystem_trace_reader* fs_reader;
+
+    fs_reader = new struct dtl_io_filesystem_trace_reader();
+    fs_reader->base.read_manifest = dtl_io_filesystem_trace_reader_read_manifest;
+    fs_reader->base.read_index_array = dtl_io_filesystem_trace_reader_read_index_array;
+    fs_reader->base.read_value = dtl_io_filesystem_trace_reader_read_value;
+    fs_reader->root = root;
+
+    return &fs_reader->base;
+}
+
+void
+dtl_io_filesystem_trace_reader_destroy(struct dtl_io_trace_reader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+
+    assert(reader->read_manifest == dtl_io_filesystem_trace_reader_read_manifest);
+
+    delete (struct dtl_io_filesystem_trace_reader*)reader;
 }
@@ -1,21 +1,66 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dtl-error.h"
 #include "dtl-io.h"
 
 struct dtl_io_importer *
 dtl_io_filesystem_importer_create(char const *root);
 
+// Read input files through a memory mapping instead of read(2).  Lets concurrent processes
+// share the page cache copy of their inputs.
+void
+dtl_io_filesystem_importer_set_memory_map(struct dtl_io_importer *, bool memory_map);
+
 void
 dtl_io_filesystem_importer_destroy(struct dtl_io_importer *);
 
 struct dtl_io_exporter *
 dtl_io_filesystem_exporter_create(char const *root);
 
+// Maximum number of rows written to each row group.  Defaults to 65535.
+void
+dtl_io_filesystem_exporter_set_row_group_size(struct dtl_io_exporter *, size_t row_group_size);
+
+// Compress exported files with the named codec, e.g. "zstd" or "snappy".  Files are uncompressed
+// by default.
+enum dtl_status
+dtl_io_filesystem_exporter_set_compression(struct dtl_io_exporter *, char const *codec, struct dtl_error **error);
+
+// Codec specific compression level.  Invalid levels are reported when a table is exported.
+void
+dtl_io_filesystem_exporter_set_compression_level(struct dtl_io_exporter *, int level);
+
+// Enabled by default.
+void
+dtl_io_filesystem_exporter_set_dictionary(struct dtl_io_exporter *, bool dictionary);
+
+// Write min/max statistics for each column chunk.  Enabled by default.
+void
+dtl_io_filesystem_exporter_set_statistics(struct dtl_io_exporter *, bool statistics);
+
+// Write a bloom filter for every exported column with the given name.  Lets later readers skip
+// row groups when filtering the column for equality.
+void
+dtl_io_filesystem_exporter_add_bloom_filter(struct dtl_io_exporter *, char const *column_name);
+
 void
 dtl_io_filesystem_exporter_destroy(struct dtl_io_exporter *);
 
+// Writes each traced array to its own Arrow IPC file under `root`.  Deferred values are written
+// in parallel on Arrow's IO thread pool, so the tracer does not need an async wrapper.
 struct dtl_io_tracer *
 dtl_io_filesystem_tracer_create(char const *root);
 
+// Waits for outstanding writes and then writes the manifest.  Returns the first error from either.
+enum dtl_status
+dtl_io_filesystem_tracer_destroy(struct dtl_io_tracer *, struct dtl_error **error);
+
+// Reads back a trace written by the filesystem tracer to `root`.
+struct dtl_io_trace_reader *
+dtl_io_filesystem_trace_reader_create(char const *root);
+
 void
-dtl_io_filesystem_tracer_destroy(struct dtl_io_tracer *);
+dtl_io_filesystem_trace_reader_destroy(struct dtl_io_trace_reader *);
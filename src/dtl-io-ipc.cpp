@@ -0,0 +1,405 @@
+extern "C" {
+#include "dtl-io-ipc.h"
+}
+
+#include "dtl-io-arrow.hpp"
+
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <arrow/ipc/api.h>
+#include <arrow/util/compression.h>
+#include <cassert>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-io.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+}
+
+/* === Importer ================================================================================= */
+
+struct dtl_io_ipc_table {
+    struct dtl_io_table base;
+
+    // Only the footer is read when the table is imported.  Record batches are read the first time
+    // the evaluator asks for a column.  For uncompressed files this amounts to slicing the
+    // mapping.
+    std::shared_ptr<arrow::ipc::RecordBatchFileReader> arrow_reader;
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    bool batches_read;
+    size_t num_rows;
+
+    // Data handed out by `read_column_data`, indexed by column.  See `dtl_io_filesystem_table`.
+    std::vector<std::shared_ptr<arrow::ChunkedArray>> arrow_columns;
+    std::vector<void *> columns;
+    std::vector<bool> owned_columns;
+};
+
+struct dtl_io_ipc_importer {
+    struct dtl_io_importer base;
+
+    std::filesystem::path root;
+};
+
+static size_t
+dtl_io_ipc_table_get_num_rows(struct dtl_io_table* table) {
+    struct dtl_io_ipc_table *ipc_table;
+
+    assert(table != NULL);
+    assert(table->get_num_rows == dtl_io_ipc_table_get_num_rows);
+
+    ipc_table = (struct dtl_io_ipc_table *) table;
+
+    return ipc_table->num_rows;
+}
+
+static arrow::Status
+dtl_io_ipc_table_read_batches(struct dtl_io_ipc_table *ipc_table) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+
+    if (ipc_table->batches_read) {
+        return arrow::Status::OK();
+    }
+
+    for (int i = 0; i < ipc_table->arrow_reader->num_record_batches(); i++) {
+        ARROW_ASSIGN_OR_RAISE(batch, ipc_table->arrow_reader->ReadRecordBatch(i));
+        ipc_table->batches.push_back(batch);
+    }
+
+    ipc_table->batches_read = true;
+    return arrow::Status::OK();
+}
+
+static enum dtl_status
+dtl_io_ipc_table_read_column_data(
+    struct dtl_io_table* table,
+    size_t col_index,
+    struct dtl_value *out,
+    struct dtl_error **error
+) {
+    enum dtl_dtype dtype;
+    struct dtl_io_ipc_table *ipc_table;
+    arrow::Status status;
+    std::shared_ptr<arrow::ChunkedArray> arrow_column;
+    void *data = NULL;
+    bool owned = false;
+
+    assert(table != NULL);
+    assert(table->read_column_data == dtl_io_ipc_table_read_column_data);
+
+    ipc_table = (struct dtl_io_ipc_table*)table;
+    dtype = dtl_schema_get_column_dtype(table->schema, col_index);
+
+    data = ipc_table->columns[col_index];
+    if (data == NULL) {
+        status = dtl_io_ipc_table_read_batches(ipc_table);
+        if (!status.ok()) {
+            dtl_io_arrow_set_error_from_status(error, status);
+            return DTL_STATUS_ERROR;
+        }
+
+        // Files with a single record batch, which is what `dtl_io_ipc_exporter` writes, give a
+        // single chunk that can be borrowed without copying.
+        arrow::ArrayVector chunks;
+        for (auto const &batch : ipc_table->batches) {
+            chunks.push_back(batch->column(col_index));
+        }
+        arrow_column = std::make_shared<arrow::ChunkedArray>(
+            std::move(chunks), ipc_table->arrow_reader->schema()->field(col_index)->type()
+        );
+
+        if (arrow_column->null_count() != 0) {
+            dtl_set_error(
+                error,
+                dtl_error_create(
+                    "Column '%s' contains null values", dtl_schema_get_column_name(table->schema, col_index)
+                )
+            );
+            return DTL_STATUS_ERROR;
+        }
+
+        data = dtl_io_arrow_import_column(*arrow_column, &owned);
+
+        ipc_table->arrow_columns[col_index] = arrow_column;
+        ipc_table->columns[col_index] = data;
+        ipc_table->owned_columns[col_index] = owned;
+    }
+
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        dtl_value_take_bool_array(out, data);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        dtl_value_take_int64_array(out, (int64_t *)data);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        dtl_value_take_double_array(out, (double *)data);
+        break;
+    default:
+        assert(false);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+static void
+dtl_io_ipc_table_destroy(struct dtl_io_table* table) {
+    struct dtl_io_ipc_table* ipc_table;
+
+    assert(table != NULL);
+    assert(table->destroy == dtl_io_ipc_table_destroy);
+
+    ipc_table = (struct dtl_io_ipc_table*)table;
+
+    for (size_t i = 0; i < ipc_table->columns.size(); i++) {
+        if (ipc_table->owned_columns[i]) {
+            free(ipc_table->columns[i]);
+        }
+    }
+
+    dtl_schema_destroy(table->schema);
+
+    delete ipc_table;
+}
+
+static struct dtl_io_table*
+dtl_io_ipc_importer_import_table(
+    struct dtl_io_importer* importer,
+    char const* name,
+    struct dtl_error **error
+) {
+    struct dtl_io_ipc_importer* ipc_importer;
+    std::shared_ptr<arrow::io::MemoryMappedFile> input_file;
+    std::shared_ptr<arrow::ipc::RecordBatchFileReader> arrow_reader;
+    int64_t num_rows;
+    struct dtl_schema *schema;
+    struct dtl_io_ipc_table* ipc_table;
+
+    assert(importer != NULL);
+    assert(importer->import_table == dtl_io_ipc_importer_import_table);
+    assert(name != NULL);
+
+    ipc_importer = (struct dtl_io_ipc_importer*)importer;
+
+    auto input_path = ipc_importer->root / name;
+
+    auto input_file_result = arrow::io::MemoryMappedFile::Open(input_path, arrow::io::FileMode::READ);
+    if (!input_file_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, input_file_result.status());
+        return NULL;
+    }
+    input_file = input_file_result.ValueUnsafe();
+
+    auto arrow_reader_result = arrow::ipc::RecordBatchFileReader::Open(input_file);
+    if (!arrow_reader_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_reader_result.status());
+        return NULL;
+    }
+    arrow_reader = arrow_reader_result.ValueUnsafe();
+
+    // Row counts are stored in the record batch headers rather than the footer, but reading them
+    // doesn't touch any of the column buffers.
+    auto num_rows_result = arrow_reader->CountRows();
+    if (!num_rows_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, num_rows_result.status());
+        return NULL;
+    }
+    num_rows = num_rows_result.ValueUnsafe();
+
+    schema = dtl_io_arrow_import_schema(*arrow_reader->schema(), name, error);
+    if (schema == NULL) {
+        return NULL;
+    }
+
+    ipc_table = new struct dtl_io_ipc_table();
+
+    ipc_table->base.get_num_rows = dtl_io_ipc_table_get_num_rows;
+    ipc_table->base.read_column_data = dtl_io_ipc_table_read_column_data;
+    ipc_table->base.destroy = dtl_io_ipc_table_destroy;
+
+    ipc_table->base.schema = schema;
+    ipc_table->num_rows = num_rows;
+    ipc_table->arrow_reader = arrow_reader;
+    ipc_table->arrow_columns.resize(dtl_schema_get_num_columns(schema));
+    ipc_table->columns.resize(dtl_schema_get_num_columns(schema), NULL);
+    ipc_table->owned_columns.resize(dtl_schema_get_num_columns(schema), false);
+
+    return &ipc_table->base;
+}
+
+struct dtl_io_importer*
+dtl_io_ipc_importer_create(char const* root) {
+    struct dtl_io_ipc_importer* ipc_importer;
+
+    ipc_importer = new struct dtl_io_ipc_importer();
+    ipc_importer->base.import_table = dtl_io_ipc_importer_import_table;
+    ipc_importer->root = root;
+
+    return &ipc_importer->base;
+}
+
+void
+dtl_io_ipc_importer_destroy(struct dtl_io_importer* importer) {
+    struct dtl_io_ipc_importer* ipc_importer;
+
+    if (importer == NULL) {
+        return;
+    }
+
+    assert(importer->import_table == dtl_io_ipc_importer_import_table);
+
+    ipc_importer = (struct dtl_io_ipc_importer*)importer;
+    delete ipc_importer;
+}
+
+/* === Exporter ================================================================================= */
+
+struct dtl_io_ipc_exporter {
+    struct dtl_io_exporter base;
+
+    std::filesystem::path root;
+    arrow::Compression::type compression;
+};
+
+static enum dtl_status
+dtl_io_ipc_exporter_export_table(
+    struct dtl_io_exporter* exporter,
+    char const* table_name,
+    struct dtl_schema *schema,
+    size_t num_rows,
+    struct dtl_value **values,
+    struct dtl_error **error
+) {
+    struct dtl_io_ipc_exporter* ipc_exporter;
+    arrow::Status arrow_status;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_ipc_exporter_export_table);
+    assert(table_name != NULL);
+    assert(schema != NULL);
+    assert(values != NULL);
+
+    ipc_exporter = (struct dtl_io_ipc_exporter*)exporter;
+
+    // Buffers are compressed in parallel on Arrow's CPU thread pool.
+    auto options = arrow::ipc::IpcWriteOptions::Defaults();
+    options.use_threads = true;
+    if (ipc_exporter->compression != arrow::Compression::UNCOMPRESSED) {
+        auto codec_result = arrow::util::Codec::Create(ipc_exporter->compression);
+        if (!codec_result.ok()) {
+            dtl_io_arrow_set_error_from_status(error, codec_result.status());
+            return DTL_STATUS_ERROR;
+        }
+        options.codec = std::move(codec_result).ValueUnsafe();
+    }
+
+    batch = dtl_io_arrow_export_batch(schema, num_rows, values);
+
+    auto output_path = ipc_exporter->root / table_name;
+
+    auto outfile_result = arrow::io::FileOutputStream::Open(output_path);
+    if (!outfile_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, outfile_result.status());
+        return DTL_STATUS_ERROR;
+    }
+    outfile = outfile_result.ValueUnsafe();
+
+    auto writer_result = arrow::ipc::MakeFileWriter(outfile, batch->schema(), options);
+    if (!writer_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, writer_result.status());
+        return DTL_STATUS_ERROR;
+    }
+    writer = writer_result.ValueUnsafe();
+
+    // The whole table goes in a single record batch so that readers can borrow each column as one
+    // contiguous buffer.
+    arrow_status = writer->WriteRecordBatch(*batch);
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
+
+    arrow_status = writer->Close();
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
+
+    arrow_status = outfile->Close();
+    if (!arrow_status.ok()) {
+        dtl_io_arrow_set_error_from_status(error, arrow_status);
+        return DTL_STATUS_ERROR;
+    }
+
+    return DTL_STATUS_OK;
+}
+
+struct dtl_io_exporter*
+dtl_io_ipc_exporter_create(char const* root) {
+    struct dtl_io_ipc_exporter* ipc_exporter;
+
+    ipc_exporter = new struct dtl_io_ipc_exporter();
+
+    ipc_exporter->base.export_table = dtl_io_ipc_exporter_export_table;
+    ipc_exporter->root = root;
+    ipc_exporter->compression = arrow::Compression::UNCOMPRESSED;
+
+    return &ipc_exporter->base;
+}
+
+enum dtl_status
+dtl_io_ipc_exporter_set_compression(
+    struct dtl_io_exporter* exporter,
+    char const* codec,
+    struct dtl_error **error
+) {
+    struct dtl_io_ipc_exporter* ipc_exporter;
+
+    assert(exporter != NULL);
+    assert(exporter->export_table == dtl_io_ipc_exporter_export_table);
+    assert(codec != NULL);
+
+    ipc_exporter = (struct dtl_io_ipc_exporter*)exporter;
+
+    auto compression_result = arrow::util::Codec::GetCompressionType(codec);
+    if (!compression_result.ok()) {
+        dtl_io_arrow_set_error_from_status(error, compression_result.status());
+        return DTL_STATUS_ERROR;
+    }
+    if (*compression_result != arrow::Compression::LZ4_FRAME && *compression_result != arrow::Compression::ZSTD) {
+        dtl_set_error(error, dtl_error_create("Compression codec '%s' is not supported by IPC files", codec));
+        return DTL_STATUS_ERROR;
+    }
+    if (!arrow::util::Codec::IsAvailable(*compression_result)) {
+        dtl_set_error(error, dtl_error_create("Compression codec '%s' is not available", codec));
+        return DTL_STATUS_ERROR;
+    }
+
+    ipc_exporter->compression = *compression_result;
+    return DTL_STATUS_OK;
+}
+
+void
+dtl_io_ipc_exporter_destroy(struct dtl_io_exporter* exporter) {
+    struct dtl_io_ipc_exporter* ipc_exporter;
+
+    if (exporter == NULL) {
+        return;
+    }
+
+    assert(exporter->export_table == dtl_io_ipc_exporter_export_table);
+
+    ipc_exporter = (struct dtl_io_ipc_exporter*)exporter;
+    delete ipc_exporter;
+}
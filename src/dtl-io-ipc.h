@@ -0,0 +1,26 @@
+#pragma once
+
+#include "dtl-error.h"
+#include "dtl-io.h"
+
+// Reads and writes tables as Arrow IPC files (Feather V2).  Unlike the Parquet importer and
+// exporter, table names are used as file names as is, and so should include an extension.
+
+// Files are memory mapped, and uncompressed columns are handed to the evaluator without being
+// copied.  Compressed files are decompressed into memory the first time a column is read.
+struct dtl_io_importer *
+dtl_io_ipc_importer_create(char const *root);
+
+void
+dtl_io_ipc_importer_destroy(struct dtl_io_importer *);
+
+struct dtl_io_exporter *
+dtl_io_ipc_exporter_create(char const *root);
+
+// Compress record batch buffers with the named codec.  IPC files only support "lz4" and "zstd".
+// Files are uncompressed by default.
+enum dtl_status
+dtl_io_ipc_exporter_set_compression(struct dtl_io_exporter *, char const *codec, struct dtl_error **error);
+
+void
+dtl_io_ipc_exporter_destroy(struct dtl_io_exporter *);
@@ -0,0 +1,194 @@
+#include "dtl-io-sampled.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-io.h"
+#include "dtl-location.h"
+#include "dtl-schema.h"
+#include "dtl-value.h"
+
+struct dtl_io_sampled_tracer {
+    struct dtl_io_tracer base;
+    struct dtl_io_tracer *inner;
+
+    double rate;
+};
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_source(
+    struct dtl_io_tracer *base_tracer,
+    char const *source,
+    char const *filename,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_source(tracer->inner, source, filename, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_input(
+    struct dtl_io_tracer *base_tracer,
+    char const *name,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_input(tracer->inner, name, schema, array_ids, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_output(
+    struct dtl_io_tracer *base_tracer,
+    char const *name,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_output(tracer->inner, name, schema, array_ids, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_trace(
+    struct dtl_io_tracer *base_tracer,
+    struct dtl_location start,
+    struct dtl_location end,
+    struct dtl_schema *schema,
+    uint64_t *array_ids,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_trace(tracer->inner, start, end, schema, array_ids, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_mapping(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t src_array_id,
+    uint64_t tgt_array_id,
+    uint64_t src_index_array_id,
+    uint64_t tgt_index_array_id,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_mapping(
+        tracer->inner, src_array_id, tgt_array_id, src_index_array_id, tgt_index_array_id, error
+    );
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_value(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t id,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_value(tracer->inner, id, dtype, size, value, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_value_deferred(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t id,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value,
+    void (*release)(void *),
+    void *user_data,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_value_deferred(tracer->inner, id, dtype, size, value, release, user_data, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_sample(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t id,
+    uint64_t row_index_array,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_sample(tracer->inner, id, row_index_array, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_record_grouping(
+    struct dtl_io_tracer *base_tracer,
+    uint64_t index_array,
+    uint64_t offsets_array,
+    uint64_t entries_array,
+    struct dtl_error **error
+) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_record_grouping(tracer->inner, index_array, offsets_array, entries_array, error);
+}
+
+static enum dtl_status
+dtl_io_sampled_tracer_flush(struct dtl_io_tracer *base_tracer, struct dtl_error **error) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return dtl_io_tracer_flush(tracer->inner, error);
+}
+
+static double
+dtl_io_sampled_tracer_get_sample_rate(struct dtl_io_tracer *base_tracer) {
+    struct dtl_io_sampled_tracer *tracer = (struct dtl_io_sampled_tracer *)base_tracer;
+
+    return tracer->rate;
+}
+
+struct dtl_io_tracer *
+dtl_io_sampled_tracer_create(struct dtl_io_tracer *inner, double rate) {
+    struct dtl_io_sampled_tracer *tracer;
+
+    assert(inner != NULL);
+    assert(rate > 0.0 && rate <= 1.0);
+
+    tracer = calloc(1, sizeof(struct dtl_io_sampled_tracer));
+    tracer->base.record_source = dtl_io_sampled_tracer_record_source;
+    tracer->base.record_input = dtl_io_sampled_tracer_record_input;
+    tracer->base.record_output = dtl_io_sampled_tracer_record_output;
+    tracer->base.record_trace = dtl_io_sampled_tracer_record_trace;
+    tracer->base.record_mapping = dtl_io_sampled_tracer_record_mapping;
+    tracer->base.record_value = dtl_io_sampled_tracer_record_value;
+    tracer->base.record_value_deferred = dtl_io_sampled_tracer_record_value_deferred;
+    tracer->base.record_sample = dtl_io_sampled_tracer_record_sample;
+    tracer->base.record_grouping = dtl_io_sampled_tracer_record_grouping;
+    tracer->base.flush = dtl_io_sampled_tracer_flush;
+    tracer->base.get_sample_rate = dtl_io_sampled_tracer_get_sample_rate;
+
+    tracer->inner = inner;
+    tracer->rate = rate;
+
+    return &tracer->base;
+}
+
+void
+dtl_io_sampled_tracer_destroy(struct dtl_io_tracer *base_tracer) {
+    if (base_tracer == NULL) {
+        return;
+    }
+
+    assert(base_tracer->get_sample_rate == dtl_io_sampled_tracer_get_sample_rate);
+
+    free(base_tracer);
+}
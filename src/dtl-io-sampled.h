@@ -0,0 +1,14 @@
+#pragma once
+
+#include "dtl-io.h"
+
+// Wraps `inner` so that only a sample of exported rows, and the rows that they were derived from,
+// are traced.  Rows are picked by a hash of their position, so the same rows are sampled every
+// run.  `rate` is the fraction of rows to keep, and must be greater than zero and at most one.
+// Everything that is recorded is passed straight through to `inner`.
+struct dtl_io_tracer *
+dtl_io_sampled_tracer_create(struct dtl_io_tracer *inner, double rate);
+
+// Does not destroy the inner tracer.
+void
+dtl_io_sampled_tracer_destroy(struct dtl_io_tracer *);
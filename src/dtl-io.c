@@ -1,12 +1,14 @@
 #include "dtl-io.h"
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "dtl-dtype.h"
 #include "dtl-error.h"
 #include "dtl-location.h"
+#include "dtl-manifest.h"
 #include "dtl-schema.h"
 #include "dtl-value.h"
 
@@ -28,6 +30,24 @@ dtl_io_table_get_num_rows(struct dtl_io_table *table) {
     return table->get_num_rows(table);
 }
 
+enum dtl_status
+dtl_io_table_add_predicate(
+    struct dtl_io_table *table,
+    size_t col_index,
+    enum dtl_io_predicate_op op,
+    int64_t value,
+    struct dtl_error **error
+) {
+    assert(table != NULL);
+    assert(col_index < dtl_schema_get_num_columns(table->schema));
+
+    if (table->add_predicate == NULL) {
+        return DTL_STATUS_OK;
+    }
+
+    return table->add_predicate(table, col_index, op, value, error);
+}
+
 enum dtl_status
 dtl_io_table_read_column_data(
     struct dtl_io_table *table,
@@ -204,3 +224,137 @@ dtl_io_tracer_record_value(
     }
     return DTL_STATUS_OK;
 }
+
+enum dtl_status
+dtl_io_tracer_record_value_deferred(
+    struct dtl_io_tracer *tracer,
+    uint64_t id,
+    enum dtl_dtype dtype,
+    size_t size,
+    struct dtl_value *value,
+    void (*release)(void *),
+    void *user_data,
+    struct dtl_error **error
+) {
+    enum dtl_status status;
+
+    assert(tracer != NULL);
+    assert(id != 0);
+    assert(dtl_dtype_is_array_type(dtype) || size == 0);
+    assert(value != NULL);
+    assert(release != NULL);
+    assert(error != NULL);
+
+    if (tracer->record_value_deferred != NULL) {
+        return tracer->record_value_deferred(tracer, id, dtype, size, value, release, user_data, error);
+    }
+
+    status = dtl_io_tracer_record_value(tracer, id, dtype, size, value, error);
+    release(user_data);
+    return status;
+}
+
+enum dtl_status
+dtl_io_tracer_record_sample(
+    struct dtl_io_tracer *tracer,
+    uint64_t id,
+    uint64_t row_index_array,
+    struct dtl_error **error
+) {
+    assert(tracer != NULL);
+    assert(id != 0);
+    assert(row_index_array != 0);
+    assert(error != NULL);
+
+    if (tracer->record_sample != NULL) {
+        return tracer->record_sample(tracer, id, row_index_array, error);
+    }
+    return DTL_STATUS_OK;
+}
+
+enum dtl_status
+dtl_io_tracer_record_grouping(
+    struct dtl_io_tracer *tracer,
+    uint64_t index_array,
+    uint64_t offsets_array,
+    uint64_t entries_array,
+    struct dtl_error **error
+) {
+    assert(tracer != NULL);
+    assert(offsets_array != 0);
+    assert(entries_array != 0);
+    assert(error != NULL);
+
+    if (tracer->record_grouping != NULL) {
+        return tracer->record_grouping(tracer, index_array, offsets_array, entries_array, error);
+    }
+    return DTL_STATUS_OK;
+}
+
+enum dtl_status
+dtl_io_tracer_flush(struct dtl_io_tracer *tracer, struct dtl_error **error) {
+    assert(tracer != NULL);
+
+    if (tracer->flush != NULL) {
+        return tracer->flush(tracer, error);
+    }
+    return DTL_STATUS_OK;
+}
+
+double
+dtl_io_tracer_get_sample_rate(struct dtl_io_tracer *tracer) {
+    assert(tracer != NULL);
+
+    if (tracer->get_sample_rate != NULL) {
+        return tracer->get_sample_rate(tracer);
+    }
+    return 1.0;
+}
+
+/* === Trace readers ============================================================================ */
+
+struct dtl_manifest *
+dtl_io_trace_reader_read_manifest(struct dtl_io_trace_reader *reader, struct dtl_error **error) {
+    assert(reader != NULL);
+    assert(reader->read_manifest != NULL);
+
+    return reader->read_manifest(reader, error);
+}
+
+enum dtl_status
+dtl_io_trace_reader_read_index_array(
+    struct dtl_io_trace_reader *reader,
+    uint64_t id,
+    size_t **out,
+    size_t *size,
+    struct dtl_error **error
+) {
+    assert(reader != NULL);
+    assert(reader->read_index_array != NULL);
+    assert(id != 0);
+    assert(out != NULL);
+    assert(size != NULL);
+
+    return reader->read_index_array(reader, id, out, size, error);
+}
+
+enum dtl_status
+dtl_io_trace_reader_read_value(
+    struct dtl_io_trace_reader *reader,
+    uint64_t id,
+    bool *found,
+    enum dtl_dtype *dtype,
+    size_t *size,
+    struct dtl_value *out,
+    struct dtl_error **error
+) {
+    assert(reader != NULL);
+    assert(reader->read_value != NULL);
+    assert(id != 0);
+    assert(found != NULL);
+    assert(dtype != NULL);
+    assert(size != NULL);
+    assert(out != NULL);
+
+    return reader->read_value(reader, id, found, dtype, size, out, error);
+}
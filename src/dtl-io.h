@@ -1,19 +1,30 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "dtl-dtype.h"
 #include "dtl-error.h"
 #include "dtl-location.h"
+#include "dtl-manifest.h"
 #include "dtl-schema.h"
 #include "dtl-value.h"
 
 /* === Tables =================================================================================== */
 
+enum dtl_io_predicate_op {
+    DTL_IO_PREDICATE_EQUAL_TO,
+    DTL_IO_PREDICATE_LESS_THAN,
+    DTL_IO_PREDICATE_LESS_THAN_OR_EQUAL_TO,
+    DTL_IO_PREDICATE_GREATER_THAN,
+    DTL_IO_PREDICATE_GREATER_THAN_OR_EQUAL_TO,
+};
+
 struct dtl_io_table {
     struct dtl_schema *schema;
     size_t (*get_num_rows)(struct dtl_io_table *table);
+    enum dtl_status (*add_predicate)(struct dtl_io_table *table, size_t col_index, enum dtl_io_predicate_op op, int64_t value, struct dtl_error **error);
     enum dtl_status (*read_column_data)(struct dtl_io_table *table, size_t col_index, struct dtl_value *out, struct dtl_error **error);
     void (*destroy)(struct dtl_io_table *);
 };
@@ -24,6 +35,15 @@ dtl_io_table_get_schema(struct dtl_io_table *table);
 size_t
 dtl_io_table_get_num_rows(struct dtl_io_table *table);
 
+// Tells the table that rows for which `column <op> value` is false will be discarded by the
+// caller, and so do not need to be read.  Tables are free to drop some, all or none of these rows,
+// and must preserve the order of the rows that remain.  Must be called before the table is first
+// asked for its size or data.  Optional.
+enum dtl_status
+dtl_io_table_add_predicate(struct dtl_io_table *table, size_t col_index, enum dtl_io_predicate_op op, int64_t value, struct dtl_error **error);
+
+// Column data written to `out` remains owned by the table, and is valid until the table is
+// destroyed.
 enum dtl_status
 dtl_io_table_read_column_data(struct dtl_io_table *table, size_t col_index, struct dtl_value *out, struct dtl_error **error);
 
@@ -36,6 +56,7 @@ struct dtl_io_importer {
     struct dtl_io_table *(*import_table)(struct dtl_io_importer *, char const *, struct dtl_error **);
 };
 
+// Importers may be asked to open several tables at once from different threads.
 struct dtl_io_table *
 dtl_io_importer_import_table(struct dtl_io_importer *, char const *, struct dtl_error **);
 
@@ -45,6 +66,8 @@ struct dtl_io_exporter {
     enum dtl_status (*export_table)(struct dtl_io_exporter *, char const *, struct dtl_schema *, size_t, struct dtl_value **, struct dtl_error **);
 };
 
+// Exporters may be asked to export several tables at once from different threads.  Values are
+// only borrowed for the duration of the call.
 enum dtl_status
 dtl_io_exporter_export_table(struct dtl_io_exporter *, char const *, struct dtl_schema *, size_t, struct dtl_value **, struct dtl_error **);
 
@@ -57,6 +80,11 @@ struct dtl_io_tracer {
     enum dtl_status (*record_trace)(struct dtl_io_tracer *, struct dtl_location start, struct dtl_location end, struct dtl_schema *, uint64_t *, struct dtl_error **);
     enum dtl_status (*record_mapping)(struct dtl_io_tracer *, uint64_t src_array, uint64_t tgt_array, uint64_t src_index_array, uint64_t tgt_index_array, struct dtl_error **);
     enum dtl_status (*record_value)(struct dtl_io_tracer *, uint64_t id, enum dtl_dtype, size_t, struct dtl_value *, struct dtl_error **);
+    enum dtl_status (*record_value_deferred)(struct dtl_io_tracer *, uint64_t id, enum dtl_dtype, size_t, struct dtl_value *, void (*release)(void *), void *, struct dtl_error **);
+    enum dtl_status (*record_sample)(struct dtl_io_tracer *, uint64_t id, uint64_t row_index_array, struct dtl_error **);
+    enum dtl_status (*record_grouping)(struct dtl_io_tracer *, uint64_t index_array, uint64_t offsets_array, uint64_t entries_array, struct dtl_error **);
+    enum dtl_status (*flush)(struct dtl_io_tracer *, struct dtl_error **);
+    double (*get_sample_rate)(struct dtl_io_tracer *);
 };
 
 enum dtl_status
@@ -71,8 +99,67 @@ dtl_io_tracer_record_output(struct dtl_io_tracer *, char const *, struct dtl_sch
 enum dtl_status
 dtl_io_tracer_record_trace(struct dtl_io_tracer *, struct dtl_location start, struct dtl_location end, struct dtl_schema *, uint64_t *, struct dtl_error **);
 
+// Passed in place of an index array to a mapping in which rows map to the rows at the same
+// index.
+#define DTL_IO_TRACER_IDENTITY_MAPPING UINT64_MAX
+
+// Records that row `src_index_array[i]` of `src_array` contributed to row `tgt_index_array[i]` of
+// `tgt_array`.  Index arrays are recorded separately, as values.
 enum dtl_status
 dtl_io_tracer_record_mapping(struct dtl_io_tracer *tracer, uint64_t src_array, uint64_t tgt_array, uint64_t src_index_array, uint64_t tgt_index_array, struct dtl_error **);
 
 enum dtl_status
 dtl_io_tracer_record_value(struct dtl_io_tracer *, uint64_t id, enum dtl_dtype, size_t, struct dtl_value *, struct dtl_error **);
+
+// As `record_value`, but the tracer may keep using `value` after returning, and calls `release`
+// with `user_data` once it is done with it.  `release` may be called from another thread, and
+// may be called before this function returns.  Tracers that don't support deferred writes record
+// the value immediately.  Errors from deferred writes are reported by the next call to `flush`.
+enum dtl_status
+dtl_io_tracer_record_value_deferred(struct dtl_io_tracer *, uint64_t id, enum dtl_dtype, size_t, struct dtl_value *, void (*release)(void *), void *user_data, struct dtl_error **);
+
+// Records that value `id` was only traced for a sample of its rows.  Row `i` of the recorded value
+// is row `row_index_array[i]` of the full array.  The row index array is recorded separately, as a
+// value.
+enum dtl_status
+dtl_io_tracer_record_sample(struct dtl_io_tracer *, uint64_t id, uint64_t row_index_array, struct dtl_error **);
+
+// Records the entries of index array `index_array` grouped by the rows that they point to, in
+// compressed sparse row form.  The entries pointing to row `r` are `entries_array[offsets_array[r]]`
+// up to `entries_array[offsets_array[r + 1]]`.  Lets mappings be followed from either end without
+// sorting them first.  Both arrays are recorded separately, as values.
+enum dtl_status
+dtl_io_tracer_record_grouping(struct dtl_io_tracer *, uint64_t index_array, uint64_t offsets_array, uint64_t entries_array, struct dtl_error **);
+
+// Waits for all deferred writes to finish and for their values to be released.
+enum dtl_status
+dtl_io_tracer_flush(struct dtl_io_tracer *, struct dtl_error **);
+
+// Fraction of exported rows that should be traced.  When less than one, the evaluator only records
+// the exported rows picked by a hash of their position, and the rows that they were derived from.
+// Defaults to one.
+double
+dtl_io_tracer_get_sample_rate(struct dtl_io_tracer *);
+
+/* === Trace readers ============================================================================ */
+
+struct dtl_io_trace_reader {
+    struct dtl_manifest *(*read_manifest)(struct dtl_io_trace_reader *, struct dtl_error **);
+    enum dtl_status (*read_index_array)(struct dtl_io_trace_reader *, uint64_t id, size_t **, size_t *, struct dtl_error **);
+    enum dtl_status (*read_value)(struct dtl_io_trace_reader *, uint64_t id, bool *, enum dtl_dtype *, size_t *, struct dtl_value *, struct dtl_error **);
+};
+
+// Reads everything that was recorded by a tracer other than values.  The caller owns the
+// manifest.
+struct dtl_manifest *
+dtl_io_trace_reader_read_manifest(struct dtl_io_trace_reader *, struct dtl_error **);
+
+// Reads back an index array recorded as part of a mapping or sample.  The caller owns the array.
+enum dtl_status
+dtl_io_trace_reader_read_index_array(struct dtl_io_trace_reader *, uint64_t id, size_t **out, size_t *size, struct dtl_error **);
+
+// Reads back the value recorded for array `id`.  Sets `found` to false if no value was recorded,
+// for example because the tracer can't store values of its type.  Empty values may also be reported
+// as missing.  The caller owns the value.
+enum dtl_status
+dtl_io_trace_reader_read_value(struct dtl_io_trace_reader *, uint64_t id, bool *found, enum dtl_dtype *dtype, size_t *size, struct dtl_value *out, struct dtl_error **);
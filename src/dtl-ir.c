@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -43,6 +44,9 @@ struct dtl_ir_expression {
     union {
         char const *ident;
         struct dtl_value value;
+
+        // Offset of `ident` in the string table of a graph image.
+        uint64_t ident_offset;
     };
 };
 
@@ -69,6 +73,9 @@ struct dtl_ir_graph {
 
     bool transforming : 1;
     bool writing : 1;
+
+    // Expressions and dependencies live in a mapped image, and are not owned by the graph.
+    bool mapped : 1;
 };
 
 /* --- References ------------------------------------------------------------------------------- */
@@ -123,6 +130,7 @@ dtl_ir_scratch_begin(struct dtl_ir_graph *graph, enum dtl_ir_op op, enum dtl_dty
 
     assert(graph != NULL);
     assert(!graph->writing);
+    assert(!graph->mapped);
     assert(op != 0);
     assert(dtype != 0);
 
@@ -158,7 +166,7 @@ dtl_ir_scratch_set_int64(struct dtl_ir_graph *graph, int64_t value) {
 
     expression = &graph->to_space.expressions[graph->to_space.expressions_length];
 
-    expression->value.as_int64 = value;
+    dtl_value_set_int64(&expression->value, value);
 }
 
 static void
@@ -552,8 +560,10 @@ error:
 
 void
 dtl_ir_graph_destroy(struct dtl_ir_graph *graph) {
-    free(graph->to_space.expressions);
-    free(graph->to_space.dependencies);
+    if (!graph->mapped) {
+        free(graph->to_space.expressions);
+        free(graph->to_space.dependencies);
+    }
     free(graph->from_space.expressions);
     free(graph->from_space.dependencies);
     free(graph->relocations);
@@ -652,6 +662,159 @@ dtl_ir_graph_remap_ref(struct dtl_ir_graph *graph, struct dtl_ir_ref *ref) {
     assert(ref->space == graph->to_space.id);
 }
 
+/* --- Images ---------------------------------------------------------------------------------- */
+
+// Images are the to-space arrays of the graph written out as they are, so that a mapped image can
+// be read with the same accessors as a graph built in memory.  Only the identifiers need to be
+// fixed up after mapping.
+
+struct dtl_ir_image_header {
+    uint32_t expression_size;
+    int32_t space;
+    uint64_t num_expressions;
+    uint64_t num_dependencies;
+};
+
+static bool
+dtl_ir_op_has_ident(enum dtl_ir_op op) {
+    return op == DTL_IR_OP_OPEN_TABLE || op == DTL_IR_OP_READ_COLUMN;
+}
+
+bool
+dtl_ir_graph_write_image(
+    struct dtl_ir_graph *graph,
+    FILE *file,
+    uint64_t (*string_offset)(char const *string, void *user_data),
+    void *user_data
+) {
+    struct dtl_ir_image_header header = {0};
+    struct dtl_ir_expression expression;
+    size_t i;
+
+    assert(graph != NULL);
+    assert(!graph->transforming);
+    assert(!graph->writing);
+
+    header.expression_size = sizeof(struct dtl_ir_expression);
+    header.space = graph->to_space.id;
+    header.num_expressions = graph->to_space.expressions_length;
+    header.num_dependencies = graph->to_space.dependencies_length;
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        return false;
+    }
+
+    for (i = 0; i < graph->to_space.expressions_length; i++) {
+        expression = graph->to_space.expressions[i];
+        if (dtl_ir_op_has_ident(expression.op)) {
+            expression.ident_offset = string_offset(expression.ident, user_data);
+        }
+        if (fwrite(&expression, sizeof(expression), 1, file) != 1) {
+            return false;
+        }
+    }
+
+    if (graph->to_space.dependencies_length > 0) {
+        if (
+            fwrite(
+                graph->to_space.dependencies,
+                sizeof(struct dtl_ir_ref),
+                graph->to_space.dependencies_length,
+                file
+            ) != graph->to_space.dependencies_length
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct dtl_ir_graph *
+dtl_ir_graph_create_from_image(void *image, size_t size, char const *strings, size_t strings_size) {
+    struct dtl_ir_image_header header;
+    struct dtl_ir_expression *expressions;
+    struct dtl_ir_ref *dependencies;
+    struct dtl_ir_ref dependency;
+    struct dtl_ir_graph *graph;
+    uint32_t start;
+    size_t i;
+    size_t j;
+
+    assert(image != NULL);
+    assert(((uintptr_t)image % _Alignof(struct dtl_ir_expression)) == 0);
+
+    if (size < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, image, sizeof(header));
+
+    if (header.expression_size != sizeof(struct dtl_ir_expression)) {
+        return NULL;
+    }
+    if (header.space != 1 && header.space != 2) {
+        return NULL;
+    }
+    if (header.num_expressions > (size - sizeof(header)) / sizeof(struct dtl_ir_expression)) {
+        return NULL;
+    }
+    if (
+        header.num_dependencies >
+        (size - sizeof(header) - header.num_expressions * sizeof(struct dtl_ir_expression)) / sizeof(struct dtl_ir_ref)
+    ) {
+        return NULL;
+    }
+
+    expressions = (struct dtl_ir_expression *)((char *)image + sizeof(header));
+    dependencies = (struct dtl_ir_ref *)(expressions + header.num_expressions);
+
+    // Check that every expression only depends on the expressions before it, as evaluation
+    // relies on this, and relocate identifiers.
+    start = 0;
+    for (i = 0; i < header.num_expressions; i++) {
+        if (expressions[i].op < DTL_IR_OP_TABLE_SHAPE || expressions[i].op > DTL_IR_OP_DIVIDE) {
+            return NULL;
+        }
+        if (expressions[i].dependencies_end < start || expressions[i].dependencies_end > header.num_dependencies) {
+            return NULL;
+        }
+        for (j = start; j < expressions[i].dependencies_end; j++) {
+            dependency = dependencies[j];
+            if (dependency.space != header.space || dependency.offset == 0 || dependency.offset > i) {
+                return NULL;
+            }
+        }
+        start = expressions[i].dependencies_end;
+
+        if (dtl_ir_op_has_ident(expressions[i].op)) {
+            if (expressions[i].ident_offset >= strings_size) {
+                return NULL;
+            }
+            expressions[i].ident = strings + expressions[i].ident_offset;
+        }
+    }
+
+    graph = calloc(1, sizeof(struct dtl_ir_graph));
+    if (graph == NULL) {
+        return NULL;
+    }
+
+    graph->interner = dtl_string_interner_create();
+
+    graph->to_space.id = header.space;
+    graph->to_space.expressions = expressions;
+    graph->to_space.expressions_length = header.num_expressions;
+    graph->to_space.expressions_capacity = header.num_expressions;
+    graph->to_space.dependencies = dependencies;
+    graph->to_space.dependencies_length = header.num_dependencies;
+    graph->to_space.dependencies_capacity = header.num_dependencies;
+
+    graph->from_space.id = header.space == 1 ? 2 : 1;
+
+    graph->mapped = true;
+
+    return graph;
+}
+
 /* === Expressions ============================================================================== */
 
 bool
@@ -790,7 +953,7 @@ dtl_ir_int64_constant_expression_create(
     assert(graph != NULL);
     assert(dtl_ir_is_shape_expression(graph, shape));
 
-    dtl_ir_scratch_begin(graph, DTL_IR_OP_CONSTANT, DTL_DTYPE_INT64);
+    dtl_ir_scratch_begin(graph, DTL_IR_OP_CONSTANT, DTL_DTYPE_INT64_ARRAY);
     dtl_ir_scratch_set_int64(graph, value);
     dtl_ir_scratch_add_dependency(graph, shape);
     return dtl_ir_scratch_end(graph);
@@ -809,7 +972,7 @@ dtl_ir_is_int64_constant_expression(struct dtl_ir_graph *graph, struct dtl_ir_re
     }
 
     dtype = dtl_ir_expression_get_dtype(graph, expression);
-    if (dtype != DTL_DTYPE_INT64) {
+    if (dtype != DTL_DTYPE_INT64_ARRAY) {
         return false;
     }
 
@@ -835,7 +998,7 @@ dtl_ir_double_constant_expression_create(
     assert(graph != NULL);
     assert(dtl_ir_is_shape_expression(graph, shape));
 
-    dtl_ir_scratch_begin(graph, DTL_IR_OP_CONSTANT, DTL_DTYPE_DOUBLE);
+    dtl_ir_scratch_begin(graph, DTL_IR_OP_CONSTANT, DTL_DTYPE_DOUBLE_ARRAY);
     dtl_ir_scratch_set_double(graph, value);
     dtl_ir_scratch_add_dependency(graph, shape);
     return dtl_ir_scratch_end(graph);
@@ -854,7 +1017,7 @@ dtl_ir_is_double_constant_expression(struct dtl_ir_graph *graph, struct dtl_ir_r
     }
 
     dtype = dtl_ir_expression_get_dtype(graph, expression);
-    if (dtype != DTL_DTYPE_DOUBLE) {
+    if (dtype != DTL_DTYPE_DOUBLE_ARRAY) {
         return false;
     }
 
@@ -1348,7 +1511,7 @@ dtl_ir_greater_than_expression_create(
     assert(dtl_ir_ref_equal(graph, dtl_ir_array_expression_get_shape(graph, left), shape));
     assert(dtl_ir_ref_equal(graph, dtl_ir_array_expression_get_shape(graph, right), shape));
 
-    dtl_ir_scratch_begin(graph, DTL_IR_OP_GREATER_THAN_OR_EQUAL_TO, DTL_DTYPE_BOOL_ARRAY);
+    dtl_ir_scratch_begin(graph, DTL_IR_OP_GREATER_THAN, DTL_DTYPE_BOOL_ARRAY);
     dtl_ir_scratch_add_dependency(graph, shape);
     dtl_ir_scratch_add_dependency(graph, left);
     dtl_ir_scratch_add_dependency(graph, right);
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #include "dtl-dtype.h"
 
@@ -95,6 +96,31 @@ dtl_ir_graph_gc_collect(struct dtl_ir_graph *graph);
 void
 dtl_ir_graph_remap_ref(struct dtl_ir_graph *graph, struct dtl_ir_ref *ref);
 
+/* --- Images ---------------------------------------------------------------------------------- */
+
+/**
+ * Writes the expressions of a finished graph to `file` as a flat image that can be mapped back
+ * into memory and used in place by `dtl_ir_graph_create_from_image`.  Identifiers are written as
+ * offsets into a string table maintained by the caller, which `string_offset` is called to look
+ * up.  Returns false, with `errno` set, if writing fails.
+ */
+bool
+dtl_ir_graph_write_image(
+    struct dtl_ir_graph *graph,
+    FILE *file,
+    uint64_t (*string_offset)(char const *string, void *user_data),
+    void *user_data
+);
+
+/**
+ * Creates a read only graph backed by an image written by `dtl_ir_graph_write_image`.  Identifiers
+ * are relocated in place to point into `strings`, so the image must be writable, though a private
+ * mapping of a read only file will do.  The image and strings must outlive the graph.  Returns
+ * NULL if the image is malformed, or was written by a build with a different expression layout.
+ */
+struct dtl_ir_graph *
+dtl_ir_graph_create_from_image(void *image, size_t size, char const *strings, size_t strings_size);
+
 /* === Shape Expressions ======================================================================== */
 
 bool
@@ -148,6 +174,7 @@ struct dtl_ir_ref
 dtl_ir_array_expression_get_shape(struct dtl_ir_graph *graph, struct dtl_ir_ref ref);
 
 /* --- Integer Constant Expressions ------------------------------------------------------------- */
+// Returns an array of the given shape with every element set to the same value.
 
 struct dtl_ir_ref
 dtl_ir_int64_constant_expression_create(
@@ -163,6 +190,7 @@ int64_t
 dtl_ir_int64_constant_expression_get_value(struct dtl_ir_graph *graph, struct dtl_ir_ref ref);
 
 /* --- Double Constant Expressions ------------------------------------------------------------- */
+// Returns an array of the given shape with every element set to the same value.
 
 struct dtl_ir_ref
 dtl_ir_double_constant_expression_create(
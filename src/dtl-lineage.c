@@ -0,0 +1,870 @@
+#include "dtl-lineage.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtl-bool-array.h"
+#include "dtl-double-array.h"
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-index-array.h"
+#include "dtl-int64-array.h"
+#include "dtl-io.h"
+#include "dtl-manifest.h"
+#include "dtl-value.h"
+
+// The index arrays of a mapping, with its entries grouped by target row and by source row, as
+// recorded by the tracer.
+struct dtl_lineage_index {
+    bool loaded;
+
+    // Number of entries.  `SIZE_MAX` if both sides are the identity, in which case every row maps
+    // to itself.
+    size_t size;
+
+    // NULL for the identity.
+    size_t *src_rows;
+    size_t *tgt_rows;
+
+    // Entries linked to row `i` of the target are `tgt_entries[tgt_offsets[i]..tgt_offsets[i + 1]]`.
+    // Only read if the target side isn't the identity.
+    size_t num_tgt_keys;
+    size_t *tgt_offsets;
+    size_t *tgt_entries;
+
+    // As above, for rows of the source.
+    size_t num_src_keys;
+    size_t *src_offsets;
+    size_t *src_entries;
+};
+
+struct dtl_lineage_value {
+    size_t array;
+
+    bool found;
+    enum dtl_dtype dtype;
+    size_t size;
+    struct dtl_value value;
+
+    // If only a sample of the array was recorded, row `i` of `value` is row `sample_rows[i]` of the
+    // full array.  Sorted.
+    size_t num_sample_rows;
+    size_t *sample_rows;
+};
+
+struct dtl_lineage {
+    struct dtl_io_trace_reader *reader;
+    struct dtl_manifest *manifest;
+
+    // One for each mapping in the manifest.
+    struct dtl_lineage_index *indexes;
+
+    size_t num_values;
+    struct dtl_lineage_value *values;
+};
+
+// A growable list of rows.
+struct dtl_lineage_rows {
+    size_t num_rows;
+    size_t *rows;
+};
+
+static void
+dtl_lineage_clear_value(struct dtl_value *value, enum dtl_dtype dtype, size_t size) {
+    switch (dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        dtl_value_clear_bool_array(value, size);
+        break;
+    case DTL_DTYPE_INT64_ARRAY:
+        dtl_value_clear_int64_array(value, size);
+        break;
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        dtl_value_clear_double_array(value, size);
+        break;
+    case DTL_DTYPE_INDEX_ARRAY:
+        dtl_value_clear_index_array(value, size);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+/* --- Indexes ---------------------------------------------------------------------------------- */
+
+// Reads the grouping recorded for index array `array`.
+static enum dtl_status
+dtl_lineage_read_grouping(
+    struct dtl_lineage *lineage,
+    size_t array,
+    size_t size,
+    size_t *num_keys,
+    size_t **offsets,
+    size_t **entries,
+    struct dtl_error **error
+) {
+    struct dtl_manifest *manifest = lineage->manifest;
+    size_t num_offsets;
+    size_t num_entries;
+    size_t i;
+
+    for (i = 0; i < manifest->num_groupings; i++) {
+        if (manifest->groupings[i].array == array) {
+            break;
+        }
+    }
+    if (i == manifest->num_groupings) {
+        dtl_set_error(error, dtl_error_create("Index array %zu has no recorded grouping", array));
+        return DTL_STATUS_ERROR;
+    }
+
+    if (dtl_io_trace_reader_read_index_array(
+            lineage->reader, manifest->groupings[i].offsets_array, offsets, &num_offsets, error
+        ) != DTL_STATUS_OK) {
+        return DTL_STATUS_ERROR;
+    }
+    if (dtl_io_trace_reader_read_index_array(
+            lineage->reader, manifest->groupings[i].entries_array, entries, &num_entries, error
+        ) != DTL_STATUS_OK) {
+        dtl_index_array_destroy(*offsets, num_offsets);
+        *offsets = NULL;
+        return DTL_STATUS_ERROR;
+    }
+
+    if (num_offsets == 0 || num_entries != size || (*offsets)[num_offsets - 1] != size) {
+        dtl_set_error(error, dtl_error_create("Grouping of index array %zu does not match the array", array));
+        dtl_index_array_destroy(*offsets, num_offsets);
+        dtl_index_array_destroy(*entries, num_entries);
+        *offsets = NULL;
+        *entries = NULL;
+        return DTL_STATUS_ERROR;
+    }
+
+    *num_keys = num_offsets - 1;
+    return DTL_STATUS_OK;
+}
+
+static struct dtl_lineage_index *
+dtl_lineage_get_index(struct dtl_lineage *lineage, size_t mapping_index, struct dtl_error **error) {
+    struct dtl_lineage_index *index = &lineage->indexes[mapping_index];
+    struct dtl_manifest_mapping *mapping = &lineage->manifest->mappings[mapping_index];
+    size_t src_size = SIZE_MAX;
+    size_t tgt_size = SIZE_MAX;
+    enum dtl_status status;
+
+    if (index->loaded) {
+        return index;
+    }
+
+    if (mapping->src_index_array >= 0) {
+        status = dtl_io_trace_reader_read_index_array(
+            lineage->reader, (uint64_t)mapping->src_index_array, &index->src_rows, &src_size, error
+        );
+        if (status != DTL_STATUS_OK) {
+            goto error;
+        }
+    }
+    if (mapping->tgt_index_array >= 0) {
+        status = dtl_io_trace_reader_read_index_array(
+            lineage->reader, (uint64_t)mapping->tgt_index_array, &index->tgt_rows, &tgt_size, error
+        );
+        if (status != DTL_STATUS_OK) {
+            goto error;
+        }
+    }
+
+    if (index->src_rows != NULL && index->tgt_rows != NULL && src_size != tgt_size) {
+        dtl_set_error(
+            error,
+            dtl_error_create(
+                "Mapping from %zu to %zu has index arrays of different lengths", mapping->src_array, mapping->tgt_array
+            )
+        );
+        goto error;
+    }
+    index->size = index->src_rows != NULL ? src_size : tgt_size;
+
+    if (index->tgt_rows != NULL) {
+        status = dtl_lineage_read_grouping(
+            lineage,
+            (size_t)mapping->tgt_index_array,
+            index->size,
+            &index->num_tgt_keys,
+            &index->tgt_offsets,
+            &index->tgt_entries,
+            error
+        );
+        if (status != DTL_STATUS_OK) {
+            goto error;
+        }
+    }
+    if (index->src_rows != NULL) {
+        status = dtl_lineage_read_grouping(
+            lineage,
+            (size_t)mapping->src_index_array,
+            index->size,
+            &index->num_src_keys,
+            &index->src_offsets,
+            &index->src_entries,
+            error
+        );
+        if (status != DTL_STATUS_OK) {
+            goto error;
+        }
+    }
+
+    index->loaded = true;
+    return index;
+
+error:
+    // Anything read before the failure is dropped, and the index is left unloaded.
+    dtl_index_array_destroy(index->src_rows, src_size);
+    dtl_index_array_destroy(index->tgt_rows, tgt_size);
+    dtl_index_array_destroy(index->tgt_offsets, index->num_tgt_keys + 1);
+    dtl_index_array_destroy(index->tgt_entries, index->size);
+    dtl_index_array_destroy(index->src_offsets, index->num_src_keys + 1);
+    dtl_index_array_destroy(index->src_entries, index->size);
+    *index = (struct dtl_lineage_index){0};
+    return NULL;
+}
+
+static void
+dtl_lineage_index_clear(struct dtl_lineage_index *index) {
+    if (index->src_rows != NULL) {
+        dtl_index_array_destroy(index->src_rows, index->size);
+    }
+    if (index->tgt_rows != NULL) {
+        dtl_index_array_destroy(index->tgt_rows, index->size);
+    }
+    if (index->tgt_offsets != NULL) {
+        dtl_index_array_destroy(index->tgt_offsets, index->num_tgt_keys + 1);
+        dtl_index_array_destroy(index->tgt_entries, index->size);
+    }
+    if (index->src_offsets != NULL) {
+        dtl_index_array_destroy(index->src_offsets, index->num_src_keys + 1);
+        dtl_index_array_destroy(index->src_entries, index->size);
+    }
+}
+
+/* --- Rows ------------------------------------------------------------------------------------- */
+
+static void
+dtl_lineage_rows_append(struct dtl_lineage_rows *rows, size_t const *entries, size_t const *lookup, size_t count) {
+    size_t i;
+
+    if (count == 0) {
+        return;
+    }
+
+    rows->rows = realloc(rows->rows, sizeof(size_t) * (rows->num_rows + count));
+    for (i = 0; i < count; i++) {
+        rows->rows[rows->num_rows + i] = lookup != NULL ? lookup[entries[i]] : entries[i];
+    }
+    rows->num_rows += count;
+}
+
+// Appends the rows of the source that are linked to row `row` of the target.
+static void
+dtl_lineage_index_find_sources(struct dtl_lineage_index *index, size_t row, struct dtl_lineage_rows *out) {
+    if (index->tgt_rows == NULL) {
+        if (row < index->size) {
+            dtl_lineage_rows_append(out, &row, index->src_rows, 1);
+        }
+        return;
+    }
+    if (row < index->num_tgt_keys) {
+        dtl_lineage_rows_append(
+            out,
+            &index->tgt_entries[index->tgt_offsets[row]],
+            index->src_rows,
+            index->tgt_offsets[row + 1] - index->tgt_offsets[row]
+        );
+    }
+}
+
+// Appends the rows of the target that are linked to row `row` of the source.
+static void
+dtl_lineage_index_find_targets(struct dtl_lineage_index *index, size_t row, struct dtl_lineage_rows *out) {
+    if (index->src_rows == NULL) {
+        if (row < index->size) {
+            dtl_lineage_rows_append(out, &row, index->tgt_rows, 1);
+        }
+        return;
+    }
+    if (row < index->num_src_keys) {
+        dtl_lineage_rows_append(
+            out,
+            &index->src_entries[index->src_offsets[row]],
+            index->tgt_rows,
+            index->src_offsets[row + 1] - index->src_offsets[row]
+        );
+    }
+}
+
+static int
+dtl_lineage_compare_rows(void const *a, void const *b) {
+    size_t row_a = *(size_t const *)a;
+    size_t row_b = *(size_t const *)b;
+
+    return (row_a > row_b) - (row_a < row_b);
+}
+
+static void
+dtl_lineage_rows_sort(struct dtl_lineage_rows *rows) {
+    size_t num_unique = 0;
+    size_t i;
+
+    if (rows->num_rows == 0) {
+        return;
+    }
+
+    qsort(rows->rows, rows->num_rows, sizeof(size_t), dtl_lineage_compare_rows);
+    for (i = 0; i < rows->num_rows; i++) {
+        if (num_unique == 0 || rows->rows[num_unique - 1] != rows->rows[i]) {
+            rows->rows[num_unique++] = rows->rows[i];
+        }
+    }
+    rows->num_rows = num_unique;
+}
+
+// Keeps only the rows that are also in `other`.  Both must be sorted.
+static void
+dtl_lineage_rows_intersect(struct dtl_lineage_rows *rows, struct dtl_lineage_rows const *other) {
+    size_t num_kept = 0;
+    size_t i;
+    size_t j = 0;
+
+    for (i = 0; i < rows->num_rows; i++) {
+        while (j < other->num_rows && other->rows[j] < rows->rows[i]) {
+            j++;
+        }
+        if (j < other->num_rows && other->rows[j] == rows->rows[i]) {
+            rows->rows[num_kept++] = rows->rows[i];
+        }
+    }
+    rows->num_rows = num_kept;
+}
+
+/* --- Values ----------------------------------------------------------------------------------- */
+
+static struct dtl_lineage_value *
+dtl_lineage_get_value(struct dtl_lineage *lineage, size_t array, struct dtl_error **error) {
+    struct dtl_lineage_value *value;
+    struct dtl_lineage_value loaded = {.array = array};
+    size_t i;
+
+    for (i = 0; i < lineage->num_values; i++) {
+        if (lineage->values[i].array == array) {
+            return &lineage->values[i];
+        }
+    }
+
+    if (dtl_io_trace_reader_read_value(
+            lineage->reader, array, &loaded.found, &loaded.dtype, &loaded.size, &loaded.value, error
+        ) != DTL_STATUS_OK) {
+        return NULL;
+    }
+
+    for (i = 0; i < lineage->manifest->num_samples; i++) {
+        if (lineage->manifest->samples[i].array != array) {
+            continue;
+        }
+        if (dtl_io_trace_reader_read_index_array(
+                lineage->reader,
+                lineage->manifest->samples[i].rows_array,
+                &loaded.sample_rows,
+                &loaded.num_sample_rows,
+                error
+            ) != DTL_STATUS_OK) {
+            if (loaded.found) {
+                dtl_lineage_clear_value(&loaded.value, loaded.dtype, loaded.size);
+            }
+            return NULL;
+        }
+        break;
+    }
+
+    lineage->num_values += 1;
+    lineage->values = realloc(lineage->values, sizeof(struct dtl_lineage_value) * lineage->num_values);
+
+    value = &lineage->values[lineage->num_values - 1];
+    *value = loaded;
+    return value;
+}
+
+// Returns the position of row `row` of the full array in the recorded value, or `SIZE_MAX` if it
+// wasn't recorded.
+static size_t
+dtl_lineage_value_find_row(struct dtl_lineage_value const *value, size_t row) {
+    size_t const *found;
+
+    if (value->sample_rows == NULL) {
+        return value->found && row < value->size ? row : SIZE_MAX;
+    }
+
+    found = bsearch(&row, value->sample_rows, value->num_sample_rows, sizeof(size_t), dtl_lineage_compare_rows);
+    return found != NULL ? (size_t)(found - value->sample_rows) : SIZE_MAX;
+}
+
+// Gathers the values of the column's rows, if they were all recorded.
+static enum dtl_status
+dtl_lineage_column_load_values(
+    struct dtl_lineage *lineage, struct dtl_lineage_column *column, struct dtl_error **error
+) {
+    struct dtl_lineage_value *value;
+    size_t *positions;
+    void *bool_array;
+    int64_t *int64_array;
+    double *double_array;
+    size_t i;
+
+    value = dtl_lineage_get_value(lineage, column->array, error);
+    if (value == NULL) {
+        return DTL_STATUS_ERROR;
+    }
+    if (!value->found) {
+        return DTL_STATUS_OK;
+    }
+
+    positions = calloc(column->num_rows + 1, sizeof(size_t));
+    for (i = 0; i < column->num_rows; i++) {
+        positions[i] = dtl_lineage_value_find_row(value, column->rows[i]);
+        if (positions[i] == SIZE_MAX) {
+            free(positions);
+            return DTL_STATUS_OK;
+        }
+    }
+
+    switch (value->dtype) {
+    case DTL_DTYPE_BOOL_ARRAY:
+        bool_array = dtl_bool_array_create(column->num_rows);
+        for (i = 0; i < column->num_rows; i++) {
+            dtl_bool_array_set(bool_array, i, dtl_bool_array_get(dtl_value_get_bool_array(&value->value), positions[i]));
+        }
+        dtl_value_take_bool_array(&column->values, bool_array);
+        break;
+
+    case DTL_DTYPE_INT64_ARRAY:
+        int64_array = dtl_int64_array_create(column->num_rows);
+        for (i = 0; i < column->num_rows; i++) {
+            int64_array[i] = dtl_value_get_int64_array(&value->value)[positions[i]];
+        }
+        dtl_value_take_int64_array(&column->values, int64_array);
+        break;
+
+    case DTL_DTYPE_DOUBLE_ARRAY:
+        double_array = dtl_double_array_create(column->num_rows);
+        for (i = 0; i < column->num_rows; i++) {
+            double_array[i] = dtl_value_get_double_array(&value->value)[positions[i]];
+        }
+        dtl_value_take_double_array(&column->values, double_array);
+        break;
+
+    default:
+        // Index arrays and masks aren't columns.
+        free(positions);
+        return DTL_STATUS_OK;
+    }
+
+    free(positions);
+
+    column->has_values = true;
+    column->dtype = value->dtype;
+    return DTL_STATUS_OK;
+}
+
+/* --- Lineage ---------------------------------------------------------------------------------- */
+
+struct dtl_lineage *
+dtl_lineage_create(struct dtl_io_trace_reader *reader, struct dtl_error **error) {
+    struct dtl_lineage *lineage;
+    struct dtl_manifest *manifest;
+
+    assert(reader != NULL);
+
+    manifest = dtl_io_trace_reader_read_manifest(reader, error);
+    if (manifest == NULL) {
+        return NULL;
+    }
+
+    lineage = calloc(1, sizeof(struct dtl_lineage));
+    lineage->reader = reader;
+    lineage->manifest = manifest;
+    lineage->indexes = calloc(manifest->num_mappings + 1, sizeof(struct dtl_lineage_index));
+
+    return lineage;
+}
+
+void
+dtl_lineage_destroy(struct dtl_lineage *lineage) {
+    size_t i;
+
+    if (lineage == NULL) {
+        return;
+    }
+
+    for (i = 0; i < lineage->manifest->num_mappings; i++) {
+        dtl_lineage_index_clear(&lineage->indexes[i]);
+    }
+    free(lineage->indexes);
+
+    for (i = 0; i < lineage->num_values; i++) {
+        if (lineage->values[i].found) {
+            dtl_lineage_clear_value(&lineage->values[i].value, lineage->values[i].dtype, lineage->values[i].size);
+        }
+        if (lineage->values[i].sample_rows != NULL) {
+            dtl_index_array_destroy(lineage->values[i].sample_rows, lineage->values[i].num_sample_rows);
+        }
+    }
+    free(lineage->values);
+
+    dtl_manifest_destroy(lineage->manifest);
+    free(lineage);
+}
+
+struct dtl_manifest const *
+dtl_lineage_get_manifest(struct dtl_lineage *lineage) {
+    assert(lineage != NULL);
+
+    return lineage->manifest;
+}
+
+static bool
+dtl_lineage_is_input(struct dtl_lineage *lineage, size_t array) {
+    size_t i;
+
+    for (i = 0; i < lineage->manifest->num_inputs; i++) {
+        if (lineage->manifest->inputs[i].array == array) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finds or adds the result column for an imported column or traced table expression.
+static struct dtl_lineage_column *
+dtl_lineage_result_get_column(
+    struct dtl_lineage_column **columns,
+    size_t *num_columns,
+    char const *table,
+    struct dtl_manifest_trace const *trace,
+    char const *column_name,
+    size_t array
+) {
+    struct dtl_lineage_column *column;
+    size_t i;
+
+    for (i = 0; i < *num_columns; i++) {
+        if ((*columns)[i].array == array && (*columns)[i].table == table && (*columns)[i].trace == trace) {
+            return &(*columns)[i];
+        }
+    }
+
+    *num_columns += 1;
+    *columns = realloc(*columns, sizeof(struct dtl_lineage_column) * *num_columns);
+
+    column = &(*columns)[*num_columns - 1];
+    *column = (struct dtl_lineage_column){
+        .table = table,
+        .trace = trace,
+        .column = column_name,
+        .array = array,
+    };
+    return column;
+}
+
+static void
+dtl_lineage_column_add_rows(struct dtl_lineage_column *column, struct dtl_lineage_rows const *rows) {
+    struct dtl_lineage_rows merged = {.num_rows = column->num_rows, .rows = column->rows};
+
+    dtl_lineage_rows_append(&merged, rows->rows, NULL, rows->num_rows);
+    dtl_lineage_rows_sort(&merged);
+
+    column->num_rows = merged.num_rows;
+    column->rows = merged.rows;
+}
+
+// Checks that the queried row exists, and was traced.
+static enum dtl_status
+dtl_lineage_check_row(
+    struct dtl_lineage *lineage, struct dtl_lineage_column const *output, size_t row, struct dtl_error **error
+) {
+    struct dtl_lineage_value *value;
+
+    value = dtl_lineage_get_value(lineage, output->array, error);
+    if (value == NULL) {
+        return DTL_STATUS_ERROR;
+    }
+
+    if (value->sample_rows != NULL) {
+        if (dtl_lineage_value_find_row(value, row) == SIZE_MAX) {
+            dtl_set_error(error, dtl_error_create("Row %zu of %s.%s was not sampled", row, output->table, output->column));
+            return DTL_STATUS_ERROR;
+        }
+        return DTL_STATUS_OK;
+    }
+
+    if (value->found && row >= value->size) {
+        dtl_set_error(
+            error,
+            dtl_error_create("Row %zu of %s.%s is out of range of its %zu rows", row, output->table, output->column, value->size)
+        );
+        return DTL_STATUS_ERROR;
+    }
+
+    return DTL_STATUS_OK;
+}
+
+// Follows every mapping into the queried column back to its source.
+static enum dtl_status
+dtl_lineage_find_direct(
+    struct dtl_lineage *lineage, struct dtl_lineage_result *result, size_t row, struct dtl_error **error
+) {
+    struct dtl_manifest *manifest = lineage->manifest;
+    struct dtl_manifest_mapping *mapping;
+    struct dtl_lineage_index *index;
+    struct dtl_lineage_rows rows;
+    struct dtl_lineage_column *column;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < manifest->num_mappings; i++) {
+        mapping = &manifest->mappings[i];
+        if (mapping->tgt_array != result->output.array) {
+            continue;
+        }
+
+        index = dtl_lineage_get_index(lineage, i, error);
+        if (index == NULL) {
+            return DTL_STATUS_ERROR;
+        }
+
+        rows = (struct dtl_lineage_rows){0};
+        dtl_lineage_index_find_sources(index, row, &rows);
+
+        for (j = 0; j < manifest->num_inputs; j++) {
+            if (manifest->inputs[j].array == mapping->src_array) {
+                column = dtl_lineage_result_get_column(
+                    &result->inputs,
+                    &result->num_inputs,
+                    manifest->inputs[j].table,
+                    NULL,
+                    manifest->inputs[j].column,
+                    mapping->src_array
+                );
+                dtl_lineage_column_add_rows(column, &rows);
+                break;
+            }
+        }
+
+        if (j == manifest->num_inputs) {
+            for (j = 0; j < manifest->num_traces; j++) {
+                if (manifest->traces[j].array == mapping->src_array) {
+                    column = dtl_lineage_result_get_column(
+                        &result->traces,
+                        &result->num_traces,
+                        NULL,
+                        &manifest->traces[j],
+                        manifest->traces[j].column,
+                        mapping->src_array
+                    );
+                    dtl_lineage_column_add_rows(column, &rows);
+                }
+            }
+        }
+
+        free(rows.rows);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+// Traced columns that aren't linked to the queried column directly are matched by the imported
+// rows that they share with it.  A row of the traced column is included if, for every import that
+// they both read from, it was computed from one of the queried row's rows.
+static enum dtl_status
+dtl_lineage_find_indirect(struct dtl_lineage *lineage, struct dtl_lineage_result *result, struct dtl_error **error) {
+    struct dtl_manifest *manifest = lineage->manifest;
+    struct dtl_manifest_trace *trace;
+    struct dtl_lineage_column *input;
+    struct dtl_lineage_column *column;
+    struct dtl_lineage_index *index;
+    struct dtl_lineage_rows candidates;
+    struct dtl_lineage_rows rows;
+    bool matched;
+    bool linked;
+    size_t num_traces = result->num_traces;
+    size_t i;
+    size_t j;
+    size_t k;
+    size_t m;
+
+    for (i = 0; i < manifest->num_traces; i++) {
+        trace = &manifest->traces[i];
+
+        if (trace->array == result->output.array || dtl_lineage_is_input(lineage, trace->array)) {
+            continue;
+        }
+        for (j = 0; j < num_traces; j++) {
+            if (result->traces[j].array == trace->array) {
+                break;
+            }
+        }
+        if (j < num_traces) {
+            continue;
+        }
+
+        candidates = (struct dtl_lineage_rows){0};
+        matched = false;
+
+        for (j = 0; j < result->num_inputs; j++) {
+            input = &result->inputs[j];
+            rows = (struct dtl_lineage_rows){0};
+            linked = false;
+
+            for (m = 0; m < manifest->num_mappings; m++) {
+                if (manifest->mappings[m].src_array != input->array || manifest->mappings[m].tgt_array != trace->array) {
+                    continue;
+                }
+
+                index = dtl_lineage_get_index(lineage, m, error);
+                if (index == NULL) {
+                    free(rows.rows);
+                    free(candidates.rows);
+                    return DTL_STATUS_ERROR;
+                }
+
+                linked = true;
+                for (k = 0; k < input->num_rows; k++) {
+                    dtl_lineage_index_find_targets(index, input->rows[k], &rows);
+                }
+            }
+
+            if (!linked) {
+                continue;
+            }
+
+            dtl_lineage_rows_sort(&rows);
+            if (matched) {
+                dtl_lineage_rows_intersect(&candidates, &rows);
+                free(rows.rows);
+            } else {
+                free(candidates.rows);
+                candidates = rows;
+                matched = true;
+            }
+        }
+
+        if (matched && candidates.num_rows > 0) {
+            column = dtl_lineage_result_get_column(
+                &result->traces, &result->num_traces, NULL, trace, trace->column, trace->array
+            );
+            dtl_lineage_column_add_rows(column, &candidates);
+        }
+        free(candidates.rows);
+    }
+
+    return DTL_STATUS_OK;
+}
+
+struct dtl_lineage_result *
+dtl_lineage_query(
+    struct dtl_lineage *lineage,
+    char const *table,
+    char const *column,
+    size_t row,
+    struct dtl_error **error
+) {
+    struct dtl_manifest *manifest;
+    struct dtl_lineage_result *result;
+    size_t i;
+
+    assert(lineage != NULL);
+    assert(table != NULL);
+    assert(column != NULL);
+
+    manifest = lineage->manifest;
+
+    for (i = 0; i < manifest->num_outputs; i++) {
+        if (strcmp(manifest->outputs[i].table, table) == 0 && strcmp(manifest->outputs[i].column, column) == 0) {
+            break;
+        }
+    }
+    if (i == manifest->num_outputs) {
+        dtl_set_error(error, dtl_error_create("No traced output column named %s.%s", table, column));
+        return NULL;
+    }
+
+    result = calloc(1, sizeof(struct dtl_lineage_result));
+    result->output = (struct dtl_lineage_column){
+        .table = manifest->outputs[i].table,
+        .column = manifest->outputs[i].column,
+        .array = manifest->outputs[i].array,
+        .num_rows = 1,
+        .rows = calloc(1, sizeof(size_t)),
+    };
+    result->output.rows[0] = row;
+
+    if (dtl_lineage_check_row(lineage, &result->output, row, error) != DTL_STATUS_OK) {
+        goto error;
+    }
+
+    if (dtl_lineage_find_direct(lineage, result, row, error) != DTL_STATUS_OK) {
+        goto error;
+    }
+
+    if (dtl_lineage_find_indirect(lineage, result, error) != DTL_STATUS_OK) {
+        goto error;
+    }
+
+    if (dtl_lineage_column_load_values(lineage, &result->output, error) != DTL_STATUS_OK) {
+        goto error;
+    }
+    for (i = 0; i < result->num_inputs; i++) {
+        if (dtl_lineage_column_load_values(lineage, &result->inputs[i], error) != DTL_STATUS_OK) {
+            goto error;
+        }
+    }
+    for (i = 0; i < result->num_traces; i++) {
+        if (dtl_lineage_column_load_values(lineage, &result->traces[i], error) != DTL_STATUS_OK) {
+            goto error;
+        }
+    }
+
+    return result;
+
+error:
+    dtl_lineage_result_destroy(result);
+    return NULL;
+}
+
+static void
+dtl_lineage_column_clear(struct dtl_lineage_column *column) {
+    if (column->has_values) {
+        dtl_lineage_clear_value(&column->values, column->dtype, column->num_rows);
+    }
+    free(column->rows);
+}
+
+void
+dtl_lineage_result_destroy(struct dtl_lineage_result *result) {
+    size_t i;
+
+    if (result == NULL) {
+        return;
+    }
+
+    dtl_lineage_column_clear(&result->output);
+    for (i = 0; i < result->num_inputs; i++) {
+        dtl_lineage_column_clear(&result->inputs[i]);
+    }
+    free(result->inputs);
+    for (i = 0; i < result->num_traces; i++) {
+        dtl_lineage_column_clear(&result->traces[i]);
+    }
+    free(result->traces);
+    free(result);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dtl-dtype.h"
+#include "dtl-error.h"
+#include "dtl-io.h"
+#include "dtl-manifest.h"
+#include "dtl-value.h"
+
+// Answers "where did this row come from" questions about a recorded trace.
+//
+// Mappings are recorded as pairs of index arrays, with entry `i` linking row `src_index[i]` of the
+// source to row `tgt_index[i]` of the target.  Looking up the rows linked to a row of the target
+// needs the entries to be grouped by target row, and looking up the rows linked to a row of the
+// source needs them grouped by source row.  Both groupings are stored in compressed sparse row
+// form: an array of offsets, with one entry per row plus one, delimiting runs of entries in a
+// second array, so that a lookup costs two reads however many rows share a key.  Identity index
+// arrays need no grouping at all.
+//
+// Groupings are built when the trace is written, and are recorded alongside the mappings.  They
+// are read the first time that a query passes through a mapping and are then kept, along with any
+// values that are read, until the lineage is destroyed.
+struct dtl_lineage;
+
+// Rows of a single traced column.
+struct dtl_lineage_column {
+    // Name of the imported or exported table.  NULL for traced table expressions.
+    char const *table;
+
+    // The traced table expression.  NULL for imported and exported tables.
+    struct dtl_manifest_trace const *trace;
+
+    char const *column;
+    size_t array;
+
+    // Sorted, without duplicates.
+    size_t num_rows;
+    size_t *rows;
+
+    // Values of each of the rows.  Only set if every one of them was recorded.
+    bool has_values;
+    enum dtl_dtype dtype;
+    struct dtl_value values;
+};
+
+struct dtl_lineage_result {
+    // The queried row.
+    struct dtl_lineage_column output;
+
+    // Rows of imported columns that the output row was computed from.
+    size_t num_inputs;
+    struct dtl_lineage_column *inputs;
+
+    // Rows of traced intermediate columns that were computed from the same imported rows.
+    size_t num_traces;
+    struct dtl_lineage_column *traces;
+};
+
+// Reads the manifest from `reader`, which must outlive the lineage.  Mappings and values are only
+// read as queries need them.
+struct dtl_lineage *
+dtl_lineage_create(struct dtl_io_trace_reader *reader, struct dtl_error **error);
+
+void
+dtl_lineage_destroy(struct dtl_lineage *lineage);
+
+struct dtl_manifest const *
+dtl_lineage_get_manifest(struct dtl_lineage *lineage);
+
+// Finds the rows that contributed to row `row` of column `column` of exported table `table`.
+// Names in the result point into the lineage's manifest.
+struct dtl_lineage_result *
+dtl_lineage_query(
+    struct dtl_lineage *lineage,
+    char const *table,
+    char const *column,
+    size_t row,
+    struct dtl_error **error
+);
+
+void
+dtl_lineage_result_destroy(struct dtl_lineage_result *result);
@@ -1,10 +1,77 @@
 #include "dtl-manifest.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+
+#include "dtl-error.h"
+
+// A manifest file starts with a fixed size header that locates each of the sections that follow it.
+// Every integer is 64 bits wide and in native byte order, and every section starts on an eight byte
+// boundary.  The first section holds all strings, NUL terminated, and records refer to strings by
+// their offset into it.  The rest are arrays of fixed size records.  Mapping, sample and grouping
+// records have the same layout as `struct dtl_manifest_mapping`, `struct dtl_manifest_sample` and
+// `struct dtl_manifest_grouping`.
+#define DTL_MANIFEST_MAGIC "DTLMANIF"
+#define DTL_MANIFEST_VERSION 2
+#define DTL_MANIFEST_BYTE_ORDER 0x0102030405060708
+
+struct dtl_manifest_file_section {
+    uint64_t offset;
+
+    // Number of records, or, for the string table, number of bytes.
+    uint64_t size;
+};
+
+struct dtl_manifest_file_header {
+    char magic[8];
+    uint64_t version;
+    uint64_t byte_order;
+
+    struct dtl_manifest_file_section strings;
+    struct dtl_manifest_file_section sources;
+    struct dtl_manifest_file_section inputs;
+    struct dtl_manifest_file_section outputs;
+    struct dtl_manifest_file_section traces;
+    struct dtl_manifest_file_section mappings;
+    struct dtl_manifest_file_section samples;
+    struct dtl_manifest_file_section groupings;
+};
+
+struct dtl_manifest_file_source {
+    uint64_t text;
+    uint64_t filename;
+};
+
+struct dtl_manifest_file_column {
+    uint64_t table;
+    uint64_t column;
+    uint64_t array;
+};
+
+struct dtl_manifest_file_trace {
+    uint64_t filename;
+    uint64_t start_offset;
+    uint64_t end_offset;
+    uint64_t column;
+    uint64_t array;
+};
+
+static_assert(sizeof(size_t) == sizeof(uint64_t), "manifest files assume 64 bit sizes");
+static_assert(sizeof(struct dtl_manifest_mapping) == 4 * sizeof(uint64_t), "mapping records are used in place");
+static_assert(sizeof(struct dtl_manifest_sample) == 2 * sizeof(uint64_t), "sample records are used in place");
+static_assert(sizeof(struct dtl_manifest_grouping) == 3 * sizeof(uint64_t), "grouping records are used in place");
 
 struct dtl_manifest *
 dtl_manifest_create(void) {
@@ -17,12 +84,34 @@ dtl_manifest_destroy(struct dtl_manifest *manifest) {
 
     assert(manifest != NULL);
 
+    if (manifest->data != NULL) {
+        free(manifest->sources);
+        free(manifest->inputs);
+        free(manifest->outputs);
+        free(manifest->traces);
+        munmap(manifest->data, manifest->data_size);
+        free(manifest);
+        return;
+    }
+
     for (i = 0; i < manifest->num_sources; i++) {
         free(manifest->sources[i].text);
         free(manifest->sources[i].filename);
     }
     free(manifest->sources);
 
+    for (i = 0; i < manifest->num_inputs; i++) {
+        free(manifest->inputs[i].table);
+        free(manifest->inputs[i].column);
+    }
+    free(manifest->inputs);
+
+    for (i = 0; i < manifest->num_outputs; i++) {
+        free(manifest->outputs[i].table);
+        free(manifest->outputs[i].column);
+    }
+    free(manifest->outputs);
+
     for (i = 0; i < manifest->num_traces; i++) {
         free(manifest->traces[i].filename);
         free(manifest->traces[i].column);
@@ -30,6 +119,8 @@ dtl_manifest_destroy(struct dtl_manifest *manifest) {
     free(manifest->traces);
 
     free(manifest->mappings);
+    free(manifest->samples);
+    free(manifest->groupings);
 
     free(manifest);
 }
@@ -39,6 +130,7 @@ dtl_manifest_add_source(struct dtl_manifest *manifest, char const *text, char co
     struct dtl_manifest_source *source;
 
     assert(manifest != NULL);
+    assert(manifest->data == NULL);
     assert(text != NULL);
     assert(filename != NULL);
 
@@ -50,18 +142,51 @@ dtl_manifest_add_source(struct dtl_manifest *manifest, char const *text, char co
     source->filename = strdup(filename);
 }
 
+static void
+dtl_manifest_column_init(struct dtl_manifest_column *column, char const *table_name, char const *column_name, size_t array) {
+    assert(table_name != NULL);
+    assert(column_name != NULL);
+
+    column->table = strdup(table_name);
+    column->column = strdup(column_name);
+    column->array = array;
+}
+
+void
+dtl_manifest_add_input(struct dtl_manifest *manifest, char const *table, char const *column, size_t array) {
+    assert(manifest != NULL);
+    assert(manifest->data == NULL);
+
+    manifest->num_inputs += 1;
+    manifest->inputs = realloc(manifest->inputs, sizeof(struct dtl_manifest_column) * manifest->num_inputs);
+
+    dtl_manifest_column_init(&manifest->inputs[manifest->num_inputs - 1], table, column, array);
+}
+
+void
+dtl_manifest_add_output(struct dtl_manifest *manifest, char const *table, char const *column, size_t array) {
+    assert(manifest != NULL);
+    assert(manifest->data == NULL);
+
+    manifest->num_outputs += 1;
+    manifest->outputs = realloc(manifest->outputs, sizeof(struct dtl_manifest_column) * manifest->num_outputs);
+
+    dtl_manifest_column_init(&manifest->outputs[manifest->num_outputs - 1], table, column, array);
+}
+
 void
 dtl_manifest_add_trace(
     struct dtl_manifest *manifest,
-    char *filename,
+    char const *filename,
     size_t start_offset,
     size_t end_offset,
-    char *column,
+    char const *column,
     size_t array
 ) {
     struct dtl_manifest_trace *trace;
 
     assert(manifest != NULL);
+    assert(manifest->data == NULL);
     assert(filename != NULL);
     assert(start_offset < end_offset);
     assert(column != NULL);
@@ -88,6 +213,7 @@ dtl_manifest_add_mapping(
     struct dtl_manifest_mapping *mapping;
 
     assert(manifest != NULL);
+    assert(manifest->data == NULL);
     assert(tgt_array > src_array);
     assert(src_index_array >= -1);
     assert(tgt_index_array >= -1);
@@ -101,3 +227,363 @@ dtl_manifest_add_mapping(
     mapping->src_index_array = src_index_array;
     mapping->tgt_index_array = tgt_index_array;
 }
+
+void
+dtl_manifest_add_sample(struct dtl_manifest *manifest, size_t array, size_t rows_array) {
+    assert(manifest != NULL);
+    assert(manifest->data == NULL);
+
+    manifest->num_samples += 1;
+    manifest->samples = realloc(manifest->samples, sizeof(struct dtl_manifest_sample) * manifest->num_samples);
+
+    manifest->samples[manifest->num_samples - 1] = (struct dtl_manifest_sample){
+        .array = array,
+        .rows_array = rows_array,
+    };
+}
+
+void
+dtl_manifest_add_grouping(struct dtl_manifest *manifest, size_t array, size_t offsets_array, size_t entries_array) {
+    assert(manifest != NULL);
+    assert(manifest->data == NULL);
+
+    manifest->num_groupings += 1;
+    manifest->groupings = realloc(manifest->groupings, sizeof(struct dtl_manifest_grouping) * manifest->num_groupings);
+
+    manifest->groupings[manifest->num_groupings - 1] = (struct dtl_manifest_grouping){
+        .array = array,
+        .offsets_array = offsets_array,
+        .entries_array = entries_array,
+    };
+}
+
+static size_t
+dtl_manifest_file_align(size_t offset) {
+    return (offset + 7) & ~(size_t)7;
+}
+
+static void
+dtl_manifest_file_section_init(
+    struct dtl_manifest_file_section *section, size_t *offset, size_t record_size, size_t size
+) {
+    section->offset = *offset;
+    section->size = size;
+    *offset = dtl_manifest_file_align(*offset + record_size * size);
+}
+
+static uint64_t
+dtl_manifest_file_add_string(char *strings, size_t *strings_size, char const *string) {
+    uint64_t offset = *strings_size;
+    size_t length = strlen(string) + 1;
+
+    memcpy(strings + offset, string, length);
+    *strings_size += length;
+
+    return offset;
+}
+
+enum dtl_status
+dtl_manifest_write(struct dtl_manifest const *manifest, char const *path, struct dtl_error **error) {
+    struct dtl_manifest_file_header header = {0};
+    struct dtl_manifest_file_source *sources;
+    struct dtl_manifest_file_column *inputs;
+    struct dtl_manifest_file_column *outputs;
+    struct dtl_manifest_file_trace *traces;
+    char *strings;
+    size_t strings_size;
+    char *data;
+    size_t size;
+    FILE *file;
+    size_t i;
+    enum dtl_status status = DTL_STATUS_OK;
+
+    assert(manifest != NULL);
+    assert(path != NULL);
+
+    strings_size = 0;
+    for (i = 0; i < manifest->num_sources; i++) {
+        strings_size += strlen(manifest->sources[i].text) + 1;
+        strings_size += strlen(manifest->sources[i].filename) + 1;
+    }
+    for (i = 0; i < manifest->num_inputs; i++) {
+        strings_size += strlen(manifest->inputs[i].table) + 1;
+        strings_size += strlen(manifest->inputs[i].column) + 1;
+    }
+    for (i = 0; i < manifest->num_outputs; i++) {
+        strings_size += strlen(manifest->outputs[i].table) + 1;
+        strings_size += strlen(manifest->outputs[i].column) + 1;
+    }
+    for (i = 0; i < manifest->num_traces; i++) {
+        strings_size += strlen(manifest->traces[i].filename) + 1;
+        strings_size += strlen(manifest->traces[i].column) + 1;
+    }
+
+    memcpy(header.magic, DTL_MANIFEST_MAGIC, sizeof(header.magic));
+    header.version = DTL_MANIFEST_VERSION;
+    header.byte_order = DTL_MANIFEST_BYTE_ORDER;
+
+    size = sizeof(struct dtl_manifest_file_header);
+    dtl_manifest_file_section_init(&header.strings, &size, 1, strings_size);
+    dtl_manifest_file_section_init(
+        &header.sources, &size, sizeof(struct dtl_manifest_file_source), manifest->num_sources
+    );
+    dtl_manifest_file_section_init(
+        &header.inputs, &size, sizeof(struct dtl_manifest_file_column), manifest->num_inputs
+    );
+    dtl_manifest_file_section_init(
+        &header.outputs, &size, sizeof(struct dtl_manifest_file_column), manifest->num_outputs
+    );
+    dtl_manifest_file_section_init(
+        &header.traces, &size, sizeof(struct dtl_manifest_file_trace), manifest->num_traces
+    );
+    dtl_manifest_file_section_init(
+        &header.mappings, &size, sizeof(struct dtl_manifest_mapping), manifest->num_mappings
+    );
+    dtl_manifest_file_section_init(
+        &header.samples, &size, sizeof(struct dtl_manifest_sample), manifest->num_samples
+    );
+    dtl_manifest_file_section_init(
+        &header.groupings, &size, sizeof(struct dtl_manifest_grouping), manifest->num_groupings
+    );
+
+    data = calloc(1, size);
+    memcpy(data, &header, sizeof(struct dtl_manifest_file_header));
+
+    strings = data + header.strings.offset;
+    strings_size = 0;
+
+    sources = (struct dtl_manifest_file_source *)(data + header.sources.offset);
+    for (i = 0; i < manifest->num_sources; i++) {
+        sources[i].text = dtl_manifest_file_add_string(strings, &strings_size, manifest->sources[i].text);
+        sources[i].filename = dtl_manifest_file_add_string(strings, &strings_size, manifest->sources[i].filename);
+    }
+
+    inputs = (struct dtl_manifest_file_column *)(data + header.inputs.offset);
+    for (i = 0; i < manifest->num_inputs; i++) {
+        inputs[i].table = dtl_manifest_file_add_string(strings, &strings_size, manifest->inputs[i].table);
+        inputs[i].column = dtl_manifest_file_add_string(strings, &strings_size, manifest->inputs[i].column);
+        inputs[i].array = manifest->inputs[i].array;
+    }
+
+    outputs = (struct dtl_manifest_file_column *)(data + header.outputs.offset);
+    for (i = 0; i < manifest->num_outputs; i++) {
+        outputs[i].table = dtl_manifest_file_add_string(strings, &strings_size, manifest->outputs[i].table);
+        outputs[i].column = dtl_manifest_file_add_string(strings, &strings_size, manifest->outputs[i].column);
+        outputs[i].array = manifest->outputs[i].array;
+    }
+
+    traces = (struct dtl_manifest_file_trace *)(data + header.traces.offset);
+    for (i = 0; i < manifest->num_traces; i++) {
+        traces[i].filename = dtl_manifest_file_add_string(strings, &strings_size, manifest->traces[i].filename);
+        traces[i].start_offset = manifest->traces[i].start_offset;
+        traces[i].end_offset = manifest->traces[i].end_offset;
+        traces[i].column = dtl_manifest_file_add_string(strings, &strings_size, manifest->traces[i].column);
+        traces[i].array = manifest->traces[i].array;
+    }
+
+    assert(strings_size == header.strings.size);
+
+    if (manifest->num_mappings > 0) {
+        memcpy(
+            data + header.mappings.offset,
+            manifest->mappings,
+            sizeof(struct dtl_manifest_mapping) * manifest->num_mappings
+        );
+    }
+    if (manifest->num_samples > 0) {
+        memcpy(
+            data + header.samples.offset, manifest->samples, sizeof(struct dtl_manifest_sample) * manifest->num_samples
+        );
+    }
+    if (manifest->num_groupings > 0) {
+        memcpy(
+            data + header.groupings.offset,
+            manifest->groupings,
+            sizeof(struct dtl_manifest_grouping) * manifest->num_groupings
+        );
+    }
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        dtl_set_error(error, dtl_error_create("Could not open '%s': %s", path, strerror(errno)));
+        status = DTL_STATUS_ERROR;
+        goto cleanup;
+    }
+    if (fwrite(data, 1, size, file) != size) {
+        dtl_set_error(error, dtl_error_create("Could not write '%s': %s", path, strerror(errno)));
+        status = DTL_STATUS_ERROR;
+        fclose(file);
+        goto cleanup;
+    }
+    if (fclose(file) != 0) {
+        dtl_set_error(error, dtl_error_create("Could not write '%s': %s", path, strerror(errno)));
+        status = DTL_STATUS_ERROR;
+    }
+
+cleanup:
+    free(data);
+    return status;
+}
+
+static bool
+dtl_manifest_file_section_is_valid(
+    struct dtl_manifest_file_section const *section, size_t record_size, size_t data_size
+) {
+    return section->offset % 8 == 0 && section->offset <= data_size &&
+           section->size <= (data_size - section->offset) / record_size;
+}
+
+static char *
+dtl_manifest_file_get_string(char *strings, size_t strings_size, uint64_t offset) {
+    // The string table is checked to end with a NUL, so any string inside it is terminated.
+    return offset < strings_size ? strings + offset : NULL;
+}
+
+struct dtl_manifest *
+dtl_manifest_map(char const *path, struct dtl_error **error) {
+    struct dtl_manifest *manifest = NULL;
+    struct dtl_manifest_file_header const *header;
+    struct dtl_manifest_file_source const *sources;
+    struct dtl_manifest_file_column const *inputs;
+    struct dtl_manifest_file_column const *outputs;
+    struct dtl_manifest_file_trace const *traces;
+    char *strings;
+    size_t strings_size;
+    struct stat stat_buf;
+    char *data;
+    size_t data_size;
+    size_t i;
+    int fd;
+
+    assert(path != NULL);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        dtl_set_error(error, dtl_error_create("Could not open '%s': %s", path, strerror(errno)));
+        return NULL;
+    }
+
+    if (fstat(fd, &stat_buf) != 0) {
+        dtl_set_error(error, dtl_error_create("Could not read '%s': %s", path, strerror(errno)));
+        close(fd);
+        return NULL;
+    }
+    data_size = stat_buf.st_size;
+
+    if (data_size < sizeof(struct dtl_manifest_file_header)) {
+        dtl_set_error(error, dtl_error_create("'%s' is not a manifest", path));
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        dtl_set_error(error, dtl_error_create("Could not map '%s': %s", path, strerror(errno)));
+        return NULL;
+    }
+
+    header = (struct dtl_manifest_file_header const *)data;
+    if (memcmp(header->magic, DTL_MANIFEST_MAGIC, sizeof(header->magic)) != 0 ||
+        header->byte_order != DTL_MANIFEST_BYTE_ORDER) {
+        dtl_set_error(error, dtl_error_create("'%s' is not a manifest", path));
+        goto error;
+    }
+    if (header->version != DTL_MANIFEST_VERSION) {
+        dtl_set_error(
+            error, dtl_error_create("'%s' has unsupported manifest version %" PRIu64, path, header->version)
+        );
+        goto error;
+    }
+    if (!dtl_manifest_file_section_is_valid(&header->strings, 1, data_size) ||
+        !dtl_manifest_file_section_is_valid(&header->sources, sizeof(struct dtl_manifest_file_source), data_size) ||
+        !dtl_manifest_file_section_is_valid(&header->inputs, sizeof(struct dtl_manifest_file_column), data_size) ||
+        !dtl_manifest_file_section_is_valid(&header->outputs, sizeof(struct dtl_manifest_file_column), data_size) ||
+        !dtl_manifest_file_section_is_valid(&header->traces, sizeof(struct dtl_manifest_file_trace), data_size) ||
+        !dtl_manifest_file_section_is_valid(&header->mappings, sizeof(struct dtl_manifest_mapping), data_size) ||
+        !dtl_manifest_file_section_is_valid(&header->samples, sizeof(struct dtl_manifest_sample), data_size) ||
+        !dtl_manifest_file_section_is_valid(&header->groupings, sizeof(struct dtl_manifest_grouping), data_size)) {
+        goto corrupt;
+    }
+
+    strings = data + header->strings.offset;
+    strings_size = header->strings.size;
+    if (strings_size > 0 && strings[strings_size - 1] != '\0') {
+        goto corrupt;
+    }
+
+    manifest = calloc(1, sizeof(struct dtl_manifest));
+    manifest->data = data;
+    manifest->data_size = data_size;
+
+    sources = (struct dtl_manifest_file_source const *)(data + header->sources.offset);
+    manifest->num_sources = header->sources.size;
+    manifest->sources = calloc(manifest->num_sources, sizeof(struct dtl_manifest_source));
+    for (i = 0; i < manifest->num_sources; i++) {
+        manifest->sources[i].text = dtl_manifest_file_get_string(strings, strings_size, sources[i].text);
+        manifest->sources[i].filename = dtl_manifest_file_get_string(strings, strings_size, sources[i].filename);
+        if (manifest->sources[i].text == NULL || manifest->sources[i].filename == NULL) {
+            goto corrupt;
+        }
+    }
+
+    inputs = (struct dtl_manifest_file_column const *)(data + header->inputs.offset);
+    manifest->num_inputs = header->inputs.size;
+    manifest->inputs = calloc(manifest->num_inputs, sizeof(struct dtl_manifest_column));
+    for (i = 0; i < manifest->num_inputs; i++) {
+        manifest->inputs[i].table = dtl_manifest_file_get_string(strings, strings_size, inputs[i].table);
+        manifest->inputs[i].column = dtl_manifest_file_get_string(strings, strings_size, inputs[i].column);
+        manifest->inputs[i].array = inputs[i].array;
+        if (manifest->inputs[i].table == NULL || manifest->inputs[i].column == NULL) {
+            goto corrupt;
+        }
+    }
+
+    outputs = (struct dtl_manifest_file_column const *)(data + header->outputs.offset);
+    manifest->num_outputs = header->outputs.size;
+    manifest->outputs = calloc(manifest->num_outputs, sizeof(struct dtl_manifest_column));
+    for (i = 0; i < manifest->num_outputs; i++) {
+        manifest->outputs[i].table = dtl_manifest_file_get_string(strings, strings_size, outputs[i].table);
+        manifest->outputs[i].column = dtl_manifest_file_get_string(strings, strings_size, outputs[i].column);
+        manifest->outputs[i].array = outputs[i].array;
+        if (manifest->outputs[i].table == NULL || manifest->outputs[i].column == NULL) {
+            goto corrupt;
+        }
+    }
+
+    traces = (struct dtl_manifest_file_trace const *)(data + header->traces.offset);
+    manifest->num_traces = header->traces.size;
+    manifest->traces = calloc(manifest->num_traces, sizeof(struct dtl_manifest_trace));
+    for (i = 0; i < manifest->num_traces; i++) {
+        manifest->traces[i].filename = dtl_manifest_file_get_string(strings, strings_size, traces[i].filename);
+        manifest->traces[i].start_offset = traces[i].start_offset;
+        manifest->traces[i].end_offset = traces[i].end_offset;
+        manifest->traces[i].column = dtl_manifest_file_get_string(strings, strings_size, traces[i].column);
+        manifest->traces[i].array = traces[i].array;
+        if (manifest->traces[i].filename == NULL || manifest->traces[i].column == NULL) {
+            goto corrupt;
+        }
+    }
+
+    manifest->num_mappings = header->mappings.size;
+    manifest->mappings = (struct dtl_manifest_mapping *)(data + header->mappings.offset);
+
+    manifest->num_samples = header->samples.size;
+    manifest->samples = (struct dtl_manifest_sample *)(data + header->samples.offset);
+
+    manifest->num_groupings = header->groupings.size;
+    manifest->groupings = (struct dtl_manifest_grouping *)(data + header->groupings.offset);
+
+    return manifest;
+
+corrupt:
+    dtl_set_error(error, dtl_error_create("'%s' is truncated or corrupt", path));
+
+error:
+    if (manifest != NULL) {
+        dtl_manifest_destroy(manifest);
+    } else {
+        munmap(data, data_size);
+    }
+    return NULL;
+}
@@ -3,11 +3,20 @@
 #include <stddef.h>
 #include <sys/types.h>
 
+#include "dtl-error.h"
+
 struct dtl_manifest_source {
     char *text;
     char *filename;
 };
 
+// A column of an imported or exported table.
+struct dtl_manifest_column {
+    char *table;
+    char *column;
+    size_t array;
+};
+
 struct dtl_manifest_trace {
     char *filename;
     size_t start_offset;
@@ -20,19 +29,52 @@ struct dtl_manifest_mapping {
     size_t src_array;
     size_t tgt_array;
 
+    // -1 if rows map to the rows at the same index.
     ssize_t src_index_array;
     ssize_t tgt_index_array;
 };
 
+// An array that was only traced for a sample of its rows.  Row `i` of the array is row
+// `rows_array[i]` of the full array.
+struct dtl_manifest_sample {
+    size_t array;
+    size_t rows_array;
+};
+
+// The entries of index array `array` grouped by the rows that they point to.  The entries pointing
+// to row `r` are `entries_array[offsets_array[r]]` up to `entries_array[offsets_array[r + 1]]`.
+struct dtl_manifest_grouping {
+    size_t array;
+    size_t offsets_array;
+    size_t entries_array;
+};
+
 struct dtl_manifest {
     struct dtl_manifest_source *sources;
     size_t num_sources;
 
+    struct dtl_manifest_column *inputs;
+    size_t num_inputs;
+
+    struct dtl_manifest_column *outputs;
+    size_t num_outputs;
+
     struct dtl_manifest_trace *traces;
     size_t num_traces;
 
     struct dtl_manifest_mapping *mappings;
     size_t num_mappings;
+
+    struct dtl_manifest_sample *samples;
+    size_t num_samples;
+
+    struct dtl_manifest_grouping *groupings;
+    size_t num_groupings;
+
+    // Set if the manifest was mapped from a file by `dtl_manifest_map`, in which case names,
+    // mappings, samples and groupings point into the mapped file and the manifest can not be added to.
+    void *data;
+    size_t data_size;
 };
 
 struct dtl_manifest *
@@ -44,13 +86,19 @@ dtl_manifest_destroy(struct dtl_manifest *manifest);
 void
 dtl_manifest_add_source(struct dtl_manifest *manifest, char const *text, char const *filename);
 
+void
+dtl_manifest_add_input(struct dtl_manifest *manifest, char const *table, char const *column, size_t array);
+
+void
+dtl_manifest_add_output(struct dtl_manifest *manifest, char const *table, char const *column, size_t array);
+
 void
 dtl_manifest_add_trace(
     struct dtl_manifest *manifest,
-    char *filename,
+    char const *filename,
     size_t start_offset,
     size_t end_offset,
-    char *column,
+    char const *column,
     size_t array
 );
 
@@ -62,3 +110,19 @@ dtl_manifest_add_mapping(
     ssize_t src_index_array,
     ssize_t tgt_index_array
 );
+
+void
+dtl_manifest_add_sample(struct dtl_manifest *manifest, size_t array, size_t rows_array);
+
+void
+dtl_manifest_add_grouping(struct dtl_manifest *manifest, size_t array, size_t offsets_array, size_t entries_array);
+
+// Writes `manifest` to `path` in a flat binary layout that `dtl_manifest_map` can read back without
+// any parsing.  The file is only readable on machines with the same byte order.
+enum dtl_status
+dtl_manifest_write(struct dtl_manifest const *manifest, char const *path, struct dtl_error **error);
+
+// Maps a manifest written by `dtl_manifest_write` into memory.  Strings, mappings, samples and
+// groupings are used in place, so opening a manifest only costs a pass over its sources, columns and traces.
+struct dtl_manifest *
+dtl_manifest_map(char const *path, struct dtl_error **error);
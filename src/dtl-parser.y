@@ -12,6 +12,7 @@
     #include "dtl-parser.h"
 
     #include <stdbool.h>
+    #include <stdint.h>
     #include <stdlib.h>
     #include <string.h>
 
@@ -257,6 +258,7 @@
 %type <node> name;
 
 %type <node> literal;
+%type <node> integer;
 %type <node> string;
 
 %type <node> column_name;
@@ -346,9 +348,34 @@ name
     ;
 
 literal
-    : string {
+    : integer {
         $$ = $1;
     }
+    | string {
+        $$ = $1;
+    }
+    ;
+
+integer
+    : INT {
+        size_t start = $1.start.offset;
+        size_t end = $1.end.offset;
+        char const *input = dtl_tokenizer_get_input(tokenizer);
+
+        int64_t value = 0;
+        for (size_t i = start; i < end; i++) {
+            if (
+                __builtin_mul_overflow(value, 10, &value) ||
+                __builtin_add_overflow(value, input[i] - '0', &value)
+            ) {
+                dtl_set_error(error, dtl_error_create("Integer literal out of range"));
+                YYABORT;
+            }
+        }
+
+        $$ = dtl_ast_int_literal_node_create(value);
+        dtl_ast_node_update_bounds($$, $1.start, $1.end);
+    }
     ;
 
 string
@@ -1,6 +1,7 @@
 #include "dtl-schema.h"
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
@@ -57,6 +58,41 @@ dtl_schema_get_column_dtype(struct dtl_schema *schema, size_t index) {
     return schema->columns[index].dtype;
 }
 
+struct dtl_schema *
+dtl_schema_copy(struct dtl_schema *schema) {
+    struct dtl_schema *copy;
+    size_t i;
+
+    assert(schema != NULL);
+
+    copy = dtl_schema_create();
+    for (i = 0; i < schema->num_columns; i++) {
+        copy = dtl_schema_add_column(copy, schema->columns[i].name, schema->columns[i].dtype);
+    }
+    return copy;
+}
+
+bool
+dtl_schema_equal(struct dtl_schema *a, struct dtl_schema *b) {
+    size_t i;
+
+    assert(a != NULL);
+    assert(b != NULL);
+
+    if (a->num_columns != b->num_columns) {
+        return false;
+    }
+    for (i = 0; i < a->num_columns; i++) {
+        if (a->columns[i].dtype != b->columns[i].dtype) {
+            return false;
+        }
+        if (strcmp(a->columns[i].name, b->columns[i].name) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void
 dtl_schema_destroy(struct dtl_schema *schema) {
     size_t i;
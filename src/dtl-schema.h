@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #include "dtl-dtype.h"
@@ -21,5 +22,12 @@ dtl_schema_get_column_name(struct dtl_schema *schema, size_t index);
 enum dtl_dtype
 dtl_schema_get_column_dtype(struct dtl_schema *schema, size_t index);
 
+struct dtl_schema *
+dtl_schema_copy(struct dtl_schema *schema);
+
+// Schemas are equal if they have the same column names and types, in the same order.
+bool
+dtl_schema_equal(struct dtl_schema *a, struct dtl_schema *b);
+
 void
 dtl_schema_destroy(struct dtl_schema *schema);
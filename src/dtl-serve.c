@@ -0,0 +1,497 @@
+#include "dtl-serve.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dtl-error.h"
+#include "dtl-eval.h"
+#include "dtl-io-cache.h"
+#include "dtl-io.h"
+
+// Requests are small, so anything longer than this is assumed to be garbage.
+#define DTL_SERVE_MAX_REQUEST_SIZE (64 * 1024)
+
+// Number of compiled plans to keep around for reuse.
+#define DTL_SERVE_MAX_PLANS 256
+
+struct dtl_serve_plan {
+    char *source;
+    struct dtl_program *program;
+
+    // One reference is held by the server while the plan is in the list, and one by each job
+    // that is executing it.
+    size_t refcount;
+
+    struct dtl_serve_plan *next;
+};
+
+struct dtl_serve_connection {
+    int fd;
+    struct dtl_serve_connection *next;
+};
+
+struct dtl_serve {
+    struct dtl_serve_formats const *formats;
+    struct dtl_io_table_cache *cache;
+
+    pthread_mutex_t plans_mutex;
+    struct dtl_serve_plan *plans; // Most recently used first.
+    size_t num_plans;
+
+    pthread_mutex_t queue_mutex;
+    pthread_cond_t queue_ready;
+    struct dtl_serve_connection *queue_head;
+    struct dtl_serve_connection *queue_tail;
+};
+
+/* === Plans ==================================================================================== */
+
+// At most one plan is kept for each script.  A plan that no longer matches the schemas of the
+// inputs it is run against is replaced with a newly compiled one.
+
+static void
+dtl_serve_plan_release(struct dtl_serve *server, struct dtl_serve_plan *plan) {
+    bool last;
+
+    pthread_mutex_lock(&server->plans_mutex);
+    assert(plan->refcount > 0);
+    plan->refcount -= 1;
+    last = plan->refcount == 0;
+    pthread_mutex_unlock(&server->plans_mutex);
+
+    if (last) {
+        dtl_program_destroy(plan->program);
+        free(plan->source);
+        free(plan);
+    }
+}
+
+// Removes `plan` from the list, returning false if it had already been removed.  Must be called
+// with the mutex held.
+static bool
+dtl_serve_plan_unlink(struct dtl_serve *server, struct dtl_serve_plan *plan) {
+    struct dtl_serve_plan **link;
+
+    for (link = &server->plans; *link != NULL; link = &(*link)->next) {
+        if (*link == plan) {
+            *link = plan->next;
+            plan->next = NULL;
+            server->num_plans -= 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Must be called with the mutex held.
+static void
+dtl_serve_plan_push_front(struct dtl_serve *server, struct dtl_serve_plan *plan) {
+    plan->next = server->plans;
+    server->plans = plan;
+    server->num_plans += 1;
+}
+
+// Returns a plan for `source` that can be executed against the tables in `importer`, compiling
+// one if there is no cached plan or the cached plan is stale.
+static struct dtl_serve_plan *
+dtl_serve_plan_acquire(
+    struct dtl_serve *server,
+    char const *source,
+    char const *filename,
+    struct dtl_io_importer *importer,
+    struct dtl_error **error
+) {
+    struct dtl_serve_plan *stale;
+    struct dtl_serve_plan *plan;
+    struct dtl_serve_plan *replaced;
+    struct dtl_serve_plan *evicted = NULL;
+
+    pthread_mutex_lock(&server->plans_mutex);
+    for (stale = server->plans; stale != NULL; stale = stale->next) {
+        if (strcmp(stale->source, source) == 0) {
+            stale->refcount += 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&server->plans_mutex);
+
+    // Checking the plan against the inputs opens tables, so is done without the lock held.
+    if (stale != NULL && dtl_program_matches_inputs(stale->program, importer)) {
+        pthread_mutex_lock(&server->plans_mutex);
+        if (dtl_serve_plan_unlink(server, stale)) {
+            dtl_serve_plan_push_front(server, stale);
+        }
+        pthread_mutex_unlock(&server->plans_mutex);
+        return stale;
+    }
+
+    plan = calloc(1, sizeof(struct dtl_serve_plan));
+    plan->program = dtl_compile(source, filename, importer, error);
+    if (plan->program == NULL) {
+        // The old plan is kept, as the inputs that it didn't match may simply be broken.
+        free(plan);
+        if (stale != NULL) {
+            dtl_serve_plan_release(server, stale);
+        }
+        return NULL;
+    }
+    plan->source = strdup(source);
+    plan->refcount = 2;
+
+    // Another job may have compiled the same script in the meantime, which is replaced either way.
+    pthread_mutex_lock(&server->plans_mutex);
+    for (replaced = server->plans; replaced != NULL; replaced = replaced->next) {
+        if (strcmp(replaced->source, source) == 0) {
+            dtl_serve_plan_unlink(server, replaced);
+            break;
+        }
+    }
+    dtl_serve_plan_push_front(server, plan);
+    if (server->num_plans > DTL_SERVE_MAX_PLANS) {
+        for (evicted = server->plans; evicted->next != NULL; evicted = evicted->next) {
+        }
+        dtl_serve_plan_unlink(server, evicted);
+    }
+    pthread_mutex_unlock(&server->plans_mutex);
+
+    if (stale != NULL) {
+        dtl_serve_plan_release(server, stale);
+    }
+    if (replaced != NULL) {
+        dtl_serve_plan_release(server, replaced);
+    }
+    if (evicted != NULL) {
+        dtl_serve_plan_release(server, evicted);
+    }
+
+    return plan;
+}
+
+/* === Jobs ===================================================================================== */
+
+static char *
+dtl_serve_read_file(char const *path, struct dtl_error **error) {
+    FILE *file;
+    char *buffer = NULL;
+    size_t capacity = 1024;
+    size_t size = 0;
+    size_t n;
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        dtl_set_error(error, dtl_error_create("Could not open '%s': %s", path, strerror(errno)));
+        return NULL;
+    }
+
+    buffer = malloc(capacity);
+    while (true) {
+        if (size == capacity - 1) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+        }
+
+        n = fread(buffer + size, 1, capacity - size - 1, file);
+        size += n;
+        if (n == 0) {
+            break;
+        }
+    }
+
+    if (ferror(file)) {
+        dtl_set_error(error, dtl_error_create("Could not read '%s'", path));
+        fclose(file);
+        free(buffer);
+        return NULL;
+    }
+    fclose(file);
+
+    buffer[size] = '\0';
+    return buffer;
+}
+
+static enum dtl_status
+dtl_serve_run_job(
+    struct dtl_serve *server,
+    char const *script_path,
+    char const *input_path,
+    char const *output_path,
+    struct dtl_error **error
+) {
+    struct dtl_serve_formats const *formats = server->formats;
+    struct dtl_io_importer *inner_importer;
+    struct dtl_io_importer *importer;
+    struct dtl_io_exporter *exporter;
+    struct dtl_serve_plan *plan;
+    char *source;
+    enum dtl_status status;
+
+    source = dtl_serve_read_file(script_path, error);
+    if (source == NULL) {
+        return DTL_STATUS_ERROR;
+    }
+
+    exporter = formats->create_exporter(output_path, error, formats->user_data);
+    if (exporter == NULL) {
+        free(source);
+        return DTL_STATUS_ERROR;
+    }
+
+    inner_importer = formats->create_importer(input_path, formats->user_data);
+    importer = dtl_io_cache_importer_create(server->cache, inner_importer, input_path, formats->get_table_path);
+
+    status = DTL_STATUS_ERROR;
+    plan = dtl_serve_plan_acquire(server, source, script_path, importer, error);
+    if (plan != NULL) {
+        status = dtl_program_execute(plan->program, importer, exporter, NULL, error);
+        dtl_serve_plan_release(server, plan);
+    }
+
+    dtl_io_cache_importer_destroy(importer);
+    formats->destroy_importer(inner_importer, formats->user_data);
+    formats->destroy_exporter(exporter, formats->user_data);
+    free(source);
+
+    return status;
+}
+
+// Reads a request of three newline terminated paths.  Returns false if the client hung up or sent
+// something that isn't a request.
+static bool
+dtl_serve_read_request(int fd, char **buffer, char *fields[3]) {
+    size_t capacity = 1024;
+    size_t size = 0;
+    size_t num_fields = 0;
+    char *start;
+    char *end;
+    ssize_t n;
+
+    *buffer = malloc(capacity);
+    while (true) {
+        if (size == capacity) {
+            if (capacity >= DTL_SERVE_MAX_REQUEST_SIZE) {
+                return false;
+            }
+            capacity *= 2;
+            *buffer = realloc(*buffer, capacity);
+        }
+
+        n = read(fd, *buffer + size, capacity - size);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        size += n;
+
+        num_fields = 0;
+        for (start = *buffer; num_fields < 3; start = end + 1) {
+            end = memchr(start, '\n', *buffer + size - start);
+            if (end == NULL) {
+                break;
+            }
+            fields[num_fields++] = start;
+        }
+        if (num_fields == 3) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < 3; i++) {
+        *strchr(fields[i], '\n') = '\0';
+    }
+    return true;
+}
+
+static void
+dtl_serve_write_reply(int fd, char const *reply) {
+    size_t length = strlen(reply);
+    ssize_t n;
+
+    // The client may have hung up, which should not take down the server.
+    while (length > 0) {
+        n = send(fd, reply, length, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        reply += n;
+        length -= n;
+    }
+}
+
+static void
+dtl_serve_handle_connection(struct dtl_serve *server, int fd) {
+    char *buffer = NULL;
+    char *fields[3];
+    struct dtl_error *error = NULL;
+    char *reply;
+    enum dtl_status status;
+
+    if (!dtl_serve_read_request(fd, &buffer, fields)) {
+        dtl_serve_write_reply(fd, "error: malformed request\n");
+        free(buffer);
+        return;
+    }
+
+    status = dtl_serve_run_job(server, fields[0], fields[1], fields[2], &error);
+    if (status == DTL_STATUS_OK) {
+        dtl_serve_write_reply(fd, "ok\n");
+    } else {
+        if (asprintf(&reply, "error: %s\n", error != NULL ? error->message : "unknown error") >= 0) {
+            dtl_serve_write_reply(fd, reply);
+            free(reply);
+        }
+        dtl_clear_error(&error);
+    }
+
+    free(buffer);
+}
+
+/* === Workers ================================================================================== */
+
+static void *
+dtl_serve_worker(void *user_data) {
+    struct dtl_serve *server = (struct dtl_serve *)user_data;
+    struct dtl_serve_connection *connection;
+
+    while (true) {
+        pthread_mutex_lock(&server->queue_mutex);
+        while (server->queue_head == NULL) {
+            pthread_cond_wait(&server->queue_ready, &server->queue_mutex);
+        }
+        connection = server->queue_head;
+        server->queue_head = connection->next;
+        if (server->queue_head == NULL) {
+            server->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&server->queue_mutex);
+
+        dtl_serve_handle_connection(server, connection->fd);
+        close(connection->fd);
+        free(connection);
+    }
+
+    return NULL;
+}
+
+static void
+dtl_serve_enqueue(struct dtl_serve *server, int fd) {
+    struct dtl_serve_connection *connection;
+
+    connection = calloc(1, sizeof(struct dtl_serve_connection));
+    connection->fd = fd;
+
+    pthread_mutex_lock(&server->queue_mutex);
+    if (server->queue_tail != NULL) {
+        server->queue_tail->next = connection;
+    } else {
+        server->queue_head = connection;
+    }
+    server->queue_tail = connection;
+    pthread_cond_signal(&server->queue_ready);
+    pthread_mutex_unlock(&server->queue_mutex);
+}
+
+/* === Server =================================================================================== */
+
+enum dtl_status
+dtl_serve(
+    char const *socket_path,
+    size_t num_threads,
+    size_t cache_size,
+    struct dtl_serve_formats const *formats,
+    struct dtl_error **error
+) {
+    struct dtl_serve server = {0};
+    struct sockaddr_un address = {0};
+    struct timespec backoff = {.tv_sec = 0, .tv_nsec = 100 * 1000 * 1000};
+    pthread_t thread;
+    size_t num_started = 0;
+    int listen_fd;
+    int fd;
+    size_t i;
+
+    assert(socket_path != NULL);
+    assert(formats != NULL);
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        dtl_set_error(error, dtl_error_create("Socket path '%s' is too long", socket_path));
+        return DTL_STATUS_ERROR;
+    }
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        dtl_set_error(error, dtl_error_create("Could not create socket: %s", strerror(errno)));
+        return DTL_STATUS_ERROR;
+    }
+
+    // Left behind by a server that was killed.
+    unlink(socket_path);
+
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, SOMAXCONN) != 0) {
+        dtl_set_error(error, dtl_error_create("Could not listen on '%s': %s", socket_path, strerror(errno)));
+        close(listen_fd);
+        return DTL_STATUS_ERROR;
+    }
+
+    server.formats = formats;
+    server.cache = dtl_io_table_cache_create(cache_size);
+    pthread_mutex_init(&server.plans_mutex, NULL);
+    pthread_mutex_init(&server.queue_mutex, NULL);
+    pthread_cond_init(&server.queue_ready, NULL);
+
+    for (i = 0; i < (num_threads > 0 ? num_threads : 1); i++) {
+        if (pthread_create(&thread, NULL, dtl_serve_worker, &server) == 0) {
+            pthread_detach(thread);
+            num_started += 1;
+        }
+    }
+    if (num_started == 0) {
+        dtl_set_error(error, dtl_error_create("Could not start worker threads"));
+        close(listen_fd);
+        return DTL_STATUS_ERROR;
+    }
+
+    while (true) {
+        fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd == -1) {
+            switch (errno) {
+            case EINTR:
+            case EAGAIN:
+            case ECONNABORTED:
+            case EPROTO:
+                // Specific to the connection that failed.
+                continue;
+            case EMFILE:
+            case ENFILE:
+            case ENOBUFS:
+            case ENOMEM:
+                // Out of resources.  The connection stays in the backlog, so retrying straight
+                // away would spin until a running job frees something up.
+                nanosleep(&backoff, NULL);
+                continue;
+            default:
+                dtl_set_error(error, dtl_error_create("Could not accept connection: %s", strerror(errno)));
+                close(listen_fd);
+                return DTL_STATUS_ERROR;
+            }
+        }
+        dtl_serve_enqueue(&server, fd);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "dtl-error.h"
+#include "dtl-io.h"
+
+// Runs DTL as a resident process that takes jobs over a unix domain socket.  Each connection
+// carries a single job, sent as three newline terminated lines giving the path of the script,
+// the input directory and the output directory.  The server replies with a single line, either
+// `ok` or `error: ` followed by a message, once the job has finished.
+//
+// Jobs run concurrently on a fixed pool of threads.  Input tables are read through a shared
+// in-memory cache, and compiled plans are reused between jobs that run the same script against
+// inputs with the same schemas.
+
+struct dtl_serve_formats {
+    // Creates the importer used to read the tables in `input_path` for a single job.
+    struct dtl_io_importer *(*create_importer)(char const *input_path, void *user_data);
+    void (*destroy_importer)(struct dtl_io_importer *importer, void *user_data);
+
+    // Creates the exporter used to write a single job's outputs to `output_path`.
+    struct dtl_io_exporter *(*create_exporter)(char const *output_path, struct dtl_error **error, void *user_data);
+    void (*destroy_exporter)(struct dtl_io_exporter *exporter, void *user_data);
+
+    // Returns the path of the file that a table will be read from.  Used to key the table cache.
+    char *(*get_table_path)(char const *input_path, char const *name);
+
+    void *user_data;
+};
+
+// Listens on `socket_path`, replacing any existing file, and serves jobs until the process is
+// killed.  Only returns if the socket can't be set up, or if accepting connections fails for a
+// reason other than a lack of resources.  `cache_size` is the number of bytes of
+// decoded column data to keep cached.
+enum dtl_status
+dtl_serve(
+    char const *socket_path,
+    size_t num_threads,
+    size_t cache_size,
+    struct dtl_serve_formats const *formats,
+    struct dtl_error **error
+);
@@ -0,0 +1,260 @@
+#include "dtl-trace-encoding.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "dtl-bool-array.h"
+
+struct dtl_trace_segment *
+dtl_trace_segment_create(size_t capacity) {
+    struct dtl_trace_segment *segment;
+
+    segment = calloc(1, sizeof(struct dtl_trace_segment));
+    segment->starts = calloc(capacity, sizeof(int64_t));
+    segment->steps = calloc(capacity, sizeof(int64_t));
+    // A mask that starts with true needs an extra, empty, leading run.
+    segment->counts = calloc(capacity + 1, sizeof(uint32_t));
+    segment->values = calloc(capacity, sizeof(int64_t));
+    segment->words = calloc((capacity + 63) / 64, sizeof(uint64_t));
+    segment->capacity = capacity;
+
+    return segment;
+}
+
+void
+dtl_trace_segment_destroy(struct dtl_trace_segment *segment) {
+    if (segment == NULL) {
+        return;
+    }
+    free(segment->starts);
+    free(segment->steps);
+    free(segment->counts);
+    free(segment->values);
+    free(segment->words);
+    free(segment);
+}
+
+void
+dtl_trace_encode_index_segment(struct dtl_trace_segment *segment, size_t const *indexes, size_t length) {
+    size_t num_sequences;
+    size_t sequences_size;
+    size_t offsets_size;
+    size_t plain_size;
+    size_t min;
+    size_t max;
+    size_t count;
+    int64_t step;
+    size_t i;
+
+    assert(length <= segment->capacity);
+    assert(length <= UINT32_MAX);
+
+    segment->length = length;
+
+    // Greedily split the segment into arithmetic sequences.  Each sequence is started by the next
+    // two values, so sorted indexes without any structure will cost one sequence for every pair.
+    num_sequences = 0;
+    i = 0;
+    while (i < length) {
+        step = 0;
+        count = 1;
+        if (i + 1 < length) {
+            step = (int64_t)(indexes[i + 1] - indexes[i]);
+            count = 2;
+            while (i + count < length && (int64_t)(indexes[i + count] - indexes[i + count - 1]) == step) {
+                count++;
+            }
+        }
+        segment->starts[num_sequences] = (int64_t)indexes[i];
+        segment->steps[num_sequences] = step;
+        segment->counts[num_sequences] = (uint32_t)count;
+        num_sequences++;
+        i += count;
+    }
+
+    min = SIZE_MAX;
+    max = 0;
+    for (i = 0; i < length; i++) {
+        min = indexes[i] < min ? indexes[i] : min;
+        max = indexes[i] > max ? indexes[i] : max;
+    }
+
+    sequences_size = num_sequences * (sizeof(int64_t) + sizeof(int64_t) + sizeof(uint32_t));
+    offsets_size = length == 0 || max - min <= UINT32_MAX ? length * sizeof(uint32_t) : SIZE_MAX;
+    plain_size = length * sizeof(int64_t);
+
+    if (sequences_size <= offsets_size && sequences_size <= plain_size) {
+        segment->encoding = DTL_TRACE_ENCODING_SEQUENCES;
+        segment->num_entries = num_sequences;
+        return;
+    }
+
+    if (offsets_size <= plain_size) {
+        segment->encoding = DTL_TRACE_ENCODING_OFFSETS;
+        segment->num_entries = length;
+        segment->base = (int64_t)min;
+        for (i = 0; i < length; i++) {
+            segment->counts[i] = (uint32_t)(indexes[i] - min);
+        }
+        return;
+    }
+
+    segment->encoding = DTL_TRACE_ENCODING_PLAIN;
+    segment->num_entries = length;
+    for (i = 0; i < length; i++) {
+        segment->values[i] = (int64_t)indexes[i];
+    }
+}
+
+void
+dtl_trace_decode_index_segment(struct dtl_trace_segment const *segment, size_t *indexes) {
+    size_t i;
+    size_t j;
+    size_t k;
+
+    switch (segment->encoding) {
+    case DTL_TRACE_ENCODING_SEQUENCES:
+        k = 0;
+        for (i = 0; i < segment->num_entries; i++) {
+            for (j = 0; j < segment->counts[i]; j++) {
+                indexes[k++] = (size_t)segment->starts[i] + (size_t)segment->steps[i] * j;
+            }
+        }
+        assert(k == segment->length);
+        break;
+
+    case DTL_TRACE_ENCODING_OFFSETS:
+        for (i = 0; i < segment->length; i++) {
+            indexes[i] = (size_t)segment->base + segment->counts[i];
+        }
+        break;
+
+    case DTL_TRACE_ENCODING_PLAIN:
+        for (i = 0; i < segment->length; i++) {
+            indexes[i] = (size_t)segment->values[i];
+        }
+        break;
+
+    default:
+        assert(false);
+    }
+}
+
+void
+dtl_trace_encode_mask_segment(struct dtl_trace_segment *segment, void const *mask, size_t offset, size_t length) {
+    size_t num_runs;
+    size_t num_positions;
+    size_t runs_size;
+    size_t positions_size;
+    size_t bitmap_size;
+    bool previous;
+    bool value;
+    size_t run;
+    size_t i;
+
+    assert(length <= segment->capacity);
+    assert(length <= UINT32_MAX);
+
+    segment->length = length;
+
+    // Runs alternate starting with false, so a mask that starts with true begins with an empty
+    // run.
+    num_runs = 0;
+    num_positions = 0;
+    previous = false;
+    for (i = 0; i < length; i++) {
+        value = dtl_bool_array_get(mask, offset + i);
+        if (i == 0 || value != previous) {
+            num_runs += i == 0 && value ? 2 : 1;
+        }
+        num_positions += value ? 1 : 0;
+        previous = value;
+    }
+
+    runs_size = num_runs * sizeof(uint32_t);
+    positions_size = num_positions * sizeof(uint32_t);
+    bitmap_size = ((length + 63) / 64) * sizeof(uint64_t);
+
+    if (runs_size <= positions_size && runs_size <= bitmap_size) {
+        segment->encoding = DTL_TRACE_ENCODING_RUNS;
+        segment->num_entries = 0;
+        previous = false;
+        run = 0;
+        for (i = 0; i < length; i++) {
+            value = dtl_bool_array_get(mask, offset + i);
+            if (value != previous) {
+                segment->counts[segment->num_entries++] = (uint32_t)run;
+                run = 0;
+            }
+            run++;
+            previous = value;
+        }
+        if (run > 0) {
+            segment->counts[segment->num_entries++] = (uint32_t)run;
+        }
+        assert(segment->num_entries == num_runs);
+        return;
+    }
+
+    if (positions_size <= bitmap_size) {
+        segment->encoding = DTL_TRACE_ENCODING_POSITIONS;
+        segment->num_entries = 0;
+        for (i = 0; i < length; i++) {
+            if (dtl_bool_array_get(mask, offset + i)) {
+                segment->counts[segment->num_entries++] = (uint32_t)i;
+            }
+        }
+        return;
+    }
+
+    segment->encoding = DTL_TRACE_ENCODING_BITMAP;
+    segment->num_entries = (length + 63) / 64;
+    for (i = 0; i < segment->num_entries; i++) {
+        segment->words[i] = 0;
+    }
+    for (i = 0; i < length; i++) {
+        if (dtl_bool_array_get(mask, offset + i)) {
+            segment->words[i / 64] |= ((uint64_t)1) << (i % 64);
+        }
+    }
+}
+
+void
+dtl_trace_decode_mask_segment(struct dtl_trace_segment const *segment, void *mask, size_t offset) {
+    size_t i;
+    size_t j;
+    size_t k;
+
+    switch (segment->encoding) {
+    case DTL_TRACE_ENCODING_RUNS:
+        k = offset;
+        for (i = 0; i < segment->num_entries; i++) {
+            for (j = 0; j < segment->counts[i]; j++) {
+                dtl_bool_array_set(mask, k++, i % 2 == 1);
+            }
+        }
+        assert(k == offset + segment->length);
+        break;
+
+    case DTL_TRACE_ENCODING_POSITIONS:
+        for (i = 0; i < segment->length; i++) {
+            dtl_bool_array_set(mask, offset + i, false);
+        }
+        for (i = 0; i < segment->num_entries; i++) {
+            dtl_bool_array_set(mask, offset + segment->counts[i], true);
+        }
+        break;
+
+    case DTL_TRACE_ENCODING_BITMAP:
+        for (i = 0; i < segment->length; i++) {
+            dtl_bool_array_set(mask, offset + i, (segment->words[i / 64] >> (i % 64)) & 1);
+        }
+        break;
+
+    default:
+        assert(false);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Index arrays and masks written by tracers are highly structured, so rather than being stored as
+// is they are split into segments that are each stored using whichever of a small set of encodings
+// suits their contents best.  Segments can be decoded independently of one another, so readers
+// only need to expand the parts of an array that they actually look at.  All of the encodings are
+// simple enough to also be expanded by a query.
+
+enum dtl_trace_encoding {
+    // Index arrays.  `SEQUENCES` stores runs of arithmetic sequences as a start, step and count
+    // each, which covers identity picks, repeated indexes from the left side of a join and tiled
+    // indexes from the right.  `OFFSETS` stores a base plus 32 bit offsets, which suits sorted
+    // indexes from `where`.  `PLAIN` is the fallback.
+    DTL_TRACE_ENCODING_SEQUENCES,
+    DTL_TRACE_ENCODING_OFFSETS,
+    DTL_TRACE_ENCODING_PLAIN,
+
+    // Masks, in the style of roaring bitmap containers.  `RUNS` stores the lengths of alternating
+    // runs of false and true values, starting with false.  `POSITIONS` stores the offsets of true
+    // values.  `BITMAP` stores every value.
+    DTL_TRACE_ENCODING_RUNS,
+    DTL_TRACE_ENCODING_POSITIONS,
+    DTL_TRACE_ENCODING_BITMAP,
+};
+
+// Only the arrays used by the segment's encoding are meaningful.
+struct dtl_trace_segment {
+    enum dtl_trace_encoding encoding;
+
+    // Number of values in the segment.
+    size_t length;
+
+    // Number of sequences, runs, offsets, positions or words.
+    size_t num_entries;
+
+    int64_t base;      // `OFFSETS`.
+    int64_t *starts;   // `SEQUENCES`.
+    int64_t *steps;    // `SEQUENCES`.
+    uint32_t *counts;  // `SEQUENCES`, `OFFSETS`, `RUNS` and `POSITIONS`.
+    int64_t *values;   // `PLAIN`.
+    uint64_t *words;   // `BITMAP`, 64 values per word, least significant bit first.
+
+    size_t capacity;
+};
+
+// Creates a segment that can hold up to `capacity` values.
+struct dtl_trace_segment *
+dtl_trace_segment_create(size_t capacity);
+
+void
+dtl_trace_segment_destroy(struct dtl_trace_segment *segment);
+
+void
+dtl_trace_encode_index_segment(struct dtl_trace_segment *segment, size_t const *indexes, size_t length);
+
+void
+dtl_trace_decode_index_segment(struct dtl_trace_segment const *segment, size_t *indexes);
+
+// Encodes `length` values from `mask`, a bool array, starting at `offset`.
+void
+dtl_trace_encode_mask_segment(struct dtl_trace_segment *segment, void const *mask, size_t offset, size_t length);
+
+// Decodes the segment into `mask`, a bool array, starting at `offset`.
+void
+dtl_trace_decode_mask_segment(struct dtl_trace_segment const *segment, void *mask, size_t offset);
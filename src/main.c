@@ -1,18 +1,37 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <getopt.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "dtl-bool-array.h"
+#include "dtl-dtype.h"
 #include "dtl-error.h"
 #include "dtl-eval.h"
+#include "dtl-io-async.h"
+#include "dtl-io-csv.h"
 #include "dtl-io-duckdb.h"
 #include "dtl-io-filesystem.h"
+#include "dtl-io-ipc.h"
+#include "dtl-io-sampled.h"
 #include "dtl-io.h"
+#include "dtl-lineage.h"
+#include "dtl-manifest.h"
+#include "dtl-schema.h"
+#include "dtl-serve.h"
+#include "dtl-value.h"
+
+// Maximum number of bytes of traced values waiting to be written to a DuckDB trace database.
+#define DTL_TRACE_QUEUE_SIZE (256 * 1024 * 1024)
 
 char *
 dtl_read_file(int f, struct dtl_error **error) {
@@ -67,28 +86,591 @@ dtl_print_error(struct dtl_error *error) {
     }
 }
 
+void
+dtl_print_usage(char const *program) {
+    fprintf(
+        stderr,
+        "usage: %s [OPTIONS] SCRIPT INPUT OUTPUT [TRACE]\n"
+        "       %s [OPTIONS] serve SOCKET\n"
+        "       %s [OPTIONS] lineage TRACE TABLE COLUMN ROW\n"
+        "\n"
+        "options:\n"
+        "  --mmap                      read inputs through a memory mapping\n"
+        "  --bloom-filter COLUMN       write bloom filters for columns named COLUMN\n"
+        "  --row-group-size ROWS       maximum number of rows in each output row group\n"
+        "  --compression CODEC         compress outputs with CODEC, e.g. zstd or snappy\n"
+        "  --compression-level LEVEL   codec specific compression level\n"
+        "  --no-dictionary             disable dictionary encoding of outputs\n"
+        "  --no-statistics             do not write column statistics to outputs\n"
+        "  --ipc-compression CODEC     compress .arrow and .feather outputs with lz4 or zstd\n"
+        "  --plan-cache DIR            reuse compiled plans stored in DIR\n"
+        "  --threads N                 number of jobs to run at once when serving\n"
+        "  --cache-size BYTES          memory to use for caching inputs when serving\n"
+        "  --trace-sample RATE         only trace a fraction RATE of exported rows\n"
+        "  --trace-format FORMAT       store TRACE as duckdb (the default) or filesystem\n"
+        "\n"
+        "Tables named *.arrow or *.feather are stored as Arrow IPC files, and all\n"
+        "other tables as Parquet files with a .parquet extension.  Tables named\n"
+        "*.csv are imported from comma separated files with a header row.\n"
+        "\n"
+        "TRACE is a DuckDB database, or with `--trace-format filesystem`, a\n"
+        "directory that gets a Parquet manifest and an Arrow IPC file for each\n"
+        "traced array.\n"
+        "\n"
+        "When serving, jobs are read from connections to SOCKET as three lines\n"
+        "giving SCRIPT, INPUT and OUTPUT.  Each job gets a reply of `ok` or\n"
+        "`error: MESSAGE` once it has finished.\n"
+        "\n"
+        "The lineage command prints the rows that ROW of an exported COLUMN was\n"
+        "computed from, one per line, as tab separated KIND, TABLE, COLUMN, ROW and\n"
+        "VALUE fields.  KIND is one of `output`, `input` or `trace`.  Traced tables\n"
+        "are named by the location of their expression in the script.  VALUE is\n"
+        "empty if it wasn't recorded.\n",
+        program,
+        program,
+        program
+    );
+}
+
+bool
+dtl_parse_int(char const *s, long min, long max, long *out) {
+    char *end;
+    long value;
+
+    errno = 0;
+    value = strtol(s, &end, 10);
+    if (errno != 0 || end == s || *end != '\0' || value < min || value > max) {
+        return false;
+    }
+
+    *out = value;
+    return true;
+}
+
+// Parses a fraction greater than zero and at most one.
+bool
+dtl_parse_fraction(char const *s, double *out) {
+    char *end;
+    double value;
+
+    errno = 0;
+    value = strtod(s, &end);
+    if (errno != 0 || end == s || *end != '\0' || !(value > 0.0 && value <= 1.0)) {
+        return false;
+    }
+
+    *out = value;
+    return true;
+}
+
+// Tables are read from and written to Arrow IPC files if their names end in `.arrow` or
+// `.feather`, and to Parquet files otherwise.  Tables with names ending in `.csv` can also be
+// imported.
+bool
+dtl_has_extension(char const *name, char const *extension) {
+    size_t length = strlen(name);
+    size_t extension_length = strlen(extension);
+
+    return length > extension_length && strcmp(name + length - extension_length, extension) == 0;
+}
+
+bool
+dtl_is_ipc_table_name(char const *name) {
+    return dtl_has_extension(name, ".arrow") || dtl_has_extension(name, ".feather");
+}
+
+struct dtl_format_options {
+    bool memory_map;
+    char const **bloom_filter_columns;
+    size_t num_bloom_filter_columns;
+    long row_group_size;
+    char const *compression;
+    long compression_level;
+    bool has_compression_level;
+    bool dictionary;
+    bool statistics;
+    char const *ipc_compression;
+};
+
+struct dtl_format_importer {
+    struct dtl_io_importer base;
+    struct dtl_io_importer *parquet;
+    struct dtl_io_importer *ipc;
+    struct dtl_io_importer *csv;
+};
+
+struct dtl_io_table *
+dtl_format_importer_import_table(struct dtl_io_importer *importer, char const *name, struct dtl_error **error) {
+    struct dtl_format_importer *format_importer = (struct dtl_format_importer *)importer;
+
+    if (dtl_is_ipc_table_name(name)) {
+        return dtl_io_importer_import_table(format_importer->ipc, name, error);
+    }
+    if (dtl_has_extension(name, ".csv")) {
+        return dtl_io_importer_import_table(format_importer->csv, name, error);
+    }
+    return dtl_io_importer_import_table(format_importer->parquet, name, error);
+}
+
+struct dtl_io_importer *
+dtl_format_importer_create(char const *input_path, struct dtl_format_options const *options) {
+    struct dtl_format_importer *format_importer;
+
+    format_importer = calloc(1, sizeof(struct dtl_format_importer));
+    format_importer->base.import_table = dtl_format_importer_import_table;
+
+    format_importer->parquet = dtl_io_filesystem_importer_create(input_path);
+    dtl_io_filesystem_importer_set_memory_map(format_importer->parquet, options->memory_map);
+    format_importer->ipc = dtl_io_ipc_importer_create(input_path);
+    format_importer->csv = dtl_io_csv_importer_create(input_path);
+
+    return &format_importer->base;
+}
+
+void
+dtl_format_importer_destroy(struct dtl_io_importer *importer) {
+    struct dtl_format_importer *format_importer = (struct dtl_format_importer *)importer;
+
+    dtl_io_csv_importer_destroy(format_importer->csv);
+    dtl_io_ipc_importer_destroy(format_importer->ipc);
+    dtl_io_filesystem_importer_destroy(format_importer->parquet);
+    free(format_importer);
+}
+
+// Returns the path of the file that the format importer will read `name` from.
+char *
+dtl_format_table_path(char const *input_path, char const *name) {
+    char *path;
+    char const *extension = "";
+
+    if (!dtl_is_ipc_table_name(name) && !dtl_has_extension(name, ".csv")) {
+        extension = ".parquet";
+    }
+
+    if (asprintf(&path, "%s/%s%s", input_path, name, extension) < 0) {
+        return NULL;
+    }
+    return path;
+}
+
+struct dtl_format_exporter {
+    struct dtl_io_exporter base;
+    struct dtl_io_exporter *parquet;
+    struct dtl_io_exporter *ipc;
+};
+
+enum dtl_status
+dtl_format_exporter_export_table(
+    struct dtl_io_exporter *exporter,
+    char const *name,
+    struct dtl_schema *schema,
+    size_t num_rows,
+    struct dtl_value **values,
+    struct dtl_error **error
+) {
+    struct dtl_format_exporter *format_exporter = (struct dtl_format_exporter *)exporter;
+
+    if (dtl_is_ipc_table_name(name)) {
+        return dtl_io_exporter_export_table(format_exporter->ipc, name, schema, num_rows, values, error);
+    }
+    return dtl_io_exporter_export_table(format_exporter->parquet, name, schema, num_rows, values, error);
+}
+
+struct dtl_io_exporter *
+dtl_format_exporter_create(
+    char const *output_path, struct dtl_format_options const *options, struct dtl_error **error
+) {
+    struct dtl_format_exporter *format_exporter;
+    enum dtl_status status;
+
+    format_exporter = calloc(1, sizeof(struct dtl_format_exporter));
+    format_exporter->base.export_table = dtl_format_exporter_export_table;
+
+    format_exporter->parquet = dtl_io_filesystem_exporter_create(output_path);
+    for (size_t i = 0; i < options->num_bloom_filter_columns; i++) {
+        dtl_io_filesystem_exporter_add_bloom_filter(format_exporter->parquet, options->bloom_filter_columns[i]);
+    }
+    if (options->row_group_size != 0) {
+        dtl_io_filesystem_exporter_set_row_group_size(format_exporter->parquet, options->row_group_size);
+    }
+    if (options->compression != NULL) {
+        status = dtl_io_filesystem_exporter_set_compression(format_exporter->parquet, options->compression, error);
+        if (status != DTL_STATUS_OK) {
+            dtl_io_filesystem_exporter_destroy(format_exporter->parquet);
+            free(format_exporter);
+            return NULL;
+        }
+    }
+    if (options->has_compression_level) {
+        dtl_io_filesystem_exporter_set_compression_level(format_exporter->parquet, options->compression_level);
+    }
+    dtl_io_filesystem_exporter_set_dictionary(format_exporter->parquet, options->dictionary);
+    dtl_io_filesystem_exporter_set_statistics(format_exporter->parquet, options->statistics);
+
+    format_exporter->ipc = dtl_io_ipc_exporter_create(output_path);
+    if (options->ipc_compression != NULL) {
+        status = dtl_io_ipc_exporter_set_compression(format_exporter->ipc, options->ipc_compression, error);
+        if (status != DTL_STATUS_OK) {
+            dtl_io_ipc_exporter_destroy(format_exporter->ipc);
+            dtl_io_filesystem_exporter_destroy(format_exporter->parquet);
+            free(format_exporter);
+            return NULL;
+        }
+    }
+
+    return &format_exporter->base;
+}
+
+void
+dtl_format_exporter_destroy(struct dtl_io_exporter *exporter) {
+    struct dtl_format_exporter *format_exporter = (struct dtl_format_exporter *)exporter;
+
+    dtl_io_ipc_exporter_destroy(format_exporter->ipc);
+    dtl_io_filesystem_exporter_destroy(format_exporter->parquet);
+    free(format_exporter);
+}
+
+// Adapters for `dtl_serve`, which creates an importer and exporter for each job.
+struct dtl_io_importer *
+dtl_serve_create_importer(char const *input_path, void *user_data) {
+    return dtl_format_importer_create(input_path, (struct dtl_format_options const *)user_data);
+}
+
+void
+dtl_serve_destroy_importer(struct dtl_io_importer *importer, void *user_data) {
+    (void)user_data;
+    dtl_format_importer_destroy(importer);
+}
+
+struct dtl_io_exporter *
+dtl_serve_create_exporter(char const *output_path, struct dtl_error **error, void *user_data) {
+    return dtl_format_exporter_create(output_path, (struct dtl_format_options const *)user_data, error);
+}
+
+void
+dtl_serve_destroy_exporter(struct dtl_io_exporter *exporter, void *user_data) {
+    (void)user_data;
+    dtl_format_exporter_destroy(exporter);
+}
+
+// Prints the location of a traced table expression as `FILENAME:LINE:COLUMN`.  Falls back to the
+// byte offset if the script wasn't recorded.
+void
+dtl_print_trace_location(struct dtl_manifest const *manifest, struct dtl_manifest_trace const *trace) {
+    char const *text = NULL;
+    size_t lineno = 1;
+    size_t column = 1;
+    size_t i;
+
+    for (i = 0; i < manifest->num_sources; i++) {
+        if (strcmp(manifest->sources[i].filename, trace->filename) == 0) {
+            text = manifest->sources[i].text;
+            break;
+        }
+    }
+    if (text == NULL || strlen(text) < trace->end_offset) {
+        printf("%s@%zu-%zu", trace->filename, trace->start_offset, trace->end_offset);
+        return;
+    }
+
+    // Nested expressions can start at the same place, so both ends are needed to tell them apart.
+    for (i = 0; i <= trace->end_offset; i++) {
+        if (i == trace->start_offset) {
+            printf("%s:%zu:%zu-", trace->filename, lineno, column);
+        }
+        if (i == trace->end_offset) {
+            break;
+        }
+        if (text[i] == '\n') {
+            lineno++;
+            column = 1;
+        } else {
+            column++;
+        }
+    }
+    printf("%zu:%zu", lineno, column);
+}
+
+void
+dtl_print_lineage_column(
+    struct dtl_manifest const *manifest, char const *kind, struct dtl_lineage_column *column
+) {
+    size_t i;
+
+    for (i = 0; i < column->num_rows; i++) {
+        printf("%s\t", kind);
+        if (column->trace != NULL) {
+            dtl_print_trace_location(manifest, column->trace);
+        } else {
+            printf("%s", column->table);
+        }
+        printf("\t%s\t%zu\t", column->column, column->rows[i]);
+
+        if (column->has_values) {
+            switch (column->dtype) {
+            case DTL_DTYPE_BOOL_ARRAY:
+                printf("%s", dtl_bool_array_get(dtl_value_get_bool_array(&column->values), i) ? "true" : "false");
+                break;
+            case DTL_DTYPE_INT64_ARRAY:
+                printf("%" PRId64, dtl_value_get_int64_array(&column->values)[i]);
+                break;
+            case DTL_DTYPE_DOUBLE_ARRAY:
+                printf("%.17g", dtl_value_get_double_array(&column->values)[i]);
+                break;
+            default:
+                break;
+            }
+        }
+        printf("\n");
+    }
+}
+
+int
+dtl_lineage_main(
+    char const *trace_path, bool trace_filesystem, char const *table, char const *column, char const *row_string
+) {
+    struct dtl_io_trace_reader *reader;
+    struct dtl_lineage *lineage = NULL;
+    struct dtl_lineage_result *result = NULL;
+    struct dtl_manifest const *manifest;
+    struct dtl_error *error = NULL;
+    long row;
+    size_t i;
+    int exit_code = 1;
+
+    if (!dtl_parse_int(row_string, 0, LONG_MAX, &row)) {
+        fprintf(stderr, "error: invalid row: %s\n", row_string);
+        return 1;
+    }
+
+    if (trace_filesystem) {
+        reader = dtl_io_filesystem_trace_reader_create(trace_path);
+    } else {
+        reader = dtl_io_duckdb_trace_reader_create(trace_path, &error);
+    }
+    if (reader == NULL) {
+        goto cleanup;
+    }
+
+    lineage = dtl_lineage_create(reader, &error);
+    if (lineage == NULL) {
+        goto cleanup;
+    }
+
+    result = dtl_lineage_query(lineage, table, column, (size_t)row, &error);
+    if (result == NULL) {
+        goto cleanup;
+    }
+
+    manifest = dtl_lineage_get_manifest(lineage);
+    dtl_print_lineage_column(manifest, "output", &result->output);
+    for (i = 0; i < result->num_inputs; i++) {
+        dtl_print_lineage_column(manifest, "input", &result->inputs[i]);
+    }
+    for (i = 0; i < result->num_traces; i++) {
+        dtl_print_lineage_column(manifest, "trace", &result->traces[i]);
+    }
+
+    exit_code = 0;
+
+cleanup:
+    if (exit_code != 0) {
+        dtl_print_error(error);
+        dtl_clear_error(&error);
+    }
+    dtl_lineage_result_destroy(result);
+    dtl_lineage_destroy(lineage);
+    if (trace_filesystem) {
+        dtl_io_filesystem_trace_reader_destroy(reader);
+    } else {
+        dtl_io_duckdb_trace_reader_destroy(reader);
+    }
+    return exit_code;
+}
+
+enum {
+    DTL_OPTION_MMAP = 256,
+    DTL_OPTION_BLOOM_FILTER,
+    DTL_OPTION_ROW_GROUP_SIZE,
+    DTL_OPTION_COMPRESSION,
+    DTL_OPTION_COMPRESSION_LEVEL,
+    DTL_OPTION_NO_DICTIONARY,
+    DTL_OPTION_NO_STATISTICS,
+    DTL_OPTION_IPC_COMPRESSION,
+    DTL_OPTION_PLAN_CACHE,
+    DTL_OPTION_THREADS,
+    DTL_OPTION_CACHE_SIZE,
+    DTL_OPTION_TRACE_SAMPLE,
+    DTL_OPTION_TRACE_FORMAT,
+};
+
+static struct option const dtl_options[] = {
+    {"mmap", no_argument, NULL, DTL_OPTION_MMAP},
+    {"bloom-filter", required_argument, NULL, DTL_OPTION_BLOOM_FILTER},
+    {"row-group-size", required_argument, NULL, DTL_OPTION_ROW_GROUP_SIZE},
+    {"compression", required_argument, NULL, DTL_OPTION_COMPRESSION},
+    {"compression-level", required_argument, NULL, DTL_OPTION_COMPRESSION_LEVEL},
+    {"no-dictionary", no_argument, NULL, DTL_OPTION_NO_DICTIONARY},
+    {"no-statistics", no_argument, NULL, DTL_OPTION_NO_STATISTICS},
+    {"ipc-compression", required_argument, NULL, DTL_OPTION_IPC_COMPRESSION},
+    {"plan-cache", required_argument, NULL, DTL_OPTION_PLAN_CACHE},
+    {"threads", required_argument, NULL, DTL_OPTION_THREADS},
+    {"cache-size", required_argument, NULL, DTL_OPTION_CACHE_SIZE},
+    {"trace-sample", required_argument, NULL, DTL_OPTION_TRACE_SAMPLE},
+    {"trace-format", required_argument, NULL, DTL_OPTION_TRACE_FORMAT},
+    {NULL, 0, NULL, 0},
+};
+
 int
 main(int argc, char **argv) {
     char const *source_path;
     char const *input_path;
     char const *output_path;
-    char const *trace_path;
+    char const *trace_path = NULL;
     int source_file;
     char *source;
+    struct dtl_format_options options = {
+        .dictionary = true,
+        .statistics = true,
+    };
+    struct dtl_serve_formats serve_formats;
     struct dtl_io_importer *importer;
     struct dtl_io_exporter *exporter;
-    struct dtl_io_tracer *tracer;
+    struct dtl_io_tracer *duckdb_tracer = NULL;
+    struct dtl_io_tracer *filesystem_tracer = NULL;
+    struct dtl_io_tracer *tracer = NULL;
+    struct dtl_io_tracer *sampled_tracer = NULL;
     struct dtl_error *error = NULL;
     enum dtl_status status;
+    char const *plan_cache = NULL;
+    long num_threads = 0;
+    long cache_size = 1L << 30;
+    double trace_sample = 1.0;
+    bool trace_filesystem = false;
+    int option;
 
-    if (argc != 5) {
+    while ((option = getopt_long(argc, argv, "", dtl_options, NULL)) != -1) {
+        switch (option) {
+        case DTL_OPTION_MMAP:
+            options.memory_map = true;
+            break;
+        case DTL_OPTION_BLOOM_FILTER:
+            options.num_bloom_filter_columns += 1;
+            options.bloom_filter_columns = realloc(
+                options.bloom_filter_columns, options.num_bloom_filter_columns * sizeof(char const *)
+            );
+            options.bloom_filter_columns[options.num_bloom_filter_columns - 1] = optarg;
+            break;
+        case DTL_OPTION_ROW_GROUP_SIZE:
+            if (!dtl_parse_int(optarg, 1, LONG_MAX, &options.row_group_size)) {
+                fprintf(stderr, "error: invalid row group size: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case DTL_OPTION_COMPRESSION:
+            options.compression = optarg;
+            break;
+        case DTL_OPTION_COMPRESSION_LEVEL:
+            if (!dtl_parse_int(optarg, INT_MIN + 1, INT_MAX, &options.compression_level)) {
+                fprintf(stderr, "error: invalid compression level: %s\n", optarg);
+                return 1;
+            }
+            options.has_compression_level = true;
+            break;
+        case DTL_OPTION_NO_DICTIONARY:
+            options.dictionary = false;
+            break;
+        case DTL_OPTION_NO_STATISTICS:
+            options.statistics = false;
+            break;
+        case DTL_OPTION_IPC_COMPRESSION:
+            options.ipc_compression = optarg;
+            break;
+        case DTL_OPTION_PLAN_CACHE:
+            plan_cache = optarg;
+            break;
+        case DTL_OPTION_THREADS:
+            if (!dtl_parse_int(optarg, 1, 1024, &num_threads)) {
+                fprintf(stderr, "error: invalid number of threads: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case DTL_OPTION_CACHE_SIZE:
+            if (!dtl_parse_int(optarg, 0, LONG_MAX, &cache_size)) {
+                fprintf(stderr, "error: invalid cache size: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case DTL_OPTION_TRACE_SAMPLE:
+            if (!dtl_parse_fraction(optarg, &trace_sample)) {
+                fprintf(stderr, "error: invalid trace sample rate: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case DTL_OPTION_TRACE_FORMAT:
+            if (strcmp(optarg, "filesystem") == 0) {
+                trace_filesystem = true;
+            } else if (strcmp(optarg, "duckdb") == 0) {
+                trace_filesystem = false;
+            } else {
+                fprintf(stderr, "error: unknown trace format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            dtl_print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - optind >= 1 && strcmp(argv[optind], "serve") == 0) {
+        if (argc - optind != 2) {
+            dtl_print_usage(argv[0]);
+            return 1;
+        }
+
+        if (num_threads == 0) {
+            num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+            if (num_threads < 1) {
+                num_threads = 1;
+            }
+        }
+
+        serve_formats.create_importer = dtl_serve_create_importer;
+        serve_formats.destroy_importer = dtl_serve_destroy_importer;
+        serve_formats.create_exporter = dtl_serve_create_exporter;
+        serve_formats.destroy_exporter = dtl_serve_destroy_exporter;
+        serve_formats.get_table_path = dtl_format_table_path;
+        serve_formats.user_data = &options;
+
+        // Only returns if the server could not be started or stopped accepting connections.
+        dtl_serve(argv[optind + 1], num_threads, cache_size, &serve_formats, &error);
+        dtl_print_error(error);
+        dtl_clear_error(&error);
+        return 1;
+    }
+
+    if (argc - optind >= 1 && strcmp(argv[optind], "lineage") == 0) {
+        if (argc - optind != 5) {
+            dtl_print_usage(argv[0]);
+            return 1;
+        }
+        return dtl_lineage_main(
+            argv[optind + 1], trace_filesystem, argv[optind + 2], argv[optind + 3], argv[optind + 4]
+        );
+    }
+
+    if (argc - optind != 3 && argc - optind != 4) {
+        dtl_print_usage(argv[0]);
         return 1;
     }
 
-    source_path = argv[1];
-    input_path = argv[2];
-    output_path = argv[3];
-    trace_path = argv[4];
+    source_path = argv[optind + 0];
+    input_path = argv[optind + 1];
+    output_path = argv[optind + 2];
+    if (argc - optind == 4) {
+        trace_path = argv[optind + 3];
+    }
 
     source_file = open(source_path, O_CLOEXEC);
     if (source_file == -1) {
@@ -106,39 +688,73 @@ main(int argc, char **argv) {
 
     close(source_file);
 
-    importer = dtl_io_filesystem_importer_create(input_path);
-    exporter = dtl_io_filesystem_exporter_create(output_path);
-    tracer = dtl_io_duckdb_tracer_create(trace_path, &error);
-    if (tracer == NULL) {
+    importer = dtl_format_importer_create(input_path, &options);
+    exporter = dtl_format_exporter_create(output_path, &options, &error);
+    if (exporter == NULL) {
         dtl_print_error(error);
         dtl_clear_error(&error);
         return 1;
     }
+    free(options.bloom_filter_columns);
+    options.bloom_filter_columns = NULL;
+    options.num_bloom_filter_columns = 0;
 
-    status = dtl_eval(source, source_path, importer, exporter, tracer, &error);
-    if (status != DTL_STATUS_OK) {
-        dtl_print_error(error);
-        dtl_clear_error(&error);
-        return 1;
+    if (trace_path != NULL && trace_filesystem) {
+        filesystem_tracer = dtl_io_filesystem_tracer_create(trace_path);
+        tracer = filesystem_tracer;
+    } else if (trace_path != NULL) {
+        duckdb_tracer = dtl_io_duckdb_tracer_create(trace_path, &error);
+        if (duckdb_tracer == NULL) {
+            dtl_print_error(error);
+            dtl_clear_error(&error);
+            return 1;
+        }
+        tracer = dtl_io_async_tracer_create(duckdb_tracer, DTL_TRACE_QUEUE_SIZE);
+    }
+    if (tracer != NULL && trace_sample < 1.0) {
+        sampled_tracer = dtl_io_sampled_tracer_create(tracer, trace_sample);
     }
 
-    free(source);
-
-    status = dtl_io_duckdb_tracer_destroy(tracer, &error);
+    if (plan_cache != NULL) {
+        status = dtl_eval_cached(
+            source, source_path, plan_cache, importer, exporter, sampled_tracer != NULL ? sampled_tracer : tracer, &error
+        );
+    } else {
+        status = dtl_eval(
+            source, source_path, importer, exporter, sampled_tracer != NULL ? sampled_tracer : tracer, &error
+        );
+    }
     if (status != DTL_STATUS_OK) {
         dtl_print_error(error);
         dtl_clear_error(&error);
         return 1;
     }
 
-    dtl_io_filesystem_exporter_destroy(exporter);
-    dtl_io_filesystem_importer_destroy(importer);
+    free(source);
 
-    if (status != DTL_STATUS_OK) {
-        dtl_print_error(error);
-        dtl_clear_error(&error);
-        return 1;
+    dtl_io_sampled_tracer_destroy(sampled_tracer);
+
+    if (filesystem_tracer != NULL) {
+        status = dtl_io_filesystem_tracer_destroy(filesystem_tracer, &error);
+        if (status != DTL_STATUS_OK) {
+            dtl_print_error(error);
+            dtl_clear_error(&error);
+            return 1;
+        }
+    } else if (tracer != NULL) {
+        status = dtl_io_async_tracer_destroy(tracer, &error);
+        if (status == DTL_STATUS_OK) {
+            status = dtl_io_duckdb_tracer_destroy(duckdb_tracer, &error);
+        }
+        if (status != DTL_STATUS_OK) {
+            dtl_print_error(error);
+            dtl_clear_error(&error);
+            return 1;
+        }
     }
 
+    dtl_format_exporter_destroy(exporter);
+    dtl_format_importer_destroy(importer);
+
     return 0;
 }
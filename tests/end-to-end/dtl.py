@@ -3,12 +3,38 @@ import pathlib
 import subprocess
 import tempfile
 
+import pyarrow.feather as feather
 import pyarrow.parquet as pq
 
 _DTL = os.environ["DTL"]
 
 
-def run(source, /, *, inputs):
+def _lineage(trace_options, trace_path, table, column, row):
+    result = subprocess.run(
+        [_DTL, *trace_options, "lineage", trace_path, table, column, str(row)],
+        stdout=subprocess.PIPE,
+        text=True,
+    )
+    result.check_returncode()
+
+    rows = []
+    for line in result.stdout.splitlines():
+        kind, name, column, row, *value = line.split("\t")
+        rows.append((kind, name, column, int(row), *value))
+    return rows
+
+
+def run(
+    source,
+    /,
+    *,
+    inputs,
+    options=(),
+    trace=True,
+    row_group_size=None,
+    lineage=(),
+    output_files=None,
+):
     with tempfile.TemporaryDirectory() as tempdir:
         root_path = pathlib.Path(tempdir)
 
@@ -18,19 +44,63 @@ def run(source, /, *, inputs):
         input_path = root_path / "input"
         input_path.mkdir()
         for input_name, input_table in inputs.items():
-            pq.write_table(input_table, input_path / f"{input_name}.parquet")
+            if isinstance(input_table, str):
+                (input_path / input_name).write_text(input_table)
+                continue
+            if isinstance(input_table, bytes):
+                (input_path / input_name).write_bytes(input_table)
+                continue
+            if input_name.endswith((".arrow", ".feather")):
+                feather.write_feather(
+                    input_table, input_path / input_name, compression="uncompressed"
+                )
+                continue
+            pq.write_table(
+                input_table,
+                input_path / f"{input_name}.parquet",
+                row_group_size=row_group_size,
+            )
 
         output_path = root_path / "output"
         output_path.mkdir()
 
+        trace_options = []
         trace_path = root_path / "trace.duckdb"
+        if trace == "filesystem":
+            trace_options = ["--trace-format", "filesystem"]
+            trace_path = root_path / "trace"
+
+        args = [_DTL, *options, *trace_options, source_path, input_path, output_path]
+        if trace:
+            args.append(trace_path)
 
-        subprocess.run(
-            [_DTL, source_path, input_path, output_path, trace_path]
-        ).check_returncode()
+        subprocess.run(args).check_returncode()
+
+        if output_files is not None:
+            for output_file_path in output_path.iterdir():
+                output_files[output_file_path.name] = output_file_path.read_bytes()
 
         outputs = {}
         for output_table_path in output_path.glob("*.parquet"):
             outputs[output_table_path.stem] = pq.read_table(output_table_path)
+        for output_table_path in output_path.glob("*.arrow"):
+            outputs[output_table_path.name] = feather.read_table(output_table_path)
+        for output_table_path in output_path.glob("*.feather"):
+            outputs[output_table_path.name] = feather.read_table(output_table_path)
+
+        if lineage:
+            return outputs, [
+                _lineage(trace_options, trace_path, *query) for query in lineage
+            ]
+
+        if trace != "filesystem":
+            return outputs, None
+
+        manifest = {}
+        for manifest_table_path in (trace_path / "manifest").glob("*.parquet"):
+            manifest[manifest_table_path.stem] = pq.read_table(manifest_table_path)
+        arrays = {}
+        for array_path in (trace_path / "arrays").glob("*.arrow"):
+            arrays[int(array_path.stem)] = feather.read_table(array_path)["value"]
 
-        return outputs, None
+        return outputs, (manifest, arrays)
@@ -0,0 +1,180 @@
+import struct
+import subprocess
+
+import pyarrow as pa
+
+import dtl
+
+
+# PyArrow doesn't expose bloom filter offsets, so the footer is decoded directly.  It is a Thrift
+# compact protocol struct, which is simple enough to walk without a schema.
+def _read_varint(data, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        result |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return result, pos
+        shift += 7
+
+
+def _read_zigzag(data, pos):
+    value, pos = _read_varint(data, pos)
+    return (value >> 1) ^ -(value & 1), pos
+
+
+def _read_value(data, pos, value_type):
+    if value_type in (1, 2):
+        # Booleans in structs are stored in the field header.
+        return value_type == 1, pos
+    if value_type == 3:
+        return data[pos], pos + 1
+    if value_type in (4, 5, 6):
+        return _read_zigzag(data, pos)
+    if value_type == 7:
+        return struct.unpack_from("<d", data, pos)[0], pos + 8
+    if value_type == 8:
+        length, pos = _read_varint(data, pos)
+        return data[pos : pos + length], pos + length
+    if value_type in (9, 10):
+        header = data[pos]
+        pos += 1
+        size, element_type = header >> 4, header & 0x0F
+        if size == 15:
+            size, pos = _read_varint(data, pos)
+        items = []
+        for _ in range(size):
+            if element_type in (1, 2):
+                item, pos = data[pos] == 1, pos + 1
+            else:
+                item, pos = _read_value(data, pos, element_type)
+            items.append(item)
+        return items, pos
+    if value_type == 11:
+        size, pos = _read_varint(data, pos)
+        items = {}
+        if size:
+            key_type, item_type = data[pos] >> 4, data[pos] & 0x0F
+            pos += 1
+            for _ in range(size):
+                key, pos = _read_value(data, pos, key_type)
+                items[key], pos = _read_value(data, pos, item_type)
+        return items, pos
+    if value_type == 12:
+        return _read_struct(data, pos)
+    raise ValueError(f"unexpected thrift type {value_type}")
+
+
+def _read_struct(data, pos):
+    fields = {}
+    field_id = 0
+    while True:
+        header = data[pos]
+        pos += 1
+        if header == 0:
+            return fields, pos
+        delta, value_type = header >> 4, header & 0x0F
+        if delta:
+            field_id += delta
+        else:
+            field_id, pos = _read_zigzag(data, pos)
+        fields[field_id], pos = _read_value(data, pos, value_type)
+
+
+def _read_column_chunks(data):
+    """
+    Returns the `ColumnMetaData` of each column chunk in a Parquet file, by row group, keyed by
+    column name.
+    """
+    assert data[-4:] == b"PAR1"
+    (footer_length,) = struct.unpack_from("<I", data, len(data) - 8)
+    footer, _ = _read_struct(data[len(data) - 8 - footer_length : len(data) - 8], 0)
+
+    row_groups = []
+    for row_group in footer[4]:
+        columns = {}
+        for column_chunk in row_group[1]:
+            meta_data = column_chunk[3]
+            columns[b".".join(meta_data[3]).decode()] = meta_data
+        row_groups.append(columns)
+    return row_groups
+
+
+_BLOOM_FILTER_OFFSET = 14
+_TOTAL_COMPRESSED_SIZE = 7
+_DATA_PAGE_OFFSET = 9
+_DICTIONARY_PAGE_OFFSET = 11
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    WITH output AS SELECT a, b FROM input WHERE a = 7;
+    EXPORT output TO 'output';
+    EXPORT input TO 'copy';
+    """
+    inputs = {"input": pa.table({"a": list(range(100)), "b": list(range(100, 200))})}
+    output_files = {}
+    outputs, _ = dtl.run(
+        src,
+        inputs=inputs,
+        options=["--bloom-filter", "a", "--row-group-size", "10"],
+        trace=False,
+        row_group_size=10,
+        output_files=output_files,
+    )
+    assert outputs["output"] == pa.table({"a": [7], "b": [107]})
+    assert outputs["copy"] == inputs["input"]
+
+    # Filters are only written for the requested columns.
+    row_groups = _read_column_chunks(output_files["copy.parquet"])
+    assert len(row_groups) == 10
+    for columns in row_groups:
+        assert _BLOOM_FILTER_OFFSET in columns["a"]
+        assert _BLOOM_FILTER_OFFSET not in columns["b"]
+
+    # The first row group holds even numbers either side of 7, so only its bloom filter can rule it
+    # out for `a = 7`.  Every other row group is ruled out by its statistics.
+    src = """
+    WITH input AS IMPORT 'input';
+    EXPORT input TO 'copy';
+    """
+    table = pa.table({"a": [i * 2 for i in range(10)] + list(range(20, 110))})
+    output_files = {}
+    dtl.run(
+        src,
+        inputs={"input": table},
+        options=["--bloom-filter", "a", "--row-group-size", "10"],
+        trace=False,
+        output_files=output_files,
+    )
+    data = bytearray(output_files["copy.parquet"])
+
+    # Overwrite the pages of the first row group, so that reading it fails.
+    column = _read_column_chunks(data)[0]["a"]
+    start = column.get(_DICTIONARY_PAGE_OFFSET, column[_DATA_PAGE_OFFSET])
+    data[start : start + column[_TOTAL_COMPRESSED_SIZE]] = b"\xff" * column[
+        _TOTAL_COMPRESSED_SIZE
+    ]
+    corrupted = {"input.parquet": bytes(data)}
+
+    src = """
+    WITH input AS IMPORT 'input';
+    WITH output AS SELECT a FROM input WHERE a = {};
+    EXPORT output TO 'output';
+    """
+    outputs, _ = dtl.run(src.format(7), inputs=corrupted, trace=False)
+    assert outputs["output"].num_rows == 0
+
+    try:
+        dtl.run(src.format(8), inputs=corrupted, trace=False)
+    except subprocess.CalledProcessError:
+        pass
+    else:
+        raise AssertionError("expected the corrupted row group to be read")
+
+
+if __name__ == "__main__":
+    main()
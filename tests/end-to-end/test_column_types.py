@@ -0,0 +1,35 @@
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    EXPORT input TO 'output';
+    """
+    inputs = {
+        "input": pa.table(
+            {
+                "bool": pa.array([True, False, True, True, False], pa.bool_()),
+                "int32": pa.array([1, -2, 3, -4, 5], pa.int32()),
+                "int64": pa.array([1, -2, 3, -4, 2**40], pa.int64()),
+                "float": pa.array([0.5, 1.5, -2.5, 3.0, 4.0], pa.float32()),
+                "double": pa.array([0.1, 0.2, 0.3, 0.4, 0.5], pa.float64()),
+            }
+        )
+    }
+    outputs, trace = dtl.run(src, inputs=inputs)
+    assert outputs["output"] == pa.table(
+        {
+            "bool": pa.array([True, False, True, True, False], pa.bool_()),
+            "int32": pa.array([1, -2, 3, -4, 5], pa.int64()),
+            "int64": pa.array([1, -2, 3, -4, 2**40], pa.int64()),
+            "float": pa.array([0.5, 1.5, -2.5, 3.0, 4.0], pa.float64()),
+            "double": pa.array([0.1, 0.2, 0.3, 0.4, 0.5], pa.float64()),
+        }
+    )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+import subprocess
+
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input.csv';
+    EXPORT input TO 'output';
+    """
+    text = "a,b,c\r\n1,0.5,true\r\n-2,1e3,FALSE\r\n3,-7,true"
+    outputs, _ = dtl.run(src, inputs={"input.csv": text})
+    assert outputs["output"] == pa.table(
+        {"a": [1, -2, 3], "b": [0.5, 1000.0, -7.0], "c": [True, False, True]}
+    )
+
+
+def empty_lines():
+    src = """
+    WITH input AS IMPORT 'input.csv';
+    EXPORT input TO 'output';
+    """
+    expected = pa.table({"a": [1, 3], "b": [0.5, 4.0]})
+
+    for text in [
+        "a,b\n1,0.5\n\n3,4\n\n",
+        "a,b\r\n1,0.5\r\n\r\n3,4\r\n\r\n",
+        "a,b\n1,0.5\n3,4\n\r",
+    ]:
+        outputs, _ = dtl.run(src, inputs={"input.csv": text})
+        assert outputs["output"] == expected
+
+
+def double_grammar():
+    src = """
+    WITH input AS IMPORT 'input.csv';
+    EXPORT input TO 'output';
+    """
+
+    # Long and exponent values take a slower path, but are checked against the same grammar.
+    text = "a\n0.1234567890123456789\n-2.5E-3\n+7.\n.5e1\n"
+    outputs, _ = dtl.run(src, inputs={"input.csv": text})
+    assert outputs["output"] == pa.table({"a": [0.1234567890123456789, -2.5e-3, 7.0, 5.0]})
+
+    for value in ["0x10", " 1.5", "1.5 ", "inf", "nan", "1e", "1.2345678901234567e"]:
+        try:
+            dtl.run(src, inputs={"input.csv": f"a\n1.5\n{value}\n"})
+        except subprocess.CalledProcessError:
+            pass
+        else:
+            raise AssertionError(f"{value!r} should not parse as a number")
+
+
+if __name__ == "__main__":
+    main()
+    empty_lines()
+    double_grammar()
@@ -0,0 +1,55 @@
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    WITH filtered AS SELECT a, b FROM input WHERE a > 2;
+    EXPORT SELECT a, a + b AS c FROM filtered TO 'output';
+    """
+    table = pa.table({"a": [1, 2, 3, 4], "b": [10, 20, 30, 40]})
+    outputs, (manifest, arrays) = dtl.run(
+        src, inputs={"input": table}, trace="filesystem"
+    )
+    assert outputs["output"] == pa.table({"a": [3, 4], "c": [33, 44]})
+
+    assert manifest["sources"]["text"].to_pylist() == [src]
+
+    inputs = manifest["inputs"].to_pylist()
+    assert {(row["table"], row["column"]) for row in inputs} == {
+        ("input", "a"),
+        ("input", "b"),
+    }
+    for row in inputs:
+        assert arrays[row["array"]] == table[row["column"]]
+
+    for row in manifest["outputs"].to_pylist():
+        assert row["table"] == "output"
+        assert arrays[row["array"]] == outputs["output"][row["column"]]
+
+    # Every output column can be traced back to the input through the filter.
+    output_arrays = set(manifest["outputs"]["array"].to_pylist())
+    input_arrays = set(manifest["inputs"]["array"].to_pylist())
+    mappings = [
+        mapping
+        for mapping in manifest["mappings"].to_pylist()
+        if mapping["tgt_array"] in output_arrays
+    ]
+    assert {mapping["tgt_array"] for mapping in mappings} == output_arrays
+    for mapping in mappings:
+        assert mapping["src_array"] in input_arrays
+        assert mapping["src_index_array"] is not None
+        assert arrays[mapping["src_index_array"]].to_pylist() == [2, 3]
+
+    # Index arrays are also recorded grouped by the rows that they point to.
+    groupings = {row["array"]: row for row in manifest["groupings"].to_pylist()}
+    for mapping in mappings:
+        grouping = groupings[mapping["src_index_array"]]
+        assert arrays[grouping["offsets_array"]].to_pylist() == [0, 0, 0, 1, 2]
+        assert arrays[grouping["entries_array"]].to_pylist() == [0, 1]
+
+
+if __name__ == "__main__":
+    main()
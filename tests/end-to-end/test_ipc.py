@@ -0,0 +1,24 @@
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input.arrow';
+    EXPORT input TO 'output.arrow';
+    EXPORT input TO 'output';
+    """
+    table = pa.table({"a": [1, 2, 3, 4], "b": [0.5, 1.5, 2.5, 3.5]})
+    outputs, _ = dtl.run(src, inputs={"input.arrow": table})
+    assert outputs["output.arrow"] == table
+    assert outputs["output"] == table
+
+    outputs, _ = dtl.run(
+        src, inputs={"input.arrow": table}, options=["--ipc-compression", "lz4"]
+    )
+    assert outputs["output.arrow"] == table
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    WITH other AS IMPORT 'other';
+    WITH joined AS SELECT a, b FROM input JOIN other ON a = id;
+    EXPORT SELECT a, a + b AS c FROM joined WHERE a > 2 TO 'output';
+    """
+    inputs = {
+        "input": pa.table({"a": [1, 2, 3, 4, 5]}),
+        "other": pa.table({"id": [5, 4, 3, 2, 1], "b": [50, 40, 30, 20, 10]}),
+    }
+
+    for trace in [True, "filesystem"]:
+        outputs, (a_rows, c_rows) = dtl.run(
+            src,
+            inputs=inputs,
+            trace=trace,
+            lineage=[("output", "a", 1), ("output", "c", 1)],
+        )
+        assert outputs["output"] == pa.table({"a": [3, 4, 5], "c": [33, 44, 55]})
+
+        # The second exported row was computed from the fourth row of `input`, and the second row
+        # of `other`.
+        assert a_rows[0] == ("output", "output", "a", 1, "4")
+        assert {row for row in a_rows if row[0] == "input"} == {
+            ("input", "input", "a", 3, "4"),
+        }
+
+        assert c_rows[0] == ("output", "output", "c", 1, "44")
+        assert {row for row in c_rows if row[0] == "input"} == {
+            ("input", "input", "a", 3, "4"),
+            ("input", "other", "b", 1, "40"),
+        }
+
+        # Intermediate tables are reported at the rows that were computed from the same inputs.
+        traces = {(row[2], row[3], row[4]) for row in c_rows if row[0] == "trace"}
+        assert ("a", 3, "4") in traces
+        assert ("b", 3, "40") in traces
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,17 @@
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    EXPORT input TO 'output';
+    """
+    inputs = {"input": pa.table({"a": [1, 2, 3, 4], "b": [5, 6, 7, 8]})}
+    outputs, trace = dtl.run(src, inputs=inputs, options=["--mmap"])
+    assert outputs["output"] == pa.table({"a": [1, 2, 3, 4], "b": [5, 6, 7, 8]})
+
+
+if __name__ == "__main__":
+    main()
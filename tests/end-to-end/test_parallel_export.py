@@ -0,0 +1,22 @@
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    names = [f"output_{i}" for i in range(8)]
+    src = "WITH input AS IMPORT 'input';\n"
+    for i, name in enumerate(names):
+        src += f"EXPORT SELECT a + b AS c{i} FROM input TO '{name}';\n"
+    src += "EXPORT SELECT a AS first FROM input TO 'output_0';\n"
+
+    inputs = {"input": pa.table({"a": list(range(1000)), "b": list(range(1000))})}
+    outputs, _ = dtl.run(src, inputs=inputs)
+
+    assert outputs["output_0"] == pa.table({"first": list(range(1000))})
+    for i, name in enumerate(names[1:], start=1):
+        assert outputs[name] == pa.table({f"c{i}": [2 * x for x in range(1000)]})
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+import pathlib
+import shutil
+import tempfile
+
+import pyarrow as pa
+
+import dtl
+
+
+def _plans(cache_dir):
+    # Plans are written to a temporary file and renamed into place, so a plan that was reused
+    # rather than recompiled keeps its inode.
+    return {path.name: path.stat().st_ino for path in pathlib.Path(cache_dir).glob("*.plan")}
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    WITH output AS SELECT a, b FROM input WHERE a >= 95;
+    EXPORT output TO 'output';
+    """
+
+    with tempfile.TemporaryDirectory() as cache_dir:
+        options = ["--plan-cache", cache_dir]
+
+        inputs = {"input": pa.table({"a": list(range(100)), "b": list(range(100, 200))})}
+        expected = pa.table({"a": [95, 96, 97, 98, 99], "b": [195, 196, 197, 198, 199]})
+
+        # The first run compiles the script and stores the plan.  The second maps it.
+        outputs, _ = dtl.run(src, inputs=inputs, options=options, trace=False)
+        assert outputs["output"] == expected
+        plans = _plans(cache_dir)
+        assert len(plans) == 1
+
+        outputs, _ = dtl.run(src, inputs=inputs, options=options, trace=True)
+        assert outputs["output"] == expected
+        assert _plans(cache_dir) == plans
+
+        # A change to the schema of an input makes the cached plan stale.
+        inputs = {"input": pa.table({"a": list(range(100)), "b": [i / 2 for i in range(100)]})}
+        expected = pa.table({"a": [95, 96, 97, 98, 99], "b": [47.5, 48.0, 48.5, 49.0, 49.5]})
+
+        outputs, _ = dtl.run(src, inputs=inputs, options=options, trace=False)
+        assert outputs["output"] == expected
+        stale_plans = _plans(cache_dir)
+        assert stale_plans.keys() == plans.keys()
+        assert stale_plans != plans
+
+        outputs, _ = dtl.run(src, inputs=inputs, options=options, trace=False)
+        assert outputs["output"] == expected
+        assert _plans(cache_dir) == stale_plans
+
+
+def edit_source():
+    src = """
+    WITH input AS IMPORT 'input';
+    WITH output AS SELECT a, b FROM input WHERE a >= 95;
+    EXPORT output TO 'output';
+    """
+    edited_src = """
+    WITH input AS IMPORT 'input';
+    WITH output AS SELECT a, b FROM input WHERE a >= 98;
+    EXPORT output TO 'output';
+    """
+    inputs = {"input": pa.table({"a": list(range(100)), "b": list(range(100, 200))})}
+
+    with tempfile.TemporaryDirectory() as cache_dir:
+        options = ["--plan-cache", cache_dir]
+
+        dtl.run(src, inputs=inputs, options=options, trace=False)
+        plans = _plans(cache_dir)
+        assert len(plans) == 1
+
+        # Plans are found by a hash of the source, so an edited script gets a plan of its own and
+        # leaves the old one alone.
+        outputs, _ = dtl.run(edited_src, inputs=inputs, options=options, trace=False)
+        assert outputs["output"] == pa.table({"a": [98, 99], "b": [198, 199]})
+        edited_plans = _plans(cache_dir)
+        assert len(edited_plans) == 2
+        assert {name: edited_plans[name] for name in plans} == plans
+
+        # Even if the hashes collide, the plan for the old source must not be used.
+        (edited_name,) = edited_plans.keys() - plans.keys()
+        (name,) = plans.keys()
+        shutil.copyfile(pathlib.Path(cache_dir) / name, pathlib.Path(cache_dir) / edited_name)
+        collided_plans = _plans(cache_dir)
+
+        outputs, _ = dtl.run(edited_src, inputs=inputs, options=options, trace=False)
+        assert outputs["output"] == pa.table({"a": [98, 99], "b": [198, 199]})
+        assert _plans(cache_dir)[edited_name] != collided_plans[edited_name]
+
+
+if __name__ == "__main__":
+    main()
+    edit_source()
@@ -0,0 +1,96 @@
+import os
+import pathlib
+import socket
+import subprocess
+import tempfile
+import time
+
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+_DTL = os.environ["DTL"]
+
+
+def _submit(socket_path, script_path, input_path, output_path):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as client:
+        client.connect(str(socket_path))
+        client.sendall(f"{script_path}\n{input_path}\n{output_path}\n".encode())
+
+        reply = b""
+        while not reply.endswith(b"\n"):
+            data = client.recv(4096)
+            if not data:
+                break
+            reply += data
+    return reply.decode()
+
+
+def _wait_for_socket(server, socket_path):
+    deadline = time.monotonic() + 30
+    while time.monotonic() < deadline:
+        assert server.poll() is None, "server exited"
+        if socket_path.exists():
+            return
+        time.sleep(0.05)
+    raise AssertionError("server did not start")
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    WITH output AS SELECT a, b FROM input WHERE a >= 95;
+    EXPORT output TO 'output';
+    """
+    table = pa.table({"a": list(range(100)), "b": list(range(100, 200))})
+    expected = pa.table({"a": [95, 96, 97, 98, 99], "b": [195, 196, 197, 198, 199]})
+
+    with tempfile.TemporaryDirectory() as tempdir:
+        root_path = pathlib.Path(tempdir)
+
+        script_path = root_path / "script.dtl"
+        script_path.write_text(src)
+
+        input_path = root_path / "input"
+        input_path.mkdir()
+        table_path = input_path / "input.parquet"
+        pq.write_table(table, table_path)
+
+        socket_path = root_path / "dtl.sock"
+        server = subprocess.Popen([_DTL, "serve", socket_path])
+        try:
+            _wait_for_socket(server, socket_path)
+
+            output_path = root_path / "output-1"
+            output_path.mkdir()
+            assert _submit(socket_path, script_path, input_path, output_path) == "ok\n"
+            assert pq.read_table(output_path / "output.parquet") == expected
+
+            # Replace the input with garbage of the same size and modification time.  The cache
+            # can't tell the difference, so the second job only succeeds if it is served from the
+            # cache rather than read from disk.
+            info = table_path.stat()
+            garbage_path = input_path / "garbage"
+            garbage_path.write_bytes(b"\xff" * info.st_size)
+            os.utime(garbage_path, ns=(info.st_atime_ns, info.st_mtime_ns))
+            os.replace(garbage_path, table_path)
+
+            output_path = root_path / "output-2"
+            output_path.mkdir()
+            assert _submit(socket_path, script_path, input_path, output_path) == "ok\n"
+            assert pq.read_table(output_path / "output.parquet") == expected
+
+            # Once the modification time changes, the file is read again.
+            os.utime(table_path, ns=(info.st_atime_ns, info.st_mtime_ns + 1_000_000_000))
+
+            output_path = root_path / "output-3"
+            output_path.mkdir()
+            assert _submit(socket_path, script_path, input_path, output_path).startswith(
+                "error: "
+            )
+        finally:
+            server.terminate()
+            server.wait()
+
+
+if __name__ == "__main__":
+    main()
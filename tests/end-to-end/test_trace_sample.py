@@ -0,0 +1,50 @@
+import pyarrow as pa
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    EXPORT SELECT a, a + b AS c FROM input WHERE a > 100 TO 'output';
+    """
+    table = pa.table({"a": range(1000), "b": range(1000, 2000)})
+    outputs, (manifest, arrays) = dtl.run(
+        src,
+        inputs={"input": table},
+        options=["--trace-sample", "0.1"],
+        trace="filesystem",
+    )
+    output = outputs["output"]
+    assert output.num_rows == 899
+
+    samples = {
+        row["array"]: arrays[row["rows_array"]].to_pylist()
+        for row in manifest["samples"].to_pylist()
+    }
+
+    # Only a sample of each exported column is recorded, and each recorded row matches the row of
+    # the export that it was sampled from.
+    for row in manifest["outputs"].to_pylist():
+        rows = samples[row["array"]]
+        assert 0 < len(rows) < output.num_rows
+        assert arrays[row["array"]].to_pylist() == [
+            output[row["column"]][i].as_py() for i in rows
+        ]
+
+    # Mappings only cover the sampled rows, and lead back to the rows of the input that they were
+    # computed from.
+    input_arrays = set(manifest["inputs"]["array"].to_pylist())
+    output_arrays = set(manifest["outputs"]["array"].to_pylist())
+    for mapping in manifest["mappings"].to_pylist():
+        if mapping["src_array"] not in input_arrays:
+            continue
+        assert mapping["tgt_array"] in output_arrays
+        src_rows = arrays[mapping["src_index_array"]].to_pylist()
+        tgt_rows = arrays[mapping["tgt_index_array"]].to_pylist()
+        assert tgt_rows == samples[mapping["tgt_array"]]
+        assert src_rows == [row + 101 for row in tgt_rows]
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,55 @@
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+import dtl
+
+
+def main():
+    src = """
+    WITH input AS IMPORT 'input';
+    EXPORT input TO 'output';
+    """
+    table = pa.table(
+        {
+            "a": list(range(10)),
+            "b": [i % 3 == 0 for i in range(10)],
+            "c": [i / 2 for i in range(10)],
+        }
+    )
+    output_files = {}
+    outputs, _ = dtl.run(
+        src,
+        inputs={"input": table},
+        output_files=output_files,
+        options=[
+            "--row-group-size",
+            "3",
+            "--compression",
+            "zstd",
+            "--compression-level",
+            "5",
+            "--no-dictionary",
+            "--no-statistics",
+        ],
+    )
+    assert outputs["output"] == table
+
+    metadata = pq.read_metadata(pa.BufferReader(output_files["output.parquet"]))
+    assert metadata.num_rows == 10
+    assert [
+        metadata.row_group(i).num_rows for i in range(metadata.num_row_groups)
+    ] == [3, 3, 3, 1]
+
+    for i in range(metadata.num_row_groups):
+        row_group = metadata.row_group(i)
+        assert row_group.num_columns == 3
+        for j in range(row_group.num_columns):
+            column = row_group.column(j)
+            assert column.compression == "ZSTD"
+            assert not column.has_dictionary_page
+            assert not any("DICTIONARY" in encoding for encoding in column.encodings)
+            assert not column.is_stats_set
+
+
+if __name__ == "__main__":
+    main()
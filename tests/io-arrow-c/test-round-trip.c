@@ -0,0 +1,129 @@
+#include <arrow/c/abi.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dtl-error.h"
+#include "dtl-eval.h"
+#include "dtl-io-arrow-c.h"
+#include "dtl-io.h"
+
+#include "dtl-test.h"
+
+static int64_t input_values[] = {1, 2, 3, 4};
+static void const *input_buffers[] = {NULL, input_values};
+static bool input_released = false;
+
+static void
+release_schema(struct ArrowSchema *schema) {
+    schema->release = NULL;
+}
+
+static void
+release_array(struct ArrowArray *array) {
+    array->release = NULL;
+}
+
+static int
+get_schema(struct ArrowArrayStream *stream, struct ArrowSchema *out) {
+    static struct ArrowSchema column = {.format = "l", .name = "a", .release = release_schema};
+    static struct ArrowSchema *columns[] = {&column};
+
+    (void)stream;
+
+    *out = (struct ArrowSchema){
+        .format = "+s", .name = "", .n_children = 1, .children = columns, .release = release_schema
+    };
+    return 0;
+}
+
+static int
+get_next(struct ArrowArrayStream *stream, struct ArrowArray *out) {
+    static struct ArrowArray column = {
+        .length = 3, .offset = 1, .n_buffers = 2, .buffers = input_buffers, .release = release_array
+    };
+    static struct ArrowArray *columns[] = {&column};
+    static void const *buffers[] = {NULL};
+    bool *done = stream->private_data;
+
+    if (*done) {
+        out->release = NULL;
+        return 0;
+    }
+    *done = true;
+
+    *out = (struct ArrowArray){
+        .length = 3, .n_buffers = 1, .n_children = 1, .buffers = buffers, .children = columns, .release = release_array
+    };
+    return 0;
+}
+
+static char const *
+get_last_error(struct ArrowArrayStream *stream) {
+    (void)stream;
+    return NULL;
+}
+
+static void
+release_stream(struct ArrowArrayStream *stream) {
+    input_released = true;
+    stream->release = NULL;
+}
+
+int
+main(void) {
+    char const *source = (
+        "WITH input AS IMPORT 'input';\n"
+        "WITH output AS SELECT a AS b FROM input;\n"
+        "EXPORT output TO 'output';\n"
+    );
+    bool done = false;
+    struct ArrowArrayStream input = {
+        .get_schema = get_schema,
+        .get_next = get_next,
+        .get_last_error = get_last_error,
+        .release = release_stream,
+        .private_data = &done,
+    };
+    struct ArrowSchema output_schema;
+    struct ArrowArray output_array;
+    struct dtl_io_importer *importer;
+    struct dtl_io_exporter *exporter;
+    struct dtl_error *error = NULL;
+    enum dtl_status status;
+    int64_t const *output_values;
+
+    importer = dtl_io_arrow_c_importer_create();
+    exporter = dtl_io_arrow_c_exporter_create();
+
+    dtl_io_arrow_c_importer_add_stream(importer, "input", &input);
+    dtl_assert(input.release == NULL);
+
+    status = dtl_eval(source, "round-trip.dtl", importer, exporter, NULL, &error);
+    dtl_assert(status == DTL_STATUS_OK);
+    dtl_assert(input_released);
+
+    dtl_assert(!dtl_io_arrow_c_exporter_take_table(exporter, "input", &output_schema, &output_array));
+    dtl_assert(dtl_io_arrow_c_exporter_take_table(exporter, "output", &output_schema, &output_array));
+
+    dtl_assert(strcmp(output_schema.format, "+s") == 0);
+    dtl_assert(output_schema.n_children == 1);
+    dtl_assert(strcmp(output_schema.children[0]->format, "l") == 0);
+    dtl_assert(strcmp(output_schema.children[0]->name, "b") == 0);
+
+    dtl_assert(output_array.length == 3);
+    dtl_assert(output_array.n_children == 1);
+    output_values = output_array.children[0]->buffers[1];
+    dtl_assert(output_values[0] == 2);
+    dtl_assert(output_values[1] == 3);
+    dtl_assert(output_values[2] == 4);
+
+    output_array.release(&output_array);
+    output_schema.release(&output_schema);
+
+    dtl_io_arrow_c_exporter_destroy(exporter);
+    dtl_io_arrow_c_importer_destroy(importer);
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dtl-error.h"
+#include "dtl-manifest.h"
+
+#include "dtl-test.h"
+
+int
+main(int argc, char **argv) {
+    struct dtl_manifest *manifest;
+    struct dtl_manifest *mapped;
+    struct dtl_error *error = NULL;
+    char path[] = "/tmp/dtl-test-manifest-XXXXXX";
+    FILE *file;
+    int fd;
+
+    (void)argc;
+    (void)argv;
+
+    fd = mkstemp(path);
+    dtl_assert(fd != -1);
+    close(fd);
+
+    manifest = dtl_manifest_create();
+    dtl_manifest_add_source(manifest, "WITH input AS IMPORT 'input';", "script.dtl");
+    dtl_manifest_add_input(manifest, "input", "a", 1);
+    dtl_manifest_add_input(manifest, "input", "b", 2);
+    dtl_manifest_add_output(manifest, "output", "c", 7);
+    dtl_manifest_add_trace(manifest, "script.dtl", 5, 28, "a", 1);
+    dtl_manifest_add_mapping(manifest, 1, 7, 3, -1);
+    dtl_manifest_add_mapping(manifest, 2, 7, -1, 4);
+    dtl_manifest_add_sample(manifest, 7, 8);
+    dtl_manifest_add_grouping(manifest, 3, 9, 10);
+
+    dtl_assert(dtl_manifest_write(manifest, path, &error) == DTL_STATUS_OK);
+    dtl_manifest_destroy(manifest);
+
+    mapped = dtl_manifest_map(path, &error);
+    dtl_assert(mapped != NULL);
+
+    dtl_assert(mapped->num_sources == 1);
+    dtl_assert(strcmp(mapped->sources[0].text, "WITH input AS IMPORT 'input';") == 0);
+    dtl_assert(strcmp(mapped->sources[0].filename, "script.dtl") == 0);
+
+    dtl_assert(mapped->num_inputs == 2);
+    dtl_assert(strcmp(mapped->inputs[1].table, "input") == 0);
+    dtl_assert(strcmp(mapped->inputs[1].column, "b") == 0);
+    dtl_assert(mapped->inputs[1].array == 2);
+
+    dtl_assert(mapped->num_outputs == 1);
+    dtl_assert(strcmp(mapped->outputs[0].column, "c") == 0);
+    dtl_assert(mapped->outputs[0].array == 7);
+
+    dtl_assert(mapped->num_traces == 1);
+    dtl_assert(strcmp(mapped->traces[0].filename, "script.dtl") == 0);
+    dtl_assert(mapped->traces[0].start_offset == 5);
+    dtl_assert(mapped->traces[0].end_offset == 28);
+    dtl_assert(strcmp(mapped->traces[0].column, "a") == 0);
+
+    dtl_assert(mapped->num_mappings == 2);
+    dtl_assert(mapped->mappings[0].src_index_array == 3);
+    dtl_assert(mapped->mappings[0].tgt_index_array == -1);
+    dtl_assert(mapped->mappings[1].src_array == 2);
+    dtl_assert(mapped->mappings[1].tgt_index_array == 4);
+
+    dtl_assert(mapped->num_samples == 1);
+    dtl_assert(mapped->samples[0].rows_array == 8);
+
+    dtl_assert(mapped->num_groupings == 1);
+    dtl_assert(mapped->groupings[0].array == 3);
+    dtl_assert(mapped->groupings[0].offsets_array == 9);
+    dtl_assert(mapped->groupings[0].entries_array == 10);
+
+    dtl_manifest_destroy(mapped);
+
+    // Truncated files are rejected rather than read past the end.
+    dtl_assert(truncate(path, 200) == 0);
+    dtl_assert(dtl_manifest_map(path, &error) == NULL);
+    dtl_assert(error != NULL);
+    dtl_error_destroy(error);
+    error = NULL;
+
+    file = fopen(path, "w");
+    fputs("not a manifest", file);
+    fclose(file);
+    dtl_assert(dtl_manifest_map(path, &error) == NULL);
+    dtl_error_destroy(error);
+
+    unlink(path);
+}
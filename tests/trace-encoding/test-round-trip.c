@@ -0,0 +1,106 @@
+#include "dtl-test.h"
+
+#include "dtl-bool-array.h"
+#include "dtl-trace-encoding.h"
+#include <stdlib.h>
+
+#define SIZE 300
+
+static void
+check_index_round_trip(struct dtl_trace_segment *segment, size_t const *indexes, enum dtl_trace_encoding encoding) {
+    size_t decoded[SIZE];
+    size_t i;
+
+    dtl_trace_encode_index_segment(segment, indexes, SIZE);
+    dtl_assert(segment->encoding == encoding);
+
+    dtl_trace_decode_index_segment(segment, decoded);
+    for (i = 0; i < SIZE; i++) {
+        dtl_assert(decoded[i] == indexes[i]);
+    }
+}
+
+static void
+check_mask_round_trip(struct dtl_trace_segment *segment, void const *mask, enum dtl_trace_encoding encoding) {
+    void *decoded;
+    size_t i;
+
+    // Encode from, and decode to, an offset that does not line up with a chunk.
+    dtl_trace_encode_mask_segment(segment, mask, 5, SIZE - 5);
+    dtl_assert(segment->encoding == encoding);
+
+    decoded = dtl_bool_array_create(SIZE + 3);
+    dtl_trace_decode_mask_segment(segment, decoded, 3);
+    for (i = 5; i < SIZE; i++) {
+        dtl_assert(dtl_bool_array_get(decoded, i - 2) == dtl_bool_array_get(mask, i));
+    }
+    dtl_bool_array_destroy(decoded, SIZE + 3);
+}
+
+int
+main(int argc, char **argv) {
+    struct dtl_trace_segment *segment;
+    size_t indexes[SIZE];
+    void *mask;
+    size_t i;
+
+    (void) argc;
+    (void) argv;
+
+    segment = dtl_trace_segment_create(SIZE);
+
+    // Identity.
+    for (i = 0; i < SIZE; i++) {
+        indexes[i] = i;
+    }
+    check_index_round_trip(segment, indexes, DTL_TRACE_ENCODING_SEQUENCES);
+    dtl_assert(segment->num_entries == 1);
+
+    // Left side of a join.
+    for (i = 0; i < SIZE; i++) {
+        indexes[i] = 1000 + i / 30;
+    }
+    check_index_round_trip(segment, indexes, DTL_TRACE_ENCODING_SEQUENCES);
+    dtl_assert(segment->num_entries == 10);
+
+    // Right side of a join.
+    for (i = 0; i < SIZE; i++) {
+        indexes[i] = 40 + i % 30;
+    }
+    check_index_round_trip(segment, indexes, DTL_TRACE_ENCODING_SEQUENCES);
+
+    // Filtered.
+    for (i = 0; i < SIZE; i++) {
+        indexes[i] = 5000000000 + i * 7 + (size_t)rand() % 5;
+    }
+    check_index_round_trip(segment, indexes, DTL_TRACE_ENCODING_OFFSETS);
+
+    // Unstructured.
+    for (i = 0; i < SIZE; i++) {
+        indexes[i] = (size_t)rand() * (size_t)rand() * (size_t)rand();
+    }
+    check_index_round_trip(segment, indexes, DTL_TRACE_ENCODING_PLAIN);
+
+    mask = dtl_bool_array_create(SIZE);
+
+    // Long runs, starting with true.
+    for (i = 0; i < SIZE; i++) {
+        dtl_bool_array_set(mask, i, (i / 100) % 2 == 0);
+    }
+    check_mask_round_trip(segment, mask, DTL_TRACE_ENCODING_RUNS);
+
+    // Sparse.
+    for (i = 0; i < SIZE; i++) {
+        dtl_bool_array_set(mask, i, i % 97 == 1);
+    }
+    check_mask_round_trip(segment, mask, DTL_TRACE_ENCODING_POSITIONS);
+
+    // Dense.
+    for (i = 0; i < SIZE; i++) {
+        dtl_bool_array_set(mask, i, rand() % 2);
+    }
+    check_mask_round_trip(segment, mask, DTL_TRACE_ENCODING_BITMAP);
+
+    dtl_bool_array_destroy(mask, SIZE);
+    dtl_trace_segment_destroy(segment);
+}